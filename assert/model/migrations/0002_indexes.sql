@@ -0,0 +1,75 @@
+-- 视图引用了GamePlayerItems，重建表之前先删除，最后以显式JOIN重新创建
+DROP VIEW IF EXISTS GamePlayerItemsView;
+DROP VIEW IF EXISTS GameItemsView;
+
+
+-- Table: GamePlayerItems
+-- itemId改为引用GameItems；以(playerId, itemId)为聚簇主键，按玩家载入背包时为连续的范围读取
+CREATE TABLE GamePlayerItems_new (
+    playerId     INTEGER NOT NULL
+                         REFERENCES GamePlayer (playerId),
+    itemId       INTEGER NOT NULL
+                         REFERENCES GameItems (itemId),
+    itemAmount   INTEGER NOT NULL,
+    itemLocation INTEGER NOT NULL,
+    PRIMARY KEY (
+        playerId,
+        itemId
+    )
+)
+WITHOUT ROWID;
+
+INSERT INTO GamePlayerItems_new (playerId, itemId, itemAmount, itemLocation)
+    SELECT playerId, itemId, itemAmount, itemLocation FROM GamePlayerItems;
+
+DROP TABLE GamePlayerItems;
+ALTER TABLE GamePlayerItems_new RENAME TO GamePlayerItems;
+
+
+-- Index: 按玩家与位置读取背包，包含itemAmount以覆盖查询（主键列itemId自动包含在索引中）
+CREATE INDEX IF NOT EXISTS GamePlayerItemsByLocation ON GamePlayerItems (
+    playerId,
+    itemLocation,
+    itemAmount
+);
+
+-- Index: 按物品查找持有者，同时用于删除GameItems时的外键检查
+CREATE INDEX IF NOT EXISTS GamePlayerItemsByItem ON GamePlayerItems (
+    itemId
+);
+
+-- Index: 按基础物品查找物品实例，同时用于删除BasicItems时的外键检查
+CREATE INDEX IF NOT EXISTS GameItemsByBase ON GameItems (
+    itemBaseId
+);
+
+
+-- View: GameItemsView
+CREATE VIEW GameItemsView AS
+    SELECT GameItems.itemId AS itemId,
+           GameItems.itemBaseId AS itemBaseId,
+           COALESCE(GameItems.itemName, BasicItems.itemName) AS itemName,
+           BasicItems.itemCateogory AS itemCateogory,
+           BasicItems.itemDescribe AS itemDescribe,
+           COALESCE(GameItems.itemProperties, BasicItems.itemProperties) AS itemProperties
+      FROM GameItems
+           INNER JOIN
+           BasicItems ON BasicItems.itemBaseId = GameItems.itemBaseId;
+
+
+-- View: GamePlayerItemsView
+CREATE VIEW GamePlayerItemsView AS
+    SELECT GamePlayerItems.playerId AS playerId,
+           GamePlayerItems.itemId AS itemId,
+           GamePlayerItems.itemAmount AS itemAmount,
+           GamePlayerItems.itemLocation AS itemLocation,
+           GameItems.itemBaseId AS itemBaseId,
+           BasicItems.itemCateogory AS itemCateogory,
+           BasicItems.itemDescribe AS itemDescribe,
+           COALESCE(GameItems.itemName, BasicItems.itemName) AS itemName,
+           COALESCE(GameItems.itemProperties, BasicItems.itemProperties) AS itemProperties
+      FROM GamePlayerItems
+           INNER JOIN
+           GameItems ON GameItems.itemId = GamePlayerItems.itemId
+           INNER JOIN
+           BasicItems ON BasicItems.itemBaseId = GameItems.itemBaseId;
@@ -1,21 +1,21 @@
 #include "context.hpp"
 
+#include <chrono>
 #include <cinttypes>
+#include <ctime>
 #include <iterator>
 #include <string>
 #include <string_view>
 #include <system_error>
 #include <filesystem>
 #include <vector>
-#include <fstream>
 
-#include "cppcrc/encoder.hh"
-#include "cppcrc/code_crc32.hh"
+#include "storage/migration.hpp"
 
 using namespace core;
 
 Context::Context(const LoggerBase::SharedPtr &logger, std::string_view rootDir)
-    : mLogger(logger), mRootDir(rootDir)
+    : mLogger(logger), mRootDir(rootDir), mAssetManifest(std::make_unique<AssetManifest>(logger, std::string(rootDir))), mQueryProfiler(std::make_unique<QueryProfiler>(logger)), mSnapshot(std::make_unique<DatabaseSnapshot>(logger)), mBasicItemsCatalog(std::make_unique<BasicItemsCatalog>()), mFormulaCache(std::make_unique<FormulaCache>(logger))
 {
 }
 
@@ -28,7 +28,7 @@ bool Context::initDirectories() noexcept
 {
     std::error_code ec;
     
-    std::vector<std::filesystem::path> dirs {fmt::format("{}/db", mRootDir), fmt::format("{}/cache/journal", mRootDir)};
+    std::vector<std::filesystem::path> dirs {fmt::format("{}/db", mRootDir), fmt::format("{}/cache/journal", mRootDir), fmt::format("{}/cache/snapshot", mRootDir)};
 
     for (auto &dir : dirs) {
         if (!std::filesystem::exists(dir)) {
@@ -47,46 +47,69 @@ bool Context::initDirectories() noexcept
     return true;
 }
 
-bool Context::initDBStruct() noexcept {
+bool Context::verifyAssets() noexcept
+{
+    if (!mAssetManifest->verify()) {
+        fatalError("Context::verifyAssets", "asset integrity check failed");
+        return false;
+    }
 
-    constexpr std::pair<std::string_view, uint32_t> files[] = {
-        {"game.sql", 1422224050}
-    };
+    return true;
+}
 
+bool Context::initDBStruct() noexcept
+{
+    if (!migration::apply(mGameDatabase, mLogger)) {
+        fatalError("Context::initDBStruct", "failed to migrate database schema");
+        return false;
+    }
 
-    for (auto &file : files) {
-        std::ifstream ifs(fmt::format("{}/db/struct/{}", mRootDir, file.first), std::ios::binary);
-        if (!ifs) {
-            fatalError("Context::initDBStruct", "Unable to open {}", file.first);
-            return false;
-        }
+    return true;
+}
 
-        std::string sql(std::istreambuf_iterator<char>(ifs), {});
-        
-        auto crcValue = crc::Encoder(crc::CodeCrc32::instance(), sql).value();
+bool Context::openGameDatabase() noexcept
+{
+    auto path = fmt::format("{}/db/game.db", mRootDir);
+    mGameDatabaseUri.clear();
 
-        ifs.close();
+    if (mDatabaseOptions.mode == DatabaseMode::disk) {
+        return mGameDatabase.open(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    }
 
-        if (crcValue != file.second) {
-            fatalError("Context::initDBStruct", "CRC check of {} fails. crc value: {}", file.first, crcValue);
-            return false;
-        } else {
-            mLogger->debug("Context::initDBStruct", "{} passes the CRC check ", file.first);
-        }
+    bool opened = false;
+    if (mDatabaseOptions.mode == DatabaseMode::sharedMemory) {
+        //以Context地址区分同一进程中的多个游戏环境
+        mGameDatabaseUri = fmt::format("file:kgame-{}?mode=memory&cache=shared", static_cast<const void*>(this));
+        opened = mGameDatabase.open(mGameDatabaseUri, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI);
+    } else {
+        opened = mGameDatabase.open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    }
 
-        if (!mGameDatabase.begin_transaction().exec(sql)) {
-            fatalError("Context::initDBStruct", "{} fails to be executed", file.first);
-            return false;
-        } else {
-            mLogger->debug("Context::initDBStruct", "exec {} completed", file.first);
-        }
+    if (!opened) {
+        return false;
+    }
+
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        mLogger->info("Context::openGameDatabase", "{} does not exist, start with an empty memory database", path);
+        return true;
     }
- 
 
+    //从磁盘文件载入，内存数据库此时还未被使用，一次复制全部页
+    auto begin = std::chrono::steady_clock::now();
+    sqlite::database_manager disk(path, SQLITE_OPEN_READONLY);
+    if (!disk.backup(mGameDatabase, -1, [](int32_t, int32_t) { return true; })) {
+        mLogger->error("Context::openGameDatabase", "failed to load {} into memory", path);
+        return false;
+    }
+    disk.close();
+
+    mLogger->info("Context::openGameDatabase", "{} loaded into memory in {} ms", path,
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count());
     return true;
 }
 
-bool Context::init()
+bool Context::init(const DatabaseOptions& options, const AssetManifest::Options& assets)
 {
     if (isRunning()) {
         mLogger->debug("Context::init", "running...");
@@ -102,29 +125,98 @@ bool Context::init()
     if (!initDirectories()) {
         return false;
     }
+
+    mAssetManifest = std::make_unique<AssetManifest>(mLogger, mRootDir, assets);
+    if (!verifyAssets()) {
+        return false;
+    }
     
-    if (!mGameDatabase.open(fmt::format("{}/db/game.db", mRootDir), SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)) {
+    mDatabaseOptions = options;
+    if (!openGameDatabase()) {
         fatalError("Context::start", "failed to open database");
         return false;
     }
 
+    mQueryProfiler->attach(mGameDatabase);
+
     if (!initDBStruct()) {
         mLogger->error("Context::init", "error init database struct");
         return false;
     }
 
-    if (mGameDatabase.begin_transaction().exec("PRAGMA foreign_keys = ON;")) {
-        mGameStatus = GameStatus::running;
-    } else {
+    //foreign_keys在事务中设置无效，必须在事务外执行
+    if (!mGameDatabase.exec("PRAGMA foreign_keys = ON;")) {
         fatalError("Context::start", "exec 'PRAGMA foreign_keys = ON' failure");
+        return false;
+    }
+
+    if (!mBasicItemsCatalog->load(mGameDatabase)) {
+        fatalError("Context::init", "failed to load basic items catalog");
+        return false;
+    }
+
+    mItemIds = std::make_unique<IdAllocator>(mGameDatabase, mLogger, "GameItems");
+    mPlayerIds = std::make_unique<IdAllocator>(mGameDatabase, mLogger, "GamePlayer");
+
+    mWriteQueue = std::make_unique<WriteBehindQueue>(mGameDatabase, mLogger);
+    if (!mWriteQueue->start()) {
+        fatalError("Context::init", "failed to start write behind queue");
+        return false;
+    }
+
+    mPlayers = std::make_unique<PlayerWorkingSet>(mGameDatabase, mLogger);
+    if (!mPlayers->start(mWriteQueue.get())) {
+        fatalError("Context::init", "failed to start player working set");
+        return false;
     }
 
+    if (mDatabaseOptions.mode != DatabaseMode::disk) {
+        //先写回一次，使磁盘文件包含迁移后的结构
+        mCheckpoint = std::make_unique<DatabaseCheckpoint>(mLogger, mDatabaseOptions.checkpoint);
+        if (!mCheckpoint->start(mGameDatabase, fmt::format("{}/db/game.db", mRootDir), mDatabaseOptions.checkpointInterval)
+            || !mCheckpoint->checkpoint()) {
+            fatalError("Context::init", "failed to start database checkpoint");
+            return false;
+        }
+    }
+
+    mGameStatus = GameStatus::running;
+
     return isRunning();
 }
 
+bool Context::snapshot(DatabaseSnapshot::Completion completion)
+{
+    if (!isRunning()) {
+        return false;
+    }
+
+    auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm tm {};
+#ifdef _WIN32
+    localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
+
+    char name[32];
+    std::strftime(name, sizeof(name), "game-%Y%m%d-%H%M%S.db", &tm);
+
+    return mSnapshot->start(mGameDatabase, fmt::format("{}/cache/snapshot/{}", mRootDir, name), std::move(completion));
+}
+
 bool Context::close()
 {
     if (isRunning()) {
+        //先将玩家的修改推入队列，再提交队列中剩余的变更，最后关闭数据库
+        mPlayers->stop();
+        mWriteQueue->stop();
+        mSnapshot->cancel();
+        mSnapshot->wait();
+        if (mCheckpoint && !mCheckpoint->stop()) {
+            mLogger->error("Context::close", "final checkpoint failed, changes since the last checkpoint are lost");
+        }
+        mQueryProfiler->detach();
         mGameStatus = mGameDatabase.close() ? GameStatus::shutoff : mGameStatus;
     }
     return mGameStatus == GameStatus::shutoff;
@@ -4,14 +4,24 @@
 #include <memory>
 #include <mutex>
 #include <stdint.h>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <utility>
 
 #include "context_fwd.hpp"
+#include "formula/formula_cache.hpp"
+#include "items/basic_items_catalog.hpp"
 #include "logger/logger.hpp"
 #include "manager_base.hpp"
+#include "player/player_working_set.hpp"
 #include "sqlite/sqlite3.hpp"
+#include "storage/asset_manifest.hpp"
+#include "storage/database_checkpoint.hpp"
+#include "storage/database_snapshot.hpp"
+#include "storage/id_allocator.hpp"
+#include "storage/query_profiler.hpp"
+#include "storage/write_behind_queue.hpp"
 
 namespace core {
 
@@ -38,11 +48,47 @@ private:
     //游戏数据库
     sqlite::database_manager mGameDatabase;
 
+    //资源文件完整性清单
+    std::unique_ptr<AssetManifest> mAssetManifest;
+
+    //游戏数据库运行模式
+    DatabaseOptions mDatabaseOptions;
+
+    //共享内存模式下游戏数据库的URI
+    std::string mGameDatabaseUri;
+
+    //内存模式下游戏数据库的定期写回
+    std::unique_ptr<DatabaseCheckpoint> mCheckpoint;
+
+    //游戏数据库延迟写入队列
+    std::unique_ptr<WriteBehindQueue> mWriteQueue;
+
+    //游戏数据库语句耗时统计
+    std::unique_ptr<QueryProfiler> mQueryProfiler;
+
+    //游戏数据库在线快照
+    std::unique_ptr<DatabaseSnapshot> mSnapshot;
+
+    //基础物品目录缓存
+    std::unique_ptr<BasicItemsCatalog> mBasicItemsCatalog;
+
+    //物品与技能公式的编译缓存
+    std::unique_ptr<FormulaCache> mFormulaCache;
+
+    //已载入内存的玩家
+    std::unique_ptr<PlayerWorkingSet> mPlayers;
+
+    //游戏物品与玩家的id分配器
+    std::unique_ptr<IdAllocator> mItemIds;
+    std::unique_ptr<IdAllocator> mPlayerIds;
+
     LoggerBase::SharedPtr mLogger;
 
     explicit Context(const LoggerBase::SharedPtr &logger, std::string_view rootDir);
 
     bool initDirectories() noexcept;
+    bool verifyAssets() noexcept;
+    bool openGameDatabase() noexcept;
     bool initDBStruct() noexcept;
 
 public:
@@ -51,7 +97,13 @@ public:
     Context(const Context&) = delete;
     Context& operator=(const Context&) = delete;
 
-    bool init();
+    /**
+     * @brief 初始化游戏环境
+     * @param options 游戏数据库运行模式，内存模式下数据库在启动时从db/game.db载入，
+     * 并按options.checkpointInterval定期以及在close时写回
+     * @param assets 资源文件校验选项，发布新资源后以acceptChanges为true启动一次以重建清单
+     */
+    bool init(const DatabaseOptions& options = DatabaseOptions(), const AssetManifest::Options& assets = AssetManifest::Options());
     bool close();
 
     /**
@@ -95,6 +147,119 @@ public:
         return mGameDatabase;
     }
 
+    /**
+     * @brief 取得共享内存模式下游戏数据库的URI
+     * 同一进程中的其它连接以SQLITE_OPEN_URI打开该URI即可访问同一个内存数据库
+     * @return 若不是共享内存模式则返回空字符串
+     */
+    const std::string& getGameDBUri() const noexcept
+    {
+        return mGameDatabaseUri;
+    }
+
+    /**
+     * @brief 取得资源文件完整性清单
+     * 在init时校验，之后可查询各资源文件的CRC32与MD5
+     */
+    const AssetManifest& getAssetManifest() const noexcept
+    {
+        return *mAssetManifest;
+    }
+
+    /**
+     * @brief 取得游戏数据库的延迟写入队列
+     * @return 若游戏未运行则返回nullptr
+     */
+    WriteBehindQueue* getWriteQueue() noexcept
+    {
+        return isRunning() ? mWriteQueue.get() : nullptr;
+    }
+
+    /**
+     * @brief 取得游戏数据库的语句耗时统计
+     * 可通过其调整慢查询阈值，或dump出统计数据
+     */
+    QueryProfiler& getQueryProfiler() noexcept
+    {
+        return *mQueryProfiler;
+    }
+
+    /**
+     * @brief 在后台为游戏数据库创建在线快照
+     * 快照写入 cache/snapshot/game-<时间>.db，期间游戏可以正常读写数据库
+     * @param completion 在后台线程中以快照结果调用
+     * @return 若游戏未运行或已有快照正在进行则返回false
+     */
+    bool snapshot(DatabaseSnapshot::Completion completion = nullptr);
+
+    /**
+     * @brief 取得在线快照的状态，可用于查询进度
+     */
+    const DatabaseSnapshot& getSnapshot() const noexcept
+    {
+        return *mSnapshot;
+    }
+
+    /**
+     * @brief 取得内存模式下的写回状态
+     * @return 若不是内存模式则返回nullptr
+     */
+    const DatabaseCheckpoint* getCheckpoint() const noexcept
+    {
+        return mCheckpoint.get();
+    }
+
+    /**
+     * @brief 取得基础物品目录缓存
+     * 游戏运行期间与BasicItems表保持一致，可无锁读取
+     */
+    BasicItemsCatalog& getBasicItemsCatalog() noexcept
+    {
+        return *mBasicItemsCatalog;
+    }
+    const BasicItemsCatalog& getBasicItemsCatalog() const noexcept
+    {
+        return *mBasicItemsCatalog;
+    }
+
+    /**
+     * @brief 取得公式缓存
+     * 不依赖游戏运行状态，可在任意线程中使用
+     */
+    FormulaCache& getFormulaCache() noexcept
+    {
+        return *mFormulaCache;
+    }
+
+    /**
+     * @brief 取得玩家工作集
+     * @return 若游戏未运行则返回nullptr
+     */
+    PlayerWorkingSet* getPlayerWorkingSet() noexcept
+    {
+        return isRunning() ? mPlayers.get() : nullptr;
+    }
+
+    /**
+     * @brief 取得游戏物品id分配器
+     * 分配的id可直接用于GameItems.itemId，记录可以稍后再写入
+     * @return 若游戏未运行则返回nullptr
+     */
+    IdAllocator* getItemIdAllocator() noexcept
+    {
+        return isRunning() ? mItemIds.get() : nullptr;
+    }
+
+    /**
+     * @brief 取得玩家id分配器
+     * 分配的id可直接用于GamePlayer.playerId，新玩家由PlayerManager::createPlayer经此分配
+     * @return 若游戏未运行则返回nullptr
+     */
+    IdAllocator* getPlayerIdAllocator() noexcept
+    {
+        return isRunning() ? mPlayerIds.get() : nullptr;
+    }
+
     /**
      * @brief 取得对应管理器
      */
@@ -0,0 +1,385 @@
+#include "formula_cache.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <sstream>
+
+#include "lepton/ParsedExpression.h"
+#include "lepton/Parser.h"
+
+using namespace core;
+
+namespace {
+
+//提升的常量在表达式中的变量名前缀，公式本身不能使用以此开头的变量名
+constexpr char kConstantPrefix = '$';
+
+//每个表达式节点编译后占用内存的估算值（运算对象、工作区与参数表）
+constexpr size_t kBytesPerNode = 96;
+
+bool isOperator(char c) noexcept
+{
+    return c == '+' || c == '-' || c == '*' || c == '/' || c == '^';
+}
+
+bool isDelimiter(char c) noexcept
+{
+    return isOperator(c) || c == '(' || c == ')' || c == ',' || std::isspace(static_cast<unsigned char>(c));
+}
+
+bool isNumberStart(char c) noexcept
+{
+    return c == '.' || std::isdigit(static_cast<unsigned char>(c));
+}
+
+/**
+ * @brief 与Lepton::Parser相同的规则取得数值的长度
+ */
+size_t numberLength(std::string_view text, size_t start) noexcept
+{
+    bool foundDecimal = text[start] == '.';
+    bool foundExp = false;
+    size_t pos = start + 1;
+    for (; pos < text.size(); ++pos) {
+        auto c = text[pos];
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            continue;
+        }
+        if (c == '.' && !foundDecimal) {
+            foundDecimal = true;
+            continue;
+        }
+        if ((c == 'e' || c == 'E') && !foundExp) {
+            foundExp = true;
+            if (pos + 1 < text.size() && (text[pos + 1] == '-' || text[pos + 1] == '+')) {
+                ++pos;
+            }
+            continue;
+        }
+        break;
+    }
+    return pos - start;
+}
+
+/**
+ * @brief 数值常量是否参与Lepton的化简
+ * Lepton会化简乘以0、加0、0作被除数、乘以1、1作被除数与以0、1为底的乘方，
+ * 这些常量提升为参数后不再化简，无穷大与NaN的结果会因是否提升而不同，因此保留原文
+ */
+bool isFoldedConstant(std::string_view token)
+{
+    auto value = std::strtod(std::string(token).c_str(), nullptr);
+    return value == 0.0 || value == 1.0;
+}
+
+/**
+ * @brief 取得提升的常量的序号
+ * @return 若不是提升的常量则返回SIZE_MAX
+ */
+size_t constantIndex(std::string_view name) noexcept
+{
+    if (name.size() < 2 || name[0] != kConstantPrefix) {
+        return SIZE_MAX;
+    }
+    size_t index = 0;
+    for (auto c : name.substr(1)) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) {
+            return SIZE_MAX;
+        }
+        index = index * 10 + static_cast<size_t>(c - '0');
+    }
+    return index;
+}
+
+size_t countNodes(const Lepton::ExpressionTreeNode& node) noexcept
+{
+    size_t count = 1;
+    for (auto& child : node.getChildren()) {
+        count += countNodes(child);
+    }
+    return count;
+}
+
+}
+
+int FormulaCache::Formula::getVariableIndex(std::string_view name) const noexcept
+{
+    auto& variables = mProgram->variables;
+    for (size_t i = 0; i < variables.size(); ++i) {
+        if (variables[i] == name) {
+            return mProgram->variableIndices[i];
+        }
+    }
+    return -1;
+}
+
+Lepton::EvaluationContext FormulaCache::Formula::createContext() const
+{
+    auto context = mProgram->expression.createContext();
+    for (size_t i = 0; i < mConstants.size(); ++i) {
+        auto index = mProgram->constantIndices[i];
+        if (index >= 0) {
+            context.setVariable(index, mConstants[i]);
+        }
+    }
+    return context;
+}
+
+FormulaCache::FormulaCache(LoggerBase::SharedPtr logger, const Options& options)
+    : mLogger(std::move(logger))
+    , mOptions(options)
+{
+}
+
+FormulaCache::FormulaPtr FormulaCache::get(std::string_view source)
+{
+    mLookups.fetch_add(1, std::memory_order_relaxed);
+
+    std::string text;
+    if (!normalize(source, text, nullptr, nullptr)) {
+        mFailures.fetch_add(1, std::memory_order_relaxed);
+        mLogger->error("FormulaCache::get", "formula '{}' uses a reserved variable name", source);
+        return nullptr;
+    }
+
+    auto& shard = mShards[std::hash<std::string> {}(text) % kShards];
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.formulas.find(text);
+        if (it != shard.formulas.end()) {
+            mHits.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+
+    //未命中时才提升常量，常量与Lepton::Parser以相同的方式读取，以得到完全相同的值
+    //没有可提升的常量时，程序只属于这一个公式，不经过共享程序的查找
+    std::shared_ptr<const Program> program;
+    std::vector<double> constants;
+    bool shared = false;
+    if (mOptions.hoistConstants) {
+        std::string normalized, shape;
+        std::vector<std::string_view> literals;
+        normalize(text, normalized, &shape, &literals);
+
+        if (!literals.empty()) {
+            constants.resize(literals.size());
+            for (size_t i = 0; i < literals.size(); ++i) {
+                std::istringstream(std::string(literals[i])) >> constants[i];
+            }
+            program = sharedProgram(shape, constants.size());
+            shared = true;
+        }
+    }
+    if (!shared) {
+        program = compile(text, 0);
+    }
+
+    FormulaPtr formula;
+    if (program) {
+        auto created = std::make_shared<Formula>();
+        created->mText = text;
+        created->mConstants = std::move(constants);
+        created->mProgram = std::move(program);
+        formula = std::move(created);
+    }
+
+    auto capacity = (mOptions.maxFormulas + kShards - 1) / kShards;
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.formulas.find(text);
+    if (it != shard.formulas.end()) {
+        return it->second;
+    }
+    if (shard.formulas.size() >= capacity) {
+        lock.unlock();
+        mUncached.fetch_add(1, std::memory_order_relaxed);
+        reportFull();
+        return formula;
+    }
+
+    it = shard.formulas.emplace(std::move(text), std::move(formula)).first;
+    shard.memoryUsage += it->first.capacity() * (it->second ? 2 : 1) + sizeof(std::string) + sizeof(FormulaPtr);
+    if (it->second) {
+        shard.memoryUsage += sizeof(Formula) + it->second->mConstants.capacity() * sizeof(double);
+        if (!shared) {
+            ++shard.programs;
+            shard.memoryUsage += it->second->mProgram->memoryUsage;
+        }
+    }
+    return it->second;
+}
+
+std::shared_ptr<const FormulaCache::Program> FormulaCache::sharedProgram(const std::string& shape, size_t constantCount)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mProgramsMutex);
+        auto it = mPrograms.find(shape);
+        if (it != mPrograms.end()) {
+            if (it->second) {
+                mSharedPrograms.fetch_add(1, std::memory_order_relaxed);
+            }
+            return it->second;
+        }
+    }
+
+    //在锁外编译，并发编译同一结构时以先插入的为准
+    auto program = compile(shape, constantCount);
+
+    std::unique_lock<std::shared_mutex> lock(mProgramsMutex);
+    auto it = mPrograms.find(shape);
+    if (it != mPrograms.end()) {
+        return it->second;
+    }
+    if (mPrograms.size() < mOptions.maxFormulas) {
+        mPrograms.emplace(shape, program);
+        mProgramsMemoryUsage += shape.capacity() + (program ? program->memoryUsage : 0);
+    }
+    return program;
+}
+
+void FormulaCache::reportFull()
+{
+    if (!mFullReported.exchange(true, std::memory_order_relaxed)) {
+        mLogger->warn("FormulaCache::get", "formula cache is full ({} formulas), new formulas are no longer cached", mOptions.maxFormulas);
+    }
+}
+
+FormulaCache::Statistics FormulaCache::statistics() const
+{
+    Statistics statistics;
+    statistics.lookups = mLookups.load(std::memory_order_relaxed);
+    statistics.hits = mHits.load(std::memory_order_relaxed);
+    statistics.sharedPrograms = mSharedPrograms.load(std::memory_order_relaxed);
+    statistics.compilations = mCompilations.load(std::memory_order_relaxed);
+    statistics.failures = mFailures.load(std::memory_order_relaxed);
+    statistics.uncached = mUncached.load(std::memory_order_relaxed);
+
+    for (auto& shard : mShards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        statistics.formulas += shard.formulas.size();
+        statistics.programs += shard.programs;
+        statistics.memoryUsage += shard.memoryUsage;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mProgramsMutex);
+    statistics.programs += mPrograms.size();
+    statistics.memoryUsage += mProgramsMemoryUsage;
+    return statistics;
+}
+
+void FormulaCache::clear()
+{
+    for (auto& shard : mShards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.formulas.clear();
+        shard.programs = 0;
+        shard.memoryUsage = 0;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mProgramsMutex);
+    mPrograms.clear();
+    mProgramsMemoryUsage = 0;
+    mFullReported.store(false, std::memory_order_relaxed);
+}
+
+bool FormulaCache::normalize(std::string_view source, std::string& text, std::string* shape, std::vector<std::string_view>* literals) const
+{
+    text.reserve(source.size());
+    if (shape != nullptr) {
+        shape->reserve(source.size());
+    }
+
+    //上一个记号是变量名或数值时，与下一个变量名或数值之间保留一个空格，以免改变原本的解析结果
+    bool lastWord = false;
+    bool pendingSpace = false;
+    //指数中的常量不提升，Lepton会将其优化为整数次幂
+    char last = 0, beforeLast = 0;
+
+    size_t pos = 0;
+    while (pos < source.size()) {
+        auto c = source[pos];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pendingSpace = true;
+            ++pos;
+            continue;
+        }
+
+        size_t length = 1;
+        bool word = false;
+        bool number = false;
+        if (isNumberStart(c)) {
+            length = numberLength(source, pos);
+            word = number = true;
+        } else if (!isDelimiter(c)) {
+            if (c == kConstantPrefix) {
+                return false;
+            }
+            while (pos + length < source.size() && !isDelimiter(source[pos + length]) && source[pos + length] != '(') {
+                ++length;
+            }
+            word = true;
+        }
+
+        auto space = pendingSpace && lastWord && word;
+        pendingSpace = false;
+
+        auto token = source.substr(pos, length);
+        if (space) {
+            text.push_back(' ');
+        }
+        text.append(token);
+
+        if (shape != nullptr) {
+            if (space) {
+                shape->push_back(' ');
+            }
+            bool exponent = last == '^' || ((last == '-' || last == '+') && beforeLast == '^');
+            if (number && mOptions.hoistConstants && !exponent && !isFoldedConstant(token)) {
+                shape->push_back(kConstantPrefix);
+                shape->append(std::to_string(literals->size()));
+                literals->push_back(token);
+            } else {
+                shape->append(token);
+            }
+        }
+
+        beforeLast = last;
+        last = word ? 'a' : c;
+        lastWord = word;
+        pos += length;
+    }
+    return true;
+}
+
+std::shared_ptr<const FormulaCache::Program> FormulaCache::compile(const std::string& shape, size_t constantCount)
+{
+    auto program = std::make_shared<Program>();
+    try {
+        auto parsed = Lepton::Parser::parse(shape);
+        program->expression = parsed.createCompiledExpression();
+        program->memoryUsage = sizeof(Program) + countNodes(parsed.getRootNode()) * kBytesPerNode;
+    } catch (const std::exception& e) {
+        mFailures.fetch_add(1, std::memory_order_relaxed);
+        mLogger->error("FormulaCache::compile", "failed to compile formula '{}': {}", shape, e.what());
+        return nullptr;
+    }
+    mCompilations.fetch_add(1, std::memory_order_relaxed);
+
+    auto& expression = program->expression;
+    program->constantIndices.assign(constantCount, -1);
+    for (auto& name : expression.getVariables()) {
+        auto index = expression.getVariableIndex(name);
+        auto constant = constantIndex(name);
+        if (constant < constantCount) {
+            program->constantIndices[constant] = index;
+        } else {
+            program->variables.push_back(name);
+            program->variableIndices.push_back(index);
+        }
+        program->memoryUsage += name.capacity();
+    }
+    return program;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "lepton/CompiledExpression.h"
+#include "logger/logger.hpp"
+
+namespace core {
+
+/**
+ * @brief 公式缓存
+ * 以规范化后的表达式文本为键，相同的公式在进程内只解析、编译一次
+ *
+ * 开启常量提升时，公式中的数值常量被替换为参数（指数中的常量除外，以保留整数次幂的优化；0与1除外，以保留与之相关的化简），
+ * 结构相同、仅常量不同的公式共享同一个编译后的程序，各公式只保存自己的常量值
+ *
+ * 公式中的变量名不能以$开头，这些名字保留给提升的常量
+ *
+ * 缓存的公式数有上限，达到上限后新的公式仍然解析并返回，但不再缓存
+ *
+ * 查找可在任意线程并发进行，取得的Formula不可变，可在多个线程间共享
+ */
+class FormulaCache {
+public:
+    struct Options {
+        //将数值常量提升为参数，使仅常量不同的公式共享编译结果
+        bool hoistConstants = true;
+        //最多缓存的公式数，编译后的程序数同样受此限制
+        size_t maxFormulas = 65536;
+    };
+
+    struct Statistics {
+        uint64_t lookups = 0;
+        //命中已缓存的公式
+        uint64_t hits = 0;
+        //未命中公式，但共享了已编译的程序
+        uint64_t sharedPrograms = 0;
+        uint64_t compilations = 0;
+        uint64_t failures = 0;
+        //缓存已满而没有缓存的公式
+        uint64_t uncached = 0;
+        size_t formulas = 0;
+        size_t programs = 0;
+        //缓存占用内存的估算值
+        size_t memoryUsage = 0;
+    };
+
+    /**
+     * @brief 编译后的程序，由结构相同的公式共享
+     */
+    struct Program {
+        Lepton::CompiledExpression expression;
+        //公式中的变量名（不含提升的常量）及其在EvaluationContext中的下标
+        std::vector<std::string> variables;
+        std::vector<int> variableIndices;
+        //第i个提升的常量在EvaluationContext中的下标
+        std::vector<int> constantIndices;
+        size_t memoryUsage = 0;
+    };
+
+    class Formula {
+        friend class FormulaCache;
+
+    public:
+        /**
+         * @brief 规范化后的表达式文本
+         */
+        const std::string& getText() const noexcept
+        {
+            return mText;
+        }
+
+        const std::vector<std::string>& getVariables() const noexcept
+        {
+            return mProgram->variables;
+        }
+
+        /**
+         * @brief 取得变量在EvaluationContext中的下标
+         * @return 若公式中没有该变量则返回-1
+         */
+        int getVariableIndex(std::string_view name) const noexcept;
+
+        /**
+         * @brief 创建求值上下文，提升的常量已经填入
+         * 每个线程应使用各自的上下文，上下文可重复使用
+         */
+        Lepton::EvaluationContext createContext() const;
+
+        /**
+         * @brief 取得编译后的程序，结构相同的公式返回同一个对象
+         */
+        const std::shared_ptr<const Program>& getProgram() const noexcept
+        {
+            return mProgram;
+        }
+
+    private:
+        std::string mText;
+        std::vector<double> mConstants;
+        std::shared_ptr<const Program> mProgram;
+    };
+
+    using FormulaPtr = std::shared_ptr<const Formula>;
+
+    FormulaCache(LoggerBase::SharedPtr logger, const Options& options);
+    explicit FormulaCache(LoggerBase::SharedPtr logger)
+        : FormulaCache(std::move(logger), Options {})
+    {
+    }
+
+    FormulaCache(const FormulaCache&) = delete;
+    FormulaCache& operator=(const FormulaCache&) = delete;
+
+    /**
+     * @brief 取得公式，未缓存时解析并编译
+     * 无法解析的公式同样会被记住，之后的查找直接返回nullptr
+     * @return 若公式无法解析则返回nullptr
+     */
+    FormulaPtr get(std::string_view text);
+
+    Statistics statistics() const;
+
+    /**
+     * @brief 清空缓存，已取得的Formula仍然有效
+     */
+    void clear();
+
+private:
+    static constexpr size_t kShards = 16;
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, FormulaPtr> formulas;
+        //不与其它公式共享的程序数
+        size_t programs = 0;
+        size_t memoryUsage = 0;
+    };
+
+    LoggerBase::SharedPtr mLogger;
+    Options mOptions;
+
+    std::array<Shard, kShards> mShards;
+
+    mutable std::shared_mutex mProgramsMutex;
+    std::unordered_map<std::string, std::shared_ptr<const Program>> mPrograms;
+    size_t mProgramsMemoryUsage = 0;
+
+    std::atomic<uint64_t> mLookups { 0 };
+    std::atomic<uint64_t> mHits { 0 };
+    std::atomic<uint64_t> mSharedPrograms { 0 };
+    std::atomic<uint64_t> mCompilations { 0 };
+    std::atomic<uint64_t> mFailures { 0 };
+    std::atomic<uint64_t> mUncached { 0 };
+    std::atomic<bool> mFullReported { false };
+
+    /**
+     * @brief 规范化表达式文本
+     * @param text 输出去除多余空白后的文本
+     * @param shape 不为空时输出常量被替换为参数后的文本，不提升常量时与text相同
+     * @param literals 不为空时输出提升的常量在source中的文本
+     * @return 若公式使用了保留的变量名（以$开头）则返回false
+     */
+    bool normalize(std::string_view source, std::string& text, std::string* shape, std::vector<std::string_view>* literals) const;
+
+    std::shared_ptr<const Program> compile(const std::string& shape, size_t constantCount);
+
+    /**
+     * @brief 取得结构相同的公式共享的程序，没有时编译
+     * @return 若无法编译则返回nullptr
+     */
+    std::shared_ptr<const Program> sharedProgram(const std::string& shape, size_t constantCount);
+
+    void reportFull();
+};
+
+}
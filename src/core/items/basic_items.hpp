@@ -3,8 +3,11 @@
 #include "context/context.hpp"
 
 #include <cinttypes>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <vector>
 
 namespace core::basic_items {
 
@@ -22,12 +25,23 @@ struct Record {
  */
 inline std::unique_ptr<Record> queryById(const std::shared_ptr<Context>& context, int64_t itemBaseId)
 {
-    auto stmt = context->getGameDB().query("BasicItems", "itemName, itemDescribe, itemCateogory, itemProperties", "WHERE itemBaseId=@id");
+    using Columns = sqlite::columns<&Record::itemBaseId, &Record::itemName, &Record::itemDescribe, &Record::itemCateogory, &Record::itemProperties>;
+
+    auto stmt = context->getGameDB().query("BasicItems", "itemBaseId, itemName, itemDescribe, itemCateogory, itemProperties", "WHERE itemBaseId=@id");
     if (!stmt.bind(itemBaseId) || stmt.step() != SQLITE_ROW) {
         return nullptr;
     }
 
-    return std::unique_ptr<Record>(new Record { itemBaseId, stmt.column_text(0), stmt.column_text(1), stmt.column_int32(2), stmt.column_text(3) });
+    return std::make_unique<Record>(stmt.read(Columns {}));
+}
+
+/**
+ * @brief 从基础物品目录缓存中查找，不访问数据库
+ * 返回的Item持有其所在的目录快照，字符串在Item释放之前有效
+ */
+inline std::optional<BasicItemsCatalog::Item> lookup(const std::shared_ptr<Context>& context, int64_t itemBaseId) noexcept
+{
+    return context->getBasicItemsCatalog().find(itemBaseId);
 }
 
 /**
@@ -36,10 +50,43 @@ inline std::unique_ptr<Record> queryById(const std::shared_ptr<Context>& context
  */
 inline int64_t insert(const std::shared_ptr<Context>& context, std::string_view name, std::string_view describe, int32_t cateogory, std::string_view properties)
 {
-    return context->getGameDB().single_step("INSERT INTO BasicItems(itemName, itemDescribe, itemCateogory, itemProperties) VALUES(?, ?, ?, ?)",
-               name, describe, cateogory, properties)
-        ? context->getGameDB().last_insert_rowid()
-        : 0;
+    if (!context->getGameDB().single_step("INSERT INTO BasicItems(itemName, itemDescribe, itemCateogory, itemProperties) VALUES(?, ?, ?, ?)",
+            name, describe, cateogory, properties)) {
+        return 0;
+    }
+
+    auto itemBaseId = context->getGameDB().last_insert_rowid();
+    context->getBasicItemsCatalog().put({ itemBaseId, name, describe, cateogory, properties });
+    return itemBaseId;
+}
+
+/**
+ * @brief 在单个事务中批量添加基础物品记录，用于导入物品目录
+ * @param records 待添加的记录，itemBaseId将被忽略并由数据库分配
+ * @return 按records顺序排列的新基础物品id，失败时返回空集合且不写入任何记录
+ */
+inline std::vector<int64_t> insertBulk(const std::shared_ptr<Context>& context, const std::vector<Record>& records)
+{
+    std::vector<std::tuple<std::string_view, std::string_view, int32_t, std::string_view>> rows;
+    rows.reserve(records.size());
+    for (auto& record : records) {
+        rows.emplace_back(record.itemName, record.itemDescribe, record.itemCateogory, record.itemProperties);
+    }
+
+    std::vector<int64_t> itemBaseIds;
+    itemBaseIds.reserve(records.size());
+    if (!context->getGameDB().bulk_insert("INSERT INTO BasicItems(itemName, itemDescribe, itemCateogory, itemProperties)", rows, &itemBaseIds)) {
+        return {};
+    }
+
+    std::vector<BasicItemsCatalog::Item> items;
+    items.reserve(records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        items.push_back({ itemBaseIds[i], records[i].itemName, records[i].itemDescribe, records[i].itemCateogory, records[i].itemProperties });
+    }
+    context->getBasicItemsCatalog().put(items);
+
+    return itemBaseIds;
 }
 
 /**
@@ -47,9 +94,44 @@ inline int64_t insert(const std::shared_ptr<Context>& context, std::string_view
  */
 inline bool update(const std::shared_ptr<Context>& context, const Record& record)
 {
-    return context->getGameDB().single_step("UPDATE BasicItems SET itemName=?, itemDescribe=?, itemCateogory=?, itemProperties=? WHERE itemBaseId=?",
-               record.itemName, record.itemDescribe, record.itemCateogory, record.itemProperties, record.itemBaseId)
-        && context->getGameDB().changes() > 0;
+    if (!context->getGameDB().single_step("UPDATE BasicItems SET itemName=?, itemDescribe=?, itemCateogory=?, itemProperties=? WHERE itemBaseId=?",
+            record.itemName, record.itemDescribe, record.itemCateogory, record.itemProperties, record.itemBaseId)
+        || context->getGameDB().changes() == 0) {
+        return false;
+    }
+
+    context->getBasicItemsCatalog().put({ record.itemBaseId, record.itemName, record.itemDescribe, record.itemCateogory, record.itemProperties });
+    return true;
+}
+
+/**
+ * @brief 通过延迟写入队列更新基础物品记录
+ * 调用立即返回，completion在写线程中调用；基础物品目录缓存在写入成功后更新
+ * @return 若游戏未运行则返回false
+ */
+inline bool updateAsync(const std::shared_ptr<Context>& context, Record record, WriteBehindQueue::Completion completion = nullptr)
+{
+    auto queue = context->getWriteQueue();
+    if (queue == nullptr) {
+        return false;
+    }
+
+    auto mutation = [record](sqlite::transaction_manager& transaction) {
+        return transaction.single_step("UPDATE BasicItems SET itemName=?, itemDescribe=?, itemCateogory=?, itemProperties=? WHERE itemBaseId=?",
+                   record.itemName, record.itemDescribe, record.itemCateogory, record.itemProperties, record.itemBaseId)
+            && transaction.changes() > 0;
+    };
+
+    //所在批次提交成功后才更新目录缓存
+    return queue->enqueue(std::move(mutation),
+        [context, record = std::move(record), completion = std::move(completion)](bool ok) {
+            if (ok) {
+                context->getBasicItemsCatalog().put({ record.itemBaseId, record.itemName, record.itemDescribe, record.itemCateogory, record.itemProperties });
+            }
+            if (completion) {
+                completion(ok);
+            }
+        });
 }
 
 /**
@@ -58,7 +140,12 @@ inline bool update(const std::shared_ptr<Context>& context, const Record& record
  */
 inline bool removeById(const std::shared_ptr<Context>& context, int64_t itemBaseId)
 {
-    return context->getGameDB().single_step("DELETE FROM BasicItems WHERE itemBaseId=?", itemBaseId) && context->getGameDB().changes() > 0;
+    if (!context->getGameDB().single_step("DELETE FROM BasicItems WHERE itemBaseId=?", itemBaseId) || context->getGameDB().changes() == 0) {
+        return false;
+    }
+
+    context->getBasicItemsCatalog().erase(itemBaseId);
+    return true;
 }
 
 }
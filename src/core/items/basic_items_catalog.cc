@@ -0,0 +1,293 @@
+#include "basic_items_catalog.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+
+using namespace core;
+
+std::optional<BasicItemsCatalog::Item> BasicItemsCatalog::Snapshot::find(int64_t itemBaseId) const noexcept
+{
+    auto item = findRow(itemBaseId);
+    if (item || !mBase || std::binary_search(mErased.begin(), mErased.end(), itemBaseId)) {
+        return item;
+    }
+    return mBase->findRow(itemBaseId);
+}
+
+std::optional<BasicItemsCatalog::Item> BasicItemsCatalog::Snapshot::findRow(int64_t itemBaseId) const noexcept
+{
+    if (!mIndex.empty()) {
+        auto slot = static_cast<uint64_t>(itemBaseId) - static_cast<uint64_t>(mFirstId);
+        if (slot >= mIndex.size() || mIndex[slot] < 0) {
+            return std::nullopt;
+        }
+        return at(static_cast<size_t>(mIndex[slot]));
+    }
+
+    auto it = std::lower_bound(mItemBaseIds.begin(), mItemBaseIds.end(), itemBaseId);
+    if (it == mItemBaseIds.end() || *it != itemBaseId) {
+        return std::nullopt;
+    }
+    return at(static_cast<size_t>(it - mItemBaseIds.begin()));
+}
+
+BasicItemsCatalog::Item BasicItemsCatalog::Snapshot::at(size_t row) const noexcept
+{
+    return Item {
+        mItemBaseIds[row],
+        string(mNames[row]),
+        string(mDescribes[row]),
+        mCategories[row],
+        string(mProperties[row]),
+        &mPropertySets[mPropertySetIndex[row]],
+    };
+}
+
+size_t BasicItemsCatalog::Snapshot::memoryUsage() const noexcept
+{
+    return sizeof(Snapshot)
+        + mIndex.capacity() * sizeof(int32_t)
+        + mItemBaseIds.capacity() * sizeof(int64_t)
+        + mCategories.capacity() * sizeof(int32_t)
+        + (mNames.capacity() + mDescribes.capacity() + mProperties.capacity()) * sizeof(StringRef)
+        + mPropertySetIndex.capacity() * sizeof(uint32_t)
+        + std::accumulate(mPropertySets.begin(), mPropertySets.end(), size_t(0), [](size_t sum, const ItemProperties& properties) {
+              return sum + properties.memoryUsage();
+          })
+        + mStrings.capacity()
+        + mErased.capacity() * sizeof(int64_t)
+        + (mBase ? mBase->memoryUsage() : 0);
+}
+
+std::shared_ptr<const BasicItemsCatalog::Snapshot> BasicItemsCatalog::Snapshot::build(std::vector<Item> items,
+    std::shared_ptr<const Snapshot> base, std::vector<int64_t> erased)
+{
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+        return a.itemBaseId < b.itemBaseId;
+    });
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->mItemBaseIds.reserve(items.size());
+    snapshot->mCategories.reserve(items.size());
+    snapshot->mNames.reserve(items.size());
+    snapshot->mDescribes.reserve(items.size());
+    snapshot->mProperties.reserve(items.size());
+    snapshot->mPropertySetIndex.reserve(items.size());
+
+    //字符串去重，键引用items中的字符串，构造期间有效
+    std::unordered_map<std::string_view, StringRef> interned;
+    auto intern = [&](std::string_view text) {
+        auto it = interned.find(text);
+        if (it == interned.end()) {
+            StringRef ref { static_cast<uint32_t>(snapshot->mStrings.size()), static_cast<uint32_t>(text.size()) };
+            snapshot->mStrings.append(text);
+            it = interned.emplace(text, ref).first;
+        }
+        return it->second;
+    };
+    std::unordered_map<uint64_t, uint32_t> propertySets;
+
+    for (auto& item : items) {
+        snapshot->mItemBaseIds.push_back(item.itemBaseId);
+        snapshot->mCategories.push_back(item.itemCateogory);
+        snapshot->mNames.push_back(intern(item.itemName));
+        snapshot->mDescribes.push_back(intern(item.itemDescribe));
+        snapshot->mProperties.push_back(intern(item.itemProperties));
+
+        //字符串去重后相同的属性文本具有相同的位置
+        auto ref = snapshot->mProperties.back();
+        auto position = (static_cast<uint64_t>(ref.offset) << 32) | ref.size;
+        auto propertySet = propertySets.find(position);
+        if (propertySet == propertySets.end()) {
+            propertySet = propertySets.emplace(position, static_cast<uint32_t>(snapshot->mPropertySets.size())).first;
+            snapshot->mPropertySets.push_back(item.properties ? *item.properties : ItemProperties::parse(item.itemProperties));
+        }
+        snapshot->mPropertySetIndex.push_back(propertySet->second);
+    }
+    snapshot->mStrings.shrink_to_fit();
+
+    //基础物品id由AUTOINCREMENT分配，通常是连续的；删除过多导致过于稀疏时不建立下标表
+    if (!items.empty()) {
+        auto span = static_cast<uint64_t>(items.back().itemBaseId) - static_cast<uint64_t>(items.front().itemBaseId) + 1;
+        if (span <= items.size() * 4 + 1024) {
+            snapshot->mFirstId = items.front().itemBaseId;
+            snapshot->mIndex.assign(static_cast<size_t>(span), -1);
+            for (size_t row = 0; row < items.size(); ++row) {
+                snapshot->mIndex[static_cast<size_t>(items[row].itemBaseId - snapshot->mFirstId)] = static_cast<int32_t>(row);
+            }
+        }
+    }
+
+    snapshot->mSize = items.size();
+    if (base) {
+        //替换的行不改变数量，新增的行与移除的行才改变
+        for (auto& item : items) {
+            if (base->findRow(item.itemBaseId)) {
+                --snapshot->mSize;
+            }
+        }
+        snapshot->mSize += base->size() - erased.size();
+        std::sort(erased.begin(), erased.end());
+        snapshot->mErased = std::move(erased);
+        snapshot->mBase = std::move(base);
+    }
+
+    return snapshot;
+}
+
+BasicItemsCatalog::BasicItemsCatalog()
+    : mCurrent(new std::shared_ptr<const Snapshot>(Snapshot::build({})))
+{
+}
+
+BasicItemsCatalog::~BasicItemsCatalog() noexcept
+{
+    delete mCurrent.load();
+}
+
+std::shared_ptr<const BasicItemsCatalog::Snapshot> BasicItemsCatalog::snapshot() const noexcept
+{
+    while (true) {
+        //先登记到当前一组再确认组没有切换，写入者切换后等待的正是登记在旧组中的读取者
+        auto epoch = mEpoch.load();
+        auto& readers = mReaders[epoch & 1].count;
+        readers.fetch_add(1);
+        if (mEpoch.load() == epoch) {
+            auto snapshot = *mCurrent.load();
+            readers.fetch_sub(1, std::memory_order_release);
+            return snapshot;
+        }
+        readers.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+bool BasicItemsCatalog::load(const sqlite::database_manager& database)
+{
+    struct Row {
+        int64_t itemBaseId;
+        std::string itemName;
+        std::string itemDescribe;
+        int32_t itemCateogory;
+        std::string itemProperties;
+    };
+    using Columns = sqlite::columns<&Row::itemBaseId, &Row::itemName, &Row::itemDescribe, &Row::itemCateogory, &Row::itemProperties>;
+
+    std::vector<Row> rows;
+    {
+        auto stmt = database.query("BasicItems", "itemBaseId, itemName, itemDescribe, itemCateogory, itemProperties", "");
+        int rc;
+        while ((rc = stmt.step()) == SQLITE_ROW) {
+            rows.push_back(stmt.read(Columns {}));
+        }
+        if (rc != SQLITE_DONE) {
+            return false;
+        }
+    }
+
+    std::vector<Item> items;
+    items.reserve(rows.size());
+    for (auto& row : rows) {
+        items.push_back(Item { row.itemBaseId, row.itemName, row.itemDescribe, row.itemCateogory, row.itemProperties });
+    }
+
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    publish(Snapshot::build(std::move(items)));
+    return true;
+}
+
+void BasicItemsCatalog::put(const std::vector<Item>& items)
+{
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    update(items, {});
+}
+
+void BasicItemsCatalog::erase(int64_t itemBaseId)
+{
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    if (!(*mCurrent.load())->find(itemBaseId)) {
+        return;
+    }
+    update({}, { itemBaseId });
+}
+
+void BasicItemsCatalog::update(const std::vector<Item>& items, const std::vector<int64_t>& erased)
+{
+    //写入者持有mWriteMutex，mCurrent只会被自己替换；旧快照在构造期间保持有效，其字符串可以直接引用
+    auto current = *mCurrent.load();
+    auto base = current->mBase ? current->mBase : current;
+
+    std::vector<int64_t> changed;
+    changed.reserve(items.size() + erased.size());
+    for (auto& item : items) {
+        changed.push_back(item.itemBaseId);
+    }
+    changed.insert(changed.end(), erased.begin(), erased.end());
+    std::sort(changed.begin(), changed.end());
+    auto isChanged = [&changed](int64_t itemBaseId) {
+        return std::binary_search(changed.begin(), changed.end(), itemBaseId);
+    };
+
+    //合并当前增量与本次修改：本次修改覆盖当前增量中相同id的行
+    std::vector<Item> rows(items.begin(), items.end());
+    std::vector<int64_t> removed;
+    if (current != base) {
+        for (size_t row = 0; row < current->mItemBaseIds.size(); ++row) {
+            if (!isChanged(current->mItemBaseIds[row])) {
+                rows.push_back(current->at(row));
+            }
+        }
+        for (auto itemBaseId : current->mErased) {
+            if (!isChanged(itemBaseId)) {
+                removed.push_back(itemBaseId);
+            }
+        }
+    }
+    //只需记录基础快照中存在的id，仅存在于增量中的行不再加入rows即被移除
+    for (auto itemBaseId : erased) {
+        if (base->findRow(itemBaseId)) {
+            removed.push_back(itemBaseId);
+        }
+    }
+
+    //增量不超过约sqrt(N)行时只构造增量快照，否则与基础快照合并重建
+    auto limit = std::max<size_t>(32, static_cast<size_t>(std::sqrt(static_cast<double>(base->size()))));
+    std::shared_ptr<const Snapshot> snapshot;
+    if (rows.size() + removed.size() <= limit) {
+        snapshot = Snapshot::build(std::move(rows), std::move(base), std::move(removed));
+    } else {
+        std::sort(removed.begin(), removed.end());
+        std::vector<int64_t> replaced;
+        replaced.reserve(rows.size());
+        for (auto& item : rows) {
+            replaced.push_back(item.itemBaseId);
+        }
+        std::sort(replaced.begin(), replaced.end());
+
+        rows.reserve(base->size() + rows.size());
+        for (size_t row = 0; row < base->mItemBaseIds.size(); ++row) {
+            auto itemBaseId = base->mItemBaseIds[row];
+            if (!std::binary_search(replaced.begin(), replaced.end(), itemBaseId) && !std::binary_search(removed.begin(), removed.end(), itemBaseId)) {
+                rows.push_back(base->at(row));
+            }
+        }
+        snapshot = Snapshot::build(std::move(rows));
+    }
+
+    publish(std::move(snapshot));
+}
+
+void BasicItemsCatalog::publish(std::shared_ptr<const Snapshot> snapshot)
+{
+    auto previous = mCurrent.exchange(new std::shared_ptr<const Snapshot>(std::move(snapshot)));
+
+    //切换读取者分组后，仍可能读到previous的只有登记在旧组中的读取者，等待它们复制完成
+    //上一次发布已等待过更早一组，因此此后不会再有读取者取得previous
+    auto epoch = mEpoch.fetch_add(1);
+    while (mReaders[epoch & 1].count.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+    delete previous;
+}
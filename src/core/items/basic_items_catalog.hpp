@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "item_properties.hpp"
+#include "sqlite/sqlite3.hpp"
+
+namespace core {
+
+/**
+ * @brief 基础物品目录缓存
+ * 启动时将BasicItems全部载入内存中的不可变快照，读取无需访问数据库；
+ * 修改时发布新快照并原子地替换当前快照（RCU），正在读取旧快照的线程不受影响。
+ *
+ * 当前快照经由原子指针发布，读取者只进行原子计数而不加锁；写入者替换指针后等待
+ * 仍可能读到旧指针的读取者离开，再释放旧指针。
+ * 快照由引用计数管理，被替换的旧快照在最后一个持有者（包括由其取得的Item）释放时回收。
+ * 单行修改不会重建整个目录：新快照只保存相对于基础快照的增量，增量超过约sqrt(N)行时才合并重建，
+ * 因此每次修改的均摊开销约为O(sqrt(N))
+ */
+class BasicItemsCatalog {
+public:
+    class Snapshot;
+
+    /**
+     * @brief 基础物品
+     * 字符串字段引用快照内部的字符串池，在snapshot释放之前有效
+     */
+    struct Item {
+        int64_t itemBaseId;
+        std::string_view itemName;
+        std::string_view itemDescribe;
+        int32_t itemCateogory;
+        std::string_view itemProperties;
+        //载入时解析好的itemProperties，为空时由itemProperties解析
+        const ItemProperties* properties = nullptr;
+        //字符串所在的快照；由Snapshot::find取得时为空，此时字符串在调用者持有该快照期间有效
+        std::shared_ptr<const Snapshot> snapshot = nullptr;
+    };
+
+    /**
+     * @brief 目录的不可变快照
+     * 各字段按列连续存放（structure of arrays），相同的字符串在字符串池中只保存一份。
+     * 增量快照只保存新增或替换的行以及被移除的id，其余的行由基础快照提供
+     */
+    class Snapshot {
+        friend class BasicItemsCatalog;
+
+    public:
+        /**
+         * @brief 按基础物品id查找
+         * id连续分布时为直接下标访问，否则退化为二分查找
+         */
+        std::optional<Item> find(int64_t itemBaseId) const noexcept;
+
+        size_t size() const noexcept { return mSize; }
+
+        /**
+         * @brief 快照占用的内存字节数（估算），包括增量快照引用的基础快照
+         */
+        size_t memoryUsage() const noexcept;
+
+    private:
+        struct StringRef {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        //mIndex[id - mFirstId]为对应的行号，-1表示不存在；id过于稀疏时mIndex为空
+        int64_t mFirstId = 0;
+        std::vector<int32_t> mIndex;
+
+        std::vector<int64_t> mItemBaseIds;
+        std::vector<int32_t> mCategories;
+        std::vector<StringRef> mNames;
+        std::vector<StringRef> mDescribes;
+        std::vector<StringRef> mProperties;
+        //每行属性在mPropertySets中的下标，相同的属性文本只解析一次
+        std::vector<uint32_t> mPropertySetIndex;
+        std::vector<ItemProperties> mPropertySets;
+
+        std::string mStrings;
+
+        //增量快照的基础快照，为空时本快照包含全部的行
+        std::shared_ptr<const Snapshot> mBase;
+        //从基础快照中移除的id，升序
+        std::vector<int64_t> mErased;
+        size_t mSize = 0;
+
+        std::string_view string(StringRef ref) const noexcept
+        {
+            return std::string_view(mStrings.data() + ref.offset, ref.size);
+        }
+
+        /**
+         * @brief 按行号取得本快照自身保存的行，行按itemBaseId升序排列
+         */
+        Item at(size_t row) const noexcept;
+
+        /**
+         * @brief 只在本快照自身保存的行中查找
+         */
+        std::optional<Item> findRow(int64_t itemBaseId) const noexcept;
+
+        /**
+         * @brief 由任意顺序的物品构造快照，items中的字符串在构造期间必须有效
+         * @param base 不为空时构造增量快照，items为新增或替换的行，erased为从base中移除的id
+         */
+        static std::shared_ptr<const Snapshot> build(std::vector<Item> items, std::shared_ptr<const Snapshot> base = nullptr,
+            std::vector<int64_t> erased = {});
+    };
+
+    BasicItemsCatalog();
+    ~BasicItemsCatalog() noexcept;
+
+    BasicItemsCatalog(const BasicItemsCatalog&) = delete;
+    BasicItemsCatalog& operator=(const BasicItemsCatalog&) = delete;
+
+    /**
+     * @brief 从数据库载入全部基础物品并发布为新快照
+     */
+    bool load(const sqlite::database_manager& database);
+
+    /**
+     * @brief 取得当前快照，持有期间快照不会被回收
+     * 不加锁，与修改并发时也不会等待
+     */
+    std::shared_ptr<const Snapshot> snapshot() const noexcept;
+
+    /**
+     * @brief 在当前快照中查找，返回的Item持有其所在的快照
+     * 每次查找都要取得并持有快照；连续多次查找时先用snapshot()取得快照再调用Snapshot::find开销更小
+     */
+    std::optional<Item> find(int64_t itemBaseId) const noexcept
+    {
+        auto current = snapshot();
+        auto item = current->find(itemBaseId);
+        if (item) {
+            item->snapshot = std::move(current);
+        }
+        return item;
+    }
+
+    /**
+     * @brief 添加或替换物品并发布新快照
+     * 仅修改缓存，调用者需保证数据库已同步修改
+     */
+    void put(const std::vector<Item>& items);
+    void put(const Item& item)
+    {
+        put(std::vector<Item> { item });
+    }
+
+    /**
+     * @brief 移除物品并发布新快照
+     */
+    void erase(int64_t itemBaseId);
+
+private:
+    struct alignas(64) ReaderCount {
+        std::atomic<uint32_t> count { 0 };
+    };
+
+    //当前快照，读取者由此复制shared_ptr；被替换的指针在读取者离开后由写入者释放
+    std::atomic<const std::shared_ptr<const Snapshot>*> mCurrent;
+
+    //正在复制当前快照的读取者数，按进入时mEpoch的奇偶分为两组
+    mutable std::array<ReaderCount, 2> mReaders;
+    std::atomic<uint32_t> mEpoch { 0 };
+
+    //修改互斥，同一时间只有一个线程构造并发布新快照
+    std::mutex mWriteMutex;
+
+    /**
+     * @brief 在当前快照上添加或替换items、移除erased，并发布新快照
+     */
+    void update(const std::vector<Item>& items, const std::vector<int64_t>& erased);
+
+    void publish(std::shared_ptr<const Snapshot> snapshot);
+};
+}
@@ -1,10 +1,15 @@
 #pragma once
 
 #include "context/context.hpp"
+#include "items/item_properties.hpp"
 
 #include <cinttypes>
+#include <functional>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 namespace core::game_items {
 
@@ -15,19 +20,173 @@ struct Record {
     std::string itemProperties;
 };
 
+/**
+ * @brief GameItemsView中的一行
+ * 字符串字段直接引用sqlite的结果缓冲区，仅在回调返回前有效，需要保留时由调用者自行拷贝
+ */
+struct View {
+    int64_t itemId;
+    int64_t itemBaseId;
+    std::string_view itemName;
+    int32_t itemCateogory;
+    std::string_view itemDescribe;
+    std::string_view itemProperties;
+};
+
+using ViewColumns = sqlite::columns<&View::itemId, &View::itemBaseId, &View::itemName, &View::itemCateogory, &View::itemDescribe, &View::itemProperties>;
+
+/**
+ * @brief 遍历GameItemsView
+ * @param other 附加的查询条件，例如 "WHERE itemBaseId=?"
+ * @param callback 以const View&调用，返回false时停止遍历
+ * @param args 绑定到other中的参数
+ * @return 若查询失败则返回false
+ */
+template <class Callback, class... Args>
+bool forEachView(const std::shared_ptr<Context>& context, std::string_view other, Callback&& callback, Args&&... args)
+{
+    auto stmt = context->getGameDB().query("GameItemsView", "itemId, itemBaseId, itemName, itemCateogory, itemDescribe, itemProperties", other);
+    if (!stmt.bind(std::forward<Args>(args)...)) {
+        return false;
+    }
+
+    for (auto& view : stmt.rows(ViewColumns {})) {
+        if (!callback(view)) {
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 游戏物品自身的属性，载入时解析一次
+ * 与基础物品属性合并时使用 ItemPropertiesOverlay(properties, *basic_items::lookup(context, itemBaseId)->properties)，
+ * 同名属性以游戏物品为准；GameItemsView在游戏物品属性非空时整体替换基础物品属性，而不是逐项覆盖
+ */
+struct Properties {
+    int64_t itemId;
+    int64_t itemBaseId;
+    //itemProperties为NULL时为空
+    ItemProperties properties;
+};
+
+/**
+ * @brief 查询并解析游戏物品自身的属性
+ * @return 若返回空指针则表示查询失败
+ */
+inline std::unique_ptr<Properties> queryProperties(const std::shared_ptr<Context>& context, int64_t itemId)
+{
+    auto stmt = context->getGameDB().query("GameItems", "itemBaseId, itemProperties", "WHERE itemId=?");
+    if (!stmt.bind(itemId) || stmt.step() != SQLITE_ROW) {
+        return nullptr;
+    }
+
+    return std::make_unique<Properties>(Properties { itemId, stmt.column<int64_t>(0), ItemProperties::parse(stmt.column_text_view(1)) });
+}
+
 inline int64_t insert(const std::shared_ptr<Context>& context, int64_t itemBaseId, std::string_view itemProperties) noexcept
 {
     return context->getGameDB().single_step("INSERT INTO GameItems(itemBaseId, itemName, itemProperties) VALUES(?, NULL, ?)", itemBaseId, itemProperties) ? context->getGameDB().last_insert_rowid() : 0;
 }
 
+/**
+ * @brief 在单个事务中批量添加游戏物品，用于批量发放奖励
+ * @param items 每项为 基础物品id, 物品属性
+ * @return 按items顺序排列的新物品id，失败时返回空集合且不写入任何记录
+ */
+inline std::vector<int64_t> insertBulk(const std::shared_ptr<Context>& context, const std::vector<std::pair<int64_t, std::string>>& items)
+{
+    std::vector<int64_t> itemIds;
+    itemIds.reserve(items.size());
+    if (!context->getGameDB().bulk_insert("INSERT INTO GameItems(itemBaseId, itemProperties)", items, &itemIds)) {
+        return {};
+    }
+    return itemIds;
+}
+
 inline bool updateProperties(const std::shared_ptr<Context>& context, int64_t itemId, std::string_view itemProperties) noexcept
 {
-    return context->getGameDB().single_step("UPDATE GameItems SET itemProperties=? WHERE itemId=?", itemId, itemProperties, itemId) && context->getGameDB().changes() > 0;
+    return context->getGameDB().single_step("UPDATE GameItems SET itemProperties=? WHERE itemId=?", itemProperties, itemId) && context->getGameDB().changes() > 0;
+}
+
+inline bool updateProperties(const std::shared_ptr<Context>& context, int64_t itemId, const ItemProperties& itemProperties)
+{
+    return updateProperties(context, itemId, itemProperties.toText());
 }
 
 inline bool updateName(const std::shared_ptr<Context>& context, int64_t itemId, std::string_view itemName) noexcept
 {
-    return context->getGameDB().single_step("UPDATE GameItems SET itemName=? WHERE itemId=?", itemId, itemName, itemId) && context->getGameDB().changes() > 0;
+    return context->getGameDB().single_step("UPDATE GameItems SET itemName=? WHERE itemId=?", itemName, itemId) && context->getGameDB().changes() > 0;
+}
+
+/**
+ * @brief 通过延迟写入队列添加游戏物品
+ * 调用立即返回，completion在写线程中以新物品id调用，失败时为0
+ * @return 若游戏未运行则返回false
+ */
+inline bool insertAsync(const std::shared_ptr<Context>& context, int64_t itemBaseId, std::string itemProperties, std::function<void(int64_t)> completion = nullptr)
+{
+    auto queue = context->getWriteQueue();
+    if (queue == nullptr) {
+        return false;
+    }
+
+    auto itemId = std::make_shared<int64_t>(0);
+    return queue->enqueue(
+        [itemBaseId, itemProperties = std::move(itemProperties), itemId](sqlite::transaction_manager& transaction) {
+            if (!transaction.single_step("INSERT INTO GameItems(itemBaseId, itemName, itemProperties) VALUES(?, NULL, ?)", itemBaseId, itemProperties)) {
+                return false;
+            }
+            *itemId = transaction.last_insert_rowid();
+            return true;
+        },
+        completion ? [itemId, completion = std::move(completion)](bool success) { completion(success ? *itemId : 0); } : WriteBehindQueue::Completion());
+}
+
+/**
+ * @brief 创建游戏物品，用于掉落、合成等需要立即得到物品id的场景
+ * 物品id由分配器立即分配，记录通过延迟写入队列异步写入，调用不会等待数据库
+ * @param completion 在写线程中以写入结果调用
+ * @return 新物品id，若游戏未运行或分配失败则返回0
+ */
+inline int64_t create(const std::shared_ptr<Context>& context, int64_t itemBaseId, std::string itemProperties, WriteBehindQueue::Completion completion = nullptr)
+{
+    auto queue = context->getWriteQueue();
+    auto allocator = context->getItemIdAllocator();
+    if (queue == nullptr || allocator == nullptr) {
+        return 0;
+    }
+
+    auto itemId = allocator->next();
+    if (itemId == 0) {
+        return 0;
+    }
+
+    bool queued = queue->enqueue(
+        [itemId, itemBaseId, itemProperties = std::move(itemProperties)](sqlite::transaction_manager& transaction) {
+            return transaction.single_step("INSERT INTO GameItems(itemId, itemBaseId, itemName, itemProperties) VALUES(?, ?, NULL, ?)", itemId, itemBaseId, itemProperties);
+        },
+        std::move(completion));
+    return queued ? itemId : 0;
+}
+
+/**
+ * @brief 通过延迟写入队列更新游戏物品属性
+ * 调用立即返回，completion在写线程中调用
+ * @return 若游戏未运行则返回false
+ */
+inline bool updatePropertiesAsync(const std::shared_ptr<Context>& context, int64_t itemId, std::string itemProperties, WriteBehindQueue::Completion completion = nullptr)
+{
+    auto queue = context->getWriteQueue();
+    if (queue == nullptr) {
+        return false;
+    }
+
+    return queue->enqueue(
+        [itemId, itemProperties = std::move(itemProperties)](sqlite::transaction_manager& transaction) {
+            return transaction.single_step("UPDATE GameItems SET itemProperties=? WHERE itemId=?", itemProperties, itemId) && transaction.changes() > 0;
+        },
+        std::move(completion));
 }
 
 }
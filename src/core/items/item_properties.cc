@@ -0,0 +1,210 @@
+#include "item_properties.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+
+#include "nlohmann/json.hpp"
+
+using namespace core;
+
+namespace {
+
+struct KeyRegistry {
+    std::shared_mutex mutex;
+    //deque在尾部追加时不会移动已有元素，ids中的键直接引用names
+    std::deque<std::string> names;
+    std::map<std::string_view, ItemProperties::Key> ids;
+};
+
+KeyRegistry& registry()
+{
+    static KeyRegistry instance;
+    return instance;
+}
+
+template <class Properties>
+std::string serialize(const Properties& properties)
+{
+    auto object = nlohmann::json::object();
+    properties.forEach([&object](ItemProperties::Key key, const ItemProperties::Value& value) {
+        auto& element = object[ItemProperties::keyName(key)];
+        switch (value.type()) {
+        case ItemProperties::Type::boolean:
+            element = *value.asBoolean();
+            break;
+        case ItemProperties::Type::integer:
+            element = *value.asInteger();
+            break;
+        case ItemProperties::Type::real:
+            element = *value.asNumber();
+            break;
+        case ItemProperties::Type::string:
+            element = std::string(*value.asString());
+            break;
+        case ItemProperties::Type::json:
+            element = nlohmann::json::parse(*value.asJson(), nullptr, false);
+            break;
+        default:
+            element = nullptr;
+            break;
+        }
+    });
+    return object.dump();
+}
+
+}
+
+ItemProperties::Key ItemProperties::key(std::string_view name)
+{
+    auto& keys = registry();
+    {
+        std::shared_lock<std::shared_mutex> lock(keys.mutex);
+        if (auto it = keys.ids.find(name); it != keys.ids.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(keys.mutex);
+    if (auto it = keys.ids.find(name); it != keys.ids.end()) {
+        return it->second;
+    }
+    auto id = static_cast<Key>(keys.names.size());
+    keys.names.emplace_back(name);
+    keys.ids.emplace(keys.names.back(), id);
+    return id;
+}
+
+std::optional<ItemProperties::Key> ItemProperties::findKey(std::string_view name) noexcept
+{
+    auto& keys = registry();
+    std::shared_lock<std::shared_mutex> lock(keys.mutex);
+    if (auto it = keys.ids.find(name); it != keys.ids.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+std::string ItemProperties::keyName(Key key)
+{
+    auto& keys = registry();
+    std::shared_lock<std::shared_mutex> lock(keys.mutex);
+    return key < keys.names.size() ? keys.names[key] : std::string();
+}
+
+ItemProperties ItemProperties::parse(std::string_view text)
+{
+    ItemProperties properties;
+    if (text.empty()) {
+        return properties;
+    }
+
+    auto json = nlohmann::json::parse(text.begin(), text.end(), nullptr, false);
+    if (json.is_discarded() || !json.is_object()) {
+        properties.mRaw = text;
+        return properties;
+    }
+
+    auto appendText = [&properties](Entry& entry, std::string_view value) {
+        entry.text.offset = static_cast<uint32_t>(properties.mStrings.size());
+        entry.text.size = static_cast<uint32_t>(value.size());
+        properties.mStrings.append(value);
+    };
+
+    properties.mEntries.reserve(json.size());
+    for (auto& element : json.items()) {
+        Entry entry {};
+        entry.key = key(element.key());
+
+        auto& value = element.value();
+        if (value.is_boolean()) {
+            entry.type = Type::boolean;
+            entry.boolean = value.get<bool>();
+        } else if (value.is_number_unsigned() && value.get<uint64_t>() > static_cast<uint64_t>(INT64_MAX)) {
+            entry.type = Type::real;
+            entry.real = value.get<double>();
+        } else if (value.is_number_integer()) {
+            entry.type = Type::integer;
+            entry.integer = value.get<int64_t>();
+        } else if (value.is_number_float()) {
+            entry.type = Type::real;
+            entry.real = value.get<double>();
+        } else if (value.is_string()) {
+            entry.type = Type::string;
+            appendText(entry, value.get_ref<const std::string&>());
+        } else if (value.is_structured()) {
+            entry.type = Type::json;
+            appendText(entry, value.dump());
+        } else {
+            entry.type = Type::null;
+        }
+        properties.mEntries.push_back(entry);
+    }
+
+    std::sort(properties.mEntries.begin(), properties.mEntries.end(), [](const Entry& a, const Entry& b) {
+        return a.key < b.key;
+    });
+    properties.mEntries.shrink_to_fit();
+    properties.mStrings.shrink_to_fit();
+    return properties;
+}
+
+const ItemProperties::Entry* ItemProperties::find(Key key) const noexcept
+{
+    //物品属性通常只有几项，线性查找比二分更快
+    if (mEntries.size() <= 8) {
+        for (auto& entry : mEntries) {
+            if (entry.key == key) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    auto it = std::lower_bound(mEntries.begin(), mEntries.end(), key, [](const Entry& entry, Key key) {
+        return entry.key < key;
+    });
+    return it != mEntries.end() && it->key == key ? &*it : nullptr;
+}
+
+std::optional<ItemProperties::Value> ItemProperties::get(Key key) const noexcept
+{
+    auto entry = find(key);
+    return entry ? std::optional<Value>(value(*entry)) : std::nullopt;
+}
+
+ItemProperties::Value ItemProperties::value(const Entry& entry) const noexcept
+{
+    Value value;
+    value.mType = entry.type;
+    switch (entry.type) {
+    case Type::boolean:
+        value.mBoolean = entry.boolean;
+        break;
+    case Type::integer:
+        value.mInteger = entry.integer;
+        break;
+    case Type::real:
+        value.mReal = entry.real;
+        break;
+    case Type::string:
+    case Type::json:
+        value.mText = std::string_view(mStrings.data() + entry.text.offset, entry.text.size);
+        break;
+    default:
+        break;
+    }
+    return value;
+}
+
+std::string ItemProperties::toText() const
+{
+    return valid() ? serialize(*this) : mRaw;
+}
+
+std::string ItemPropertiesOverlay::toText() const
+{
+    return serialize(*this);
+}
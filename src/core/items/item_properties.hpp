@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cinttypes>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core {
+
+/**
+ * @brief 预解析的物品属性
+ * itemProperties列保存为JSON对象文本，载入时解析一次为按键id排序的定长条目，
+ * 键名在进程内统一分配id，查询时无需重新解析文本也不分配内存
+ *
+ * 若文本不是合法的JSON对象，则保留原始文本且不包含任何属性，toText原样返回
+ */
+class ItemProperties {
+public:
+    using Key = uint32_t;
+
+    enum class Type : uint8_t {
+        null,
+        boolean,
+        integer,
+        real,
+        string,
+        //嵌套的对象或数组，以JSON文本保存
+        json
+    };
+
+    /**
+     * @brief 属性值
+     * 字符串引用所属ItemProperties的内部缓冲区
+     */
+    class Value {
+        friend class ItemProperties;
+
+    public:
+        Type type() const noexcept { return mType; }
+
+        std::optional<bool> asBoolean() const noexcept
+        {
+            return mType == Type::boolean ? std::optional<bool>(mBoolean) : std::nullopt;
+        }
+
+        std::optional<int64_t> asInteger() const noexcept
+        {
+            return mType == Type::integer ? std::optional<int64_t>(mInteger) : std::nullopt;
+        }
+
+        /**
+         * @brief 取得数值，整数将被转换为浮点数
+         */
+        std::optional<double> asNumber() const noexcept
+        {
+            if (mType == Type::real) {
+                return mReal;
+            }
+            return mType == Type::integer ? std::optional<double>(static_cast<double>(mInteger)) : std::nullopt;
+        }
+
+        std::optional<std::string_view> asString() const noexcept
+        {
+            return mType == Type::string ? std::optional<std::string_view>(mText) : std::nullopt;
+        }
+
+        /**
+         * @brief 取得嵌套对象或数组的JSON文本
+         */
+        std::optional<std::string_view> asJson() const noexcept
+        {
+            return mType == Type::json ? std::optional<std::string_view>(mText) : std::nullopt;
+        }
+
+    private:
+        Type mType = Type::null;
+        union {
+            bool mBoolean;
+            int64_t mInteger = 0;
+            double mReal;
+        };
+        std::string_view mText;
+    };
+
+    /**
+     * @brief 取得键名对应的id，不存在时分配新id
+     * 频繁使用的键应在初始化时取得id并保存，例如 static const auto kAttack = ItemProperties::key("atk");
+     */
+    static Key key(std::string_view name);
+
+    /**
+     * @brief 查找键名对应的id，不分配新id
+     */
+    static std::optional<Key> findKey(std::string_view name) noexcept;
+
+    static std::string keyName(Key key);
+
+    ItemProperties() = default;
+
+    /**
+     * @brief 解析itemProperties文本，空文本视为没有属性
+     */
+    static ItemProperties parse(std::string_view text);
+
+    /**
+     * @brief 是否由合法的JSON对象解析而来
+     */
+    bool valid() const noexcept { return mRaw.empty(); }
+
+    bool empty() const noexcept { return mEntries.empty(); }
+    size_t size() const noexcept { return mEntries.size(); }
+
+    std::optional<Value> get(Key key) const noexcept;
+    std::optional<Value> get(std::string_view name) const noexcept
+    {
+        auto id = findKey(name);
+        return id ? get(*id) : std::nullopt;
+    }
+
+    /**
+     * @brief 按键id升序遍历
+     * @param callback 以 (Key, const Value&) 调用
+     */
+    template <class Callback>
+    void forEach(Callback&& callback) const
+    {
+        for (auto& entry : mEntries) {
+            callback(entry.key, value(entry));
+        }
+    }
+
+    /**
+     * @brief 序列化为itemProperties列的JSON文本
+     */
+    std::string toText() const;
+
+    size_t memoryUsage() const noexcept
+    {
+        return sizeof(ItemProperties) + mEntries.capacity() * sizeof(Entry) + mStrings.capacity() + mRaw.capacity();
+    }
+
+private:
+    friend class ItemPropertiesOverlay;
+
+    struct Entry {
+        union {
+            bool boolean;
+            int64_t integer;
+            double real;
+            //字符串与嵌套JSON在mStrings中的位置
+            struct {
+                uint32_t offset;
+                uint32_t size;
+            } text;
+        };
+        Key key;
+        Type type;
+    };
+
+    //按key升序排列
+    std::vector<Entry> mEntries;
+    std::string mStrings;
+    //解析失败时保存的原始文本
+    std::string mRaw;
+
+    const Entry* find(Key key) const noexcept;
+    Value value(const Entry& entry) const noexcept;
+};
+
+/**
+ * @brief 将游戏物品自身的属性叠加在其基础物品属性之上
+ * 同名属性以top为准，不复制任何一方；两者的生命周期必须长于overlay
+ */
+class ItemPropertiesOverlay {
+public:
+    ItemPropertiesOverlay(const ItemProperties& top, const ItemProperties& base) noexcept
+        : mTop(top)
+        , mBase(base)
+    {
+    }
+
+    std::optional<ItemProperties::Value> get(ItemProperties::Key key) const noexcept
+    {
+        auto value = mTop.get(key);
+        return value ? value : mBase.get(key);
+    }
+
+    std::optional<ItemProperties::Value> get(std::string_view name) const noexcept
+    {
+        auto id = ItemProperties::findKey(name);
+        return id ? get(*id) : std::nullopt;
+    }
+
+    /**
+     * @brief 按键id升序遍历合并后的属性
+     * @param callback 以 (Key, const Value&) 调用
+     */
+    template <class Callback>
+    void forEach(Callback&& callback) const
+    {
+        auto top = mTop.mEntries.begin(), topEnd = mTop.mEntries.end();
+        auto base = mBase.mEntries.begin(), baseEnd = mBase.mEntries.end();
+        while (top != topEnd || base != baseEnd) {
+            if (base == baseEnd || (top != topEnd && top->key <= base->key)) {
+                if (base != baseEnd && base->key == top->key) {
+                    ++base;
+                }
+                callback(top->key, mTop.value(*top));
+                ++top;
+            } else {
+                callback(base->key, mBase.value(*base));
+                ++base;
+            }
+        }
+    }
+
+    /**
+     * @brief 序列化合并后的属性
+     */
+    std::string toText() const;
+
+private:
+    const ItemProperties& mTop;
+    const ItemProperties& mBase;
+};
+
+}
@@ -0,0 +1,438 @@
+#include "async_logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+using namespace core;
+
+namespace {
+
+std::atomic<uint64_t> gNextLoggerId { 1 };
+
+constexpr uint8_t kPaddingLevel = 0xFF;
+
+size_t alignRecord(size_t size) noexcept
+{
+    return (size + 7) & ~size_t(7);
+}
+
+size_t roundUpPowerOfTwo(size_t value) noexcept
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+const char* levelName(LogLevel level) noexcept
+{
+    switch (level) {
+    case LogLevel::debug:
+        return "DEBUG";
+    case LogLevel::info:
+        return "INFO ";
+    case LogLevel::warn:
+        return "WARN ";
+    default:
+        return "ERROR";
+    }
+}
+
+/**
+ * @brief 以秒为单位缓存格式化好的时间，同一秒内的日志只调用一次localtime
+ */
+struct ClockText {
+    int64_t second = -1;
+    char text[32] {};
+};
+
+void writeLine(fmt::memory_buffer& output, ClockText& clock, int64_t timestamp, LogLevel level, std::string_view text)
+{
+    auto second = timestamp / 1000000000;
+    if (second != clock.second) {
+        auto time = static_cast<std::time_t>(second);
+        std::tm local {};
+        localtime_r(&time, &local);
+        std::strftime(clock.text, sizeof(clock.text), "%Y-%m-%d %H:%M:%S", &local);
+        clock.second = second;
+    }
+
+    fmt::format_to(fmt::appender(output), "{}.{:03} {} ", clock.text, (timestamp / 1000000) % 1000, levelName(level));
+    output.append(text.data(), text.data() + text.size());
+    output.push_back('\n');
+}
+
+}
+
+struct AsyncLogger::Record {
+    //包括记录头在内按8字节对齐后的长度
+    uint32_t size;
+    uint32_t length;
+    int64_t timestamp;
+    uint8_t level;
+};
+
+/**
+ * @brief 单生产者单消费者的字节环形缓冲区
+ * 记录连续存放，剩余空间不足以放下一条记录时以填充记录（或不足一个记录头的空隙）跳到缓冲区开头
+ */
+struct AsyncLogger::Ring {
+    explicit Ring(size_t capacity)
+        : data(new char[capacity])
+        , capacity(capacity)
+        , mask(capacity - 1)
+    {
+    }
+
+    std::unique_ptr<char[]> data;
+    size_t capacity;
+    size_t mask;
+
+    alignas(64) std::atomic<uint64_t> head { 0 };
+    alignas(64) std::atomic<uint64_t> tail { 0 };
+
+    //所属线程已经退出
+    std::atomic<bool> closed { false };
+    //所属的AsyncLogger已经销毁
+    std::atomic<bool> detached { false };
+    //所属线程正在写入，stop()在最后一次取出前等待写入结束
+    alignas(64) std::atomic<bool> writing { false };
+
+    size_t used() const noexcept
+    {
+        return static_cast<size_t>(head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @return 若剩余空间不足则返回false，不写入任何内容
+     */
+    bool tryPush(LogLevel level, int64_t timestamp, std::string_view text) noexcept
+    {
+        auto size = alignRecord(sizeof(Record) + text.size());
+        auto h = head.load(std::memory_order_relaxed);
+        auto offset = h & mask;
+        auto toEnd = capacity - offset;
+        size_t skip = toEnd < size ? toEnd : 0;
+
+        if (h + skip + size - tail.load(std::memory_order_acquire) > capacity) {
+            return false;
+        }
+
+        if (skip >= sizeof(Record)) {
+            Record padding { static_cast<uint32_t>(skip), 0, 0, kPaddingLevel };
+            std::memcpy(data.get() + offset, &padding, sizeof(Record));
+        }
+
+        Record record { static_cast<uint32_t>(size), static_cast<uint32_t>(text.size()), timestamp, static_cast<uint8_t>(level) };
+        auto at = data.get() + ((h + skip) & mask);
+        std::memcpy(at, &record, sizeof(Record));
+        std::memcpy(at + sizeof(Record), text.data(), text.size());
+
+        head.store(h + skip + size, std::memory_order_release);
+        return true;
+    }
+};
+
+AsyncLogger::AsyncLogger(const Options& options)
+    : mOptions(options)
+    , mId(gNextLoggerId.fetch_add(1, std::memory_order_relaxed))
+{
+    //保证缓冲区至少能放下若干条最长的日志
+    mOptions.bufferSize = roundUpPowerOfTwo(std::max(mOptions.bufferSize, 4 * alignRecord(sizeof(Record) + mOptions.maxMessageSize)));
+}
+
+AsyncLogger::~AsyncLogger() noexcept
+{
+    stop();
+
+    std::lock_guard<std::mutex> lock(mRingsMutex);
+    for (auto& ring : mRings) {
+        ring->detached.store(true, std::memory_order_release);
+    }
+
+    if (mOwnsOutput && mOutput != nullptr) {
+        std::fclose(mOutput);
+    }
+}
+
+bool AsyncLogger::start()
+{
+    if (mRunning.load(std::memory_order_acquire)) {
+        return true;
+    }
+
+    if (mOutput == nullptr) {
+        if (mOptions.path.empty()) {
+            mOutput = stdout;
+        } else {
+            mOutput = std::fopen(mOptions.path.c_str(), "ab");
+            if (mOutput == nullptr) {
+                return false;
+            }
+            mOwnsOutput = true;
+        }
+    }
+
+    mRunning.store(true, std::memory_order_release);
+    mWriter = std::thread(&AsyncLogger::writerLoop, this);
+    return true;
+}
+
+void AsyncLogger::stop() noexcept
+{
+    if (!mRunning.exchange(false, std::memory_order_seq_cst)) {
+        return;
+    }
+
+    mWake.notify_one();
+    if (mWriter.joinable()) {
+        mWriter.join();
+    }
+
+    //在mRunning改为false之前已经开始写入的线程仍会写入缓冲区，等待它们写完，
+    //之后开始的写入都会看到mRunning为false而同步写出
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(mRingsMutex);
+        rings = mRings;
+    }
+    for (auto& ring : rings) {
+        while (ring->writing.load(std::memory_order_seq_cst)) {
+            std::this_thread::yield();
+        }
+    }
+
+    //后台线程退出前已写出全部日志，这里写出停止过程中仍在写入的日志
+    fmt::memory_buffer output;
+    while (drain(output) > 0) {
+    }
+}
+
+AsyncLogger::Statistics AsyncLogger::statistics() const
+{
+    Statistics statistics;
+    statistics.written = mWritten.load(std::memory_order_relaxed);
+    statistics.dropped = mDropped.load(std::memory_order_relaxed);
+    statistics.batches = mBatches.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mRingsMutex);
+    statistics.buffers = mRings.size();
+    return statistics;
+}
+
+void AsyncLogger::info(const std::string& message) const
+{
+    submit(LogLevel::info, message);
+}
+
+void AsyncLogger::debug(const std::string& message) const
+{
+    submit(LogLevel::debug, message);
+}
+
+void AsyncLogger::warn(const std::string& message) const
+{
+    submit(LogLevel::warn, message);
+}
+
+void AsyncLogger::error(const std::string& message) const
+{
+    submit(LogLevel::error, message);
+}
+
+void AsyncLogger::vlog(LogLevel level, std::string_view source, std::string_view message, fmt::format_args args) const
+{
+    //每个线程复用同一个格式化缓冲区，稳定后不再分配内存
+    thread_local fmt::memory_buffer buffer;
+    buffer.clear();
+    buffer.push_back('[');
+    buffer.append(source.data(), source.data() + source.size());
+    buffer.push_back(']');
+    buffer.push_back(' ');
+    fmt::vformat_to(fmt::appender(buffer), message, args);
+    submit(level, std::string_view(buffer.data(), buffer.size()));
+}
+
+AsyncLogger::Ring& AsyncLogger::ring() const
+{
+    struct Cache {
+        std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings;
+
+        ~Cache()
+        {
+            for (auto& entry : rings) {
+                entry.second->closed.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Cache cache;
+
+    for (auto& entry : cache.rings) {
+        if (entry.first == mId) {
+            return *entry.second;
+        }
+    }
+
+    //顺便移除已销毁的AsyncLogger的缓冲区
+    cache.rings.erase(std::remove_if(cache.rings.begin(), cache.rings.end(),
+                          [](auto& entry) { return entry.second->detached.load(std::memory_order_acquire); }),
+        cache.rings.end());
+
+    auto ring = std::make_shared<Ring>(mOptions.bufferSize);
+    {
+        std::lock_guard<std::mutex> lock(mRingsMutex);
+        mRings.push_back(ring);
+    }
+    cache.rings.emplace_back(mId, ring);
+    return *ring;
+}
+
+void AsyncLogger::submit(LogLevel level, std::string_view text) const
+{
+    auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (text.size() > mOptions.maxMessageSize) {
+        text = text.substr(0, mOptions.maxMessageSize);
+    }
+
+    if (!mRunning.load(std::memory_order_acquire)) {
+        writeSync(level, timestamp, text);
+        return;
+    }
+
+    //先标记正在写入再检查mRunning，与stop()中先清除mRunning再检查标记相对，
+    //二者至少有一方看到对方的修改：要么这里同步写出，要么stop()等待这次写入结束
+    auto& buffer = ring();
+    buffer.writing.store(true, std::memory_order_seq_cst);
+    if (!mRunning.load(std::memory_order_seq_cst)) {
+        buffer.writing.store(false, std::memory_order_release);
+        writeSync(level, timestamp, text);
+        return;
+    }
+
+    while (!buffer.tryPush(level, timestamp, text)) {
+        if (mOptions.overflow == Overflow::drop || !mRunning.load(std::memory_order_acquire)) {
+            buffer.writing.store(false, std::memory_order_release);
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        mWake.notify_one();
+        std::this_thread::yield();
+    }
+    buffer.writing.store(false, std::memory_order_release);
+
+    //后台线程每隔flushInterval取出一次，缓冲区过半时才提前唤醒，
+    //以免每条日志都唤醒后台线程
+    if (mWriterSleeping.load(std::memory_order_relaxed) && buffer.used() >= buffer.capacity / 2) {
+        mWake.notify_one();
+    }
+}
+
+void AsyncLogger::writeSync(LogLevel level, int64_t timestamp, std::string_view text) const
+{
+    std::lock_guard<std::mutex> lock(mSyncMutex);
+    fmt::memory_buffer output;
+    ClockText clock;
+    writeLine(output, clock, timestamp, level, text);
+    auto file = mOutput != nullptr ? mOutput : stdout;
+    std::fwrite(output.data(), 1, output.size(), file);
+    std::fflush(file);
+    mWritten.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncLogger::writerLoop()
+{
+    fmt::memory_buffer output;
+    while (mRunning.load(std::memory_order_acquire)) {
+        if (drain(output) > 0) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mWriterSleeping.store(true, std::memory_order_relaxed);
+        mWake.wait_for(lock, mOptions.flushInterval);
+        mWriterSleeping.store(false, std::memory_order_relaxed);
+    }
+
+    while (drain(output) > 0) {
+    }
+}
+
+size_t AsyncLogger::drain(fmt::memory_buffer& output)
+{
+    struct Entry {
+        int64_t timestamp;
+        LogLevel level;
+        std::string_view text;
+    };
+
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(mRingsMutex);
+        //移除所属线程已退出且已取空的缓冲区
+        mRings.erase(std::remove_if(mRings.begin(), mRings.end(),
+                         [](auto& ring) {
+                             return ring->closed.load(std::memory_order_acquire)
+                                 && ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed);
+                         }),
+            mRings.end());
+        rings = mRings;
+    }
+
+    //先取得各缓冲区当前的全部记录，写出之后才推进tail，期间生产者不会覆盖这些记录
+    std::vector<Entry> entries;
+    std::vector<uint64_t> tails(rings.size());
+    for (size_t i = 0; i < rings.size(); ++i) {
+        auto& ring = *rings[i];
+        auto t = ring.tail.load(std::memory_order_relaxed);
+        auto h = ring.head.load(std::memory_order_acquire);
+        while (t < h) {
+            auto offset = t & ring.mask;
+            auto toEnd = ring.capacity - offset;
+            if (toEnd < sizeof(Record)) {
+                t += toEnd;
+                continue;
+            }
+
+            Record record;
+            std::memcpy(&record, ring.data.get() + offset, sizeof(Record));
+            if (record.level != kPaddingLevel) {
+                entries.push_back({ record.timestamp, static_cast<LogLevel>(record.level),
+                    std::string_view(ring.data.get() + offset + sizeof(Record), record.length) });
+            }
+            t += record.size;
+        }
+        tails[i] = t;
+    }
+
+    auto dropped = mDropped.load(std::memory_order_relaxed);
+    if (entries.empty() && dropped == mReportedDrops) {
+        return 0;
+    }
+
+    //各线程的日志按时间合并
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.timestamp < b.timestamp; });
+
+    output.clear();
+    ClockText clock;
+    for (auto& entry : entries) {
+        writeLine(output, clock, entry.timestamp, entry.level, entry.text);
+    }
+    if (dropped != mReportedDrops) {
+        auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        writeLine(output, clock, now, LogLevel::warn, fmt::format("[AsyncLogger] dropped {} messages", dropped - mReportedDrops));
+        mReportedDrops = dropped;
+    }
+
+    std::fwrite(output.data(), 1, output.size(), mOutput);
+    std::fflush(mOutput);
+
+    for (size_t i = 0; i < rings.size(); ++i) {
+        rings[i]->tail.store(tails[i], std::memory_order_release);
+    }
+
+    mWritten.fetch_add(entries.size(), std::memory_order_relaxed);
+    mBatches.fetch_add(1, std::memory_order_relaxed);
+    return entries.size() + 1;
+}
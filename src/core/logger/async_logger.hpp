@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "logger.hpp"
+
+namespace core {
+
+/**
+ * @brief 异步日志
+ * 每个写日志的线程拥有自己的单生产者单消费者环形缓冲区，在调用线程中格式化后写入缓冲区即返回，
+ * 由后台线程按时间顺序合并各缓冲区的日志并批量写入文件或标准输出
+ *
+ * 缓冲区已满时按overflow处理：丢弃（并在之后输出丢弃的条数）或等待后台线程腾出空间
+ *
+ * 关闭的级别在格式化之前返回，几乎没有开销；开启的级别在调用线程中的开销以格式化本身为主
+ * （另有取时间戳与写入环形缓冲区），写文件的开销转移到后台线程，但单核上仍然占用同一个CPU
+ *
+ * 后台线程每隔flushInterval写出一次，缓冲区过半时提前唤醒；
+ * 与stop()并发的调用要么在停止前写入缓冲区并由stop()写出，要么在调用线程中同步写出，不会丢失
+ */
+class AsyncLogger : public LoggerBase {
+public:
+    enum class Overflow {
+        drop,
+        block
+    };
+
+    struct Options {
+        //为空时写入标准输出，否则追加到该文件
+        std::string path;
+        //每个线程的缓冲区大小，向上取整为2的幂
+        size_t bufferSize = 256 * 1024;
+        //单条日志的最大长度，超出部分被截断
+        size_t maxMessageSize = 4096;
+        Overflow overflow = Overflow::drop;
+        //后台线程在没有新日志时的最长等待时间
+        std::chrono::milliseconds flushInterval { 10 };
+    };
+
+    struct Statistics {
+        uint64_t written = 0;
+        uint64_t dropped = 0;
+        uint64_t batches = 0;
+        size_t buffers = 0;
+    };
+
+    explicit AsyncLogger(const Options& options);
+    AsyncLogger()
+        : AsyncLogger(Options {})
+    {
+    }
+
+    ~AsyncLogger() noexcept override;
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    using LoggerBase::debug;
+    using LoggerBase::error;
+    using LoggerBase::info;
+    using LoggerBase::warn;
+
+    /**
+     * @brief 打开输出并启动后台线程
+     * 未启动或已停止时日志在调用线程中同步写出
+     */
+    bool start();
+
+    /**
+     * @brief 写出全部已缓冲的日志后停止后台线程
+     */
+    void stop() noexcept;
+
+    Statistics statistics() const;
+
+protected:
+    void info(const std::string& message) const override;
+    void debug(const std::string& message) const override;
+    void warn(const std::string& message) const override;
+    void error(const std::string& message) const override;
+
+    void vlog(LogLevel level, std::string_view source, std::string_view message, fmt::format_args args) const override;
+
+private:
+    struct Ring;
+    struct Record;
+
+    Options mOptions;
+    //区分不同的AsyncLogger实例，用于线程本地缓冲区的查找
+    uint64_t mId;
+
+    FILE* mOutput = nullptr;
+    bool mOwnsOutput = false;
+
+    mutable std::mutex mRingsMutex;
+    mutable std::vector<std::shared_ptr<Ring>> mRings;
+
+    mutable std::mutex mWakeMutex;
+    mutable std::condition_variable mWake;
+    mutable std::atomic<bool> mWriterSleeping { false };
+
+    std::atomic<bool> mRunning { false };
+    std::thread mWriter;
+
+    //未运行时同步写出
+    mutable std::mutex mSyncMutex;
+
+    mutable std::atomic<uint64_t> mWritten { 0 };
+    mutable std::atomic<uint64_t> mBatches { 0 };
+    mutable std::atomic<uint64_t> mDropped { 0 };
+    //已输出过提示的丢弃条数
+    uint64_t mReportedDrops = 0;
+
+    Ring& ring() const;
+
+    void submit(LogLevel level, std::string_view text) const;
+
+    /**
+     * @brief 未运行时在调用线程中同步写出
+     */
+    void writeSync(LogLevel level, int64_t timestamp, std::string_view text) const;
+
+    void writerLoop();
+
+    /**
+     * @brief 取出各缓冲区中的全部日志，按时间排序后写出
+     * @return 写出的条数
+     */
+    size_t drain(fmt::memory_buffer& output);
+};
+
+}
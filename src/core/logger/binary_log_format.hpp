@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace core::binlog {
+
+/**
+ * @brief 二进制日志段的文件格式，由BinaryLogger写入、tools/log_decoder读取
+ *
+ * 段由SegmentHeader开头，之后是按8字节对齐、依次存放的记录，每条记录以RecordHeader开头：
+ *   - 格式定义：FormatDefinition，之后是来源与格式字符串
+ *   - 日志：EntryHeader，之后是argCount个参数，每个参数以一个ArgType字节开头
+ * 同一段内使用的格式都在该段内定义，但定义不一定出现在使用它的日志之前
+ * 数值均为写入端的本机字节序
+ */
+
+constexpr char kMagic[8] = { 'K', 'G', 'L', 'O', 'G', 'S', 'E', 'G' };
+constexpr uint32_t kVersion = 1;
+
+enum class RecordKind : uint8_t {
+    //未写完的记录（写入时进程退出），解码时跳过
+    incomplete = 0,
+    format = 1,
+    entry = 2
+};
+
+enum class ArgType : uint8_t {
+    int64 = 1,
+    uint64 = 2,
+    boolean = 3,
+    character = 4,
+    float32 = 5,
+    float64 = 6,
+    //uint32长度，之后是字符串内容
+    string = 7,
+    pointer = 8
+};
+
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t capacity;
+    //已写入的字节数（含段头），段正常关闭时写入，为0表示段未正常关闭
+    uint64_t used;
+    uint64_t sequence;
+    //创建时间，system_clock的纳秒数
+    int64_t createdAt;
+};
+
+struct RecordHeader {
+    //包括记录头在内按8字节对齐后的长度
+    uint32_t size;
+    RecordKind kind;
+    //日志级别，即core::LogLevel的值
+    uint8_t level;
+    uint16_t argCount;
+};
+
+struct FormatDefinition {
+    uint32_t id;
+    uint32_t sourceLength;
+    uint32_t formatLength;
+    uint32_t reserved;
+};
+
+struct EntryHeader {
+    uint32_t id;
+    uint32_t reserved;
+    int64_t timestamp;
+};
+
+constexpr uint32_t alignRecord(size_t size) noexcept
+{
+    return static_cast<uint32_t>((size + 7) & ~size_t(7));
+}
+
+inline bool checkMagic(const SegmentHeader& header) noexcept
+{
+    return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+}
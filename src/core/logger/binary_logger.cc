@@ -0,0 +1,460 @@
+#include "binary_logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "binary_log_format.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace core;
+
+namespace {
+
+std::atomic<uint64_t> gNextLoggerId { 1 };
+
+//超出maxFormats或参数无法序列化时使用的格式，参数为格式化好的整条日志
+constexpr std::string_view kTextFormat = "{}";
+
+//可以序列化的参数个数上限，更多的参数在调用线程中格式化为文本
+constexpr uint16_t kMaxArgs = 16;
+
+int64_t now() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 将fmt的参数按类型依次写入缓冲区
+ * 缓冲区按参数数量上限与字符串长度上限分配，写入时不再检查剩余空间
+ * 无法还原的类型（自定义类型、long double、128位整数）使ok为false
+ */
+struct ArgWriter {
+    char* at;
+    size_t maxStringSize;
+    bool ok = true;
+
+    template <typename T>
+    void put(binlog::ArgType type, const T& value) noexcept
+    {
+        *at++ = static_cast<char>(type);
+        std::memcpy(at, &value, sizeof(T));
+        at += sizeof(T);
+    }
+
+    void putString(const char* data, size_t size) noexcept
+    {
+        auto length = static_cast<uint32_t>(std::min(size, maxStringSize));
+        put(binlog::ArgType::string, length);
+        std::memcpy(at, data, length);
+        at += length;
+    }
+
+    template <typename T>
+    void operator()(T value) noexcept
+    {
+        if constexpr (std::is_same_v<T, bool>) {
+            put(binlog::ArgType::boolean, static_cast<uint8_t>(value));
+        } else if constexpr (std::is_same_v<T, char>) {
+            put(binlog::ArgType::character, value);
+        } else if constexpr (std::is_integral_v<T> && sizeof(T) <= 8) {
+            if constexpr (std::is_signed_v<T>) {
+                put(binlog::ArgType::int64, static_cast<int64_t>(value));
+            } else {
+                put(binlog::ArgType::uint64, static_cast<uint64_t>(value));
+            }
+        } else if constexpr (std::is_same_v<T, float>) {
+            put(binlog::ArgType::float32, value);
+        } else if constexpr (std::is_same_v<T, double>) {
+            put(binlog::ArgType::float64, value);
+        } else if constexpr (std::is_same_v<T, const char*>) {
+            putString(value, std::strlen(value));
+        } else if constexpr (std::is_same_v<T, fmt::string_view>) {
+            putString(value.data(), value.size());
+        } else if constexpr (std::is_same_v<T, const void*>) {
+            put(binlog::ArgType::pointer, reinterpret_cast<uint64_t>(value));
+        } else {
+            ok = false;
+        }
+    }
+};
+
+/**
+ * @brief 当前线程序列化参数用的缓冲区
+ */
+char* argumentBuffer(size_t maxStringSize)
+{
+    thread_local std::vector<char> buffer;
+    auto size = kMaxArgs * (sizeof(binlog::ArgType) + sizeof(uint32_t) + std::max<size_t>(maxStringSize, 8));
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+    return buffer.data();
+}
+
+}
+
+BinaryLogger::BinaryLogger(const Options& options)
+    : mOptions(options)
+    , mId(gNextLoggerId.fetch_add(1, std::memory_order_relaxed))
+{
+    mOptions.maxFormats = std::max<uint32_t>(mOptions.maxFormats, 1);
+    //保证一个段至少能放下若干条带最长字符串参数的日志
+    mOptions.segmentSize = std::max(mOptions.segmentSize, size_t(64) * (mOptions.maxStringSize + 1024));
+    mTextFormat = registerFormat({}, kTextFormat);
+}
+
+BinaryLogger::~BinaryLogger() noexcept
+{
+    stop();
+}
+
+bool BinaryLogger::start()
+{
+    {
+        std::lock_guard<std::mutex> lock(mRotateMutex);
+        if (mSlots[mGeneration.load() & 1].base != nullptr) {
+            return true;
+        }
+
+        //接着之前运行留下的段编号
+        std::error_code code;
+        std::filesystem::path path(mOptions.path);
+        auto directory = path.parent_path();
+        if (!directory.empty()) {
+            std::filesystem::create_directories(directory, code);
+        }
+
+        auto prefix = path.filename().string() + ".";
+        std::vector<uint64_t> sequences;
+        for (auto& entry : std::filesystem::directory_iterator(directory.empty() ? "." : directory, code)) {
+            auto name = entry.path().filename().string();
+            if (name.size() <= prefix.size() + 5 || name.compare(0, prefix.size(), prefix) != 0
+                || name.compare(name.size() - 5, 5, ".klog") != 0) {
+                continue;
+            }
+            auto number = name.substr(prefix.size(), name.size() - prefix.size() - 5);
+            if (!number.empty() && std::all_of(number.begin(), number.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                sequences.push_back(std::stoull(number));
+            }
+        }
+        std::sort(sequences.begin(), sequences.end());
+        mSequences.assign(sequences.begin(), sequences.end());
+        mNextSequence = std::max(mNextSequence, sequences.empty() ? 1 : sequences.back() + 1);
+    }
+
+    auto generation = mGeneration.load();
+    rotate(generation, true);
+    return mSlots[(generation + 1) & 1].base != nullptr;
+}
+
+void BinaryLogger::stop() noexcept
+{
+    rotate(mGeneration.load(), false);
+}
+
+BinaryLogger::Statistics BinaryLogger::statistics() const
+{
+    Statistics statistics;
+    statistics.written = mWritten.load(std::memory_order_relaxed);
+    statistics.dropped = mDropped.load(std::memory_order_relaxed);
+    statistics.segments = mSegments.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mFormatsMutex);
+    statistics.formats = mFormats.size();
+    return statistics;
+}
+
+void BinaryLogger::info(const std::string& message) const
+{
+    submit(LogLevel::info, message);
+}
+
+void BinaryLogger::debug(const std::string& message) const
+{
+    submit(LogLevel::debug, message);
+}
+
+void BinaryLogger::warn(const std::string& message) const
+{
+    submit(LogLevel::warn, message);
+}
+
+void BinaryLogger::error(const std::string& message) const
+{
+    submit(LogLevel::error, message);
+}
+
+void BinaryLogger::vlog(LogLevel level, std::string_view source, std::string_view message, fmt::format_args args) const
+{
+    auto timestamp = now();
+
+    auto format = findFormat(source, message);
+    auto buffer = argumentBuffer(mOptions.maxStringSize);
+    ArgWriter writer { buffer, mOptions.maxStringSize };
+    uint16_t count = 0;
+    if (format != nullptr) {
+        for (;; ++count) {
+            auto arg = args.get(count);
+            if (!arg) {
+                break;
+            }
+            if (count == kMaxArgs) {
+                writer.ok = false;
+                break;
+            }
+            fmt::visit_format_arg(writer, arg);
+            if (!writer.ok) {
+                break;
+            }
+        }
+    }
+
+    if (format == nullptr || !writer.ok) {
+        //只能在调用线程中格式化
+        fmt::memory_buffer text;
+        fmt::format_to(fmt::appender(text), "[{}] ", source);
+        fmt::vformat_to(fmt::appender(text), message, args);
+        submit(level, std::string_view(text.data(), text.size()));
+        return;
+    }
+
+    append(*format, level, timestamp, buffer, static_cast<size_t>(writer.at - buffer), count);
+}
+
+const BinaryLogger::Format* BinaryLogger::findFormat(std::string_view source, std::string_view format) const
+{
+    //以字符串的地址查找，命中后再比较内容，以免调用方复用同一块内存存放不同的格式
+    struct Cache {
+        struct Entry {
+            const char* source = nullptr;
+            const char* format = nullptr;
+            const Format* value = nullptr;
+        };
+
+        uint64_t logger = 0;
+        Entry entries[256];
+    };
+    thread_local Cache cache;
+    if (cache.logger != mId) {
+        cache = Cache {};
+        cache.logger = mId;
+    }
+
+    auto hash = (reinterpret_cast<uintptr_t>(source.data()) * 0x9E3779B97F4A7C15ull) ^ reinterpret_cast<uintptr_t>(format.data());
+    auto& entry = cache.entries[(hash ^ (hash >> 17) ^ (hash >> 9)) & 255];
+    if (entry.source == source.data() && entry.format == format.data() && entry.value != nullptr
+        && entry.value->source == source && entry.value->format == format) {
+        return entry.value;
+    }
+
+    auto value = registerFormat(source, format);
+    if (value != nullptr) {
+        entry = { source.data(), format.data(), value };
+    }
+    return value;
+}
+
+const BinaryLogger::Format* BinaryLogger::registerFormat(std::string_view source, std::string_view format) const
+{
+    std::string key;
+    key.reserve(source.size() + format.size() + 1);
+    key.append(source);
+    key.push_back('\0');
+    key.append(format);
+
+    std::lock_guard<std::mutex> lock(mFormatsMutex);
+    auto it = mFormatIndex.find(key);
+    if (it != mFormatIndex.end()) {
+        return it->second;
+    }
+    if (mFormats.size() >= mOptions.maxFormats) {
+        return nullptr;
+    }
+
+    auto& created = mFormats.emplace_back(Format { static_cast<uint32_t>(mFormats.size()), std::string(source), std::string(format) });
+    mFormatIndex.emplace(std::move(key), &created);
+    return &created;
+}
+
+void BinaryLogger::submit(LogLevel level, std::string_view text) const
+{
+    auto timestamp = now();
+
+    auto buffer = argumentBuffer(mOptions.maxStringSize);
+    ArgWriter writer { buffer, mOptions.maxStringSize };
+    writer.putString(text.data(), text.size());
+    append(*mTextFormat, level, timestamp, buffer, static_cast<size_t>(writer.at - buffer), 1);
+}
+
+void BinaryLogger::append(const Format& format, LogLevel level, int64_t timestamp, const char* args, size_t size, uint16_t argCount) const
+{
+    auto entrySize = binlog::alignRecord(sizeof(binlog::RecordHeader) + sizeof(binlog::EntryHeader) + size);
+
+    for (;;) {
+        auto generation = mGeneration.load(std::memory_order_acquire);
+        auto& slot = mSlots[generation & 1];
+
+        //先登记为写入者再确认该段仍是当前段，切换段时会等待登记过的写入者完成
+        slot.writers.fetch_add(1);
+        if (mGeneration.load() != generation) {
+            slot.writers.fetch_sub(1, std::memory_order_release);
+            continue;
+        }
+
+        if (slot.base == nullptr) {
+            slot.writers.fetch_sub(1, std::memory_order_release);
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        //格式在每个段内由第一次使用它的线程定义，定义写入之后才标记为已定义，
+        //因此看到标记的线程预留的位置一定在定义之后；并发的首次使用可能各写一次相同的定义
+        auto& defined = slot.defined[format.id];
+        bool define = defined.load(std::memory_order_acquire) == 0;
+        uint32_t definitionSize = define
+            ? binlog::alignRecord(sizeof(binlog::RecordHeader) + sizeof(binlog::FormatDefinition) + format.source.size() + format.format.size())
+            : 0;
+
+        auto offset = slot.offset.fetch_add(definitionSize + entrySize, std::memory_order_relaxed);
+        auto fits = offset + definitionSize + entrySize <= slot.capacity;
+
+        //定义与日志在同一次预留中，放不下时都不写入，在下一个段中重新定义
+        if (fits && define) {
+            auto at = slot.base + offset;
+            binlog::RecordHeader header { definitionSize, binlog::RecordKind::format, 0, 0 };
+            binlog::FormatDefinition definition { format.id, static_cast<uint32_t>(format.source.size()), static_cast<uint32_t>(format.format.size()), 0 };
+            std::memcpy(at, &header, sizeof(header));
+            at += sizeof(header);
+            std::memcpy(at, &definition, sizeof(definition));
+            at += sizeof(definition);
+            std::memcpy(at, format.source.data(), format.source.size());
+            std::memcpy(at + format.source.size(), format.format.data(), format.format.size());
+            defined.store(1, std::memory_order_release);
+        }
+
+        if (fits) {
+            auto at = slot.base + offset + definitionSize;
+            binlog::RecordHeader header { entrySize, binlog::RecordKind::entry, static_cast<uint8_t>(level), argCount };
+            binlog::EntryHeader entry { format.id, 0, timestamp };
+            std::memcpy(at, &header, sizeof(header));
+            std::memcpy(at + sizeof(header), &entry, sizeof(entry));
+            std::memcpy(at + sizeof(header) + sizeof(entry), args, size);
+        }
+
+        slot.writers.fetch_sub(1, std::memory_order_release);
+        if (fits) {
+            mWritten.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        rotate(generation, true);
+    }
+}
+
+void BinaryLogger::rotate(uint64_t generation, bool openNext) const
+{
+    std::lock_guard<std::mutex> lock(mRotateMutex);
+    if (mGeneration.load() != generation) {
+        return;
+    }
+
+    auto& next = mSlots[(generation + 1) & 1];
+    if (openNext && !openSegment(next)) {
+        std::fprintf(stderr, "BinaryLogger: failed to create %s, logging is disabled\n", segmentPath(mNextSequence - 1).c_str());
+    }
+    mGeneration.store(generation + 1);
+
+    auto& previous = mSlots[generation & 1];
+    while (previous.writers.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+    closeSegment(previous);
+}
+
+bool BinaryLogger::openSegment(Slot& slot) const
+{
+#if defined(__linux__)
+    auto sequence = mNextSequence++;
+    auto path = segmentPath(sequence);
+    auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(mOptions.segmentSize)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    auto base = ::mmap(nullptr, mOptions.segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    binlog::SegmentHeader header {};
+    std::memcpy(header.magic, binlog::kMagic, sizeof(header.magic));
+    header.version = binlog::kVersion;
+    header.headerSize = sizeof(header);
+    header.capacity = mOptions.segmentSize;
+    header.sequence = sequence;
+    header.createdAt = now();
+    std::memcpy(base, &header, sizeof(header));
+
+    slot.base = static_cast<char*>(base);
+    slot.capacity = mOptions.segmentSize;
+    slot.fd = fd;
+    slot.offset.store(sizeof(header), std::memory_order_relaxed);
+    slot.defined.reset(new std::atomic<uint8_t>[mOptions.maxFormats]());
+    mSegments.fetch_add(1, std::memory_order_relaxed);
+
+    //删除最旧的段
+    mSequences.push_back(sequence);
+    while (mOptions.maxSegments > 0 && mSequences.size() > mOptions.maxSegments) {
+        std::remove(segmentPath(mSequences.front()).c_str());
+        mSequences.pop_front();
+    }
+    return true;
+#else
+    (void)slot;
+    return false;
+#endif
+}
+
+void BinaryLogger::closeSegment(Slot& slot) const
+{
+#if defined(__linux__)
+    if (slot.base == nullptr) {
+        return;
+    }
+
+    //截去未使用的部分
+    auto used = std::min<uint64_t>(slot.offset.load(std::memory_order_relaxed), slot.capacity);
+    auto header = reinterpret_cast<binlog::SegmentHeader*>(slot.base);
+    header->used = used;
+    ::munmap(slot.base, slot.capacity);
+    if (::ftruncate(slot.fd, static_cast<off_t>(used)) != 0) {
+        std::fprintf(stderr, "BinaryLogger: failed to truncate segment\n");
+    }
+    ::close(slot.fd);
+
+    slot.base = nullptr;
+    slot.capacity = 0;
+    slot.fd = -1;
+    slot.defined.reset();
+#else
+    (void)slot;
+#endif
+}
+
+std::string BinaryLogger::segmentPath(uint64_t sequence) const
+{
+    return fmt::format("{}.{:06}.klog", mOptions.path, sequence);
+}
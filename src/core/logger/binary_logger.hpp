@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "logger.hpp"
+
+namespace core {
+
+/**
+ * @brief 二进制日志
+ * 调用时只写入格式编号与参数的原始字节，不做任何格式化，由tools/log_decoder离线还原为文本或JSON
+ *
+ * 每个不同的 来源+格式字符串 在首次使用时登记一个编号，之后各线程以字符串地址查找编号；
+ * 日志写入内存映射的段文件，段写满后切换到下一个段，最多保留maxSegments个段
+ * 进程崩溃时已写入映射内存的日志仍会由系统写回文件
+ */
+class BinaryLogger : public LoggerBase {
+public:
+    struct Options {
+        //段文件路径前缀，段文件名为 <path>.<序号>.klog
+        std::string path = "logs/kgame";
+        //每个段文件的大小
+        size_t segmentSize = 16 * 1024 * 1024;
+        //最多保留的段数（包括之前运行留下的段），超出时删除最旧的段，为0时不删除
+        size_t maxSegments = 8;
+        //不同格式的最大数量，超出后的日志在调用线程中格式化为文本写入
+        uint32_t maxFormats = 4096;
+        //单个字符串参数的最大长度，超出部分被截断
+        uint32_t maxStringSize = 4096;
+    };
+
+    struct Statistics {
+        uint64_t written = 0;
+        uint64_t dropped = 0;
+        uint64_t segments = 0;
+        size_t formats = 0;
+    };
+
+    explicit BinaryLogger(const Options& options);
+    BinaryLogger()
+        : BinaryLogger(Options {})
+    {
+    }
+
+    ~BinaryLogger() noexcept override;
+
+    BinaryLogger(const BinaryLogger&) = delete;
+    BinaryLogger& operator=(const BinaryLogger&) = delete;
+
+    using LoggerBase::debug;
+    using LoggerBase::error;
+    using LoggerBase::info;
+    using LoggerBase::warn;
+
+    /**
+     * @brief 创建第一个段文件
+     * 未启动或已停止时日志被丢弃
+     */
+    bool start();
+
+    /**
+     * @brief 等待正在进行的写入完成后关闭当前段
+     */
+    void stop() noexcept;
+
+    Statistics statistics() const;
+
+protected:
+    void info(const std::string& message) const override;
+    void debug(const std::string& message) const override;
+    void warn(const std::string& message) const override;
+    void error(const std::string& message) const override;
+
+    void vlog(LogLevel level, std::string_view source, std::string_view message, fmt::format_args args) const override;
+
+private:
+    struct Format {
+        uint32_t id;
+        std::string source;
+        std::string format;
+    };
+
+    /**
+     * @brief 段的映射
+     * 当前段与上一个段轮流使用两个Slot，切换时等待上一个段的写入全部完成后才关闭它
+     */
+    struct Slot {
+        //正在访问该Slot的写入线程数
+        std::atomic<uint32_t> writers { 0 };
+        std::atomic<uint64_t> offset { 0 };
+        char* base = nullptr;
+        size_t capacity = 0;
+        int fd = -1;
+        //格式是否已在该段内定义
+        std::unique_ptr<std::atomic<uint8_t>[]> defined;
+    };
+
+    Options mOptions;
+    uint64_t mId;
+
+    //当前段为mSlots[mGeneration & 1]
+    mutable std::atomic<uint64_t> mGeneration { 0 };
+    mutable Slot mSlots[2];
+    mutable std::mutex mRotateMutex;
+    mutable uint64_t mNextSequence = 1;
+    //现存的段的序号，从旧到新
+    mutable std::deque<uint64_t> mSequences;
+
+    mutable std::mutex mFormatsMutex;
+    mutable std::deque<Format> mFormats;
+    mutable std::unordered_map<std::string, const Format*> mFormatIndex;
+    //参数为整条文本的格式
+    const Format* mTextFormat = nullptr;
+
+    mutable std::atomic<uint64_t> mWritten { 0 };
+    mutable std::atomic<uint64_t> mDropped { 0 };
+    mutable std::atomic<uint64_t> mSegments { 0 };
+
+    /**
+     * @return 超出maxFormats时返回nullptr
+     */
+    const Format* findFormat(std::string_view source, std::string_view format) const;
+    const Format* registerFormat(std::string_view source, std::string_view format) const;
+
+    void submit(LogLevel level, std::string_view text) const;
+    void append(const Format& format, LogLevel level, int64_t timestamp, const char* args, size_t size, uint16_t argCount) const;
+
+    /**
+     * @brief 将当前段由generation切换到下一个段
+     * 若已被其他线程切换则直接返回
+     */
+    void rotate(uint64_t generation, bool openNext) const;
+    bool openSegment(Slot& slot) const;
+    void closeSegment(Slot& slot) const;
+    std::string segmentPath(uint64_t sequence) const;
+};
+
+}
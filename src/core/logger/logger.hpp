@@ -1,11 +1,20 @@
 #pragma once
 
+#include <atomic>
 #include <string_view>
 #include <memory>
 #include "fmt/format.h"
 
 namespace core {
 
+enum class LogLevel {
+    debug,
+    info,
+    warn,
+    error,
+    off
+};
+
 class LoggerBase {
 protected:
     virtual void info(const std::string &message) const = 0;
@@ -13,34 +22,90 @@ protected:
     virtual void warn(const std::string &message) const = 0;
     virtual void error(const std::string &message) const = 0;
 
+    /**
+     * @brief 输出一条已通过级别检查的日志
+     * 默认实现格式化为"[source] message"后交给对应级别的info/debug/warn/error，
+     * 子类可以重写以避免构造临时字符串
+     */
+    virtual void vlog(LogLevel level, std::string_view source, std::string_view message, fmt::format_args args) const
+    {
+        fmt::memory_buffer buffer;
+        fmt::format_to(fmt::appender(buffer), "[{}] ", source);
+        fmt::vformat_to(fmt::appender(buffer), message, args);
+        auto text = fmt::to_string(buffer);
+        switch (level) {
+        case LogLevel::debug:
+            this->debug(text);
+            break;
+        case LogLevel::info:
+            this->info(text);
+            break;
+        case LogLevel::warn:
+            this->warn(text);
+            break;
+        default:
+            this->error(text);
+            break;
+        }
+    }
+
 public:
     using SharedPtr = std::shared_ptr<LoggerBase>;
 
     virtual ~LoggerBase() = default;
 
+    /**
+     * @brief 设置输出的最低级别，低于该级别的日志在格式化之前即被丢弃
+     */
+    void setLevel(LogLevel level) noexcept
+    {
+        mLevel.store(level, std::memory_order_relaxed);
+    }
+
+    LogLevel getLevel() const noexcept
+    {
+        return mLevel.load(std::memory_order_relaxed);
+    }
+
+    bool isEnabled(LogLevel level) const noexcept
+    {
+        return level >= mLevel.load(std::memory_order_relaxed);
+    }
+
     template <typename... Args>
     constexpr void info(std::string_view source, std::string_view message, Args&&... messageArgs) const
     {
-        this->info(fmt::format(fmt::format("[{}] {}", source, message), std::forward<Args>(messageArgs)...));
+        if (isEnabled(LogLevel::info)) {
+            vlog(LogLevel::info, source, message, fmt::make_format_args(messageArgs...));
+        }
     }
 
     template <typename... Args>
     constexpr void debug(std::string_view source, std::string_view message, Args&&... messageArgs) const
     {
-        this->debug(fmt::format(fmt::format("[{}] {}", source, message), std::forward<Args>(messageArgs)...));
+        if (isEnabled(LogLevel::debug)) {
+            vlog(LogLevel::debug, source, message, fmt::make_format_args(messageArgs...));
+        }
     }
 
-    template <typename... Args>                                                                             
+    template <typename... Args>
     constexpr void warn(std::string_view source, std::string_view message, Args&&... messageArgs) const
     {
-        this->warn(fmt::format(fmt::format("[{}] {}", source, message), std::forward<Args>(messageArgs)...));
+        if (isEnabled(LogLevel::warn)) {
+            vlog(LogLevel::warn, source, message, fmt::make_format_args(messageArgs...));
+        }
     }
 
     template <typename... Args>
     constexpr void error(std::string_view source, std::string_view message, Args&&... messageArgs) const
     {
-        this->error(fmt::format(fmt::format("[{}] {}", source, message), std::forward<Args>(messageArgs)...));
+        if (isEnabled(LogLevel::error)) {
+            vlog(LogLevel::error, source, message, fmt::make_format_args(messageArgs...));
+        }
     }
+
+private:
+    std::atomic<LogLevel> mLevel { LogLevel::debug };
 };
 
 }
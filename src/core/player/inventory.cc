@@ -0,0 +1,314 @@
+#include "inventory.hpp"
+
+#include <algorithm>
+
+using namespace core;
+
+std::unique_ptr<Inventory> Inventory::load(const sqlite::database_manager& database, int64_t playerId)
+{
+    using Columns = sqlite::columns<&Slot::itemId, &Slot::itemAmount, &Slot::itemLocation>;
+
+    auto stmt = database.query("GamePlayerItems", "itemId, itemAmount, itemLocation", "WHERE playerId=?");
+    if (!stmt.bind(playerId)) {
+        return nullptr;
+    }
+
+    std::vector<Slot> slots;
+    int rc;
+    while ((rc = stmt.step()) == SQLITE_ROW) {
+        slots.push_back(stmt.read(Columns {}));
+    }
+    if (rc != SQLITE_DONE) {
+        return nullptr;
+    }
+
+    return std::make_unique<Inventory>(playerId, slots);
+}
+
+Inventory::Inventory(int64_t playerId, const std::vector<Slot>& slots)
+    : mPlayerId(playerId)
+    , mSlots(slots)
+    , mDirty(slots.size(), 0)
+{
+    mItemIndex.reserve(slots.size());
+    for (uint32_t index = 0; index < mSlots.size(); ++index) {
+        mItemIndex.emplace(mSlots[index].itemId, index);
+        mLocationIndex[mSlots[index].itemLocation].push_back(index);
+    }
+}
+
+const Inventory::Slot* Inventory::find(int64_t itemId) const noexcept
+{
+    auto it = mItemIndex.find(itemId);
+    return it != mItemIndex.end() ? &mSlots[it->second] : nullptr;
+}
+
+Inventory::Slot* Inventory::findSlot(int64_t itemId) noexcept
+{
+    auto it = mItemIndex.find(itemId);
+    return it != mItemIndex.end() ? &mSlots[it->second] : nullptr;
+}
+
+std::vector<int64_t> Inventory::itemsAt(int32_t itemLocation) const
+{
+    std::vector<int64_t> itemIds;
+    if (auto it = mLocationIndex.find(itemLocation); it != mLocationIndex.end()) {
+        itemIds.reserve(it->second.size());
+        for (auto index : it->second) {
+            itemIds.push_back(mSlots[index].itemId);
+        }
+    }
+    return itemIds;
+}
+
+void Inventory::markDirty(uint32_t index) noexcept
+{
+    if (!mDirty[index]) {
+        ++mDirtyCount;
+    }
+    mDirty[index] = ++mStamp;
+}
+
+void Inventory::place(uint32_t index, int32_t itemLocation)
+{
+    mSlots[index].itemLocation = itemLocation;
+    mLocationIndex[itemLocation].push_back(index);
+}
+
+void Inventory::unplace(uint32_t index)
+{
+    auto it = mLocationIndex.find(mSlots[index].itemLocation);
+    if (it == mLocationIndex.end()) {
+        return;
+    }
+
+    auto& indexes = it->second;
+    indexes.erase(std::find(indexes.begin(), indexes.end(), index));
+    if (indexes.empty()) {
+        mLocationIndex.erase(it);
+    }
+}
+
+bool Inventory::add(int64_t itemId, int64_t itemAmount, int32_t itemLocation)
+{
+    if (itemAmount <= 0 || mItemIndex.count(itemId) != 0) {
+        return false;
+    }
+
+    uint32_t index;
+    if (!mFreeSlots.empty()) {
+        index = mFreeSlots.back();
+        mFreeSlots.pop_back();
+        mSlots[index] = Slot { itemId, itemAmount, itemLocation };
+    } else {
+        index = static_cast<uint32_t>(mSlots.size());
+        mSlots.push_back(Slot { itemId, itemAmount, itemLocation });
+        mDirty.push_back(0);
+    }
+
+    mItemIndex.emplace(itemId, index);
+    place(index, itemLocation);
+    markDirty(index);
+    return true;
+}
+
+bool Inventory::remove(int64_t itemId)
+{
+    auto it = mItemIndex.find(itemId);
+    if (it == mItemIndex.end()) {
+        return false;
+    }
+
+    auto index = it->second;
+    unplace(index);
+    mItemIndex.erase(it);
+
+    if (mDirty[index]) {
+        mDirty[index] = 0;
+        --mDirtyCount;
+    }
+    mFreeSlots.push_back(index);
+    mRemoved.emplace_back(itemId, ++mStamp);
+    return true;
+}
+
+bool Inventory::setAmount(int64_t itemId, int64_t itemAmount)
+{
+    if (itemAmount < 0) {
+        return false;
+    }
+    if (itemAmount == 0) {
+        return remove(itemId);
+    }
+
+    auto it = mItemIndex.find(itemId);
+    if (it == mItemIndex.end()) {
+        return false;
+    }
+
+    mSlots[it->second].itemAmount = itemAmount;
+    markDirty(it->second);
+    return true;
+}
+
+bool Inventory::move(int64_t itemId, int32_t itemLocation)
+{
+    auto it = mItemIndex.find(itemId);
+    if (it == mItemIndex.end()) {
+        return false;
+    }
+
+    auto index = it->second;
+    if (mSlots[index].itemLocation != itemLocation) {
+        unplace(index);
+        place(index, itemLocation);
+        markDirty(index);
+    }
+    return true;
+}
+
+bool Inventory::stack(int64_t fromItemId, int64_t toItemId, int64_t amount)
+{
+    auto from = findSlot(fromItemId);
+    auto to = findSlot(toItemId);
+    if (from == nullptr || to == nullptr || from == to || amount <= 0 || amount > from->itemAmount) {
+        return false;
+    }
+
+    to->itemAmount += amount;
+    markDirty(mItemIndex[toItemId]);
+    return setAmount(fromItemId, from->itemAmount - amount);
+}
+
+bool Inventory::split(int64_t itemId, int64_t amount, int64_t newItemId, int32_t itemLocation)
+{
+    auto slot = findSlot(itemId);
+    if (slot == nullptr || amount <= 0 || amount >= slot->itemAmount || mItemIndex.count(newItemId) != 0) {
+        return false;
+    }
+
+    auto remain = slot->itemAmount - amount;
+    return add(newItemId, amount, itemLocation) && setAmount(itemId, remain);
+}
+
+Inventory::Changes Inventory::collectChanges() const
+{
+    Changes changes;
+    changes.removes.reserve(mRemoved.size());
+    for (auto& removed : mRemoved) {
+        changes.removes.emplace_back(mPlayerId, removed.first);
+    }
+
+    changes.upserts.reserve(mDirtyCount);
+    for (uint32_t index = 0; index < mSlots.size() && changes.upserts.size() < mDirtyCount; ++index) {
+        if (mDirty[index]) {
+            auto& slot = mSlots[index];
+            changes.upserts.emplace_back(mPlayerId, slot.itemId, slot.itemAmount, slot.itemLocation);
+        }
+    }
+    return changes;
+}
+
+void Inventory::clearChanges(uint64_t stamp) noexcept
+{
+    for (auto& dirty : mDirty) {
+        if (dirty != 0 && dirty <= stamp) {
+            dirty = 0;
+            --mDirtyCount;
+        }
+    }
+    mRemoved.erase(std::remove_if(mRemoved.begin(), mRemoved.end(), [stamp](const std::pair<int64_t, uint64_t>& removed) {
+        return removed.second <= stamp;
+    }),
+        mRemoved.end());
+}
+
+void Inventory::settle()
+{
+    //每次写回都包含当时全部未写回的修改，任何一次成功都可以清除它之前的修改，与其它写回的结果无关
+    auto finished = std::remove_if(mPending.begin(), mPending.end(), [this](const std::shared_ptr<Pending>& pending) {
+        auto state = pending->state.load(std::memory_order_acquire);
+        if (state == Pending::succeeded) {
+            clearChanges(pending->stamp);
+        }
+        return state != Pending::running;
+    });
+    mPending.erase(finished, mPending.end());
+}
+
+bool Inventory::writeChanges(sqlite::transaction_manager& transaction, const Changes& changes)
+{
+    //先删除再写入，移除后又放回的同一物品最终以写入为准
+    if (!changes.removes.empty() && !transaction.bulk_step("DELETE FROM GamePlayerItems WHERE playerId=? AND itemId=?", changes.removes)) {
+        return false;
+    }
+
+    return changes.upserts.empty()
+        || transaction.bulk_insert("INSERT INTO GamePlayerItems(playerId, itemId, itemAmount, itemLocation)", changes.upserts, nullptr,
+            "ON CONFLICT(playerId, itemId) DO UPDATE SET itemAmount=excluded.itemAmount, itemLocation=excluded.itemLocation");
+}
+
+bool Inventory::flush(sqlite::transaction_manager& transaction)
+{
+    settle();
+    if (!isDirty()) {
+        return true;
+    }
+
+    if (!writeChanges(transaction, collectChanges())) {
+        return false;
+    }
+
+    clearChanges(mStamp);
+    return true;
+}
+
+bool Inventory::flush(const sqlite::database_manager& database)
+{
+    settle();
+    if (!isDirty()) {
+        return true;
+    }
+
+    auto transaction = database.begin_transaction();
+    if (!transaction || !writeChanges(transaction, collectChanges())) {
+        transaction.rollback();
+        return false;
+    }
+    if (!transaction.end_transaction()) {
+        return false;
+    }
+
+    clearChanges(mStamp);
+    return true;
+}
+
+bool Inventory::flush(WriteBehindQueue& queue, WriteBehindQueue::Completion completion)
+{
+    settle();
+    if (!isDirty()) {
+        if (completion) {
+            completion(true);
+        }
+        return true;
+    }
+
+    auto changes = std::make_shared<Changes>(collectChanges());
+    auto pending = std::make_shared<Pending>();
+    pending->stamp = mStamp;
+
+    //写线程只设置结果，修改标记由游戏线程在settle中清除
+    auto mutation = [changes](sqlite::transaction_manager& transaction) { return writeChanges(transaction, *changes); };
+    auto done = [pending, completion = std::move(completion)](bool success) {
+        pending->state.store(success ? Pending::succeeded : Pending::failed, std::memory_order_release);
+        if (completion) {
+            completion(success);
+        }
+    };
+    if (!queue.enqueue(std::move(mutation), std::move(done))) {
+        return false;
+    }
+
+    mPending.push_back(std::move(pending));
+    return true;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+
+#include "sqlite/sqlite3.hpp"
+#include "storage/write_behind_queue.hpp"
+
+namespace core {
+
+/**
+ * @brief 玩家背包
+ * 登录时一次性载入玩家在GamePlayerItems中的全部行，之后的移动、堆叠、拆分等操作只修改内存，
+ * 并记录被修改的格子；在每帧结束或玩家下线时调用flush，在一个事务中只写回发生变化的行
+ *
+ * 背包不是线程安全的，应只在处理该玩家的游戏线程中使用
+ */
+class Inventory {
+public:
+    struct Slot {
+        int64_t itemId;
+        int64_t itemAmount;
+        int32_t itemLocation;
+    };
+
+    /**
+     * @brief 载入指定玩家的背包
+     * @return 若查询失败则返回nullptr
+     */
+    static std::unique_ptr<Inventory> load(const sqlite::database_manager& database, int64_t playerId);
+
+    /**
+     * @brief 由已经查询出的行构造背包，用于批量载入多个玩家
+     */
+    Inventory(int64_t playerId, const std::vector<Slot>& slots);
+
+    int64_t getPlayerId() const noexcept
+    {
+        return mPlayerId;
+    }
+
+    size_t size() const noexcept
+    {
+        return mItemIndex.size();
+    }
+
+    /**
+     * @brief 按物品id查找
+     * 返回的指针在下一次修改背包之前有效
+     */
+    const Slot* find(int64_t itemId) const noexcept;
+
+    /**
+     * @brief 取得指定位置上的全部物品id
+     */
+    std::vector<int64_t> itemsAt(int32_t itemLocation) const;
+
+    /**
+     * @brief 遍历全部物品
+     * @param callback 以const Slot&调用
+     */
+    template <class Callback>
+    void forEach(Callback&& callback) const
+    {
+        for (auto& element : mItemIndex) {
+            callback(mSlots[element.second]);
+        }
+    }
+
+    /**
+     * @brief 放入物品
+     * @return 若物品已在背包中或数量不为正则返回false
+     */
+    bool add(int64_t itemId, int64_t itemAmount, int32_t itemLocation);
+
+    /**
+     * @brief 移除物品
+     */
+    bool remove(int64_t itemId);
+
+    /**
+     * @brief 设置物品数量，数量为0时移除物品
+     */
+    bool setAmount(int64_t itemId, int64_t itemAmount);
+
+    /**
+     * @brief 将物品移动到指定位置
+     */
+    bool move(int64_t itemId, int32_t itemLocation);
+
+    /**
+     * @brief 将from的amount个数量堆叠到to上，from数量为0时被移除
+     * 两者是否可以堆叠由调用者判断
+     */
+    bool stack(int64_t fromItemId, int64_t toItemId, int64_t amount);
+
+    /**
+     * @brief 从物品中拆分出amount个数量，作为newItemId放在指定位置
+     * newItemId需由调用者预先分配
+     */
+    bool split(int64_t itemId, int64_t amount, int64_t newItemId, int32_t itemLocation);
+
+    /**
+     * @brief 是否有尚未写回的修改
+     * 已推入延迟写入队列的修改在settle确认写入成功之前仍视为未写回
+     */
+    bool isDirty() const noexcept
+    {
+        return mDirtyCount != 0 || !mRemoved.empty();
+    }
+
+    /**
+     * @brief 处理已完成的延迟写回：写入成功的清除对应的修改标记，失败的保留修改标记等待下一次写回
+     * 每次flush前会自动调用
+     */
+    void settle();
+
+    /**
+     * @brief 在调用者的事务中写回发生变化的行
+     * 成功后清除修改标记，失败时保留修改标记，调用者回滚事务后可以重试
+     */
+    bool flush(sqlite::transaction_manager& transaction);
+
+    /**
+     * @brief 在一个事务中同步写回发生变化的行，用于玩家下线
+     */
+    bool flush(const sqlite::database_manager& database);
+
+    /**
+     * @brief 通过延迟写入队列写回发生变化的行，用于每帧结束时
+     * 变化的行在调用时复制，修改标记保留到写入成功后由settle清除；写入失败或尚未确认的行会在下一次flush时再次写入。
+     * 写入结果同时通过completion在写线程中报告
+     * @return 若队列未运行则返回false
+     */
+    bool flush(WriteBehindQueue& queue, WriteBehindQueue::Completion completion = nullptr);
+
+private:
+    struct Changes {
+        std::vector<std::tuple<int64_t, int64_t, int64_t, int32_t>> upserts;
+        std::vector<std::tuple<int64_t, int64_t>> removes;
+    };
+
+    //已推入延迟写入队列的写回，state由写线程设置
+    struct Pending {
+        enum State : int { running, succeeded, failed };
+
+        //写回包含了序号不大于stamp的全部修改
+        uint64_t stamp;
+        std::atomic<int> state { running };
+    };
+
+    int64_t mPlayerId;
+
+    //mSlots中被移除的格子由mFreeSlots复用，下标在物品存在期间保持不变
+    std::vector<Slot> mSlots;
+    //每个格子最后一次修改的序号，0表示没有未写回的修改
+    std::vector<uint64_t> mDirty;
+    std::vector<uint32_t> mFreeSlots;
+    size_t mDirtyCount = 0;
+    //修改序号
+    uint64_t mStamp = 0;
+
+    std::unordered_map<int64_t, uint32_t> mItemIndex;
+    std::unordered_map<int32_t, std::vector<uint32_t>> mLocationIndex;
+
+    //自上次写回后被移除的物品id及移除时的修改序号
+    std::vector<std::pair<int64_t, uint64_t>> mRemoved;
+
+    std::vector<std::shared_ptr<Pending>> mPending;
+
+    Slot* findSlot(int64_t itemId) noexcept;
+    void markDirty(uint32_t index) noexcept;
+    void place(uint32_t index, int32_t itemLocation);
+    void unplace(uint32_t index);
+
+    Changes collectChanges() const;
+    /**
+     * @brief 清除序号不大于stamp的修改标记，之后的修改保留
+     */
+    void clearChanges(uint64_t stamp) noexcept;
+    static bool writeChanges(sqlite::transaction_manager& transaction, const Changes& changes);
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "context/context.hpp"
+
+#include <cinttypes>
+#include <string_view>
+
+namespace core::player_items {
+
+/**
+ * @brief GamePlayerItemsView中的一行
+ * 字符串字段直接引用sqlite的结果缓冲区，仅在回调返回前有效，需要保留时由调用者自行拷贝
+ */
+struct View {
+    int64_t playerId;
+    int64_t itemId;
+    int64_t itemAmount;
+    int32_t itemLocation;
+    int64_t itemBaseId;
+    int32_t itemCateogory;
+    std::string_view itemDescribe;
+    std::string_view itemName;
+    std::string_view itemProperties;
+};
+
+using ViewColumns = sqlite::columns<&View::playerId, &View::itemId, &View::itemAmount, &View::itemLocation, &View::itemBaseId,
+    &View::itemCateogory, &View::itemDescribe, &View::itemName, &View::itemProperties>;
+
+/**
+ * @brief 遍历指定玩家的全部物品
+ * @param callback 以const View&调用，返回false时停止遍历
+ * @return 若查询失败则返回false
+ */
+template <class Callback>
+bool forEachByPlayer(const std::shared_ptr<Context>& context, int64_t playerId, Callback&& callback)
+{
+    auto stmt = context->getGameDB().query("GamePlayerItemsView",
+        "playerId, itemId, itemAmount, itemLocation, itemBaseId, itemCateogory, itemDescribe, itemName, itemProperties",
+        "WHERE playerId=?");
+    if (!stmt.bind(playerId)) {
+        return false;
+    }
+
+    for (auto& view : stmt.rows(ViewColumns {})) {
+        if (!callback(view)) {
+            break;
+        }
+    }
+    return true;
+}
+
+}
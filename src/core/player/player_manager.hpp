@@ -1,8 +1,10 @@
 #pragma once
 
-#include "context/context_fwd.hpp"
+#include "context/context.hpp"
 #include "context/manager_base.hpp"
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace core {
 
@@ -13,7 +15,79 @@ public:
     explicit PlayerManager(const std::shared_ptr<Context> &context)
         : ManagerBase(context) {};
 
+    /**
+     * @brief 创建玩家，用于注册等需要立即得到玩家id的场景
+     * 玩家id由分配器立即分配，记录通过延迟写入队列异步写入，调用不会等待数据库
+     * @param completion 在写线程中以写入结果调用
+     * @return 新玩家id，若游戏未运行或分配失败则返回0
+     */
+    int64_t createPlayer(std::string playerName, WriteBehindQueue::Completion completion = nullptr)
+    {
+        auto queue = mContext->getWriteQueue();
+        auto allocator = mContext->getPlayerIdAllocator();
+        if (queue == nullptr || allocator == nullptr) {
+            return 0;
+        }
+
+        auto playerId = allocator->next();
+        if (playerId == 0) {
+            return 0;
+        }
+
+        bool queued = queue->enqueue(
+            [playerId, playerName = std::move(playerName)](sqlite::transaction_manager &transaction) {
+                return transaction.single_step("INSERT INTO GamePlayer(playerId, playerName, playerRegdate) VALUES(?, ?, datetime('now'))", playerId, playerName);
+            },
+            std::move(completion));
+        return queued ? playerId : 0;
+    }
+
+    /**
+     * @brief 取得玩家，未载入时从数据库载入
+     * @return 若玩家不存在或游戏未运行则返回nullptr
+     */
+    PlayerWorkingSet::PlayerPtr getPlayer(int64_t playerId)
+    {
+        auto players = mContext->getPlayerWorkingSet();
+        return players != nullptr ? players->acquire(playerId) : nullptr;
+    }
+
+    /**
+     * @brief 批量取得玩家，未载入的玩家合并为一次载入
+     */
+    std::vector<PlayerWorkingSet::PlayerPtr> getPlayers(const std::vector<int64_t> &playerIds)
+    {
+        auto players = mContext->getPlayerWorkingSet();
+        return players != nullptr ? players->acquire(playerIds) : std::vector<PlayerWorkingSet::PlayerPtr>(playerIds.size());
+    }
+
+    /**
+     * @brief 预先载入即将登录的玩家
+     */
+    void prefetch(const std::vector<int64_t> &playerIds)
+    {
+        if (auto players = mContext->getPlayerWorkingSet()) {
+            players->prefetch(playerIds);
+        }
+    }
+
+    /**
+     * @brief 写回全部已载入玩家的修改，在每帧结束时调用
+     */
+    bool flush()
+    {
+        auto players = mContext->getPlayerWorkingSet();
+        return players != nullptr && players->flush();
+    }
+
+    /**
+     * @brief 取得命中率与载入耗时统计
+     */
+    PlayerWorkingSet::Statistics statistics() const
+    {
+        auto players = mContext->getPlayerWorkingSet();
+        return players != nullptr ? players->statistics() : PlayerWorkingSet::Statistics {};
+    }
 };
 
 }
-
@@ -0,0 +1,478 @@
+#include "player_working_set.hpp"
+
+#include <algorithm>
+
+using namespace core;
+
+//SQLite参数数量上限至少为999，每条 IN (...) 查询最多绑定的玩家数
+static constexpr size_t kMaxIdsPerQuery = 500;
+
+static size_t bucketOf(uint64_t nanoseconds) noexcept
+{
+    auto micros = nanoseconds / 1000;
+    size_t bucket = 0;
+    while (micros != 0 && bucket + 1 < PlayerWorkingSet::kHistogramBuckets) {
+        micros >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+std::chrono::microseconds PlayerWorkingSet::Statistics::loadPercentile(double p) const noexcept
+{
+    auto calls = misses + coalesced;
+    if (calls == 0) {
+        return std::chrono::microseconds(0);
+    }
+    //p为1时取最后一个样本所在的桶
+    auto target = std::min(static_cast<uint64_t>(static_cast<double>(calls) * p), calls - 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kHistogramBuckets; ++i) {
+        seen += loadHistogram[i];
+        if (seen > target) {
+            return std::chrono::microseconds(std::min<uint64_t>(uint64_t(1) << i, maxLoadNanoseconds / 1000 + 1));
+        }
+    }
+    return std::chrono::microseconds(maxLoadNanoseconds / 1000);
+}
+
+PlayerWorkingSet::PlayerWorkingSet(sqlite::database_manager database, LoggerBase::SharedPtr logger, const Options& options)
+    : mDatabase(std::move(database))
+    , mLogger(std::move(logger))
+    , mOptions(options)
+{
+    if (mOptions.maxBatchSize == 0) {
+        mOptions.maxBatchSize = 1;
+    }
+}
+
+PlayerWorkingSet::~PlayerWorkingSet() noexcept
+{
+    stop();
+}
+
+bool PlayerWorkingSet::start(WriteBehindQueue* queue)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRunning) {
+        return true;
+    }
+
+    if (!mDatabase) {
+        mLogger->error("PlayerWorkingSet::start", "database is not open");
+        return false;
+    }
+
+    mQueue = queue;
+    mRunning = true;
+    mLoader = std::thread(&PlayerWorkingSet::loaderLoop, this);
+    return true;
+}
+
+void PlayerWorkingSet::stop() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRunning) {
+            return;
+        }
+        mRunning = false;
+    }
+    mHasPending.notify_all();
+
+    if (mLoader.joinable()) {
+        mLoader.join();
+    }
+
+    std::vector<PlayerPtr> players;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        players.reserve(mPlayers.size());
+        for (auto& element : mPlayers) {
+            players.push_back(std::move(element.second.player));
+        }
+        mPlayers.clear();
+        mLru.clear();
+    }
+
+    if (!flush(players)) {
+        mLogger->error("PlayerWorkingSet::stop", "failed to write back some players");
+    }
+}
+
+std::shared_future<PlayerWorkingSet::PlayerPtr> PlayerWorkingSet::request(int64_t playerId, PlayerPtr& player)
+{
+    if (auto it = mPlayers.find(playerId); it != mPlayers.end() && it->second.evicting) {
+        //等待淘汰的写回结束，由载入线程决定保留该玩家并交给等待者
+        ++mStatistics.coalesced;
+        auto& loading = mLoading[playerId];
+        if (!loading.future.valid()) {
+            loading.future = loading.promise.get_future().share();
+        }
+        return loading.future;
+    } else if (it != mPlayers.end()) {
+        ++mStatistics.hits;
+        mLru.splice(mLru.begin(), mLru, it->second.lru);
+        player = it->second.player;
+        return {};
+    }
+
+    if (auto it = mLoading.find(playerId); it != mLoading.end()) {
+        ++mStatistics.coalesced;
+        return it->second.future;
+    }
+
+    ++mStatistics.misses;
+    auto& loading = mLoading[playerId];
+    loading.future = loading.promise.get_future().share();
+    mPending.push_back(playerId);
+    return loading.future;
+}
+
+PlayerWorkingSet::PlayerPtr PlayerWorkingSet::acquire(int64_t playerId)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    PlayerPtr player;
+    std::shared_future<PlayerPtr> future;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRunning) {
+            return nullptr;
+        }
+        future = request(playerId, player);
+    }
+
+    if (player) {
+        return player;
+    }
+
+    mHasPending.notify_one();
+    player = future.get();
+    recordLoad(begin);
+    return player;
+}
+
+std::vector<PlayerWorkingSet::PlayerPtr> PlayerWorkingSet::acquire(const std::vector<int64_t>& playerIds)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    std::vector<PlayerPtr> players(playerIds.size());
+    std::vector<std::shared_future<PlayerPtr>> futures(playerIds.size());
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRunning) {
+            return players;
+        }
+        for (size_t i = 0; i < playerIds.size(); ++i) {
+            futures[i] = request(playerIds[i], players[i]);
+        }
+    }
+
+    mHasPending.notify_one();
+    for (size_t i = 0; i < playerIds.size(); ++i) {
+        if (futures[i].valid()) {
+            players[i] = futures[i].get();
+            recordLoad(begin);
+        }
+    }
+    return players;
+}
+
+void PlayerWorkingSet::prefetch(const std::vector<int64_t>& playerIds)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRunning) {
+            return;
+        }
+        PlayerPtr player;
+        for (auto playerId : playerIds) {
+            request(playerId, player);
+        }
+    }
+    mHasPending.notify_one();
+}
+
+bool PlayerWorkingSet::flush()
+{
+    std::vector<PlayerPtr> players;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        players.reserve(mPlayers.size());
+        for (auto& element : mPlayers) {
+            //正在淘汰的玩家由载入线程写回
+            if (!element.second.evicting && element.second.player->inventory.isDirty()) {
+                players.push_back(element.second.player);
+            }
+        }
+    }
+    return flush(players);
+}
+
+bool PlayerWorkingSet::flush(const std::vector<PlayerPtr>& players)
+{
+    bool success = true;
+    for (auto& player : players) {
+        //经由延迟写入队列写回，保证与之前推入队列的修改按顺序提交；队列未运行时同步写回
+        if (mQueue != nullptr && player->inventory.flush(*mQueue)) {
+            continue;
+        }
+        success = player->inventory.flush(mDatabase) && success;
+    }
+    return success;
+}
+
+PlayerWorkingSet::Statistics PlayerWorkingSet::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto statistics = mStatistics;
+    statistics.size = mPlayers.size();
+    return statistics;
+}
+
+void PlayerWorkingSet::recordLoad(std::chrono::steady_clock::time_point begin)
+{
+    auto nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mStatistics.loadHistogram[bucketOf(nanoseconds)];
+    mStatistics.totalLoadNanoseconds += nanoseconds;
+    mStatistics.maxLoadNanoseconds = std::max(mStatistics.maxLoadNanoseconds, nanoseconds);
+}
+
+std::vector<uint8_t> PlayerWorkingSet::writeBack(const std::vector<PlayerPtr>& players)
+{
+    //结果由写线程在完成回调中设置；只等待这些玩家的写回，不等待队列中其它无关的变更
+    struct Pending {
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining = 0;
+        std::vector<uint8_t> written;
+    };
+    auto pending = std::make_shared<Pending>();
+    pending->written.assign(players.size(), 0);
+
+    for (size_t i = 0; i < players.size(); ++i) {
+        auto& inventory = players[i]->inventory;
+        if (mQueue != nullptr) {
+            {
+                std::lock_guard<std::mutex> lock(pending->mutex);
+                ++pending->remaining;
+            }
+            auto completion = [pending, i](bool success) {
+                std::lock_guard<std::mutex> lock(pending->mutex);
+                pending->written[i] = success;
+                if (--pending->remaining == 0) {
+                    pending->done.notify_one();
+                }
+            };
+            if (inventory.flush(*mQueue, std::move(completion))) {
+                continue;
+            }
+
+            //队列未运行，completion不会被调用
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            --pending->remaining;
+        }
+
+        auto written = inventory.flush(mDatabase);
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        pending->written[i] = written;
+    }
+
+    std::unique_lock<std::mutex> lock(pending->mutex);
+    pending->done.wait(lock, [&pending] {
+        return pending->remaining == 0;
+    });
+    return pending->written;
+}
+
+void PlayerWorkingSet::loaderLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mHasPending.wait(lock, [this] {
+            return !mPending.empty() || !mRunning;
+        });
+        if (!mRunning) {
+            break;
+        }
+
+        //等待更多请求合并到同一批次
+        if (mOptions.maxBatchDelay.count() > 0) {
+            auto deadline = std::chrono::steady_clock::now() + mOptions.maxBatchDelay;
+            mHasPending.wait_until(lock, deadline, [this] {
+                return mPending.size() >= mOptions.maxBatchSize || !mRunning;
+            });
+        }
+
+        auto count = std::min(mPending.size(), mOptions.maxBatchSize);
+        std::vector<int64_t> batch(mPending.begin(), mPending.begin() + static_cast<std::ptrdiff_t>(count));
+        mPending.erase(mPending.begin(), mPending.begin() + static_cast<std::ptrdiff_t>(count));
+
+        lock.unlock();
+        auto loaded = loadBatch(batch);
+        lock.lock();
+
+        ++mStatistics.batches;
+        mStatistics.loadedPlayers += loaded.size();
+
+        for (auto playerId : batch) {
+            PlayerPtr player;
+            if (auto it = loaded.find(playerId); it != loaded.end()) {
+                player = std::move(it->second);
+                mLru.push_front(playerId);
+                mPlayers.emplace(playerId, Entry { player, mLru.begin() });
+            }
+
+            auto loading = mLoading.find(playerId);
+            loading->second.promise.set_value(std::move(player));
+            mLoading.erase(loading);
+        }
+
+        //被淘汰的玩家在确认写回后才移除，因此之后重新载入时总能读到最新的数据
+        auto evicting = selectEvictions();
+        if (!evicting.empty()) {
+            lock.unlock();
+            auto written = writeBack(evicting);
+            lock.lock();
+            evict(evicting, written);
+        }
+    }
+
+    //停止时仍未载入的请求以nullptr结束
+    for (auto& element : mLoading) {
+        element.second.promise.set_value(nullptr);
+    }
+    mLoading.clear();
+    mPending.clear();
+}
+
+std::vector<PlayerWorkingSet::PlayerPtr> PlayerWorkingSet::selectEvictions()
+{
+    std::vector<PlayerPtr> evicting;
+
+    auto count = mPlayers.size();
+    for (auto it = mLru.rbegin(); count > mOptions.capacity && it != mLru.rend(); ++it) {
+        auto& entry = mPlayers.find(*it)->second;
+        //仍被外部持有的玩家正在使用，跳过
+        if (entry.player.use_count() > 1) {
+            continue;
+        }
+
+        entry.evicting = true;
+        evicting.push_back(entry.player);
+        --count;
+    }
+    return evicting;
+}
+
+void PlayerWorkingSet::evict(const std::vector<PlayerPtr>& players, const std::vector<uint8_t>& written)
+{
+    size_t failures = 0;
+    for (size_t i = 0; i < players.size(); ++i) {
+        auto playerId = players[i]->playerId;
+        auto entry = mPlayers.find(playerId);
+        entry->second.evicting = false;
+
+        //写回期间被请求的玩家不再淘汰，直接交给等待者
+        if (auto loading = mLoading.find(playerId); loading != mLoading.end()) {
+            mLru.splice(mLru.begin(), mLru, entry->second.lru);
+            loading->second.promise.set_value(entry->second.player);
+            mLoading.erase(loading);
+            continue;
+        }
+
+        //写回期间没有其它线程访问该玩家，在此确认写回结果并清除修改标记
+        auto& inventory = entry->second.player->inventory;
+        inventory.settle();
+        if (!written[i] || inventory.isDirty()) {
+            ++failures;
+            continue;
+        }
+
+        mLru.erase(entry->second.lru);
+        mPlayers.erase(entry);
+        ++mStatistics.evictions;
+    }
+
+    if (failures != 0) {
+        mStatistics.evictionFailures += failures;
+        mLogger->error("PlayerWorkingSet", "failed to write back {} evicted players, kept in memory", failures);
+    }
+}
+
+std::unordered_map<int64_t, PlayerWorkingSet::PlayerPtr> PlayerWorkingSet::loadBatch(const std::vector<int64_t>& playerIds)
+{
+    struct Row {
+        int64_t playerId;
+        std::string playerName;
+        std::string playerRegdate;
+    };
+    std::vector<Row> rows;
+    std::unordered_map<int64_t, std::vector<Player::Bind>> binds;
+    std::unordered_map<int64_t, std::vector<Inventory::Slot>> slots;
+
+    //在同一个事务中读取三张表，保证彼此一致
+    auto transaction = mDatabase.begin_transaction();
+    if (!transaction) {
+        mLogger->error("PlayerWorkingSet::loadBatch", "failed to begin transaction");
+        return {};
+    }
+
+    auto query = [&](std::string_view head, size_t first, size_t count, auto&& onRow) {
+        std::string sql(head);
+        sql.append(" IN (");
+        for (size_t i = 0; i < count; ++i) {
+            sql.append(i == 0 ? "?" : ", ?");
+        }
+        sql.append(")");
+
+        auto stmt = transaction.prepare(sql);
+        for (size_t i = 0; i < count; ++i) {
+            if (!stmt.bind_at(static_cast<int32_t>(i + 1), playerIds[first + i])) {
+                return false;
+            }
+        }
+
+        int rc;
+        while ((rc = stmt.step()) == SQLITE_ROW) {
+            onRow(stmt);
+        }
+        return rc == SQLITE_DONE;
+    };
+
+    for (size_t first = 0; first < playerIds.size(); first += kMaxIdsPerQuery) {
+        auto count = std::min(kMaxIdsPerQuery, playerIds.size() - first);
+
+        bool success = query("SELECT playerId, playerName, playerRegdate FROM GamePlayer WHERE playerId", first, count, [&](const sqlite::stmt_manager& stmt) {
+            rows.push_back(stmt.read(sqlite::columns<&Row::playerId, &Row::playerName, &Row::playerRegdate> {}));
+        });
+        success = success && query("SELECT playerId, bindObject, bindTime FROM GamePlayerBind WHERE playerId", first, count, [&](const sqlite::stmt_manager& stmt) {
+            binds[stmt.column<int64_t>(0)].push_back(Player::Bind { stmt.column<std::string>(1), stmt.column<std::string>(2) });
+        });
+        success = success && query("SELECT playerId, itemId, itemAmount, itemLocation FROM GamePlayerItems WHERE playerId", first, count, [&](const sqlite::stmt_manager& stmt) {
+            slots[stmt.column<int64_t>(0)].push_back(Inventory::Slot { stmt.column<int64_t>(1), stmt.column<int64_t>(2), stmt.column<int32_t>(3) });
+        });
+
+        if (!success) {
+            mLogger->error("PlayerWorkingSet::loadBatch", "failed to load {} players", count);
+            return {};
+        }
+    }
+
+    std::unordered_map<int64_t, PlayerPtr> players;
+    players.reserve(rows.size());
+    for (auto& row : rows) {
+        auto playerId = row.playerId;
+        players.emplace(playerId, std::make_shared<Player>(Player {
+                                      playerId,
+                                      std::move(row.playerName),
+                                      std::move(row.playerRegdate),
+                                      std::move(binds[playerId]),
+                                      Inventory(playerId, slots[playerId]),
+                                  }));
+    }
+    return players;
+}
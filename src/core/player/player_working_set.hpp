@@ -0,0 +1,206 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "inventory.hpp"
+#include "logger/logger.hpp"
+#include "sqlite/sqlite3.hpp"
+#include "storage/write_behind_queue.hpp"
+
+namespace core {
+
+/**
+ * @brief 已载入内存的玩家
+ * 不是线程安全的，同一玩家应只在一个游戏线程中修改
+ */
+struct Player {
+    struct Bind {
+        std::string bindObject;
+        std::string bindTime;
+    };
+
+    int64_t playerId;
+    std::string playerName;
+    std::string playerRegdate;
+    std::vector<Bind> binds;
+    Inventory inventory;
+};
+
+/**
+ * @brief 玩家工作集
+ * 在内存中保留有限数量的玩家，未命中的请求由载入线程合并，
+ * 每批对GamePlayer、GamePlayerBind与GamePlayerItems各执行一次 IN (...) 查询；
+ * 同一玩家的并发请求共享同一次载入
+ *
+ * 超出容量时按最近最少使用淘汰没有被外部持有的玩家：先写回背包的修改并等待提交，
+ * 只淘汰确认写回成功的玩家，写回失败的玩家继续保留在内存中并保留修改标记，等待下一次淘汰时重试
+ */
+class PlayerWorkingSet {
+public:
+    //载入耗时分布按微秒取对数分桶：[0,1), [1,2), [2,4) ... [2^(n-2), +inf)
+    static constexpr size_t kHistogramBuckets = 24;
+
+    struct Options {
+        //最多保留的玩家数，被外部持有的玩家不会被淘汰，因此实际数量可能暂时超出
+        size_t capacity = 4096;
+        //单批最多载入的玩家数
+        size_t maxBatchSize = 256;
+        //从批次中第一个请求到开始载入的最长等待时间
+        //为0时立即载入，载入期间到达的请求自然合并为下一批
+        std::chrono::microseconds maxBatchDelay { 0 };
+    };
+
+    struct Statistics {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        //等待其它请求正在进行的载入的次数
+        uint64_t coalesced = 0;
+        uint64_t evictions = 0;
+        //因写回失败而未能淘汰的次数
+        uint64_t evictionFailures = 0;
+        uint64_t batches = 0;
+        uint64_t loadedPlayers = 0;
+        //未命中请求从发出到取得玩家的耗时
+        uint64_t totalLoadNanoseconds = 0;
+        uint64_t maxLoadNanoseconds = 0;
+        std::array<uint64_t, kHistogramBuckets> loadHistogram {};
+        size_t size = 0;
+
+        double hitRate() const noexcept
+        {
+            auto total = hits + misses + coalesced;
+            return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+        }
+
+        /**
+         * @brief 由分布估算的载入耗时分位数（取所在桶的上界）
+         */
+        std::chrono::microseconds loadPercentile(double p) const noexcept;
+    };
+
+    using PlayerPtr = std::shared_ptr<Player>;
+
+    PlayerWorkingSet(sqlite::database_manager database, LoggerBase::SharedPtr logger, const Options& options);
+    PlayerWorkingSet(sqlite::database_manager database, LoggerBase::SharedPtr logger)
+        : PlayerWorkingSet(std::move(database), std::move(logger), Options {})
+    {
+    }
+
+    ~PlayerWorkingSet() noexcept;
+
+    PlayerWorkingSet(const PlayerWorkingSet&) = delete;
+    PlayerWorkingSet& operator=(const PlayerWorkingSet&) = delete;
+
+    /**
+     * @brief 启动载入线程
+     * @param queue 用于写回背包的延迟写入队列，为空时同步写回
+     */
+    bool start(WriteBehindQueue* queue);
+
+    /**
+     * @brief 停止载入线程，并写回全部玩家的修改
+     * 修改经由延迟写入队列写回，因此需在队列停止之前调用
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief 取得玩家，未载入时等待载入完成
+     * @return 若玩家不存在、载入失败或未运行则返回nullptr
+     */
+    PlayerPtr acquire(int64_t playerId);
+
+    /**
+     * @brief 批量取得玩家，未载入的玩家在同一批次中载入
+     * @return 按playerIds顺序排列，不存在的玩家为nullptr
+     */
+    std::vector<PlayerPtr> acquire(const std::vector<int64_t>& playerIds);
+
+    /**
+     * @brief 预先载入玩家而不等待，用于登录高峰前批量预取
+     */
+    void prefetch(const std::vector<int64_t>& playerIds);
+
+    /**
+     * @brief 写回全部玩家背包的修改，通常在每帧结束时于游戏线程调用
+     */
+    bool flush();
+
+    Statistics statistics() const;
+
+private:
+    struct Entry {
+        PlayerPtr player;
+        std::list<int64_t>::iterator lru;
+        //正在为淘汰而写回，期间对该玩家的请求等待写回结束
+        bool evicting = false;
+    };
+
+    struct Loading {
+        std::promise<PlayerPtr> promise;
+        std::shared_future<PlayerPtr> future;
+    };
+
+    sqlite::database_manager mDatabase;
+    LoggerBase::SharedPtr mLogger;
+    Options mOptions;
+    WriteBehindQueue* mQueue = nullptr;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mHasPending;
+
+    std::unordered_map<int64_t, Entry> mPlayers;
+    //最近使用的在前
+    std::list<int64_t> mLru;
+
+    std::unordered_map<int64_t, Loading> mLoading;
+    std::vector<int64_t> mPending;
+
+    Statistics mStatistics;
+
+    bool mRunning = false;
+    std::thread mLoader;
+
+    /**
+     * @brief 在持有mMutex时取得已载入的玩家或正在进行的载入
+     * @return 若都不存在则登记新的载入请求
+     */
+    std::shared_future<PlayerPtr> request(int64_t playerId, PlayerPtr& player);
+
+    void loaderLoop();
+
+    std::unordered_map<int64_t, PlayerPtr> loadBatch(const std::vector<int64_t>& playerIds);
+
+    /**
+     * @brief 在持有mMutex时选出超出容量的空闲玩家并标记为正在淘汰，返回需要在锁外写回的玩家
+     */
+    std::vector<PlayerPtr> selectEvictions();
+
+    /**
+     * @brief 在持有mMutex时淘汰写回成功的玩家，写回失败或在写回期间被请求的玩家继续保留
+     * @param written 与players一一对应的写回结果
+     */
+    void evict(const std::vector<PlayerPtr>& players, const std::vector<uint8_t>& written);
+
+    bool flush(const std::vector<PlayerPtr>& players);
+
+    /**
+     * @brief 写回玩家并等待提交
+     * @return 与players一一对应的写回结果
+     */
+    std::vector<uint8_t> writeBack(const std::vector<PlayerPtr>& players);
+
+    void recordLoad(std::chrono::steady_clock::time_point begin);
+};
+
+}
@@ -0,0 +1,421 @@
+#include "asset_manifest.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <system_error>
+#include <iterator>
+#include <thread>
+
+#include "cppcrc/code_crc32.hh"
+#include "cppcrc/encoder.hh"
+#include "md5/md5.h"
+#include "thread/thread_pool.hpp"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace core;
+
+namespace {
+
+constexpr char kMagic[8] = { 'K', 'G', 'M', 'A', 'N', 'I', 'F', 'S' };
+constexpr uint32_t kVersion = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    //其后所有记录的CRC32
+    uint32_t crc32;
+    uint32_t reserved;
+};
+
+//每条记录：size, mtime, crc32, md5, 路径长度, 路径
+constexpr size_t kRecordSize = sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint32_t) + 16 + sizeof(uint16_t);
+
+template <typename T>
+void append(std::string& buffer, const T& value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void take(const char*& at, T& value)
+{
+    std::memcpy(&value, at, sizeof(T));
+    at += sizeof(T);
+}
+
+uint32_t checksum(const char* data, size_t size)
+{
+    crc::Encoder encoder(crc::CodeCrc32::instance());
+    encoder.update(reinterpret_cast<const uint8_t*>(data), size);
+    return static_cast<uint32_t>(encoder.value());
+}
+
+#ifndef _WIN32
+
+/**
+ * @brief 递归遍历目录，以相对游戏根目录的路径、大小与修改时间访问每个普通文件
+ * 文件相对所在目录的句柄取得元数据，每个文件只需一次stat
+ * @param path 当前目录相对游戏根目录的路径，遍历时在其后拼接子路径
+ * @return 目录不存在时返回false且errno为ENOENT
+ */
+template <typename Visitor>
+bool scanDirectory(int parent, const char* name, std::string& path, Visitor& visitor)
+{
+    int fd = openat(parent, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    auto dir = fdopendir(fd);
+    if (dir == nullptr) {
+        close(fd);
+        return false;
+    }
+
+    bool ok = true;
+    auto length = path.size();
+    while (auto item = readdir(dir)) {
+        if (std::strcmp(item->d_name, ".") == 0 || std::strcmp(item->d_name, "..") == 0) {
+            continue;
+        }
+        path.resize(length);
+        path += '/';
+        path += item->d_name;
+
+        if (item->d_type == DT_DIR) {
+            ok = scanDirectory(fd, item->d_name, path, visitor);
+        } else if (item->d_type == DT_REG || item->d_type == DT_LNK || item->d_type == DT_UNKNOWN) {
+            struct stat st;
+            ok = fstatat(fd, item->d_name, &st, 0) == 0;
+            if (ok && S_ISDIR(st.st_mode)) {
+                ok = scanDirectory(fd, item->d_name, path, visitor);
+            } else if (ok && S_ISREG(st.st_mode)) {
+                visitor(path, static_cast<uint64_t>(st.st_size), static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec);
+            }
+        }
+        //遍历期间被删除的文件按不存在处理
+        if (!ok && errno != ENOENT) {
+            break;
+        }
+        ok = true;
+    }
+    closedir(dir);
+    path.resize(length);
+    return ok;
+}
+
+#endif
+
+/**
+ * @brief 需要重新计算的文件
+ */
+struct Pending {
+    std::string path;
+    AssetManifest::Entry entry;
+    //清单中原有的记录，新增文件为nullptr
+    const AssetManifest::Entry* recorded;
+};
+
+}
+
+AssetManifest::AssetManifest(LoggerBase::SharedPtr logger, std::string rootDir, const Options& options)
+    : mLogger(std::move(logger))
+    , mRootDir(std::move(rootDir))
+    , mOptions(options)
+{
+}
+
+bool AssetManifest::hashFile(const std::string& path, Entry& entry) noexcept
+{
+    auto file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    crc::Encoder crc32(crc::CodeCrc32::instance());
+    md5::MD5 md5;
+    std::vector<uint8_t> buffer(256 * 1024);
+    size_t read = 0;
+    uint64_t size = 0;
+    while ((read = std::fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+        crc32.update(buffer.data(), read);
+        md5.update(static_cast<const void*>(buffer.data()), read);
+        size += read;
+    }
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+
+    entry.size = size;
+    entry.crc32 = static_cast<uint32_t>(crc32.value());
+    std::memcpy(entry.md5.data(), md5.digest(), entry.md5.size());
+    return ok;
+}
+
+const AssetManifest::Entry* AssetManifest::find(std::string_view path) const
+{
+    auto it = mEntries.find(std::string(path));
+    return it != mEntries.end() ? &it->second.entry : nullptr;
+}
+
+bool AssetManifest::load()
+{
+    mEntries.clear();
+
+    std::ifstream is(fmt::format("{}/{}", mRootDir, mOptions.path), std::ios::binary | std::ios::ate);
+    if (!is) {
+        return false;
+    }
+    std::string data(static_cast<size_t>(is.tellg()), '\0');
+    if (!is.seekg(0).read(data.data(), static_cast<std::streamsize>(data.size()))) {
+        return false;
+    }
+
+    FileHeader header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion
+        || header.crc32 != checksum(data.data() + sizeof(header), data.size() - sizeof(header))) {
+        return false;
+    }
+
+    const char* at = data.data() + sizeof(header);
+    const char* end = data.data() + data.size();
+    mEntries.reserve(header.count);
+    for (uint32_t i = 0; i < header.count; ++i) {
+        if (static_cast<size_t>(end - at) < kRecordSize) {
+            mEntries.clear();
+            return false;
+        }
+        Entry entry;
+        uint16_t length;
+        take(at, entry.size);
+        take(at, entry.mtime);
+        take(at, entry.crc32);
+        take(at, entry.md5);
+        take(at, length);
+        if (end - at < length) {
+            mEntries.clear();
+            return false;
+        }
+        mEntries.emplace(std::string(at, length), Record { entry });
+        at += length;
+    }
+    return true;
+}
+
+bool AssetManifest::save() const
+{
+    std::string buffer(sizeof(FileHeader), '\0');
+    buffer.reserve(sizeof(FileHeader) + mEntries.size() * (kRecordSize + 48));
+    for (auto& [path, record] : mEntries) {
+        auto& entry = record.entry;
+        append(buffer, entry.size);
+        append(buffer, entry.mtime);
+        append(buffer, entry.crc32);
+        append(buffer, entry.md5);
+        append(buffer, static_cast<uint16_t>(path.size()));
+        buffer.append(path);
+    }
+
+    FileHeader header {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.count = static_cast<uint32_t>(mEntries.size());
+    header.crc32 = checksum(buffer.data() + sizeof(header), buffer.size() - sizeof(header));
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    //先写入临时文件再替换，中途退出不会留下不完整的清单
+    auto path = fmt::format("{}/{}", mRootDir, mOptions.path);
+    auto temporary = path + ".tmp";
+    {
+        std::ofstream os(temporary, std::ios::binary | std::ios::trunc);
+        if (!os.write(buffer.data(), static_cast<std::streamsize>(buffer.size())) || !os.flush()) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    return !ec;
+}
+
+bool AssetManifest::verify() noexcept
+{
+    //校验需要分配内存、创建线程与写日志，其中的异常都视为校验失败
+    try {
+        return verifyFiles();
+    } catch (const std::exception& e) {
+        try {
+            mLogger->error("AssetManifest::verify", "verification failed: {}", e.what());
+        } catch (...) {
+        }
+    } catch (...) {
+    }
+    return false;
+}
+
+bool AssetManifest::verifyFiles()
+{
+    auto begin = std::chrono::steady_clock::now();
+    mStatistics = Statistics {};
+
+    if (!load()) {
+        std::error_code ec;
+        if (std::filesystem::exists(fmt::format("{}/{}", mRootDir, mOptions.path), ec)) {
+            mLogger->warn("AssetManifest::verify", "{} is corrupted, all assets will be rehashed", mOptions.path);
+        }
+    }
+
+    //遍历资源目录，元数据未变化的文件沿用原记录
+    std::vector<Pending> pending;
+    size_t found = 0;
+
+    auto visit = [&](const std::string& path, uint64_t size, int64_t mtime) {
+        auto recorded = mEntries.find(path);
+        if (recorded != mEntries.end()) {
+            ++found;
+            recorded->second.seen = true;
+            if (recorded->second.entry.size == size && recorded->second.entry.mtime == mtime) {
+                return;
+            }
+        }
+        Entry entry;
+        entry.size = size;
+        entry.mtime = mtime;
+        pending.push_back({ path, entry, recorded != mEntries.end() ? &recorded->second.entry : nullptr });
+    };
+
+    for (auto& directory : mOptions.directories) {
+#ifndef _WIN32
+        std::string path = directory;
+        if (!scanDirectory(AT_FDCWD, fmt::format("{}/{}", mRootDir, directory).c_str(), path, visit) && errno != ENOENT) {
+            mLogger->error("AssetManifest::verify", "failed to scan {}: {}", path, std::strerror(errno));
+            return false;
+        }
+#else
+        std::error_code ec;
+        auto prefixLength = mRootDir.size() + 1;
+        std::filesystem::recursive_directory_iterator it(fmt::format("{}/{}", mRootDir, directory), ec), end;
+        for (; !ec && it != end; it.increment(ec)) {
+            if (!it->is_regular_file(ec)) {
+                continue;
+            }
+            auto size = it->file_size(ec);
+            auto mtime = it->last_write_time(ec);
+            if (ec) {
+                break;
+            }
+            visit(it->path().generic_string().substr(prefixLength), size,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count());
+        }
+        if (ec && ec != std::errc::no_such_file_or_directory) {
+            mLogger->error("AssetManifest::verify", "failed to scan {}: {}", directory, ec.message());
+            return false;
+        }
+#endif
+    }
+
+    //清单中有记录但未再遇到的文件已被删除
+    if (found != mEntries.size()) {
+        for (auto& [path, record] : mEntries) {
+            if (record.seen) {
+                continue;
+            }
+            if (!mOptions.acceptChanges) {
+                mLogger->error("AssetManifest::verify", "{} is missing", path);
+                return false;
+            }
+            ++mStatistics.removed;
+        }
+    }
+
+    //并行重新计算，任何一个文件不一致后其余线程不再领取新文件
+    std::atomic<size_t> next { 0 };
+    std::atomic<bool> failed { false };
+    auto work = [&]() {
+        while (!failed) {
+            auto i = next++;
+            if (i >= pending.size()) {
+                break;
+            }
+            auto& file = pending[i];
+            auto mtime = file.entry.mtime;
+            if (!hashFile(fmt::format("{}/{}", mRootDir, file.path), file.entry)) {
+                mLogger->error("AssetManifest::verify", "unable to read {}", file.path);
+                failed = true;
+                break;
+            }
+            file.entry.mtime = mtime;
+
+            auto recorded = file.recorded;
+            if (recorded != nullptr && !mOptions.acceptChanges
+                && (recorded->size != file.entry.size || recorded->crc32 != file.entry.crc32 || recorded->md5 != file.entry.md5)) {
+                mLogger->error("AssetManifest::verify", "{} does not match the manifest", file.path);
+                failed = true;
+                break;
+            }
+        }
+    };
+
+    if (!pending.empty()) {
+        auto threads = mOptions.threads != 0 ? mOptions.threads : std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min(threads, pending.size());
+
+        std::vector<std::promise<void>> done(threads);
+        {
+            ThreadPool pool(threads);
+            for (auto& promise : done) {
+                pool.commit([&work, &promise] {
+                    work();
+                    promise.set_value();
+                });
+            }
+            for (auto& promise : done) {
+                promise.get_future().wait();
+            }
+        }
+
+        if (failed) {
+            return false;
+        }
+    }
+
+    if (mStatistics.removed != 0) {
+        for (auto it = mEntries.begin(); it != mEntries.end();) {
+            it = it->second.seen ? std::next(it) : mEntries.erase(it);
+        }
+    }
+    for (auto& file : pending) {
+        if (file.recorded == nullptr) {
+            ++mStatistics.added;
+        }
+        mEntries[std::move(file.path)] = Record { file.entry, true };
+    }
+
+    mStatistics.files = mEntries.size();
+    mStatistics.hashed = pending.size();
+
+    if ((mStatistics.hashed != 0 || mStatistics.removed != 0) && !save()) {
+        //清单只是缓存，写入失败不影响本次校验结果
+        mLogger->warn("AssetManifest::verify", "failed to write {}", mOptions.path);
+    }
+
+    mStatistics.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+    mLogger->info("AssetManifest::verify", "{} files verified, {} rehashed, {} added, {} removed in {} ms", mStatistics.files,
+        mStatistics.hashed, mStatistics.added, mStatistics.removed, mStatistics.duration.count() / 1000.0);
+    return true;
+}
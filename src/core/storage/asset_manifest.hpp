@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "logger/logger.hpp"
+
+namespace core {
+
+/**
+ * @brief 资源文件完整性清单
+ * 记录游戏根目录下资源与结构文件的路径、大小、修改时间、CRC32与MD5，保存为cache/manifest.bin。
+ * 启动校验时大小与修改时间均未变化的文件直接信任清单，只有元数据变化的文件才并行重新计算，
+ * 内容与清单不一致或文件缺失即视为校验失败
+ */
+class AssetManifest {
+public:
+    struct Options {
+        //需要校验的目录，相对游戏根目录
+        std::vector<std::string> directories { "assert" };
+        //清单文件，相对游戏根目录
+        std::string path = "cache/manifest.bin";
+        //接受与清单不一致的内容并更新清单，用于发布新资源后重建清单
+        bool acceptChanges = false;
+        //并行计算的线程数，为0时使用硬件线程数
+        size_t threads = 0;
+    };
+
+    struct Entry {
+        uint64_t size = 0;
+        //修改时间，自纪元起的纳秒数
+        int64_t mtime = 0;
+        uint32_t crc32 = 0;
+        std::array<uint8_t, 16> md5 {};
+    };
+
+    struct Statistics {
+        //清单中的文件数
+        size_t files = 0;
+        //因元数据变化或新增而重新计算的文件数
+        size_t hashed = 0;
+        size_t added = 0;
+        size_t removed = 0;
+        std::chrono::microseconds duration { 0 };
+    };
+
+    AssetManifest(LoggerBase::SharedPtr logger, std::string rootDir, const Options& options);
+    AssetManifest(LoggerBase::SharedPtr logger, std::string rootDir)
+        : AssetManifest(std::move(logger), std::move(rootDir), Options {})
+    {
+    }
+
+    AssetManifest(const AssetManifest&) = delete;
+    AssetManifest& operator=(const AssetManifest&) = delete;
+
+    /**
+     * @brief 校验资源文件并在有变化时写回清单
+     * 不存在或已损坏的清单按空清单处理，所有文件都作为新增文件计算
+     * @return 有文件内容不一致、缺失、无法读取或校验过程中出错时返回false，此时不更新清单
+     */
+    bool verify() noexcept;
+
+    /**
+     * @brief 查找文件的记录
+     * @param path 相对游戏根目录的路径，以'/'分隔
+     * @return 若清单中不存在则返回nullptr
+     */
+    const Entry* find(std::string_view path) const;
+
+    const Statistics& statistics() const noexcept
+    {
+        return mStatistics;
+    }
+
+    /**
+     * @brief 计算文件的CRC32与MD5
+     */
+    static bool hashFile(const std::string& path, Entry& entry) noexcept;
+
+private:
+    LoggerBase::SharedPtr mLogger;
+    std::string mRootDir;
+    Options mOptions;
+
+    struct Record {
+        Entry entry;
+        //本次校验中是否在资源目录中遇到
+        bool seen = false;
+    };
+
+    std::unordered_map<std::string, Record> mEntries;
+    Statistics mStatistics;
+
+    bool verifyFiles();
+    bool load();
+    bool save() const;
+};
+
+}
@@ -0,0 +1,115 @@
+#include "database_checkpoint.hpp"
+
+using namespace core;
+
+DatabaseCheckpoint::DatabaseCheckpoint(LoggerBase::SharedPtr logger, const DatabaseSnapshot::Options& options)
+    : mLogger(logger)
+    , mSnapshot(logger, options)
+{
+}
+
+DatabaseCheckpoint::~DatabaseCheckpoint() noexcept
+{
+    stop();
+}
+
+bool DatabaseCheckpoint::start(const sqlite::database_manager& database, std::string path, std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRunning) {
+        return false;
+    }
+
+    mDatabase = database;
+    mPath = std::move(path);
+    mInterval = interval;
+    mRunning = true;
+
+    mTimer = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mRunning) {
+            if (mCv.wait_for(lock, mInterval, [this] { return !mRunning; })) {
+                break;
+            }
+
+            lock.unlock();
+            checkpoint();
+            lock.lock();
+        }
+    });
+
+    return true;
+}
+
+bool DatabaseCheckpoint::stop() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRunning) {
+            return true;
+        }
+        mRunning = false;
+    }
+    mCv.notify_all();
+
+    if (mTimer.joinable()) {
+        mTimer.join();
+    }
+
+    return checkpoint();
+}
+
+bool DatabaseCheckpoint::readVersion(Version& version) const noexcept
+{
+    version.changes = mDatabase.total_changes();
+
+    //data_version只反映其它连接提交的更改，本连接的更改由total_changes反映，两者都不包括表结构的更改
+    auto dataVersion = mDatabase.query("pragma_data_version", "data_version");
+    auto schemaVersion = mDatabase.query("pragma_schema_version", "schema_version");
+    if (version.changes < 0 || dataVersion.step() != SQLITE_ROW || schemaVersion.step() != SQLITE_ROW) {
+        return false;
+    }
+
+    version.dataVersion = dataVersion.column_int64(0);
+    version.schemaVersion = schemaVersion.column_int64(0);
+    return true;
+}
+
+bool DatabaseCheckpoint::checkpoint() noexcept
+{
+    std::lock_guard<std::mutex> guard(mCheckpointMutex);
+
+    //在快照之前读取版本，快照期间的更改会使下一次写回不被跳过
+    Version version;
+    bool versioned = readVersion(version);
+    if (versioned && mWritten && version == mWrittenVersion) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mStatistics.skipped;
+        return true;
+    }
+
+    DatabaseSnapshot::Result result;
+    if (mSnapshot.start(mDatabase, mPath, [&result](const DatabaseSnapshot::Result& r) { result = r; })) {
+        mSnapshot.wait();
+    }
+
+    mWritten = result.success && versioned;
+    mWrittenVersion = version;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (result.success) {
+        ++mStatistics.count;
+        mStatistics.lastDuration = result.duration;
+        mStatistics.lastMaxStep = result.maxStep;
+        mStatistics.lastSuccess = std::chrono::system_clock::now();
+    } else {
+        ++mStatistics.failures;
+    }
+    return result.success;
+}
+
+DatabaseCheckpoint::Statistics DatabaseCheckpoint::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStatistics;
+}
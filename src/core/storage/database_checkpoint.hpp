@@ -0,0 +1,123 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cinttypes>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "database_snapshot.hpp"
+#include "logger/logger.hpp"
+#include "sqlite/sqlite3.hpp"
+
+namespace core {
+
+/**
+ * @brief 游戏数据库的运行模式
+ */
+enum class DatabaseMode {
+    //直接读写磁盘上的db/game.db
+    disk,
+    //在私有内存数据库中运行，启动时从db/game.db载入并定期写回
+    memory,
+    //与memory相同，但使用共享缓存的内存数据库，同一进程中的其它连接可按Context::getGameDBUri取得的URI访问
+    sharedMemory
+};
+
+struct DatabaseOptions {
+    DatabaseMode mode = DatabaseMode::disk;
+    //内存模式下写回磁盘的间隔，即崩溃时最多丢失的数据时长
+    std::chrono::milliseconds checkpointInterval { 30000 };
+    //写回时的分批参数
+    DatabaseSnapshot::Options checkpoint {};
+};
+
+/**
+ * @brief 内存数据库检查点
+ * 定期将内存数据库以在线快照的方式分批写回磁盘文件，写回先写入临时文件再替换，
+ * 因此磁盘上的文件始终是某个完整的检查点。
+ * 写回前比较数据库的版本（本连接的更改行数、其它连接的提交次数与表结构版本），
+ * 自上次成功写回后没有变化时跳过本次写回
+ */
+class DatabaseCheckpoint {
+public:
+    struct Statistics {
+        //成功写回的次数
+        size_t count = 0;
+        size_t failures = 0;
+        //数据库没有变化而跳过的次数
+        size_t skipped = 0;
+        std::chrono::microseconds lastDuration { 0 };
+        //最近一次写回中单批复制的最长耗时
+        std::chrono::microseconds lastMaxStep { 0 };
+        //最近一次成功写回的时间
+        std::chrono::system_clock::time_point lastSuccess {};
+    };
+
+    DatabaseCheckpoint(LoggerBase::SharedPtr logger, const DatabaseSnapshot::Options& options);
+
+    ~DatabaseCheckpoint() noexcept;
+
+    DatabaseCheckpoint(const DatabaseCheckpoint&) = delete;
+    DatabaseCheckpoint& operator=(const DatabaseCheckpoint&) = delete;
+
+    /**
+     * @brief 开始定期写回
+     * @param path 写回的磁盘文件路径
+     */
+    bool start(const sqlite::database_manager& database, std::string path, std::chrono::milliseconds interval);
+
+    /**
+     * @brief 停止定期写回，并同步执行最后一次写回
+     * @return 最后一次写回是否成功，若未启动则返回true
+     */
+    bool stop() noexcept;
+
+    /**
+     * @brief 立即同步执行一次写回
+     */
+    bool checkpoint() noexcept;
+
+    Statistics statistics() const;
+
+private:
+    struct Version {
+        int64_t changes = -1;
+        int64_t dataVersion = -1;
+        int64_t schemaVersion = -1;
+
+        bool operator==(const Version& other) const noexcept
+        {
+            return changes == other.changes && dataVersion == other.dataVersion && schemaVersion == other.schemaVersion;
+        }
+    };
+
+    /**
+     * @brief 读取数据库的当前版本
+     * @return 读取失败时返回false
+     */
+    bool readVersion(Version& version) const noexcept;
+
+    LoggerBase::SharedPtr mLogger;
+    DatabaseSnapshot mSnapshot;
+
+    sqlite::database_manager mDatabase;
+    std::string mPath;
+    std::chrono::milliseconds mInterval { 0 };
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCv;
+    bool mRunning = false;
+    std::thread mTimer;
+
+    //保证同一时间只有一次写回
+    std::mutex mCheckpointMutex;
+    //最近一次成功写回时的数据库版本
+    bool mWritten = false;
+    Version mWrittenVersion;
+
+    Statistics mStatistics;
+};
+
+}
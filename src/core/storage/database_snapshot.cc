@@ -0,0 +1,175 @@
+#include "database_snapshot.hpp"
+
+#include <filesystem>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace core;
+
+static bool syncFile(const std::string& path) noexcept
+{
+#ifdef _WIN32
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool success = ::fsync(fd) == 0;
+    ::close(fd);
+    return success;
+#endif
+}
+
+DatabaseSnapshot::DatabaseSnapshot(LoggerBase::SharedPtr logger, const Options& options)
+    : mLogger(std::move(logger))
+    , mOptions(options)
+{
+}
+
+DatabaseSnapshot::~DatabaseSnapshot() noexcept
+{
+    cancel();
+    wait();
+}
+
+bool DatabaseSnapshot::start(const sqlite::database_manager& database, std::string path, Completion completion)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRunning) {
+        return false;
+    }
+
+    //回收上一次已结束的线程
+    if (mWorker.joinable()) {
+        mWorker.join();
+    }
+
+    mRunning = true;
+    mCancelled = false;
+    mRemaining = 0;
+    mPageCount = 0;
+
+    mWorker = std::thread([this, database, path = std::move(path), completion = std::move(completion)]() {
+        auto result = run(database, path);
+
+        if (result.success) {
+            mLogger->info("DatabaseSnapshot", "snapshot {} completed: {} pages in {} steps, {} ms, max step {} us, {} steps over budget",
+                result.path, result.pageCount, result.steps, result.duration.count() / 1000, result.maxStep.count(), result.stepsOverBudget);
+        } else {
+            mLogger->error("DatabaseSnapshot", "snapshot {} failed after {} ms", result.path, result.duration.count() / 1000);
+        }
+
+        if (completion) {
+            completion(result);
+        }
+        mRunning = false;
+    });
+
+    return true;
+}
+
+DatabaseSnapshot::Result DatabaseSnapshot::run(const sqlite::database_manager& database, const std::string& path)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Result result;
+    result.path = path;
+
+    auto temporary = path + ".tmp";
+    std::error_code ec;
+    std::filesystem::remove(temporary, ec);
+
+    auto begin = Clock::now();
+    auto stepBegin = begin;
+
+    auto budget = mOptions.stepBudget;
+    auto maxPages = std::max(mOptions.maxPagesPerStep, 1);
+    auto onStep = [&](int32_t remaining, int32_t pageCount, int32_t& pagesPerStep) {
+        auto now = Clock::now();
+        auto step = std::chrono::duration_cast<std::chrono::microseconds>(now - stepBegin);
+        result.maxStep = std::max(result.maxStep, step);
+        ++result.steps;
+
+        //按本批的实测耗时调整下一批的页数：超出预算时按比例缩小，不到预算一半时加倍
+        if (budget.count() > 0 && pagesPerStep > 0) {
+            if (step > budget) {
+                ++result.stepsOverBudget;
+                pagesPerStep = std::max<int32_t>(1, static_cast<int32_t>(pagesPerStep * budget.count() / step.count()));
+            } else if (step * 2 < budget) {
+                pagesPerStep = std::min(maxPages, pagesPerStep * 2);
+            }
+        }
+        result.pagesPerStep = pagesPerStep;
+
+        mRemaining = remaining;
+        mPageCount = pageCount;
+
+        if (mCancelled) {
+            return false;
+        }
+
+        if (remaining > 0) {
+            std::this_thread::sleep_for(mOptions.yield);
+        }
+        stepBegin = Clock::now();
+        return true;
+    };
+
+    {
+        //快照文件在完成前只是临时文件，无需日志与同步写入；否则最后一批复制时目标库提交的fsync
+        //会在持有源数据库连接锁期间执行，造成明显的卡顿。完成后再在锁外统一落盘。
+        //目标库的写事务持续到备份完成，页缓存设小后每批复制的页随即写出，而不是积攒到最后一批一次写出
+        sqlite::database_manager destination(temporary, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        result.success = destination
+            && destination.exec("PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF; PRAGMA cache_size = 16;")
+            && database.backup(destination, mOptions.pagesPerStep, onStep);
+        result.success = destination.close() && result.success && syncFile(temporary);
+    }
+
+    auto end = Clock::now();
+    result.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+    result.pageCount = mPageCount;
+
+    if (result.success) {
+        std::filesystem::rename(temporary, path, ec);
+        result.success = !ec;
+    }
+
+    if (!result.success) {
+        std::filesystem::remove(temporary, ec);
+    }
+
+    return result;
+}
+
+bool DatabaseSnapshot::isRunning() const noexcept
+{
+    return mRunning;
+}
+
+double DatabaseSnapshot::progress() const noexcept
+{
+    int32_t pageCount = mPageCount;
+    if (pageCount <= 0) {
+        return mRunning ? 0.0 : 1.0;
+    }
+    return 1.0 - static_cast<double>(mRemaining) / static_cast<double>(pageCount);
+}
+
+void DatabaseSnapshot::cancel() noexcept
+{
+    mCancelled = true;
+}
+
+void DatabaseSnapshot::wait() noexcept
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mWorker.joinable()) {
+        mWorker.join();
+    }
+}
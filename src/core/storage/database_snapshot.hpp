@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "logger/logger.hpp"
+#include "sqlite/sqlite3.hpp"
+
+namespace core {
+
+/**
+ * @brief 数据库在线快照
+ * 在后台线程中通过sqlite备份接口分批复制数据库，每批只短暂持有连接锁，
+ * 批次之间让出执行，使游戏线程在快照期间几乎不被阻塞。
+ * 每批的页数按实测耗时调整，使单批耗时保持在stepBudget以内，与页大小和磁盘速度无关
+ */
+class DatabaseSnapshot {
+public:
+    struct Options {
+        //每批复制的初始页数
+        int32_t pagesPerStep = 32;
+        //每批页数的上限
+        int32_t maxPagesPerStep = 1024;
+        //单批复制的目标耗时，即单次持有连接锁的时长；超过时减少每批页数，远低于时增加
+        //为0时始终按pagesPerStep复制
+        std::chrono::microseconds stepBudget { 250 };
+        //两批之间的让出时长
+        std::chrono::microseconds yield { 500 };
+    };
+
+    struct Result {
+        bool success = false;
+        std::string path;
+        //数据库总页数
+        int32_t pageCount = 0;
+        //复制批次数
+        size_t steps = 0;
+        //快照总耗时
+        std::chrono::microseconds duration { 0 };
+        //单批复制的最长耗时（包括等待连接锁），即快照对游戏线程造成的最大阻塞
+        std::chrono::microseconds maxStep { 0 };
+        //超过stepBudget的批次数
+        size_t stepsOverBudget = 0;
+        //结束时的每批页数
+        int32_t pagesPerStep = 0;
+    };
+
+    using Completion = std::function<void(const Result&)>;
+
+    DatabaseSnapshot(LoggerBase::SharedPtr logger, const Options& options);
+    explicit DatabaseSnapshot(LoggerBase::SharedPtr logger)
+        : DatabaseSnapshot(std::move(logger), Options {})
+    {
+    }
+
+    ~DatabaseSnapshot() noexcept;
+
+    DatabaseSnapshot(const DatabaseSnapshot&) = delete;
+    DatabaseSnapshot& operator=(const DatabaseSnapshot&) = delete;
+
+    /**
+     * @brief 开始快照
+     * 先写入path.tmp，完成后再重命名为path，因此path要么不存在要么是完整的快照
+     * @param completion 在后台线程中以快照结果调用
+     * @return 若已有快照正在进行则返回false
+     */
+    bool start(const sqlite::database_manager& database, std::string path, Completion completion = nullptr);
+
+    bool isRunning() const noexcept;
+
+    /**
+     * @brief 当前快照的进度，范围[0, 1]
+     */
+    double progress() const noexcept;
+
+    /**
+     * @brief 中止正在进行的快照
+     */
+    void cancel() noexcept;
+
+    /**
+     * @brief 等待正在进行的快照结束
+     */
+    void wait() noexcept;
+
+private:
+    LoggerBase::SharedPtr mLogger;
+    Options mOptions;
+
+    std::mutex mMutex;
+    std::thread mWorker;
+
+    std::atomic_bool mRunning { false };
+    std::atomic_bool mCancelled { false };
+    std::atomic<int32_t> mRemaining { 0 };
+    std::atomic<int32_t> mPageCount { 0 };
+
+    Result run(const sqlite::database_manager& database, const std::string& path);
+};
+
+}
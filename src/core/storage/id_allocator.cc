@@ -0,0 +1,79 @@
+#include "id_allocator.hpp"
+
+using namespace core;
+
+IdAllocator::IdAllocator(sqlite::database_manager database, LoggerBase::SharedPtr logger, std::string table, const Options& options)
+    : mDatabase(std::move(database))
+    , mLogger(std::move(logger))
+    , mTable(std::move(table))
+    , mOptions(options)
+{
+    if (mOptions.blockSize <= 0) {
+        mOptions.blockSize = 1;
+    }
+}
+
+IdAllocator::~IdAllocator() noexcept = default;
+
+int64_t IdAllocator::next()
+{
+    while (true) {
+        auto block = mCurrent.load(std::memory_order_acquire);
+        if (block != nullptr) {
+            auto id = block->next.fetch_add(1, std::memory_order_relaxed);
+            if (id <= block->last) {
+                return id;
+            }
+        }
+
+        if (!reserve(block)) {
+            return 0;
+        }
+    }
+}
+
+bool IdAllocator::reserve(Block* exhausted)
+{
+    std::lock_guard<std::mutex> lock(mReserveMutex);
+
+    //其它线程已经预留了新块
+    if (mCurrent.load(std::memory_order_acquire) != exhausted) {
+        return true;
+    }
+
+    auto transaction = mDatabase.begin_transaction();
+    if (!transaction) {
+        mLogger->error("IdAllocator::reserve", "failed to begin transaction for {}", mTable);
+        return false;
+    }
+
+    //表中还没有插入过记录时sqlite_sequence中没有对应的行，以现有的最大rowid为起点
+    auto last = int64_t(0);
+    bool success = transaction.single_step(fmt::format("INSERT INTO sqlite_sequence(name, seq) SELECT ?1, COALESCE((SELECT max(rowid) FROM {}), 0) "
+                                                       "WHERE NOT EXISTS (SELECT 1 FROM sqlite_sequence WHERE name=?1)",
+                                               mTable),
+                       mTable)
+        && transaction.single_step("UPDATE sqlite_sequence SET seq=seq+? WHERE name=?", mOptions.blockSize, mTable);
+
+    if (success) {
+        auto stmt = transaction.prepare("SELECT seq FROM sqlite_sequence WHERE name=?");
+        success = stmt.bind(mTable) && stmt.step() == SQLITE_ROW;
+        if (success) {
+            last = stmt.column<int64_t>(0);
+        }
+    }
+
+    if (!success || !transaction.end_transaction()) {
+        transaction.rollback();
+        mLogger->error("IdAllocator::reserve", "failed to reserve ids for {}", mTable);
+        return false;
+    }
+
+    auto block = std::make_unique<Block>();
+    block->next.store(last - mOptions.blockSize + 1, std::memory_order_relaxed);
+    block->last = last;
+
+    mCurrent.store(block.get(), std::memory_order_release);
+    mBlocks.push_back(std::move(block));
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "logger/logger.hpp"
+#include "sqlite/sqlite3.hpp"
+
+namespace core {
+
+/**
+ * @brief 按块预留的id分配器
+ * 每次在一个事务中将表在sqlite_sequence中的序号推进一整块，之后在内存中无锁地逐个分配，
+ * 因此新记录可以在插入数据库之前就确定id，并交由延迟写入队列异步写入
+ *
+ * 预留的块同样推进了AUTOINCREMENT的序号，仍使用AUTOINCREMENT插入的代码不会与之冲突；
+ * 进程退出时未用完的id被丢弃，id不保证连续
+ */
+class IdAllocator {
+public:
+    struct Options {
+        //每次预留的id数
+        int64_t blockSize = 4096;
+    };
+
+    /**
+     * @param table 使用AUTOINCREMENT主键的表名
+     */
+    IdAllocator(sqlite::database_manager database, LoggerBase::SharedPtr logger, std::string table, const Options& options);
+    IdAllocator(sqlite::database_manager database, LoggerBase::SharedPtr logger, std::string table)
+        : IdAllocator(std::move(database), std::move(logger), std::move(table), Options {})
+    {
+    }
+
+    ~IdAllocator() noexcept;
+
+    IdAllocator(const IdAllocator&) = delete;
+    IdAllocator& operator=(const IdAllocator&) = delete;
+
+    /**
+     * @brief 分配一个新id
+     * 当前块用完时在数据库中预留下一块，因此不能在同一数据库的事务中调用
+     * @return 若预留失败则返回0
+     */
+    int64_t next();
+
+    const std::string& getTable() const noexcept
+    {
+        return mTable;
+    }
+
+private:
+    struct Block {
+        std::atomic<int64_t> next;
+        int64_t last;
+    };
+
+    sqlite::database_manager mDatabase;
+    LoggerBase::SharedPtr mLogger;
+    std::string mTable;
+    Options mOptions;
+
+    std::atomic<Block*> mCurrent { nullptr };
+
+    //预留新块的互斥，同一时间只有一个线程访问数据库
+    std::mutex mReserveMutex;
+    //其它线程可能仍在旧块上执行fetch_add，因此块在分配器销毁前不会释放
+    std::vector<std::unique_ptr<Block>> mBlocks;
+
+    bool reserve(Block* exhausted);
+};
+
+}
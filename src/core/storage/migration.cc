@@ -0,0 +1,122 @@
+#include "migration.hpp"
+
+#include <iterator>
+
+#include "cppcrc/static_encoder.hh"
+
+using namespace core;
+
+static constexpr migration::Step kSteps[] = {
+#include "storage/migrations.inc"
+};
+
+static constexpr bool versionsIncreasing() noexcept
+{
+    for (size_t i = 1; i < std::size(kSteps); ++i) {
+        if (kSteps[i].version <= kSteps[i - 1].version) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//CMake生成时已检查，此处防止手工修改生成的文件
+static_assert(versionsIncreasing(), "migration versions must be unique and increasing");
+
+/**
+ * @brief 编译期计算指定版本的迁移脚本的CRC32
+ * @return 若没有该版本则返回0
+ */
+static constexpr uint64_t scriptChecksum(int32_t version) noexcept
+{
+    for (auto& step : kSteps) {
+        if (step.version == version) {
+            return crc::checksum<crc::Crc32>(step.sql);
+        }
+    }
+    return 0;
+}
+
+//已发布的脚本的CRC32，脚本被修改时编译失败
+static_assert(scriptChecksum(1) == 2198211790u, "0001_init.sql has been published and must not be modified");
+static_assert(scriptChecksum(2) == 1222093722u, "0002_indexes.sql has been published and must not be modified");
+
+const migration::Step* migration::begin() noexcept
+{
+    return std::begin(kSteps);
+}
+
+const migration::Step* migration::end() noexcept
+{
+    return std::end(kSteps);
+}
+
+int32_t migration::latestVersion() noexcept
+{
+    return std::prev(std::end(kSteps))->version;
+}
+
+/**
+ * @brief 检查当前事务中的外键约束
+ * 迁移在事务中执行，无法开启外键检查，重建表时复制的行可能引用了不存在的父行
+ * @return 违反约束的行数，检查失败时返回-1
+ */
+static int64_t foreignKeyViolations(const sqlite::transaction_manager& transaction, const LoggerBase::SharedPtr& logger, std::string_view name) noexcept
+{
+    auto stmt = transaction.prepare("PRAGMA foreign_key_check");
+    int64_t violations = 0;
+    int rc;
+    while ((rc = stmt.step()) == SQLITE_ROW) {
+        if (violations == 0) {
+            logger->error("migration::apply", "{}: {} references missing row in {}", name, stmt.column_text(0), stmt.column_text(2));
+        }
+        ++violations;
+    }
+    return rc == SQLITE_DONE ? violations : -1;
+}
+
+int32_t migration::currentVersion(const sqlite::database_manager& database) noexcept
+{
+    auto stmt = database.query("pragma_user_version", "user_version");
+    return stmt.step() == SQLITE_ROW ? stmt.column_int32(0) : -1;
+}
+
+bool migration::apply(const sqlite::database_manager& database, const LoggerBase::SharedPtr& logger) noexcept
+{
+    auto version = currentVersion(database);
+    if (version < 0) {
+        logger->error("migration::apply", "unable to read schema version");
+        return false;
+    }
+
+    if (version == latestVersion()) {
+        logger->debug("migration::apply", "schema is up to date (version {})", version);
+        return true;
+    }
+
+    if (version > latestVersion()) {
+        logger->error("migration::apply", "schema version {} is newer than supported version {}", version, latestVersion());
+        return false;
+    }
+
+    for (auto step = begin(); step != end(); ++step) {
+        if (step->version <= version) {
+            continue;
+        }
+
+        auto transaction = database.begin_transaction();
+        if (!transaction
+            || !transaction.exec(std::string(step->sql))
+            || foreignKeyViolations(transaction, logger, step->name) != 0
+            || !transaction.exec(fmt::format("PRAGMA user_version = {}", step->version))
+            || !transaction.end_transaction()) {
+            transaction.rollback();
+            logger->error("migration::apply", "{} fails to be executed", step->name);
+            return false;
+        }
+
+        logger->info("migration::apply", "schema migrated to version {} ({})", step->version, step->name);
+    }
+
+    return true;
+}
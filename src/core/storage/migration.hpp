@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cinttypes>
+#include <string_view>
+
+#include "logger/logger.hpp"
+#include "sqlite/sqlite3.hpp"
+
+namespace core::migration {
+
+/**
+ * @brief 数据库结构迁移步骤
+ * 迁移脚本位于assert/model/migrations，文件名以版本号开头，构建时按版本顺序嵌入程序
+ * 已发布的脚本不可修改，结构变更需新增一个更高版本的脚本
+ */
+struct Step {
+    int32_t version;
+    std::string_view name;
+    std::string_view sql;
+};
+
+/**
+ * @brief 嵌入程序的全部迁移步骤，按版本号升序排列
+ */
+const Step* begin() noexcept;
+const Step* end() noexcept;
+
+/**
+ * @brief 程序支持的最新结构版本
+ */
+int32_t latestVersion() noexcept;
+
+/**
+ * @brief 取得数据库当前的结构版本（PRAGMA user_version）
+ * @return 若查询失败则返回-1
+ */
+int32_t currentVersion(const sqlite::database_manager& database) noexcept;
+
+/**
+ * @brief 依次执行尚未应用的迁移步骤
+ * 每个步骤与版本号的更新在同一事务中完成，失败时回滚该步骤并停止
+ * 每个步骤执行后检查外键约束，存在引用了不存在的行的数据时同样回滚并停止
+ * 数据库已是最新版本时不执行任何语句
+ * @return 若迁移失败或数据库版本高于程序支持的版本则返回false
+ */
+bool apply(const sqlite::database_manager& database, const LoggerBase::SharedPtr& logger) noexcept;
+
+}
@@ -0,0 +1,312 @@
+#include "query_profiler.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+using namespace core;
+
+static size_t bucketOf(uint64_t nanoseconds) noexcept
+{
+    auto micros = nanoseconds / 1000;
+    size_t bucket = 0;
+    while (micros != 0 && bucket + 1 < QueryProfiler::kHistogramBuckets) {
+        micros >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+std::chrono::microseconds QueryProfiler::Statistics::percentile(double p) const noexcept
+{
+    auto target = static_cast<uint64_t>(static_cast<double>(calls) * p);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kHistogramBuckets; ++i) {
+        seen += histogram[i];
+        if (seen > target) {
+            return std::chrono::microseconds(std::min<uint64_t>(uint64_t(1) << i, maxNanoseconds / 1000 + 1));
+        }
+    }
+    return std::chrono::microseconds(maxNanoseconds / 1000);
+}
+
+QueryProfiler::QueryProfiler(LoggerBase::SharedPtr logger, const Options& options)
+    : mLogger(std::move(logger))
+    , mOptions(options)
+{
+}
+
+QueryProfiler::~QueryProfiler() noexcept
+{
+    detach();
+}
+
+bool QueryProfiler::attach(const sqlite::database_manager& database)
+{
+    detach();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDatabase = database;
+    }
+
+    //注册与取消注册都不能持有mMutex：回调在持有sqlite连接锁时调用并会获取mMutex
+    if (!database.trace(SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, &QueryProfiler::traceCallback, this)) {
+        mLogger->error("QueryProfiler::attach", "failed to register trace callback");
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDatabase = sqlite::database_manager();
+        return false;
+    }
+    return true;
+}
+
+void QueryProfiler::detach() noexcept
+{
+    sqlite::database_manager database;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        database = mDatabase;
+    }
+
+    //sqlite3_trace_v2返回后该连接上不会再有正在执行的回调
+    if (database) {
+        database.trace(0, nullptr, nullptr);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDatabase = sqlite::database_manager();
+    }
+
+    std::lock_guard<std::mutex> lock(mExplainMutex);
+    mExplainDatabase.close();
+}
+
+void QueryProfiler::setSlowThreshold(std::chrono::microseconds threshold) noexcept
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOptions.slowThreshold = threshold;
+}
+
+int QueryProfiler::traceCallback(unsigned type, void* context, void* p, void* x)
+{
+    //SQLITE_TRACE_PROFILE自带的耗时精度只有毫秒，因此在语句开始时自行记录起始时间
+    //语句总是在执行它的线程上开始和结束，起始时间保存在线程局部的表中即可
+    thread_local std::unordered_map<sqlite3_stmt*, std::chrono::steady_clock::time_point> startTimes;
+
+    auto stmt = static_cast<sqlite3_stmt*>(p);
+    if (type == SQLITE_TRACE_STMT) {
+        startTimes.emplace(stmt, std::chrono::steady_clock::now());
+    } else if (type == SQLITE_TRACE_PROFILE) {
+        auto nanoseconds = static_cast<uint64_t>(*static_cast<sqlite3_int64*>(x));
+        if (auto start = startTimes.find(stmt); start != startTimes.end()) {
+            nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start->second).count());
+            startTimes.erase(start);
+        }
+        static_cast<QueryProfiler*>(context)->record(stmt, nanoseconds);
+    }
+    return 0;
+}
+
+void QueryProfiler::record(sqlite3_stmt* stmt, uint64_t nanoseconds)
+{
+    auto text = sqlite3_sql(stmt);
+    if (text == nullptr) {
+        return;
+    }
+
+    std::string sql, path;
+    bool explainPlan = false;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto normalized = mNormalized.find(text);
+        if (normalized == mNormalized.end()) {
+            //拼接了字面量的语句每条都不同，缓存满时清空，常用语句很快会被重新缓存
+            if (mNormalized.size() >= mOptions.normalizedCacheSize) {
+                mNormalized.clear();
+            }
+            normalized = mNormalized.emplace(text, normalize(text)).first;
+        }
+
+        auto& statistics = mStatistics[normalized->second];
+        if (statistics.calls == 0) {
+            statistics.sql = normalized->second;
+        }
+
+        ++statistics.calls;
+        ++statistics.histogram[bucketOf(nanoseconds)];
+        statistics.totalNanoseconds += nanoseconds;
+        statistics.maxNanoseconds = std::max(statistics.maxNanoseconds, nanoseconds);
+
+        if (nanoseconds < static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(mOptions.slowThreshold).count())) {
+            return;
+        }
+
+        ++statistics.slowCalls;
+        sql = statistics.sql;
+
+        //同一种语句只在第一次变慢时记录查询计划
+        if (mOptions.explainSlowQueries && mExplained.insert(sql).second) {
+            explainPlan = true;
+            path = mDatabase.filename();
+        }
+    }
+
+    //查询计划在mMutex之外取得，打开连接与执行EXPLAIN期间其它语句的统计不受影响
+    if (explainPlan) {
+        mLogger->warn("QueryProfiler", "slow query {:.3f} ms: {}\n{}", nanoseconds / 1e6, sql, explain(path, text));
+    } else {
+        mLogger->warn("QueryProfiler", "slow query {:.3f} ms: {}", nanoseconds / 1e6, sql);
+    }
+}
+
+std::string QueryProfiler::explain(const std::string& path, const std::string& sql)
+{
+    std::lock_guard<std::mutex> lock(mExplainMutex);
+
+    if (!mExplainDatabase) {
+        if (path.empty() || !mExplainDatabase.open(path, SQLITE_OPEN_READONLY)) {
+            return "  (query plan unavailable)";
+        }
+    }
+
+    auto transaction = mExplainDatabase.begin_transaction();
+    auto stmt = transaction.prepare(std::string("EXPLAIN QUERY PLAN ").append(sql));
+
+    std::string plan;
+    while (stmt.step() == SQLITE_ROW) {
+        plan.append("  ").append(stmt.column_text_view(3)).append("\n");
+    }
+
+    if (plan.empty()) {
+        return "  (query plan unavailable)";
+    }
+    plan.pop_back();
+    return plan;
+}
+
+std::vector<QueryProfiler::Statistics> QueryProfiler::snapshot() const
+{
+    std::vector<Statistics> result;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        result.reserve(mStatistics.size());
+        for (auto& element : mStatistics) {
+            result.push_back(element.second);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const Statistics& a, const Statistics& b) {
+        return a.totalNanoseconds > b.totalNanoseconds;
+    });
+    return result;
+}
+
+std::string QueryProfiler::dump(size_t top) const
+{
+    auto statistics = snapshot();
+    if (statistics.size() > top) {
+        statistics.resize(top);
+    }
+
+    std::string text = fmt::format("{:>10} {:>12} {:>10} {:>10} {:>10} {:>8}  {}\n", "calls", "total(ms)", "avg(us)", "p99(us)", "max(us)", "slow", "sql");
+    for (auto& element : statistics) {
+        fmt::format_to(std::back_inserter(text), "{:>10} {:>12.3f} {:>10.1f} {:>10} {:>10} {:>8}  {}\n",
+            element.calls,
+            element.totalNanoseconds / 1e6,
+            element.totalNanoseconds / 1e3 / static_cast<double>(element.calls),
+            element.percentile(0.99).count(),
+            element.maxNanoseconds / 1000,
+            element.slowCalls,
+            element.sql);
+    }
+    return text;
+}
+
+void QueryProfiler::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStatistics.clear();
+    mExplained.clear();
+}
+
+std::string QueryProfiler::normalize(std::string_view sql)
+{
+    std::string result;
+    result.reserve(sql.size());
+
+    auto isWord = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    };
+
+    for (size_t i = 0; i < sql.size();) {
+        char c = sql[i];
+
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            while (i < sql.size() && std::isspace(static_cast<unsigned char>(sql[i]))) {
+                ++i;
+            }
+            if (!result.empty()) {
+                result.push_back(' ');
+            }
+            continue;
+        }
+
+        if (c == '\'') {
+            //字符串字面量，''为转义的单引号
+            for (++i; i < sql.size(); ++i) {
+                if (sql[i] == '\'') {
+                    if (i + 1 < sql.size() && sql[i + 1] == '\'') {
+                        ++i;
+                    } else {
+                        ++i;
+                        break;
+                    }
+                }
+            }
+            result.push_back('?');
+            continue;
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(c)) && (result.empty() || !isWord(result.back()))) {
+            while (i < sql.size() && (isWord(sql[i]) || sql[i] == '.')) {
+                ++i;
+            }
+            result.push_back('?');
+            continue;
+        }
+
+        if ((c == '@' || c == ':' || c == '$') && i + 1 < sql.size() && isWord(sql[i + 1])) {
+            //具名参数
+            for (++i; i < sql.size() && isWord(sql[i]); ++i) {
+            }
+            result.push_back('?');
+            continue;
+        }
+
+        if (c == '?') {
+            //?NNN
+            for (++i; i < sql.size() && std::isdigit(static_cast<unsigned char>(sql[i])); ++i) {
+            }
+            result.push_back('?');
+            continue;
+        }
+
+        result.push_back(c);
+        ++i;
+    }
+
+    while (!result.empty() && (result.back() == ' ' || result.back() == ';')) {
+        result.pop_back();
+    }
+
+    //将 IN (?, ?, ?) 或多行VALUES中的参数列表合并为一个，使不同批量大小的语句聚合到一起
+    for (size_t pos = 0; (pos = result.find("?, ?", pos)) != std::string::npos;) {
+        result.erase(pos + 1, 3);
+    }
+    for (size_t pos = 0; (pos = result.find("(?), (?)", pos)) != std::string::npos;) {
+        result.erase(pos + 3, 5);
+    }
+
+    return result;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "logger/logger.hpp"
+#include "sqlite/sqlite3.hpp"
+
+namespace core {
+
+/**
+ * @brief SQL语句耗时统计
+ * 通过sqlite3_trace_v2的SQLITE_TRACE_PROFILE事件，按归一化后的SQL聚合调用次数与耗时分布，
+ * 并将超过阈值的语句连同其EXPLAIN QUERY PLAN写入慢查询日志
+ */
+class QueryProfiler {
+public:
+    //耗时分布按微秒取对数分桶：[0,1), [1,2), [2,4) ... [2^(n-2), +inf)
+    static constexpr size_t kHistogramBuckets = 24;
+
+    struct Options {
+        //慢查询阈值
+        std::chrono::microseconds slowThreshold { 20000 };
+        //是否为慢查询记录查询计划（每种语句仅记录一次）
+        bool explainSlowQueries = true;
+        //归一化结果缓存的条目上限，达到上限时清空重建
+        size_t normalizedCacheSize = 4096;
+    };
+
+    struct Statistics {
+        std::string sql;
+        uint64_t calls = 0;
+        uint64_t slowCalls = 0;
+        uint64_t totalNanoseconds = 0;
+        uint64_t maxNanoseconds = 0;
+        std::array<uint64_t, kHistogramBuckets> histogram {};
+
+        /**
+         * @brief 由分布估算的分位耗时（取所在桶的上界）
+         */
+        std::chrono::microseconds percentile(double p) const noexcept;
+    };
+
+    QueryProfiler(LoggerBase::SharedPtr logger, const Options& options);
+    explicit QueryProfiler(LoggerBase::SharedPtr logger)
+        : QueryProfiler(std::move(logger), Options {})
+    {
+    }
+
+    ~QueryProfiler() noexcept;
+
+    QueryProfiler(const QueryProfiler&) = delete;
+    QueryProfiler& operator=(const QueryProfiler&) = delete;
+
+    /**
+     * @brief 开始统计指定数据库上执行的语句
+     * 同一时间只能统计一个数据库，重复调用将先停止统计之前的数据库
+     */
+    bool attach(const sqlite::database_manager& database);
+
+    /**
+     * @brief 停止统计
+     * 需在数据库关闭前调用
+     */
+    void detach() noexcept;
+
+    void setSlowThreshold(std::chrono::microseconds threshold) noexcept;
+
+    /**
+     * @brief 取得当前统计数据，按总耗时降序排列
+     */
+    std::vector<Statistics> snapshot() const;
+
+    /**
+     * @brief 将总耗时最高的top条语句格式化为文本
+     * 调用次数远高于其它语句的简单查询通常意味着N+1查询
+     */
+    std::string dump(size_t top = 20) const;
+
+    /**
+     * @brief 清空统计数据
+     */
+    void reset();
+
+    /**
+     * @brief 归一化SQL文本
+     * 合并空白，将字面量替换为?，并将连续的参数列表合并，使同一模式的语句聚合到一起
+     */
+    static std::string normalize(std::string_view sql);
+
+private:
+    LoggerBase::SharedPtr mLogger;
+    Options mOptions;
+
+    mutable std::mutex mMutex;
+    sqlite::database_manager mDatabase;
+
+    //以sqlite3_sql返回的原始文本为键缓存归一化结果，避免每次回调都重新归一化
+    std::unordered_map<std::string, std::string> mNormalized;
+    std::unordered_map<std::string, Statistics> mStatistics;
+    //已记录过查询计划的语句
+    std::unordered_set<std::string> mExplained;
+
+    //用于EXPLAIN QUERY PLAN的独立只读连接，避免在跟踪回调中重入被统计的连接
+    //打开与查询都在mExplainMutex下进行，不阻塞其它语句的统计
+    std::mutex mExplainMutex;
+    sqlite::database_manager mExplainDatabase;
+
+    static int traceCallback(unsigned type, void* context, void* p, void* x);
+
+    void record(sqlite3_stmt* stmt, uint64_t nanoseconds);
+
+    std::string explain(const std::string& path, const std::string& sql);
+};
+
+}
@@ -0,0 +1,208 @@
+#include "write_behind_queue.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <vector>
+
+using namespace core;
+
+WriteBehindQueue::WriteBehindQueue(sqlite::database_manager database, LoggerBase::SharedPtr logger, const Options& options)
+    : mDatabase(std::move(database))
+    , mLogger(std::move(logger))
+    , mOptions(options)
+{
+    if (mOptions.capacity == 0) {
+        mOptions.capacity = 1;
+    }
+    if (mOptions.maxBatchSize == 0) {
+        mOptions.maxBatchSize = 1;
+    }
+}
+
+WriteBehindQueue::~WriteBehindQueue() noexcept
+{
+    stop();
+}
+
+bool WriteBehindQueue::start()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRunning) {
+        return true;
+    }
+
+    if (!mDatabase) {
+        mLogger->error("WriteBehindQueue::start", "database is not open");
+        return false;
+    }
+
+    mRunning = true;
+    mWriter = std::thread(&WriteBehindQueue::writerLoop, this);
+    return true;
+}
+
+void WriteBehindQueue::stop() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+    }
+    mNotEmpty.notify_all();
+    mNotFull.notify_all();
+
+    if (mWriter.joinable()) {
+        mWriter.join();
+    }
+}
+
+bool WriteBehindQueue::push(std::unique_lock<std::mutex>& lock, Mutation&& mutation, Completion&& completion)
+{
+    mEntries.push_back(Entry { std::move(mutation), std::move(completion) });
+    ++mEnqueued;
+
+    //仅在写线程可能处于等待状态时唤醒，避免每次推入都产生一次唤醒
+    bool wake = mEntries.size() == 1 || mEntries.size() >= mOptions.maxBatchSize;
+    lock.unlock();
+    if (wake) {
+        mNotEmpty.notify_one();
+    }
+    return true;
+}
+
+bool WriteBehindQueue::enqueue(Mutation mutation, Completion completion)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mNotFull.wait(lock, [this] {
+        return mEntries.size() < mOptions.capacity || !mRunning;
+    });
+
+    if (!mRunning) {
+        return false;
+    }
+
+    return push(lock, std::move(mutation), std::move(completion));
+}
+
+bool WriteBehindQueue::tryEnqueue(Mutation mutation, Completion completion)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (!mRunning || mEntries.size() >= mOptions.capacity) {
+        return false;
+    }
+
+    return push(lock, std::move(mutation), std::move(completion));
+}
+
+void WriteBehindQueue::flush()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto target = mEnqueued;
+
+    ++mFlushWaiters;
+    mNotEmpty.notify_one();
+    mDrained.wait(lock, [this, target] {
+        return mCompleted >= target;
+    });
+    --mFlushWaiters;
+}
+
+size_t WriteBehindQueue::pending() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+bool WriteBehindQueue::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRunning;
+}
+
+void WriteBehindQueue::writerLoop()
+{
+    std::deque<Entry> batch;
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (true) {
+        mNotEmpty.wait(lock, [this] {
+            return !mEntries.empty() || !mRunning;
+        });
+
+        if (mEntries.empty()) {
+            //已停止且队列已清空
+            break;
+        }
+
+        //等待批次凑满或超过最长等待时间，停止或有flush请求时立即提交
+        auto deadline = std::chrono::steady_clock::now() + mOptions.maxBatchDelay;
+        mNotEmpty.wait_until(lock, deadline, [this] {
+            return mEntries.size() >= mOptions.maxBatchSize || !mRunning || mFlushWaiters > 0;
+        });
+
+        auto count = std::min(mEntries.size(), mOptions.maxBatchSize);
+        std::move(mEntries.begin(), mEntries.begin() + count, std::back_inserter(batch));
+        mEntries.erase(mEntries.begin(), mEntries.begin() + count);
+
+        lock.unlock();
+        mNotFull.notify_all();
+
+        commitBatch(batch);
+        batch.clear();
+
+        lock.lock();
+        mCompleted += count;
+        mDrained.notify_all();
+    }
+
+    lock.unlock();
+    mDrained.notify_all();
+}
+
+void WriteBehindQueue::commitBatch(std::deque<Entry>& batch)
+{
+    std::vector<bool> results(batch.size(), false);
+
+    auto transaction = mDatabase.begin_transaction();
+    if (!transaction) {
+        mLogger->error("WriteBehindQueue::commitBatch", "failed to begin transaction, {} mutations dropped", batch.size());
+    } else {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            //每个变更使用独立的保存点，单个变更失败不影响同批次的其它变更
+            if (!transaction.exec("SAVEPOINT write_behind")) {
+                continue;
+            }
+
+            bool success = false;
+            try {
+                success = batch[i].mutation(transaction);
+            } catch (const std::exception& e) {
+                mLogger->error("WriteBehindQueue::commitBatch", "mutation throws: {}", e.what());
+            }
+
+            if (!success) {
+                transaction.exec("ROLLBACK TO write_behind");
+            }
+            transaction.exec("RELEASE write_behind");
+            results[i] = success;
+        }
+
+        if (!transaction.end_transaction()) {
+            mLogger->error("WriteBehindQueue::commitBatch", "failed to commit {} mutations", batch.size());
+            transaction.rollback();
+            results.assign(batch.size(), false);
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (!batch[i].completion) {
+            continue;
+        }
+
+        try {
+            batch[i].completion(results[i]);
+        } catch (const std::exception& e) {
+            mLogger->error("WriteBehindQueue::commitBatch", "completion throws: {}", e.what());
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cinttypes>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "logger/logger.hpp"
+#include "sqlite/sqlite3.hpp"
+
+namespace core {
+
+/**
+ * @brief 延迟写入队列
+ * 游戏线程将数据库变更推入队列后立即返回，由独立的写线程按批次合并为单个事务提交，
+ * 以减少每次变更各自提交事务带来的fsync开销
+ *
+ * 队列为先进先出且只有一个写线程，因此同一实体的变更按推入顺序执行
+ * 队列满时enqueue将阻塞调用者，直到写线程腾出空间
+ */
+class WriteBehindQueue {
+public:
+    /**
+     * @brief 变更操作
+     * 在写线程的批量事务中执行，返回false表示本次变更失败，仅回滚该变更本身
+     */
+    using Mutation = std::function<bool(sqlite::transaction_manager&)>;
+
+    /**
+     * @brief 完成回调
+     * 在批次提交（或回滚）后于写线程中调用，参数表示变更是否已持久化
+     * 回调中不应执行耗时操作，也不应再调用flush
+     */
+    using Completion = std::function<void(bool)>;
+
+    struct Options {
+        //队列容量，超出后enqueue阻塞
+        size_t capacity = 4096;
+        //单个事务最多包含的变更数
+        size_t maxBatchSize = 256;
+        //从批次中第一个变更到提交的最长等待时间
+        std::chrono::milliseconds maxBatchDelay { 10 };
+    };
+
+    WriteBehindQueue(sqlite::database_manager database, LoggerBase::SharedPtr logger, const Options& options);
+    WriteBehindQueue(sqlite::database_manager database, LoggerBase::SharedPtr logger)
+        : WriteBehindQueue(std::move(database), std::move(logger), Options {})
+    {
+    }
+
+    ~WriteBehindQueue() noexcept;
+
+    WriteBehindQueue(const WriteBehindQueue&) = delete;
+    WriteBehindQueue& operator=(const WriteBehindQueue&) = delete;
+
+    /**
+     * @brief 启动写线程
+     */
+    bool start();
+
+    /**
+     * @brief 停止写线程
+     * 队列中剩余的变更会先全部提交
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief 推入一个变更
+     * 队列已满时阻塞直到有空间
+     * @return 若队列未运行则返回false，此时completion不会被调用
+     */
+    bool enqueue(Mutation mutation, Completion completion = nullptr);
+
+    /**
+     * @brief 尝试推入一个变更
+     * @return 若队列已满或未运行则立即返回false
+     */
+    bool tryEnqueue(Mutation mutation, Completion completion = nullptr);
+
+    /**
+     * @brief 等待调用前推入的全部变更执行完毕
+     */
+    void flush();
+
+    /**
+     * @brief 队列中等待执行的变更数
+     */
+    size_t pending() const;
+
+    bool isRunning() const;
+
+private:
+    struct Entry {
+        Mutation mutation;
+        Completion completion;
+    };
+
+    sqlite::database_manager mDatabase;
+    LoggerBase::SharedPtr mLogger;
+    Options mOptions;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+    std::condition_variable mDrained;
+
+    std::deque<Entry> mEntries;
+    //已推入的变更总数
+    uint64_t mEnqueued = 0;
+    //已执行完毕（无论成功与否）的变更总数
+    uint64_t mCompleted = 0;
+    //正在等待flush的调用者数，非零时写线程不再等待批次凑满
+    size_t mFlushWaiters = 0;
+
+    bool mRunning = false;
+    std::thread mWriter;
+
+    bool push(std::unique_lock<std::mutex>& lock, Mutation&& mutation, Completion&& completion);
+
+    void writerLoop();
+
+    void commitBatch(std::deque<Entry>& batch);
+};
+
+}
@@ -1,38 +1,26 @@
-#include <iostream>
+#include <cstdio>
 
-#include "logger/logger.hpp"
+#include "logger/async_logger.hpp"
 #include "context/context.hpp"
 
-class Logger: public core::LoggerBase {
-    virtual void info(const std::string &message) const override {
-        std::cout << message << std::endl;
-    }
-
-    virtual void debug(const std::string &message) const override {
-        std::cout << message << std::endl;
-    }
-
-    virtual void warn(const std::string &message) const override {
-        std::cout << message << std::endl;
-    }
-
-    virtual void error(const std::string &message) const override {
-        std::cout << message << std::endl;
-    }
-};
-
 int main()
 {
+    auto logger = std::make_shared<core::AsyncLogger>();
+    if (!logger->start()) {
+        printf("failed to start logger\n");
+        return 0;
+    }
 
-    auto context = core::Context::instantiate(std::make_shared<Logger>(), ".");
+    auto context = core::Context::instantiate(logger, ".");
 
     if (!context->init()) {
+        logger->stop();
         printf("error\n");
         return 0;
     }
 
+    logger->stop();
     printf("completed\n");
 
     return 0;
 }
-
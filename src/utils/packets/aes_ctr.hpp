@@ -0,0 +1,213 @@
+#pragma once
+
+/**
+ * @file aes_ctr.hpp
+ * @brief AES-128 CTR模式加解密
+ * 支持AES-NI的处理器上每次并行计算8个密钥流块，否则使用third_party/aes中的tiny-AES，
+ * 两种实现的结果完全一致
+ *
+ */
+
+#include <cinttypes>
+#include <cstring>
+
+#include "aes/aes.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define UTILS_AES_NI
+#include <immintrin.h>
+#endif
+
+namespace utils::aes {
+
+constexpr size_t kKeySize = 16;
+constexpr size_t kBlockSize = 16;
+
+#ifdef UTILS_AES_NI
+
+namespace detail {
+
+#define UTILS_AES_NI_TARGET __attribute__((target("aes,sse2")))
+
+template <int Rcon>
+UTILS_AES_NI_TARGET inline __m128i expandKey(__m128i key)
+{
+    auto assist = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(key, Rcon), 0xFF);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+UTILS_AES_NI_TARGET inline void expandKeys(const uint8_t* key, __m128i roundKeys[11])
+{
+    roundKeys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+    roundKeys[1] = expandKey<0x01>(roundKeys[0]);
+    roundKeys[2] = expandKey<0x02>(roundKeys[1]);
+    roundKeys[3] = expandKey<0x04>(roundKeys[2]);
+    roundKeys[4] = expandKey<0x08>(roundKeys[3]);
+    roundKeys[5] = expandKey<0x10>(roundKeys[4]);
+    roundKeys[6] = expandKey<0x20>(roundKeys[5]);
+    roundKeys[7] = expandKey<0x40>(roundKeys[6]);
+    roundKeys[8] = expandKey<0x80>(roundKeys[7]);
+    roundKeys[9] = expandKey<0x1B>(roundKeys[8]);
+    roundKeys[10] = expandKey<0x36>(roundKeys[9]);
+}
+
+/**
+ * @brief 计算Lanes个连续计数器块的密钥流并与数据异或
+ * 各块的轮运算相互独立，交错执行以掩盖aesenc的延迟，数据的读取与异或也在此期间完成
+ */
+template <int Lanes>
+UTILS_AES_NI_TARGET inline void xorKeystream(const __m128i roundKeys[11], uint64_t nonce, uint64_t& counter, const uint8_t* input, uint8_t* output)
+{
+    __m128i blocks[Lanes];
+#pragma GCC unroll 8
+    for (int i = 0; i < Lanes; ++i) {
+        auto block = _mm_set_epi64x(static_cast<long long>(__builtin_bswap64(counter + i)), static_cast<long long>(nonce));
+        blocks[i] = _mm_xor_si128(block, roundKeys[0]);
+    }
+#pragma GCC unroll 9
+    for (int round = 1; round < 10; ++round) {
+#pragma GCC unroll 8
+        for (int i = 0; i < Lanes; ++i) {
+            blocks[i] = _mm_aesenc_si128(blocks[i], roundKeys[round]);
+        }
+    }
+#pragma GCC unroll 8
+    for (int i = 0; i < Lanes; ++i) {
+        auto keystream = _mm_aesenclast_si128(blocks[i], roundKeys[10]);
+        auto text = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * kBlockSize));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * kBlockSize), _mm_xor_si128(text, keystream));
+    }
+    counter += Lanes;
+}
+
+UTILS_AES_NI_TARGET inline void ctr(const __m128i roundKeys[11], const uint8_t* iv, const uint8_t* input, uint8_t* output, size_t size)
+{
+    //计数器为IV的低64位，按大端递增
+    uint64_t nonce, counter;
+    std::memcpy(&nonce, iv, sizeof(nonce));
+    std::memcpy(&counter, iv + 8, sizeof(counter));
+    counter = __builtin_bswap64(counter);
+
+    for (; size >= 8 * kBlockSize; input += 8 * kBlockSize, output += 8 * kBlockSize, size -= 8 * kBlockSize) {
+        xorKeystream<8>(roundKeys, nonce, counter, input, output);
+    }
+    //不足8块的剩余部分按4、2、1块交错计算，小包不必逐块等待aesenc的延迟
+    if (size >= 4 * kBlockSize) {
+        xorKeystream<4>(roundKeys, nonce, counter, input, output);
+        input += 4 * kBlockSize, output += 4 * kBlockSize, size -= 4 * kBlockSize;
+    }
+    if (size >= 2 * kBlockSize) {
+        xorKeystream<2>(roundKeys, nonce, counter, input, output);
+        input += 2 * kBlockSize, output += 2 * kBlockSize, size -= 2 * kBlockSize;
+    }
+    if (size >= kBlockSize) {
+        xorKeystream<1>(roundKeys, nonce, counter, input, output);
+        input += kBlockSize, output += kBlockSize, size -= kBlockSize;
+    }
+    if (size > 0) {
+        uint8_t last[kBlockSize] = {};
+        std::memcpy(last, input, size);
+        xorKeystream<1>(roundKeys, nonce, counter, last, last);
+        std::memcpy(output, last, size);
+    }
+}
+
+#undef UTILS_AES_NI_TARGET
+
+}
+
+#endif
+
+/**
+ * @brief AES-128 CTR
+ * 计数器块为16字节IV，其中低8字节作为大端计数器逐块递增，高8字节不变，
+ * 同一密钥下不同消息的IV高8字节（nonce）不能重复
+ */
+class AesCtr {
+public:
+    enum class Backend {
+        //运行时检测，优先使用AES-NI
+        automatic,
+        aesni,
+        portable
+    };
+
+    explicit AesCtr(const uint8_t* key, Backend backend = Backend::automatic) noexcept
+        : mBackend(backend == Backend::automatic ? (hardwareSupported() ? Backend::aesni : Backend::portable) : backend)
+    {
+        if (mBackend == Backend::aesni && !hardwareSupported()) {
+            mBackend = Backend::portable;
+        }
+#ifdef UTILS_AES_NI
+        if (mBackend == Backend::aesni) {
+            detail::expandKeys(key, mRoundKeys);
+            return;
+        }
+#endif
+        AES_init_ctx(&mContext, key);
+    }
+
+    /**
+     * @brief 处理器是否支持AES-NI
+     */
+    static bool hardwareSupported() noexcept
+    {
+#ifdef UTILS_AES_NI
+        static const bool supported = __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    Backend backend() const noexcept
+    {
+        return mBackend;
+    }
+
+    /**
+     * @brief 加密或解密
+     * 从input读取、将结果写入output，两者可以是同一块内存
+     * @param iv 初始计数器块，16字节
+     */
+    void apply(const uint8_t* iv, const uint8_t* input, uint8_t* output, size_t size) const noexcept
+    {
+#ifdef UTILS_AES_NI
+        if (mBackend == Backend::aesni) {
+            detail::ctr(mRoundKeys, iv, input, output, size);
+            return;
+        }
+#endif
+        //tiny-AES只支持原地处理，且上下文中保存着当前计数器，每次复制一份
+        if (input != output) {
+            std::memmove(output, input, size);
+        }
+        auto context = mContext;
+        AES_ctx_set_iv(&context, iv);
+        AES_CTR_xcrypt_buffer(&context, output, size);
+    }
+
+    /**
+     * @brief 以nonce为高8字节、计数器从0开始加密或解密
+     */
+    void apply(uint64_t nonce, const uint8_t* input, uint8_t* output, size_t size) const noexcept
+    {
+        uint8_t iv[kBlockSize] = {};
+        for (size_t i = 0; i < sizeof(nonce); ++i) {
+            iv[i] = static_cast<uint8_t>(nonce >> (56 - 8 * i));
+        }
+        apply(iv, input, output, size);
+    }
+
+private:
+    Backend mBackend;
+#ifdef UTILS_AES_NI
+    __m128i mRoundKeys[11];
+#endif
+    AES_ctx mContext;
+};
+
+}
@@ -28,6 +28,9 @@ using BytesT = bytes::BytesT;
 // 定义数据封包最大字节数（数据头(16) + 数据(n)）
 constexpr size_t MAX_DATAPACK_SIZE = 4096;
 
+// 数据头标志，与数据长度共用4字节，占最高的8位
+constexpr uint8_t FLAG_ENCRYPTED = 0x01; // 数据已加密
+
 /**
  * @brief 计算数据crc，用于校验数据包是否正确接收
  *
@@ -49,7 +52,8 @@ uint16_t evalCrcSick(Iterator first, Iterator last)
     while (first != last) {
         shortCur = 0x00FF & static_cast<uint16_t>(*first++);
 
-        crc = (crc & 0x8000) ? ((crc << 1) ^ 0x8005) : (crc << 1);
+        //等价于 (crc & 0x8000) ? ((crc << 1) ^ 0x8005) : (crc << 1)，对随机数据（如密文）避免分支预测失败
+        crc = static_cast<uint16_t>((crc << 1) ^ (static_cast<uint16_t>(0 - (crc >> 15)) & 0x8005));
 
         crc ^= (shortCur | shortPre);
         shortPre = shortCur << 8;
@@ -79,6 +83,7 @@ private:
     uint16_t mOperation; // 操作码
     uint16_t mTag; // 操作标识
 
+    uint8_t mFlags; // 标志
     uint32_t mDataSize; // 数据长度
 
     uint16_t mHeadCrc; // 数据头校验
@@ -93,12 +98,15 @@ private:
         std::enable_if_t<std::is_same_v<std::decay_t<typename Iterator::value_type>, ByteT>, int> = 0>
     PacketHead(Iterator it)
     {
-        it += bytesToInteger(it, mVersion);
-        it += bytesToInteger(it, mOperation);
-        it += bytesToInteger(it, mTag);
-        it += bytesToInteger(it, mDataSize);
-        it += bytesToInteger(it, mHeadCrc);
-        it += bytesToInteger(it, mDataCrc);
+        it += bytes::bytesToInteger(it, mVersion);
+        it += bytes::bytesToInteger(it, mOperation);
+        it += bytes::bytesToInteger(it, mTag);
+        it += bytes::bytesToInteger(it, mDataSize);
+        it += bytes::bytesToInteger(it, mHeadCrc);
+        it += bytes::bytesToInteger(it, mDataCrc);
+
+        mFlags = static_cast<uint8_t>(mDataSize >> 24);
+        mDataSize &= 0x00FFFFFF;
     }
 
     /**
@@ -107,13 +115,15 @@ private:
      * @param version
      * @param operation
      * @param tag
+     * @param flags
      * @param size
      * @param dataCrc
      */
-    PacketHead(const uint32_t version, const uint16_t operation, const uint16_t tag, const uint32_t size, const uint16_t dataCrc) noexcept
+    PacketHead(const uint32_t version, const uint16_t operation, const uint16_t tag, const uint8_t flags, const uint32_t size, const uint16_t dataCrc) noexcept
         : mVersion(version)
         , mOperation(operation)
         , mTag(tag)
+        , mFlags(flags)
         , mDataSize(size)
         , mHeadCrc(0)
         , mDataCrc(dataCrc)
@@ -133,7 +143,7 @@ private:
         it += bytes::integerToBytes(this->mVersion, it);
         it += bytes::integerToBytes(this->mOperation, it);
         it += bytes::integerToBytes(this->mTag, it);
-        it += bytes::integerToBytes(this->mDataSize, it);
+        it += bytes::integerToBytes(static_cast<uint32_t>(this->mFlags) << 24 | this->mDataSize, it);
 
         //基于前面构造的数据计算数据头校验码
         it += bytes::integerToBytes(evalCrcSick(buffer.begin(), it), it);
@@ -149,7 +159,7 @@ private:
      */
     std::string toString() const
     {
-        return std::string().append("[").append("version: ").append(std::to_string(this->mVersion)).append("; ").append("operation: ").append(std::to_string(this->mOperation)).append("; ").append("tag: ").append(std::to_string(this->mTag)).append("; ").append("size: ").append(std::to_string(this->mDataSize)).append("; ").append("header_crc: ").append(std::to_string(this->mHeadCrc)).append("; ").append("data_crc: ").append(std::to_string(this->mDataCrc)).append(" ]");
+        return std::string().append("[").append("version: ").append(std::to_string(this->mVersion)).append("; ").append("operation: ").append(std::to_string(this->mOperation)).append("; ").append("tag: ").append(std::to_string(this->mTag)).append("; ").append("flags: ").append(std::to_string(this->mFlags)).append("; ").append("size: ").append(std::to_string(this->mDataSize)).append("; ").append("header_crc: ").append(std::to_string(this->mHeadCrc)).append("; ").append("data_crc: ").append(std::to_string(this->mDataCrc)).append(" ]");
     }
 };
 
@@ -195,9 +205,22 @@ public:
     template <class Iterator,
         std::enable_if_t<std::is_same_v<std::decay_t<typename Iterator::value_type>, ByteT>, int> = 0>
     Packet(const uint32_t version, const uint16_t operation, const uint16_t tag, Iterator first, Iterator last) noexcept
-        : mHead(version, operation, tag, static_cast<uint32_t>(std::distance(first, last)),
-            hash_u16(first, last))
+        : Packet(version, operation, tag, 0, first, last)
+    {
+    }
+
+    /**
+     * @brief 通过制定头信息、标志以及数据迭代器构造数据
+     *
+     * @param flags 数据头标志，如FLAG_ENCRYPTED
+     */
+    template <class Iterator,
+        std::enable_if_t<std::is_same_v<std::decay_t<typename Iterator::value_type>, ByteT>, int> = 0>
+    Packet(const uint32_t version, const uint16_t operation, const uint16_t tag, const uint8_t flags, Iterator first, Iterator last) noexcept
+        : mHead(version, operation, tag, flags, static_cast<uint32_t>(std::distance(first, last)),
+            evalCrcSick(first, last))
     {
+        mData.reserve(mHead.mDataSize);
         std::copy(first, last, std::back_inserter(mData));
     }
 
@@ -226,6 +249,11 @@ public:
         return this->mHead.mTag;
     }
 
+    auto flags() const noexcept
+    {
+        return this->mHead.mFlags;
+    }
+
     auto size() const noexcept
     {
         return this->mHead.mDataSize;
@@ -244,6 +272,7 @@ public:
     auto toBytes() const
     {
         auto buff = this->mHead.toBytes();
+        buff.reserve(buff.size() + this->mData.size());
         std::copy(this->mData.cbegin(), this->mData.cend(), std::back_insert_iterator(buff));
         return buff;
     }
@@ -283,6 +312,18 @@ private:
         mBuffer.clear();
     }
 
+    /**
+     * @brief 将数据流追加到缓冲区，直到缓冲区达到size字节或数据流耗尽
+     * @return 未使用的数据流起点
+     */
+    template <class Iterator>
+    Iterator fill(Iterator first, Iterator last, size_t size)
+    {
+        auto count = std::min<size_t>(static_cast<size_t>(std::distance(first, last)), size - std::min(size, mBuffer.size()));
+        mBuffer.insert(mBuffer.end(), first, first + count);
+        return first + count;
+    }
+
     /**
      * @brief 校验当前构造的临时包头是否正确
      * 校验成功则清理缓存，校验失败则重置解包器
@@ -370,9 +411,7 @@ public:
 
         if (auto head_ptr = std::get_if<PacketHead>(&mHead)) {
             // 基于数据头中的数据长度构造数据
-            while (first != last && mBuffer.size() < head_ptr->mDataSize) {
-                mBuffer.push_back(*first++);
-            }
+            first = this->fill(first, last, head_ptr->mDataSize);
 
             if (mBuffer.size() == head_ptr->mDataSize) {
                 //一个完整的数据包构造完成
@@ -380,9 +419,7 @@ public:
             }
         } else {
             // 如果不存在临时的数据头，则先构造数据头
-            while (first != last && mBuffer.size() < PacketHead::kHeadSize) {
-                mBuffer.push_back(*first++);
-            }
+            first = this->fill(first, last, PacketHead::kHeadSize);
 
             //构造临时的数据头
             if (mBuffer.size() == PacketHead::kHeadSize) {
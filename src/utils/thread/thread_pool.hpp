@@ -15,13 +15,16 @@ public:
     using Task = std::function<void()>;
 
     ThreadPool(size_t count) noexcept
-        : mCount(count), isRunning(true)
+        : mCount(0), mIdleThread(0), isRunning(true)
     {
         addThread(count);
     }
 
     ~ThreadPool() noexcept {
-        this->isRunning = false;
+        {
+            std::lock_guard<std::mutex> lk(mMutex);
+            this->isRunning = false;
+        }
         mCv.notify_all();
 
         for (auto &pool : mPool) {
@@ -51,9 +54,17 @@ public:
         return mIdleThread;
     }
 
+    size_t threadCount() const {
+        return mCount;
+    }
+
     template<typename... Args>
     void commit(Args&&... args) {
-        mTasks.emplace(std::forward<Args>(args)...);
+        {
+            std::lock_guard<std::mutex> lk(mMutex);
+            mTasks.emplace(std::forward<Args>(args)...);
+        }
+        mCv.notify_one();
     }
 
 private:
@@ -66,7 +77,7 @@ private:
 
     std::atomic_size_t mIdleThread;
 
-    bool isRunning;
+    std::atomic_bool isRunning;
 
     void waitAndProcess()
     {
@@ -81,7 +92,7 @@ private:
             return;
         }
 
-        auto task = mTasks.front();
+        auto task = std::move(mTasks.front());
         mTasks.pop();
 
         lk.unlock();
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "packets/aes_ctr.hpp"
+#include "packets/channel.hpp"
+
+using namespace utils;
+
+static std::vector<uint8_t> fromHex(const char* hex)
+{
+    std::vector<uint8_t> bytes;
+    for (; hex[0] != '\0' && hex[1] != '\0'; hex += 2) {
+        unsigned value;
+        std::sscanf(hex, "%2x", &value);
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+    return bytes;
+}
+
+/**
+ * @brief NIST SP 800-38A F.5.1 CTR-AES128.Encrypt
+ */
+static bool checkVector(aes::AesCtr::Backend backend)
+{
+    auto key = fromHex("2b7e151628aed2a6abf7158809cf4f3c");
+    auto iv = fromHex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+    auto plaintext = fromHex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                             "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+    auto expected = fromHex("874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+                            "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee");
+
+    aes::AesCtr cipher(key.data(), backend);
+    cipher.apply(iv.data(), plaintext.data(), plaintext.data(), plaintext.size());
+    return plaintext == expected;
+}
+
+static double throughput(const aes::AesCtr& cipher, std::vector<uint8_t>& buffer, size_t size, size_t total)
+{
+    auto begin = std::chrono::steady_clock::now();
+    uint64_t nonce = 0;
+    for (size_t done = 0; done < total; done += size) {
+        cipher.apply(nonce++, buffer.data(), buffer.data(), size);
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return static_cast<double>(total) / seconds / 1e9;
+}
+
+/**
+ * @brief 组包、转为字节流、解包并取出数据的单包耗时
+ */
+static double packetCost(packet::PacketChannel& sender, packet::PacketChannel& receiver, const std::vector<uint8_t>& data, int count, bool& ok)
+{
+    packet::BytesT received;
+    auto unpacker = packet::Unpacker([&](const packet::Packet& p) { ok = receiver.unpack(p, received) && received == data && ok; });
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        auto bytes = sender.pack(1, 2, 3, data).toBytes();
+        unpacker.process(bytes.cbegin(), bytes.cend());
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / count;
+}
+
+/**
+ * 校验AES-NI与tiny-AES两种实现及加密通道的协商，并比较两种实现的吞吐量和加密带来的单包开销
+ */
+int main(int argc, char* argv[])
+{
+    bool ok = true;
+    bool hardware = aes::AesCtr::hardwareSupported();
+    std::printf("AES-NI %s\n", hardware ? "supported" : "not supported");
+
+    ok = checkVector(aes::AesCtr::Backend::portable) && ok;
+    ok = checkVector(aes::AesCtr::Backend::aesni) && ok;
+    if (!ok) {
+        std::printf("test vector failed\n");
+    }
+
+    std::mt19937 random(20221019);
+    std::vector<uint8_t> key(aes::kKeySize);
+    for (auto& c : key) {
+        c = static_cast<uint8_t>(random());
+    }
+    aes::AesCtr aesni(key.data(), aes::AesCtr::Backend::aesni);
+    aes::AesCtr portable(key.data(), aes::AesCtr::Backend::portable);
+
+    for (size_t size = 0; size <= 1100 && ok; ++size) {
+        std::vector<uint8_t> data(size);
+        for (auto& c : data) {
+            c = static_cast<uint8_t>(random());
+        }
+        auto a = data, b = data;
+        std::vector<uint8_t> c(size);
+        aesni.apply(size, a.data(), a.data(), size);
+        portable.apply(size, b.data(), b.data(), size);
+        aesni.apply(size, data.data(), c.data(), size);
+        if (a != b || a != c) {
+            std::printf("backends differ at size %zu\n", size);
+            ok = false;
+        }
+    }
+
+    //默认要求加密：双方一开始就发送加密包，拒绝明文，不持有密钥的一方无法解包
+    packet::PacketChannel client(key.data()), server(key.data()), plain;
+    std::vector<uint8_t> message(300, 7);
+    packet::BytesT received;
+    auto request = client.pack(1, 2, 3, message);
+    if (!client.encrypting() || !server.encrypting() || !(request.flags() & packet::FLAG_ENCRYPTED) || request.data() == message
+        || plain.unpack(request, received) || !server.unpack(request, received) || received != message
+        || server.unpack(plain.pack(1, 2, 3, message), received)) {
+        std::printf("required encryption failed\n");
+        ok = false;
+    }
+
+    //关闭required时协商：发起方先发送加密包，另一方收到后回复也加密，协商之前接受明文
+    packet::PacketChannel::Options initiator;
+    initiator.initiate = true;
+    initiator.required = false;
+    packet::PacketChannel::Options optional;
+    optional.required = false;
+    packet::PacketChannel optionalClient(key.data(), initiator), optionalServer(key.data(), optional);
+    if (optionalServer.encrypting() || !optionalClient.encrypting() || !optionalServer.unpack(plain.pack(1, 2, 3, message), received)
+        || received != message) {
+        ok = false;
+    }
+    request = optionalClient.pack(1, 2, 3, message);
+    if (!(request.flags() & packet::FLAG_ENCRYPTED) || !optionalServer.unpack(request, received) || received != message
+        || !optionalServer.encrypting()) {
+        std::printf("negotiation failed\n");
+        ok = false;
+    }
+
+    int packets = argc > 1 ? std::stoi(argv[1]) : 200000;
+    for (size_t size : { 64, 1024, 4000 }) {
+        std::vector<uint8_t> data(size);
+        for (auto& c : data) {
+            c = static_cast<uint8_t>(random());
+        }
+        //两种通道交替测量多轮并各取最小值，减少调度与频率变化带来的噪声
+        packet::PacketChannel sender, receiver;
+        packet::PacketChannel encryptedSender(key.data()), encryptedReceiver(key.data());
+        double plainCost = 0, encryptedCost = 0;
+        for (int round = 0; round < 5; ++round) {
+            auto plain = packetCost(sender, receiver, data, packets / 5, ok);
+            auto encrypted = packetCost(encryptedSender, encryptedReceiver, data, packets / 5, ok);
+            plainCost = round == 0 ? plain : std::min(plainCost, plain);
+            encryptedCost = round == 0 ? encrypted : std::min(encryptedCost, encrypted);
+        }
+        std::printf("%4zu bytes packet: plain %8.1f ns, encrypted %8.1f ns (+%.1f%%)\n", size, plainCost, encryptedCost,
+            (encryptedCost / plainCost - 1) * 100);
+    }
+
+    std::vector<uint8_t> buffer(64 * 1024);
+    for (size_t size : { 64, 1024, 64 * 1024 }) {
+        std::printf("%6zu bytes: aesni %6.2f GB/s, tiny-AES %6.3f GB/s\n", size, throughput(aesni, buffer, size, 256 << 20),
+            throughput(portable, buffer, size, 16 << 20));
+    }
+
+    std::printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
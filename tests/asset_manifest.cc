@@ -0,0 +1,73 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "storage/asset_manifest.hpp"
+#include "test_logger.hpp"
+
+static void writeFile(const std::filesystem::path& path, const std::string& content)
+{
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    os << content;
+}
+
+static bool verify(const std::string& root, const char* name, bool expected, size_t hashed, bool acceptChanges = false)
+{
+    core::AssetManifest::Options options;
+    options.acceptChanges = acceptChanges;
+    core::AssetManifest manifest(std::make_shared<test::Logger>(test::Logger::Warn), root, options);
+
+    auto begin = std::chrono::steady_clock::now();
+    auto result = manifest.verify();
+    auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    auto& statistics = manifest.statistics();
+    std::cout << name << ": " << (result ? "passed" : "failed") << " in " << ms << " ms";
+    if (result) {
+        std::cout << ", " << statistics.files << " files, " << statistics.hashed << " rehashed";
+    }
+    std::cout << std::endl;
+    return result == expected && (!result || statistics.hashed == hashed);
+}
+
+/**
+ * 测量冷启动与热启动时校验资源文件的耗时，并检查修改、仅更新时间与删除文件时的结果
+ */
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? std::stoi(argv[1]) : 10000;
+
+    auto root = std::filesystem::temp_directory_path() / "kgame_asset_manifest";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "cache");
+    for (int i = 0; i < count; ++i) {
+        auto directory = root / "assert" / std::to_string(i % 100);
+        std::filesystem::create_directories(directory);
+        writeFile(directory / (std::to_string(i) + ".json"), std::string(256 + i % 4096, static_cast<char>('a' + i % 26)));
+    }
+
+    bool ok = true;
+    ok = verify(root.string(), "cold", true, static_cast<size_t>(count)) && ok;
+    ok = verify(root.string(), "warm", true, 0) && ok;
+
+    //只更新修改时间，内容不变
+    auto touched = root / "assert/1/1.json";
+    std::filesystem::last_write_time(touched, std::filesystem::last_write_time(touched) + std::chrono::seconds(5));
+    ok = verify(root.string(), "touched", true, 1) && ok;
+
+    //内容被修改
+    auto modified = root / "assert/2/2.json";
+    writeFile(modified, "modified");
+    ok = verify(root.string(), "modified", false, 0) && ok;
+    ok = verify(root.string(), "accepted", true, 1, true) && ok;
+
+    std::filesystem::remove(root / "assert/3/3.json");
+    ok = verify(root.string(), "removed", false, 0) && ok;
+    ok = verify(root.string(), "accepted", true, 0, true) && ok;
+
+    std::filesystem::remove_all(root);
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
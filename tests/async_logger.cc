@@ -0,0 +1,169 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger/async_logger.hpp"
+
+static double nanosecondsPerCall(std::chrono::steady_clock::time_point begin, long calls)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / static_cast<double>(calls);
+}
+
+/**
+ * @brief 调用线程自身消耗的CPU时间，不包括单核上被后台线程抢占的时间
+ */
+static int64_t threadCpuNanoseconds()
+{
+    timespec now {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+static size_t countLines(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(file, line)) {
+        ++lines;
+    }
+    return lines;
+}
+
+/**
+ * 测量关闭与开启debug级别时每次调用的耗时，并校验block模式下不丢日志、drop模式下正确统计丢弃条数，
+ * 以及与stop()并发写入的日志不会丢失
+ */
+int main(int argc, char* argv[])
+{
+    long calls = argc > 1 ? std::stol(argv[1]) : 1000000;
+    const std::string path = "bench_async_logger.log";
+    bool ok = true;
+
+    {
+        std::remove(path.c_str());
+        core::AsyncLogger::Options options;
+        options.path = path;
+        options.overflow = core::AsyncLogger::Overflow::block;
+        auto logger = std::make_shared<core::AsyncLogger>(options);
+        if (!logger->start()) {
+            std::cout << "failed to open " << path << std::endl;
+            return 1;
+        }
+
+        logger->setLevel(core::LogLevel::info);
+        auto begin = std::chrono::steady_clock::now();
+        for (long i = 0; i < calls; ++i) {
+            logger->debug("bench", "player {} moved to ({}, {})", i, 1.5, 2.5);
+        }
+        std::cout << "disabled debug: " << nanosecondsPerCall(begin, calls) << " ns/call" << std::endl;
+
+        logger->setLevel(core::LogLevel::debug);
+        begin = std::chrono::steady_clock::now();
+        auto cpu = threadCpuNanoseconds();
+        for (long i = 0; i < calls; ++i) {
+            logger->debug("bench", "player {} moved to ({}, {})", i, 1.5, 2.5);
+        }
+        auto wall = nanosecondsPerCall(begin, calls);
+        std::cout << "enabled debug: " << wall << " ns/call, "
+                  << static_cast<double>(threadCpuNanoseconds() - cpu) / static_cast<double>(calls) << " ns/call on the calling thread" << std::endl;
+
+        const int threads = 4;
+        begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (long i = 0; i < calls / threads; ++i) {
+                    logger->info("bench", "thread {} message {}", t, i);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::cout << threads << " threads: " << nanosecondsPerCall(begin, calls / threads * threads) << " ns/call" << std::endl;
+
+        logger->stop();
+        auto statistics = logger->statistics();
+        std::cout << statistics.written << " written in " << statistics.batches << " batches, "
+                  << statistics.dropped << " dropped" << std::endl;
+
+        auto expected = static_cast<size_t>(calls + calls / threads * threads);
+        auto lines = countLines(path);
+        if (statistics.dropped != 0 || statistics.written != expected || lines != expected) {
+            std::cout << "block mode lost messages: expected " << expected << " lines, got " << lines << std::endl;
+            ok = false;
+        }
+    }
+
+    {
+        //缓冲区很小且不等待，必然有日志被丢弃，丢弃的条数与写出的条数之和应等于调用次数
+        std::remove(path.c_str());
+        core::AsyncLogger::Options options;
+        options.path = path;
+        options.bufferSize = 4096;
+        options.maxMessageSize = 128;
+        auto logger = std::make_shared<core::AsyncLogger>(options);
+        logger->start();
+        for (long i = 0; i < calls; ++i) {
+            logger->info("bench", "message {}", i);
+        }
+        logger->stop();
+
+        auto statistics = logger->statistics();
+        std::cout << "drop mode: " << statistics.written << " written, " << statistics.dropped << " dropped" << std::endl;
+        //丢弃提示同样占一行
+        auto lines = countLines(path);
+        if (statistics.written + statistics.dropped != static_cast<uint64_t>(calls) || lines < statistics.written) {
+            std::cout << "drop mode accounting mismatch, " << lines << " lines" << std::endl;
+            ok = false;
+        }
+    }
+
+    {
+        //与stop()并发写入的日志要么写入文件，要么（block模式下停止后仍在等待空间时）计为丢弃，不能丢失
+        std::remove(path.c_str());
+        core::AsyncLogger::Options options;
+        options.path = path;
+        options.overflow = core::AsyncLogger::Overflow::block;
+        auto logger = std::make_shared<core::AsyncLogger>(options);
+        logger->start();
+
+        const int threads = 4;
+        std::atomic<long> logged { 0 };
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (long i = 0; i < calls / threads / 4; ++i) {
+                    logger->info("bench", "thread {} message {}", t, i);
+                    logged.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        while (logged.load(std::memory_order_relaxed) < calls / 32) {
+            std::this_thread::yield();
+        }
+        logger->stop();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        auto statistics = logger->statistics();
+        auto lines = countLines(path);
+        std::cout << "concurrent stop: " << statistics.written << " written, " << statistics.dropped << " dropped" << std::endl;
+        if (statistics.written + statistics.dropped != static_cast<uint64_t>(logged.load()) || lines != statistics.written + (statistics.dropped != 0 ? 1 : 0)) {
+            std::cout << "messages logged during stop were lost: " << logged.load() << " logged, " << lines << " lines" << std::endl;
+            ok = false;
+        }
+    }
+
+    std::remove(path.c_str());
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "context/context.hpp"
+#include "items/basic_items.hpp"
+#include "test_logger.hpp"
+
+/**
+ * 比较基础物品目录缓存与SQL查询的单次查找耗时，并校验两者结果一致
+ */
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? std::stoi(argv[1]) : 10000;
+    int lookups = argc > 2 ? std::stoi(argv[2]) : 1000000;
+
+    auto root = std::filesystem::temp_directory_path() / "kgame_basic_items_catalog";
+    std::filesystem::remove_all(root);
+
+    core::DatabaseOptions options;
+    options.mode = core::DatabaseMode::memory;
+
+    auto context = core::Context::instantiate(std::make_shared<test::Logger>(), root.u8string());
+    if (!context->init(options)) {
+        std::cout << "init failure" << std::endl;
+        return 1;
+    }
+
+    std::vector<core::basic_items::Record> records;
+    for (int i = 0; i < count; ++i) {
+        records.push_back({ 0, "item" + std::to_string(i), "describe", i % 8, "{\"atk\":" + std::to_string(i % 100) + "}" });
+    }
+    auto itemBaseIds = core::basic_items::insertBulk(context, records);
+    if (itemBaseIds.size() != records.size()) {
+        std::cout << "insert failure" << std::endl;
+        return 1;
+    }
+
+    std::mt19937_64 random(42);
+    std::vector<int64_t> keys(static_cast<size_t>(lookups));
+    for (auto& key : keys) {
+        key = itemBaseIds[random() % itemBaseIds.size()];
+    }
+
+    //SQL路径的查找次数较少，避免运行时间过长
+    size_t sqlLookups = keys.size() / 100 + 1;
+    int64_t checksum = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < sqlLookups; ++i) {
+        auto record = core::basic_items::queryById(context, keys[i]);
+        checksum += record ? record->itemCateogory : -1;
+    }
+    auto sqlTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / sqlLookups;
+
+    int64_t catalogChecksum = 0;
+    for (size_t i = 0; i < sqlLookups; ++i) {
+        auto item = core::basic_items::lookup(context, keys[i]);
+        catalogChecksum += item ? item->itemCateogory : -1;
+    }
+    if (checksum != catalogChecksum) {
+        std::cout << "catalog does not match database" << std::endl;
+        return 1;
+    }
+
+    size_t length = 0;
+    begin = std::chrono::steady_clock::now();
+    for (auto key : keys) {
+        auto item = core::basic_items::lookup(context, key);
+        length += item ? item->itemName.size() : 0;
+    }
+    auto catalogTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / keys.size();
+
+    //先取得快照再连续查找，省去每次查找持有快照的开销
+    begin = std::chrono::steady_clock::now();
+    {
+        auto snapshot = context->getBasicItemsCatalog().snapshot();
+        for (auto key : keys) {
+            auto item = snapshot->find(key);
+            length += item ? item->itemName.size() : 0;
+        }
+    }
+    auto snapshotTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / keys.size();
+
+    //修改后新快照立即可见
+    core::basic_items::Record record { itemBaseIds.front(), "renamed", "describe", 0, "{}" };
+    if (!core::basic_items::update(context, record) || core::basic_items::lookup(context, record.itemBaseId)->itemName != "renamed") {
+        std::cout << "catalog was not updated" << std::endl;
+        return 1;
+    }
+
+    //单行修改只构造增量快照，增量过大时才合并重建
+    auto& catalog = context->getBasicItemsCatalog();
+    int updates = 10000;
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < updates; ++i) {
+        auto item = catalog.find(itemBaseIds[static_cast<size_t>(i) % itemBaseIds.size()]);
+        catalog.put({ item->itemBaseId, "renamed", item->itemDescribe, i % 8, item->itemProperties });
+    }
+    auto putTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / updates;
+
+    std::cout << count << " items, catalog " << context->getBasicItemsCatalog().snapshot()->memoryUsage() / 1024 << " KiB" << std::endl;
+    std::cout << "sql:     " << sqlTime << " ns/op" << std::endl;
+    std::cout << "catalog: " << catalogTime << " ns/op" << std::endl;
+    std::cout << "snapshot: " << snapshotTime << " ns/op (" << length << ")" << std::endl;
+    std::cout << "put:     " << putTime << " us/op" << std::endl;
+
+    context->close();
+    std::filesystem::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <atomic>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "items/basic_items_catalog.hpp"
+#include "test_expect.hpp"
+
+struct Expected {
+    std::string name;
+    int32_t category;
+};
+
+static bool matches(const core::BasicItemsCatalog& catalog, const std::map<int64_t, Expected>& expected, int64_t maxId)
+{
+    auto snapshot = catalog.snapshot();
+    if (snapshot->size() != expected.size()) {
+        return false;
+    }
+    for (int64_t id = 0; id <= maxId; ++id) {
+        auto item = snapshot->find(id);
+        auto it = expected.find(id);
+        if (it == expected.end() ? item.has_value() : !item || item->itemName != it->second.name || item->itemCateogory != it->second.category) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * 以随机的添加、替换与移除校验增量快照与合并重建后的查找结果，
+ * 校验大量修改后仍然存活的快照数量有界，被Item持有的快照不会被回收，
+ * 以及与修改并发的读取总是取得完整有效的物品
+ */
+int main()
+{
+    constexpr int64_t maxId = 2000;
+
+    core::BasicItemsCatalog catalog;
+    std::map<int64_t, Expected> expected;
+
+    std::vector<core::BasicItemsCatalog::Item> initial;
+    std::vector<std::string> names;
+    for (int64_t id = 1; id <= 1000; ++id) {
+        names.push_back("item" + std::to_string(id));
+    }
+    for (int64_t id = 1; id <= 1000; ++id) {
+        initial.push_back({ id, names[id - 1], "describe", static_cast<int32_t>(id % 8), "{}" });
+        expected[id] = { names[id - 1], static_cast<int32_t>(id % 8) };
+    }
+    catalog.put(initial);
+    bool ok = test::expect(matches(catalog, expected, maxId), "initial");
+
+    //修改前取得的Item在之后的修改中保持有效
+    auto pinned = catalog.find(1);
+    std::weak_ptr<const core::BasicItemsCatalog::Snapshot> pinnedSnapshot = pinned->snapshot;
+
+    std::mt19937_64 random(42);
+    std::vector<std::weak_ptr<const core::BasicItemsCatalog::Snapshot>> history;
+    for (int i = 0; i < 5000; ++i) {
+        auto id = static_cast<int64_t>(random() % maxId) + 1;
+        if (random() % 4 == 0) {
+            catalog.erase(id);
+            expected.erase(id);
+        } else {
+            auto name = "name" + std::to_string(i);
+            catalog.put({ id, name, "describe", i, "{\"atk\":1}" });
+            expected[id] = { name, i };
+        }
+        history.push_back(catalog.snapshot());
+
+        if (i % 250 == 0 && !matches(catalog, expected, maxId)) {
+            ok = test::expect(false, "after write " + std::to_string(i));
+        }
+    }
+    ok = test::expect(matches(catalog, expected, maxId), "after writes") && ok;
+
+    //只有当前快照、它的基础快照以及被Item持有的快照存活
+    size_t alive = 0;
+    for (auto& snapshot : history) {
+        alive += snapshot.expired() ? 0 : 1;
+    }
+    ok = test::expect(alive <= 2, "retained snapshots " + std::to_string(alive)) && ok;
+    ok = test::expect(!pinnedSnapshot.expired() && pinned->itemName == "item1", "pinned item") && ok;
+    pinned.reset();
+    ok = test::expect(pinnedSnapshot.expired(), "pinned snapshot released") && ok;
+
+    //并发读取：名称与分类由同一次修改写入，读到的Item必须一致且字符串有效
+    {
+        for (int64_t id = 1; id <= 64; ++id) {
+            catalog.put({ id, "c0", "describe", 0, "{}" });
+        }
+        std::atomic<bool> running { true };
+        std::atomic<uint64_t> reads { 0 }, mismatches { 0 };
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 2; ++t) {
+            readers.emplace_back([&catalog, &running, &reads, &mismatches, t] {
+                std::mt19937_64 random(static_cast<uint64_t>(t));
+                while (running) {
+                    auto item = catalog.find(static_cast<int64_t>(random() % 64) + 1);
+                    if (item && item->itemName != "c" + std::to_string(item->itemCateogory)) {
+                        ++mismatches;
+                    }
+                    ++reads;
+                }
+            });
+        }
+        for (int i = 0; i < 20000; ++i) {
+            auto id = static_cast<int64_t>(i % 64) + 1;
+            catalog.put({ id, "c" + std::to_string(i), "describe", i, "{}" });
+        }
+        running = false;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        ok = test::expect(reads > 0 && mismatches == 0, "concurrent reads") && ok;
+    }
+
+    return test::report(ok);
+}
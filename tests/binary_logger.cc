@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger/async_logger.hpp"
+#include "logger/binary_log_format.hpp"
+#include "logger/binary_logger.hpp"
+
+static const std::string kDirectory = "bench_binary_logger";
+
+template <typename Logger>
+static double run(Logger& logger, int threads, long calls)
+{
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (long i = 0; i < calls / threads; ++i) {
+                logger.info("bench", "player {} moved to ({}, {}) in zone {}", i, 1.5 * t, 2.5, "forest");
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / static_cast<double>(calls / threads * threads);
+}
+
+/**
+ * @brief 统计各段中的日志条数，并检查每条日志使用的格式都在同一段内、在它之前定义
+ */
+static bool countEntries(size_t& count)
+{
+    bool ok = true;
+    for (auto& file : std::filesystem::directory_iterator(kDirectory)) {
+        if (file.path().extension() != ".klog") {
+            continue;
+        }
+        std::ifstream is(file.path(), std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+        core::binlog::SegmentHeader header;
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (!core::binlog::checkMagic(header) || header.used != data.size()) {
+            std::cout << file.path() << " was not closed properly" << std::endl;
+            ok = false;
+            continue;
+        }
+
+        std::set<uint32_t> defined;
+        for (size_t offset = header.headerSize; offset < header.used;) {
+            core::binlog::RecordHeader record;
+            std::memcpy(&record, data.data() + offset, sizeof(record));
+            if (record.size == 0) {
+                break;
+            }
+            uint32_t id;
+            std::memcpy(&id, data.data() + offset + sizeof(record), sizeof(id));
+            if (record.kind == core::binlog::RecordKind::format) {
+                defined.insert(id);
+            } else if (record.kind == core::binlog::RecordKind::entry) {
+                if (defined.count(id) == 0) {
+                    std::cout << file.path() << " uses format " << id << " before defining it" << std::endl;
+                    ok = false;
+                }
+                ++count;
+            }
+            offset += record.size;
+        }
+    }
+    return ok;
+}
+
+/**
+ * 比较文本异步日志与二进制日志每次调用的耗时，并校验二进制日志没有丢失记录
+ */
+int main(int argc, char* argv[])
+{
+    long calls = argc > 1 ? std::stol(argv[1]) : 1000000;
+    bool ok = true;
+    std::filesystem::remove_all(kDirectory);
+
+    for (int threads : { 1, 4 }) {
+        core::AsyncLogger::Options textOptions;
+        textOptions.path = kDirectory + "/text.log";
+        textOptions.overflow = core::AsyncLogger::Overflow::block;
+        std::filesystem::create_directories(kDirectory);
+        core::AsyncLogger text(textOptions);
+        text.start();
+        auto textTime = run(text, threads, calls);
+        text.stop();
+
+        core::BinaryLogger::Options binaryOptions;
+        binaryOptions.path = kDirectory + "/binary";
+        binaryOptions.segmentSize = 4 * 1024 * 1024;
+        binaryOptions.maxSegments = 0;
+        core::BinaryLogger binary(binaryOptions);
+        if (!binary.start()) {
+            std::cout << "failed to create a log segment" << std::endl;
+            return 1;
+        }
+        auto binaryTime = run(binary, threads, calls);
+        binary.stop();
+
+        auto statistics = binary.statistics();
+        size_t count = 0;
+        ok = countEntries(count) && ok;
+        std::cout << threads << " thread(s): text " << textTime << " ns/call, binary " << binaryTime << " ns/call, "
+                  << statistics.segments << " segments, " << count << " records" << std::endl;
+
+        auto expected = static_cast<size_t>(calls / threads * threads);
+        if (statistics.dropped != 0 || statistics.written != expected || count != expected) {
+            std::cout << "expected " << expected << " records" << std::endl;
+            ok = false;
+        }
+        std::filesystem::remove_all(kDirectory);
+    }
+
+    {
+        //超过可序列化个数的参数在调用线程中格式化为文本，不能截断
+        core::BinaryLogger::Options options;
+        options.path = kDirectory + "/many";
+        core::BinaryLogger binary(options);
+        binary.start();
+        binary.info("bench", "{} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {}", 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17);
+        binary.stop();
+
+        std::string data;
+        for (auto& file : std::filesystem::directory_iterator(kDirectory)) {
+            std::ifstream is(file.path(), std::ios::binary);
+            data.append(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+        }
+        if (binary.statistics().written != 1 || data.find("[bench] 0 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17") == std::string::npos) {
+            std::cout << "arguments beyond the serializable count were lost" << std::endl;
+            ok = false;
+        }
+        std::filesystem::remove_all(kDirectory);
+    }
+
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cppcrc.hh"
+
+static uint64_t byteByByte(const crc::CodeBase::ShareConstPtr &code,
+                           const uint8_t *data, size_t size) {
+  crc::Encoder encoder(code);
+  for (size_t i = 0; i < size; ++i) {
+    encoder.update(data[i]);
+  }
+  return encoder.value();
+}
+
+// The compile-time encoder must agree with the reference check values.
+static_assert(crc::checksum<crc::Crc32>("123456789") == 0xCBF43926);
+static_assert(crc::checksum<crc::Crc64Ecma>("123456789") ==
+              0x6C40DF5F0B497347ull);
+static_assert(crc::checksum<crc::Crc64We>("123456789") ==
+              0x62EC59E3F1A4F00Aull);
+static_assert(crc::checksum<crc::Crc16>("123456789") == 0xBB3D);
+
+template <class Algorithm>
+static uint64_t staticChecksum(const uint8_t *data, size_t size) {
+  crc::StaticEncoder<Algorithm> encoder;
+  encoder.update(data, size);
+  return encoder.value();
+}
+
+/**
+ * Check the bulk update, the static encoder and combining partial crcs against
+ * the byte-by-byte update for every code, at every length up to a few kilobytes and at unaligned
+ * offsets, then compare their throughput.
+ */
+int main(int argc, char *argv[]) {
+  using StaticChecksum = uint64_t (*)(const uint8_t *, size_t);
+  struct Code {
+    const char *name;
+    crc::CodeBase::ShareConstPtr code;
+    StaticChecksum staticChecksum;
+  };
+  std::vector<Code> codes = {
+      {"crc8", crc::CodeCrc8::instance(), staticChecksum<crc::Crc8>},
+      {"crc16", crc::CodeCrc16::instance(), staticChecksum<crc::Crc16>},
+      {"crc32", crc::CodeCrc32::instance(), staticChecksum<crc::Crc32>},
+      {"crc64_ecma", crc::CodeCrc64::ecmaInstance(),
+       staticChecksum<crc::Crc64Ecma>},
+      {"crc64_we", crc::CodeCrc64::weInstance(), staticChecksum<crc::Crc64We>},
+      {"crckrmit", crc::CodeCrcKrmit::instance(),
+       staticChecksum<crc::CrcKrmit>},
+      {"crcsick", crc::CodeCrcSick::instance(), staticChecksum<crc::CrcSick>},
+      {"crcdnp", crc::CodeCrcDnp::instance(), staticChecksum<crc::CrcDnp>}};
+
+  std::mt19937_64 random(20221019);
+  std::vector<uint8_t> data(4 << 20);
+  for (auto &c : data) {
+    c = static_cast<uint8_t>(random());
+  }
+
+  bool ok = true;
+  for (auto &code : codes) {
+    for (size_t size = 0; size <= 4200 && ok; size += size < 300 ? 1 : 37) {
+      auto offset = static_cast<size_t>(random() % 16);
+      auto expected = byteByByte(code.code, data.data() + offset, size);
+      if (crc::Encoder(code.code, data.data() + offset,
+                       data.data() + offset + size)
+              .value() != expected) {
+        printf("%s: bulk update differs at size %zu offset %zu\n", code.name,
+               size, offset);
+        ok = false;
+      }
+
+      if (code.staticChecksum(data.data() + offset, size) != expected) {
+        printf("%s: static encoder differs at size %zu\n", code.name, size);
+        ok = false;
+      }
+
+      // Split into two updates, the second one must continue from the first.
+      auto split = size / 3;
+      crc::Encoder encoder(code.code);
+      encoder.update(data.data() + offset, split);
+      encoder.update(data.data() + offset + split, size - split);
+      if (encoder.value() != expected) {
+        printf("%s: split update differs at size %zu\n", code.name, size);
+        ok = false;
+      }
+
+      // Hash the parts separately and merge them.
+      crc::Encoder head(code.code), tail(code.code);
+      head.update(data.data() + offset, split);
+      if (split > 0) {
+        tail.setPreByte(data[offset + split - 1]);
+      }
+      tail.update(data.data() + offset + split, size - split);
+      head.combine(tail, size - split);
+      if (head.value() != expected) {
+        printf("%s: combine differs at size %zu\n", code.name, size);
+        ok = false;
+      }
+    }
+
+    std::istringstream stream(
+        std::string(data.begin(), data.begin() + 200000 + 13));
+    if (crc::Encoder(code.code, stream).value() !=
+        byteByByte(code.code, data.data(), 200000 + 13)) {
+      printf("%s: istream update differs\n", code.name);
+      ok = false;
+    }
+  }
+
+  auto rounds = argc > 1 ? std::stoi(argv[1]) : 8;
+  for (auto &code : codes) {
+    auto begin = std::chrono::steady_clock::now();
+    auto slow = byteByByte(code.code, data.data(), data.size());
+    auto byteSeconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - begin)
+                           .count();
+
+    begin = std::chrono::steady_clock::now();
+    uint64_t fast = 0;
+    for (int i = 0; i < rounds; ++i) {
+      fast = crc::Encoder(code.code, data.data(), data.data() + data.size())
+                 .value();
+    }
+    auto bulkSeconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - begin)
+                           .count() /
+                       rounds;
+
+    auto megabytes = static_cast<double>(data.size()) / (1 << 20);
+    printf("%-10s byte-by-byte %8.1f MiB/s, bulk %8.1f MiB/s\n", code.name,
+           megabytes / byteSeconds, megabytes / bulkSeconds);
+    ok = ok && slow == fast;
+  }
+
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
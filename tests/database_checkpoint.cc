@@ -0,0 +1,91 @@
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+#include "context/context.hpp"
+#include "sqlite/sqlite3.hpp"
+#include "storage/database_checkpoint.hpp"
+#include "test_expect.hpp"
+#include "test_logger.hpp"
+
+static int64_t count(const std::filesystem::path& path)
+{
+    sqlite::database_manager database(path.u8string(), SQLITE_OPEN_READONLY);
+    auto stmt = database.query("item", "COUNT(*)");
+    return stmt.step() == SQLITE_ROW ? stmt.column_int64(0) : -1;
+}
+
+static int64_t playerCount(const sqlite::database_manager& database)
+{
+    auto stmt = database.query("GamePlayer", "COUNT(*)");
+    return stmt.step() == SQLITE_ROW ? stmt.column_int64(0) : -1;
+}
+
+/**
+ * 校验检查点在数据库没有变化时跳过写回，本连接、其它连接与表结构的更改都会触发写回，
+ * 以及共享内存模式下其它连接可经由Context::getGameDBUri访问游戏数据库，其更改在close时写回
+ */
+int main()
+{
+    auto root = std::filesystem::temp_directory_path() / "kgame_database_checkpoint";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    auto path = root / "game.db";
+
+    int flags = SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_URI | SQLITE_OPEN_SHAREDCACHE;
+    sqlite::database_manager database("file:kgame_checkpoint?mode=memory&cache=shared", flags);
+    sqlite::database_manager other("file:kgame_checkpoint?mode=memory&cache=shared", flags);
+    bool ok = database.exec("CREATE TABLE item(id INTEGER PRIMARY KEY, name TEXT)");
+
+    core::DatabaseCheckpoint checkpoint(std::make_shared<test::Logger>(), core::DatabaseSnapshot::Options {});
+    ok = test::expect(checkpoint.start(database, path.u8string(), std::chrono::hours(1)), "start") && ok;
+
+    ok = test::expect(checkpoint.checkpoint() && checkpoint.statistics().count == 1, "first checkpoint") && ok;
+    ok = test::expect(checkpoint.checkpoint() && checkpoint.statistics().count == 1 && checkpoint.statistics().skipped == 1, "unchanged skipped") && ok;
+
+    database.exec("INSERT INTO item(name) VALUES('sword')");
+    ok = test::expect(checkpoint.checkpoint() && checkpoint.statistics().count == 2, "own change written") && ok;
+    ok = test::expect(count(path) == 1, "own change on disk") && ok;
+
+    other.exec("INSERT INTO item(name) VALUES('shield')");
+    ok = test::expect(checkpoint.checkpoint() && checkpoint.statistics().count == 3, "other connection change written") && ok;
+    ok = test::expect(count(path) == 2, "other connection change on disk") && ok;
+
+    database.exec("CREATE INDEX item_name ON item(name)");
+    ok = test::expect(checkpoint.checkpoint() && checkpoint.statistics().count == 4, "schema change written") && ok;
+
+    //停止时的最后一次写回同样在没有变化时跳过
+    ok = test::expect(checkpoint.stop() && checkpoint.statistics().count == 4 && checkpoint.statistics().skipped == 2, "stop skipped") && ok;
+
+    other.close();
+    database.close();
+    std::filesystem::remove_all(root);
+
+    //共享内存模式
+    {
+        core::DatabaseOptions options;
+        options.mode = core::DatabaseMode::sharedMemory;
+        auto context = core::Context::instantiate(std::make_shared<test::Logger>(), root.u8string());
+        ok = test::expect(context->init(options), "shared memory init") && ok;
+        ok = test::expect(!context->getGameDBUri().empty(), "shared memory uri") && ok;
+
+        sqlite::database_manager attached(context->getGameDBUri(), SQLITE_OPEN_READWRITE | SQLITE_OPEN_URI);
+        ok = test::expect(attached.exec("INSERT INTO GamePlayer(playerName, playerRegdate) VALUES('player', '2022-10-19')"), "attach by uri") && ok;
+        ok = test::expect(playerCount(context->getGameDB()) == 1, "change visible to context") && ok;
+        attached.close();
+
+        ok = test::expect(context->close(), "shared memory close") && ok;
+        sqlite::database_manager disk((root / "db" / "game.db").u8string(), SQLITE_OPEN_READONLY);
+        ok = test::expect(playerCount(disk) == 1, "attached change on disk") && ok;
+        disk.close();
+
+        core::DatabaseOptions memory;
+        memory.mode = core::DatabaseMode::memory;
+        auto privateContext = core::Context::instantiate(std::make_shared<test::Logger>(), root.u8string());
+        ok = test::expect(privateContext->init(memory) && privateContext->getGameDBUri().empty(), "private memory has no uri") && ok;
+        privateContext->close();
+    }
+    std::filesystem::remove_all(root);
+
+    return test::report(ok);
+}
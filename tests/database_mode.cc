@@ -0,0 +1,65 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "context/context.hpp"
+#include "items/basic_items.hpp"
+#include "items/game_items.hpp"
+#include "test_logger.hpp"
+
+/**
+ * 在磁盘模式与内存模式下执行相同的变更负载，比较吞吐量
+ */
+static void run(const char* name, core::DatabaseMode mode, int count)
+{
+    auto root = std::filesystem::temp_directory_path() / "kgame_database_mode";
+    std::filesystem::remove_all(root);
+
+    core::DatabaseOptions options;
+    options.mode = mode;
+
+    auto logger = std::make_shared<test::Logger>(test::Logger::Info | test::Logger::Warn | test::Logger::Error);
+    auto context = core::Context::instantiate(logger, root.u8string());
+    if (!context->init(options)) {
+        std::cout << name << ": init failure" << std::endl;
+        return;
+    }
+
+    auto itemBaseId = core::basic_items::insert(context, "sword", "a sword", 1, "{}");
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        core::game_items::insert(context, itemBaseId, "{\"atk\":1}");
+    }
+    auto syncTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        core::game_items::insertAsync(context, itemBaseId, "{\"atk\":1}");
+    }
+    context->getWriteQueue()->flush();
+    auto asyncTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    begin = std::chrono::steady_clock::now();
+    context->close();
+    auto closeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << name << ": "
+              << count / syncTime << " sync inserts/s, "
+              << count / asyncTime << " write-behind inserts/s, "
+              << "close " << closeTime * 1000 << " ms" << std::endl;
+
+    std::filesystem::remove_all(root);
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? std::stoi(argv[1]) : 2000;
+
+    run("disk", core::DatabaseMode::disk, count);
+    run("memory", core::DatabaseMode::memory, count);
+    run("shared memory", core::DatabaseMode::sharedMemory, count);
+
+    return 0;
+}
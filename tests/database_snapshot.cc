@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "storage/database_snapshot.hpp"
+#include "test_logger.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+struct Latency {
+    std::chrono::microseconds p50 { 0 };
+    std::chrono::microseconds p99 { 0 };
+    std::chrono::microseconds max { 0 };
+};
+
+static Latency summarize(std::vector<std::chrono::microseconds> samples)
+{
+    Latency latency;
+    if (samples.empty()) {
+        return latency;
+    }
+    std::sort(samples.begin(), samples.end());
+    latency.p50 = samples[samples.size() / 2];
+    latency.p99 = samples[samples.size() * 99 / 100];
+    latency.max = samples.back();
+    return latency;
+}
+
+/**
+ * @brief 模拟游戏线程：每1ms执行一次点查询，记录每次查询的耗时，直到done返回true
+ */
+template <class Done>
+static std::vector<std::chrono::microseconds> tick(const sqlite::database_manager& database, Done&& done)
+{
+    std::vector<std::chrono::microseconds> samples;
+    for (int64_t i = 0; !done(samples.size()); ++i) {
+        auto begin = Clock::now();
+        database.single_step("SELECT value FROM counter WHERE id=?", i % 16);
+        samples.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return samples;
+}
+
+static void run(const char* name, const sqlite::database_manager& database, const std::filesystem::path& path,
+    const core::DatabaseSnapshot::Options& options, const Latency& baseline)
+{
+    core::DatabaseSnapshot snapshot(std::make_shared<test::Logger>(), options);
+    core::DatabaseSnapshot::Result result;
+    snapshot.start(database, path.u8string(), [&](const core::DatabaseSnapshot::Result& r) { result = r; });
+    auto during = summarize(tick(database, [&](size_t) { return !snapshot.isRunning(); }));
+    snapshot.wait();
+
+    std::printf("%-9s %s, %d pages in %zu steps (%d pages/step at end), %lld ms, max step %lld us, %zu steps over budget\n",
+        name, result.success ? "ok" : "FAILED", result.pageCount, result.steps, result.pagesPerStep,
+        static_cast<long long>(result.duration.count() / 1000), static_cast<long long>(result.maxStep.count()), result.stepsOverBudget);
+    std::printf("%-9s game query p50 %lld us, p99 %lld us, max %lld us; max added %lld us (requirement <= 1000 us)\n",
+        "", static_cast<long long>(during.p50.count()), static_cast<long long>(during.p99.count()),
+        static_cast<long long>(during.max.count()), static_cast<long long>((during.max - baseline.max).count()));
+}
+
+/**
+ * 在后台快照期间以1ms间隔执行点查询，比较固定每批页数与按耗时自适应时游戏线程的最长阻塞
+ */
+int main(int argc, char* argv[])
+{
+    int megabytes = argc > 1 ? std::stoi(argv[1]) : 64;
+
+    auto root = std::filesystem::temp_directory_path() / "kgame_database_snapshot";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    sqlite::database_manager database((root / "game.db").u8string(), SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX);
+    database.exec("CREATE TABLE data(id INTEGER PRIMARY KEY, payload BLOB);"
+                  "CREATE TABLE counter(id INTEGER PRIMARY KEY, value INT);"
+                  "WITH RECURSIVE c(x) AS (SELECT 0 UNION ALL SELECT x+1 FROM c LIMIT 16) INSERT INTO counter SELECT x, 0 FROM c;"
+                  "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x+1 FROM c LIMIT "
+        + std::to_string(megabytes * 256) + ") INSERT INTO data SELECT x, randomblob(4000) FROM c;");
+
+    auto baseline = summarize(tick(database, [](size_t count) { return count >= 500; }));
+    std::printf("baseline  game query p50 %lld us, p99 %lld us, max %lld us\n", static_cast<long long>(baseline.p50.count()),
+        static_cast<long long>(baseline.p99.count()), static_cast<long long>(baseline.max.count()));
+
+    core::DatabaseSnapshot::Options fixed;
+    fixed.stepBudget = std::chrono::microseconds(0);
+    run("fixed", database, root / "fixed.db", fixed, baseline);
+
+    run("adaptive", database, root / "adaptive.db", core::DatabaseSnapshot::Options {}, baseline);
+
+    database.close();
+    std::filesystem::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "formula/formula_cache.hpp"
+#include "lepton/ParsedExpression.h"
+#include "lepton/Parser.h"
+#include "test_logger.hpp"
+
+static double seconds(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+//物品公式模板，%a、%b、%c处填入随机常量
+static const char* kTemplates[] = {
+    "atk * %a + str * %b",
+    "atk * (1 + crit * %a) - def * %b",
+    "max(0, atk - def * %a) * (1 + %b * level)",
+    "lv^2 * %a + lv * %b + %c",
+    "min(hp + regen * %a, maxHp) / maxHp",
+    "base * (1 + %a * lv) ^ 1.5",
+    "sqrt(level) * %a + %b",
+    "(str + agi * %a) * (1 + %b * step(level - %c))",
+    "hp * %a + def * %b + res * %c",
+    "%a + %b * log(1 + exp(level / %c))",
+};
+
+static std::string instantiate(const std::string& pattern, std::mt19937_64& random)
+{
+    std::string result;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] == '%' && i + 1 < pattern.size()) {
+            //0与1不提升，随机常量不取这两个值，以使同一模板的公式结构相同
+            int value;
+            do {
+                value = static_cast<int>(random() % 400);
+            } while (value < 2 || value == 100);
+            result += random() % 2 == 0 ? std::to_string(value) : std::to_string(value / 100) + "." + std::to_string(value % 100);
+            ++i;
+        } else if (pattern[i] == ' ' && random() % 3 == 0) {
+            result += "  ";
+        } else {
+            result += pattern[i];
+        }
+    }
+    return result;
+}
+
+/**
+ * 以5万个物品的公式比较 逐个解析编译 与 经由公式缓存 的启动耗时，并校验结果一致
+ */
+int main(int argc, char* argv[])
+{
+    int items = argc > 1 ? std::stoi(argv[1]) : 50000;
+    //不同物品的公式只有有限的种类，常量的取值范围也有限，因此大量物品的公式完全相同
+    std::mt19937_64 random(20221019);
+    std::vector<std::string> formulas;
+    for (int i = 0; i < items; ++i) {
+        formulas.push_back(instantiate(kTemplates[random() % (sizeof(kTemplates) / sizeof(kTemplates[0]))], random));
+    }
+
+    //逐个编译的结果在计时后释放，以免之后的计时受到已占用的内存的影响
+    auto begin = std::chrono::steady_clock::now();
+    {
+        std::vector<Lepton::CompiledExpression> naive;
+        naive.reserve(formulas.size());
+        for (auto& formula : formulas) {
+            naive.push_back(Lepton::Parser::parse(formula).createCompiledExpression());
+        }
+        std::cout << "parse every formula: " << seconds(begin) << "s" << std::endl;
+    }
+
+    bool ok = true;
+    for (auto hoist : { false, true }) {
+        core::FormulaCache::Options options;
+        options.hoistConstants = hoist;
+        core::FormulaCache cache(std::make_shared<test::Logger>(), options);
+
+        begin = std::chrono::steady_clock::now();
+        std::vector<core::FormulaCache::FormulaPtr> cached;
+        cached.reserve(formulas.size());
+        for (auto& formula : formulas) {
+            cached.push_back(cache.get(formula));
+        }
+        auto elapsed = seconds(begin);
+
+        auto statistics = cache.statistics();
+        std::cout << "formula cache" << (hoist ? " (hoisted constants)" : "") << ": " << elapsed << "s, "
+                  << statistics.formulas << " formulas, " << statistics.programs << " programs, "
+                  << statistics.compilations << " compilations, " << statistics.hits << " hits, "
+                  << statistics.memoryUsage / 1024 << " KiB" << std::endl;
+
+        //与逐个编译的结果比较
+        for (size_t i = 0; i < formulas.size(); i += 7) {
+            auto& formula = cached[i];
+            if (!formula) {
+                std::cout << "failed to compile " << formulas[i] << std::endl;
+                ok = false;
+                break;
+            }
+
+            auto context = formula->createContext();
+            auto expression = Lepton::Parser::parse(formulas[i]).createCompiledExpression();
+            for (auto& name : expression.getVariables()) {
+                auto value = 1.0 + static_cast<double>(i % 97) * 0.5 + static_cast<double>(name.size());
+                expression.getVariableReference(name) = value;
+                context.setVariable(formula->getVariableIndex(name), value);
+            }
+            auto expected = expression.evaluate();
+            auto result = context.evaluate();
+            if (!(result == expected || std::fabs(result - expected) <= 1e-12 * std::fabs(expected))) {
+                std::cout << formulas[i] << ": expected " << expected << " got " << result << std::endl;
+                ok = false;
+                break;
+            }
+        }
+
+        if (hoist && statistics.compilations > sizeof(kTemplates) / sizeof(kTemplates[0])) {
+            std::cout << "structurally identical formulas were compiled more than once" << std::endl;
+            ok = false;
+        }
+    }
+
+    //0与1不提升，与之相关的化简不因是否提升常量而不同
+    for (auto hoist : { false, true }) {
+        core::FormulaCache::Options options;
+        options.hoistConstants = hoist;
+        core::FormulaCache cache(std::make_shared<test::Logger>(), options);
+        for (auto text : { "x * 0", "0 * x", "0 / x", "x * 1", "1 / x", "x + 0" }) {
+            auto formula = cache.get(text);
+            auto context = formula->createContext();
+            auto expression = Lepton::Parser::parse(text).createCompiledExpression();
+            //化简为常量后不再有变量x
+            auto index = formula->getVariableIndex("x");
+            bool hasVariable = expression.getVariables().count("x") != 0;
+            for (double x : { static_cast<double>(INFINITY), 0.0, 2.0 }) {
+                if (index >= 0) {
+                    context.setVariable(index, x);
+                }
+                if (hasVariable) {
+                    expression.getVariableReference("x") = x;
+                }
+                auto expected = expression.evaluate();
+                auto result = context.evaluate();
+                if (!(result == expected || (std::isnan(result) && std::isnan(expected)))) {
+                    std::cout << text << (hoist ? " (hoisted constants)" : "") << ": expected " << expected << " got " << result << std::endl;
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    //求导后的化简不能引入NaN
+    {
+        auto derivative = Lepton::Parser::parse("x^2*y").differentiate("x").optimize().createCompiledExpression();
+        derivative.getVariableReference("x") = -1.0;
+        derivative.getVariableReference("y") = 3.0;
+        if (derivative.evaluate() != -6.0) {
+            std::cout << "d(x^2*y)/dx at x=-1, y=3: expected -6 got " << derivative.evaluate() << std::endl;
+            ok = false;
+        }
+    }
+
+    //缓存已满时不再缓存新的公式，但仍然返回解析结果
+    {
+        core::FormulaCache::Options options;
+        options.maxFormulas = 32;
+        core::FormulaCache cache(std::make_shared<test::Logger>(0), options);
+        bool compiled = true;
+        for (size_t i = 0; i < 1000; ++i) {
+            compiled = cache.get(formulas[i]) != nullptr && compiled;
+        }
+        auto statistics = cache.statistics();
+        if (!compiled || statistics.formulas > options.maxFormulas || statistics.programs > options.maxFormulas * 2 || statistics.uncached == 0) {
+            std::cout << "formula cache exceeds its capacity: " << statistics.formulas << " formulas, " << statistics.programs << " programs" << std::endl;
+            ok = false;
+        }
+    }
+
+    //多线程同时查找
+    core::FormulaCache cache(std::make_shared<test::Logger>());
+    const int threads = 8;
+    begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (size_t i = t; i < formulas.size() * 4; i += threads) {
+                cache.get(formulas[i % formulas.size()]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto statistics = cache.statistics();
+    std::cout << threads << " threads, " << statistics.lookups << " lookups: " << seconds(begin) << "s, "
+              << statistics.compilations << " compilations" << std::endl;
+
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
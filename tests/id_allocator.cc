@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "context/context.hpp"
+#include "items/basic_items.hpp"
+#include "items/game_items.hpp"
+#include "player/player_manager.hpp"
+#include "test_logger.hpp"
+
+static double seconds(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/**
+ * 比较 同步插入、经由队列插入 与 预分配id后异步写入 三种方式每秒可创建的物品数，
+ * 并校验经由玩家id分配器创建的玩家
+ */
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? std::stoi(argv[1]) : 2000;
+    int threads = argc > 2 ? std::stoi(argv[2]) : 4;
+
+    auto root = std::filesystem::temp_directory_path() / "kgame_id_allocator";
+    std::filesystem::remove_all(root);
+
+    auto context = core::Context::instantiate(std::make_shared<test::Logger>(), root.u8string());
+    if (!context->init()) {
+        std::cout << "init failure" << std::endl;
+        return 1;
+    }
+
+    auto itemBaseId = core::basic_items::insert(context, "potion", "a potion", 1, "{}");
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        core::game_items::insert(context, itemBaseId, "{}");
+    }
+    std::cout << "insert:       " << count / seconds(begin) << " items/s" << std::endl;
+
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < count * 10; ++i) {
+        core::game_items::insertAsync(context, itemBaseId, "{}");
+    }
+    context->getWriteQueue()->flush();
+    std::cout << "insertAsync:  " << count * 10 / seconds(begin) << " items/s (until persisted)" << std::endl;
+
+    //多个游戏线程同时创建物品，id在调用返回时即可使用
+    std::vector<std::vector<int64_t>> itemIds(static_cast<size_t>(threads));
+    std::vector<std::thread> workers;
+    begin = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < count * 10; ++i) {
+                itemIds[static_cast<size_t>(t)].push_back(core::game_items::create(context, itemBaseId, "{}"));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto assigned = seconds(begin);
+    context->getWriteQueue()->flush();
+    auto persisted = seconds(begin);
+
+    auto total = static_cast<double>(count) * 10 * threads;
+    std::cout << "create:       " << total / assigned << " items/s (ids assigned), "
+              << total / persisted << " items/s (until persisted), " << threads << " threads" << std::endl;
+
+    //单独测量分配器本身，预留新块之外无锁
+    workers.clear();
+    begin = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (int i = 0; i < count * 100; ++i) {
+                context->getItemIdAllocator()->next();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::cout << "next():       " << static_cast<double>(count) * 100 * threads / seconds(begin) << " ids/s, " << threads << " threads" << std::endl;
+
+    //id互不重复，且之后使用AUTOINCREMENT插入的记录不会与已分配的id冲突
+    std::vector<int64_t> all;
+    for (auto& ids : itemIds) {
+        all.insert(all.end(), ids.begin(), ids.end());
+    }
+    std::sort(all.begin(), all.end());
+    bool unique = std::adjacent_find(all.begin(), all.end()) == all.end() && all.front() != 0;
+    bool afterBlock = core::game_items::insert(context, itemBaseId, "{}") > all.back();
+
+    auto stmt = context->getGameDB().query("GameItems", "count(*)");
+    stmt.step();
+    auto rows = stmt.column<int64_t>(0);
+    bool complete = rows == count + count * 10 + static_cast<int64_t>(all.size()) + 1;
+
+    std::cout << "unique ids: " << unique << ", autoincrement after reserved block: " << afterBlock << ", all rows persisted: " << complete << std::endl;
+
+    //玩家id同样在调用返回时即可使用，写入后可按该id载入
+    core::PlayerManager players(context);
+    std::vector<int64_t> playerIds;
+    for (int i = 0; i < count; ++i) {
+        playerIds.push_back(players.createPlayer("player" + std::to_string(i)));
+    }
+    context->getWriteQueue()->flush();
+    auto sorted = playerIds;
+    std::sort(sorted.begin(), sorted.end());
+    bool playersUnique = std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end() && sorted.front() != 0;
+    auto player = players.getPlayer(playerIds.back());
+    bool playersLoaded = player && player->playerName == "player" + std::to_string(count - 1) && !player->playerRegdate.empty();
+
+    std::cout << "unique player ids: " << playersUnique << ", created players loaded: " << playersLoaded << std::endl;
+
+    context->close();
+    std::filesystem::remove_all(root);
+    return unique && afterBlock && complete && playersUnique && playersLoaded ? 0 : 1;
+}
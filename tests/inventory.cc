@@ -0,0 +1,132 @@
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include "player/inventory.hpp"
+#include "storage/write_behind_queue.hpp"
+#include "test_expect.hpp"
+#include "test_logger.hpp"
+
+using Rows = std::map<int64_t, std::tuple<int64_t, int32_t>>;
+
+static Rows rows(const sqlite::database_manager& database, int64_t playerId)
+{
+    Rows result;
+    auto stmt = database.query("GamePlayerItems", "itemId, itemAmount, itemLocation", "WHERE playerId=?");
+    stmt.bind(playerId);
+    for (auto [itemId, itemAmount, itemLocation] : stmt.rows<std::tuple<int64_t, int64_t, int32_t>>()) {
+        result[itemId] = { itemAmount, itemLocation };
+    }
+    return result;
+}
+
+static Rows rows(const core::Inventory& inventory)
+{
+    Rows result;
+    inventory.forEach([&result](const core::Inventory::Slot& slot) {
+        result[slot.itemId] = { slot.itemAmount, slot.itemLocation };
+    });
+    return result;
+}
+
+/**
+ * @brief 通过延迟写入队列写回并等待结果
+ */
+static bool flushQueued(core::Inventory& inventory, core::WriteBehindQueue& queue)
+{
+    auto result = std::make_shared<bool>(false);
+    if (!inventory.flush(queue, [result](bool success) { *result = success; })) {
+        return false;
+    }
+    queue.flush();
+    inventory.settle();
+    return *result;
+}
+
+/**
+ * 校验背包的放入、移动、堆叠、拆分与移除，以及同步写回和经由延迟写入队列的写回，
+ * 包括写回失败时保留修改标记并在下一次写回时补写
+ */
+int main()
+{
+    sqlite::database_manager database(":memory:", SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY | SQLITE_OPEN_FULLMUTEX);
+    bool ok = database.exec("CREATE TABLE GamePlayerItems(playerId INTEGER NOT NULL, itemId INTEGER NOT NULL, itemAmount INTEGER NOT NULL,"
+                            " itemLocation INTEGER NOT NULL, PRIMARY KEY(playerId, itemId));"
+                            "INSERT INTO GamePlayerItems VALUES(1, 10, 5, 0), (1, 11, 1, 0), (2, 20, 1, 0);"
+                            //control.fail非零时拒绝写入，用于模拟写回失败
+                            "CREATE TABLE control(fail INTEGER);"
+                            "INSERT INTO control VALUES(0);"
+                            "CREATE TRIGGER failInsert BEFORE INSERT ON GamePlayerItems WHEN (SELECT fail FROM control) BEGIN SELECT RAISE(ABORT, 'fail'); END;"
+                            "CREATE TRIGGER failUpdate BEFORE UPDATE ON GamePlayerItems WHEN (SELECT fail FROM control) BEGIN SELECT RAISE(ABORT, 'fail'); END;"
+                            "CREATE TRIGGER failDelete BEFORE DELETE ON GamePlayerItems WHEN (SELECT fail FROM control) BEGIN SELECT RAISE(ABORT, 'fail'); END;");
+
+    auto inventory = core::Inventory::load(database, 1);
+    ok = test::expect(inventory && inventory->size() == 2 && !inventory->isDirty(), "load") && ok;
+    if (!inventory) {
+        return 1;
+    }
+
+    //放入
+    ok = test::expect(inventory->add(12, 3, 1) && inventory->isDirty(), "add") && ok;
+    ok = test::expect(!inventory->add(12, 1, 1) && !inventory->add(13, 0, 1), "add rejects duplicates and empty amount") && ok;
+
+    //移动
+    ok = test::expect(inventory->move(10, 2) && inventory->find(10)->itemLocation == 2, "move") && ok;
+    ok = test::expect(inventory->itemsAt(0) == std::vector<int64_t> { 11 } && inventory->itemsAt(2) == std::vector<int64_t> { 10 }, "location index") && ok;
+    ok = test::expect(!inventory->move(99, 2), "move missing item") && ok;
+
+    //堆叠：全部堆叠后来源被移除
+    ok = test::expect(inventory->stack(10, 12, 2) && inventory->find(10)->itemAmount == 3 && inventory->find(12)->itemAmount == 5, "stack") && ok;
+    ok = test::expect(!inventory->stack(10, 12, 4) && !inventory->stack(10, 10, 1), "stack rejects invalid amount") && ok;
+    ok = test::expect(inventory->stack(11, 12, 1) && inventory->find(11) == nullptr && inventory->find(12)->itemAmount == 6, "stack all") && ok;
+
+    //拆分
+    ok = test::expect(inventory->split(12, 2, 13, 3) && inventory->find(12)->itemAmount == 4 && inventory->find(13)->itemAmount == 2, "split") && ok;
+    ok = test::expect(!inventory->split(12, 4, 14, 3) && !inventory->split(12, 1, 10, 3), "split rejects invalid amount and id") && ok;
+
+    //同步写回
+    ok = test::expect(inventory->flush(database) && !inventory->isDirty(), "flush") && ok;
+    ok = test::expect(rows(database, 1) == rows(*inventory), "flushed rows") && ok;
+    ok = test::expect(rows(database, 2).size() == 1, "other player untouched") && ok;
+
+    core::WriteBehindQueue queue(database, std::make_shared<test::Logger>(0));
+    ok = test::expect(queue.start(), "queue start") && ok;
+
+    //延迟写回成功后清除修改标记
+    inventory->move(13, 4);
+    inventory->remove(10);
+    ok = test::expect(flushQueued(*inventory, queue) && !inventory->isDirty(), "queued flush") && ok;
+    ok = test::expect(rows(database, 1) == rows(*inventory), "queued rows") && ok;
+
+    //写回失败时保留修改标记，恢复后补写
+    database.exec("UPDATE control SET fail=1");
+    inventory->setAmount(12, 9);
+    inventory->remove(13);
+    auto expected = rows(*inventory);
+    ok = test::expect(!flushQueued(*inventory, queue) && inventory->isDirty(), "failed flush keeps dirty") && ok;
+    ok = test::expect(rows(database, 1) != expected, "failed flush wrote nothing") && ok;
+
+    //失败期间的新修改与之前失败的修改一起写回
+    inventory->add(14, 1, 0);
+    expected = rows(*inventory);
+    database.exec("UPDATE control SET fail=0");
+    ok = test::expect(flushQueued(*inventory, queue) && !inventory->isDirty(), "retry flush") && ok;
+    ok = test::expect(rows(database, 1) == expected, "retried rows") && ok;
+
+    //写回尚未确认时的新修改不会被之前的写回清除
+    inventory->setAmount(12, 1);
+    ok = test::expect(inventory->flush(queue), "pending flush") && ok;
+    inventory->move(14, 5);
+    queue.flush();
+    inventory->settle();
+    ok = test::expect(inventory->isDirty(), "modification after pending flush stays dirty") && ok;
+    ok = test::expect(inventory->flush(database) && rows(database, 1) == rows(*inventory), "later flush") && ok;
+
+    //队列未运行时返回false并保留修改标记
+    queue.stop();
+    inventory->move(14, 6);
+    ok = test::expect(!inventory->flush(queue) && inventory->isDirty(), "stopped queue") && ok;
+
+    return test::report(ok);
+}
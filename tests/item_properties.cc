@@ -0,0 +1,49 @@
+#include <string>
+
+#include "items/item_properties.hpp"
+#include "test_expect.hpp"
+
+int main()
+{
+    using core::ItemProperties;
+    using core::ItemPropertiesOverlay;
+
+    bool ok = true;
+    auto base = ItemProperties::parse(R"({"atk":10,"def":5,"speed":1.5,"name":"sword","bound":false,"tags":["a","b"]})");
+    auto top = ItemProperties::parse(R"({"atk":12,"enchant":"fire"})");
+
+    ok = test::expect(base.valid() && base.size() == 6, "parse base") && ok;
+    ok = test::expect(base.get("atk")->asInteger() == 10, "integer") && ok;
+    ok = test::expect(base.get("speed")->asNumber() == 1.5, "real") && ok;
+    ok = test::expect(base.get("atk")->asNumber() == 10.0, "integer as number") && ok;
+    ok = test::expect(base.get("name")->asString() == std::string_view("sword"), "string") && ok;
+    ok = test::expect(base.get("bound")->asBoolean() == false, "boolean") && ok;
+    ok = test::expect(base.get("tags")->asJson() == std::string_view(R"(["a","b"])"), "nested json") && ok;
+    ok = test::expect(!base.get("missing"), "missing key") && ok;
+    ok = test::expect(!base.get("atk")->asString(), "type mismatch") && ok;
+
+    auto atk = ItemProperties::key("atk");
+    ItemPropertiesOverlay overlay(top, base);
+    ok = test::expect(overlay.get(atk)->asInteger() == 12, "overlay top wins") && ok;
+    ok = test::expect(overlay.get("def")->asInteger() == 5, "overlay falls back to base") && ok;
+    ok = test::expect(overlay.get("enchant")->asString() == std::string_view("fire"), "overlay top only") && ok;
+
+    size_t count = 0;
+    overlay.forEach([&count](ItemProperties::Key, const ItemProperties::Value&) { ++count; });
+    ok = test::expect(count == 7, "overlay forEach") && ok;
+
+    auto merged = ItemProperties::parse(overlay.toText());
+    ok = test::expect(merged.size() == 7 && merged.get(atk)->asInteger() == 12, "overlay round trip") && ok;
+
+    auto text = base.toText();
+    auto reparsed = ItemProperties::parse(text);
+    ok = test::expect(reparsed.toText() == text, "round trip") && ok;
+
+    auto invalid = ItemProperties::parse("not json");
+    ok = test::expect(!invalid.valid() && invalid.empty() && invalid.toText() == "not json", "invalid text is preserved") && ok;
+
+    auto empty = ItemProperties::parse("");
+    ok = test::expect(empty.valid() && empty.empty(), "empty text") && ok;
+
+    return test::report(ok);
+}
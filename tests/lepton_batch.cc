@@ -0,0 +1,99 @@
+#include "Lepton.h"
+#include "lepton/Parser.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//比较逐个计算与按列批量计算公式的耗时，并校验两者结果一致
+
+static const char* kFormulas[] = {
+    "atk * (1 + crit * critDamage) - def * 0.5",
+    "max(0, atk - def) * (1 + 0.01 * level) + sqrt(level)",
+    "lv^2 * 0.5 + lv^3 * 0.01 + lv * 3 + base",
+    "min(hp + regen * dt, maxHp) / maxHp",
+    "abs(x - y) * step(x - y) + 1 / (1 + x * x)",
+    "(a + b) * (a - b) / (c + 1) + sin(a) * cos(b)",
+    "exp(-x / 50) * log(1 + y) + x^(y / 50) + x^1.5 + tanh(x - y) + erf(x / 100) - erfc(y / 100)",
+    "atan(x) + asin(x / 100) + acos(y / 100) + sinh(x / 50) + cosh(y / 50) + tan(x) + sec(y) + csc(x + 1) + cot(y + 1)",
+};
+
+template <typename Function>
+static double measure(int rounds, int entities, Function function)
+{
+    auto begin = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        function();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    return elapsed / (static_cast<double>(rounds) * entities);
+}
+
+int main()
+{
+    const int entities = 10000;
+    const int rounds = 200;
+    bool ok = true;
+
+    std::mt19937_64 random(20221019);
+    std::uniform_real_distribution<double> distribution(0.0, 100.0);
+
+    std::cout << "avx2 available: " << (Lepton::EvaluationContext::getUseVectorInstructions() ? "yes" : "no") << std::endl;
+
+    for (auto text : kFormulas) {
+        auto compiled = Lepton::Parser::parse(text).createCompiledExpression();
+        auto context = compiled.createContext();
+        const int variableCount = context.getNumVariables();
+
+        std::vector<std::vector<double>> columns(variableCount, std::vector<double>(entities));
+        std::vector<const double*> pointers(variableCount);
+        for (int v = 0; v < variableCount; ++v) {
+            for (auto& value : columns[v]) {
+                value = distribution(random);
+            }
+            pointers[v] = columns[v].data();
+        }
+
+        std::vector<double> expected(entities), results(entities);
+        auto scalar = measure(rounds, entities, [&] {
+            auto variables = context.getVariables();
+            for (int i = 0; i < entities; ++i) {
+                for (int v = 0; v < variableCount; ++v) {
+                    variables[v] = columns[v][i];
+                }
+                expected[i] = context.evaluate();
+            }
+        });
+
+        double times[2] = {};
+        for (int vectorized = 0; vectorized < 2; ++vectorized) {
+            if (Lepton::EvaluationContext::setUseVectorInstructions(vectorized != 0) != (vectorized != 0)) {
+                continue;
+            }
+            times[vectorized] = measure(rounds, entities, [&] {
+                context.evaluateBatch(pointers.data(), results.data(), entities);
+            });
+
+            for (int i = 0; i < entities; ++i) {
+                auto difference = std::fabs(results[i] - expected[i]);
+                if (!(results[i] == expected[i] || difference <= 1e-12 * std::fabs(expected[i]))) {
+                    std::cout << text << ": entity " << i << " expected " << expected[i] << " got " << results[i] << std::endl;
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        Lepton::EvaluationContext::setUseVectorInstructions(true);
+
+        std::cout << text << std::endl
+                  << "    scalar loop " << scalar << " ns/entity"
+                  << ", batch " << times[0] << " ns/entity"
+                  << ", batch avx2 " << times[1] << " ns/entity" << std::endl;
+    }
+
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include "Lepton.h"
+#include "lepton/Parser.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+//多个线程共享同一个CompiledExpression，每个线程使用独立的EvaluationContext
+
+static const char* kFormulas[] = {
+    "atk * (1 + crit * critDamage) - def * 0.5",
+    "max(0, atk - def) * (1 + 0.01 * level) + sqrt(level)",
+    "lv^2 * 0.5 + lv * 3 + base",
+    "(a + b) * (a - b) / (c + 1) + sin(a) * cos(b)",
+    "step(x - 10) * x + (1 - step(x - 10)) * x^2",
+    "42",
+    "x",
+};
+
+static double value(int thread, int iteration, int variable)
+{
+    return static_cast<double>((thread * 7919 + iteration * 104729 + variable * 1299709) % 1000) / 10.0;
+}
+
+int main()
+{
+    const int threads = 8;
+    const int iterations = 200000;
+    bool ok = true;
+
+    for (auto text : kFormulas) {
+        auto parsed = Lepton::Parser::parse(text);
+        const auto compiled = parsed.createCompiledExpression();
+
+        std::vector<std::string> names(compiled.getVariables().begin(), compiled.getVariables().end());
+        for (int i = 0; i < static_cast<int>(names.size()); ++i) {
+            if (compiled.getVariableIndex(names[i]) != i) {
+                std::cout << text << ": unexpected index for " << names[i] << std::endl;
+                ok = false;
+            }
+        }
+
+        //以未编译的表达式计算的结果作为基准
+        std::vector<std::vector<double>> expected(threads);
+        for (int t = 0; t < threads; ++t) {
+            expected[t].resize(1000);
+            for (int i = 0; i < 1000; ++i) {
+                std::map<std::string, double> variables;
+                for (int v = 0; v < static_cast<int>(names.size()); ++v) {
+                    variables[names[v]] = value(t, i, v);
+                }
+                expected[t][i] = parsed.evaluate(variables);
+            }
+        }
+
+        std::vector<int> mismatches(threads, 0);
+        std::vector<std::thread> workers;
+        auto begin = std::chrono::steady_clock::now();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                auto context = compiled.createContext();
+                auto variables = context.getVariables();
+                for (int i = 0; i < iterations; ++i) {
+                    for (int v = 0; v < context.getNumVariables(); ++v) {
+                        variables[v] = value(t, i % 1000, v);
+                    }
+                    auto result = context.evaluate();
+                    auto& target = expected[t][i % 1000];
+                    if (!(result == target || std::fabs(result - target) <= 1e-12 * std::fabs(target))) {
+                        ++mismatches[t];
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+
+        int total = 0;
+        for (auto count : mismatches) {
+            total += count;
+        }
+        if (total != 0) {
+            ok = false;
+        }
+
+        //复制CompiledExpression共享已编译的程序，但各自拥有变量
+        auto copy = compiled;
+        for (auto& name : names) {
+            copy.getVariableReference(name) = 1.0;
+        }
+        std::map<std::string, double> ones;
+        for (auto& name : names) {
+            ones[name] = 1.0;
+        }
+        if (copy.evaluate() != parsed.evaluate(ones)) {
+            std::cout << text << ": copy evaluated differently" << std::endl;
+            ok = false;
+        }
+
+        std::cout << text << ": " << threads << " threads, "
+                  << elapsed / (static_cast<double>(threads) * iterations) << " ns/eval, "
+                  << total << " mismatches" << std::endl;
+    }
+
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
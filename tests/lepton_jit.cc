@@ -0,0 +1,224 @@
+#include "Lepton.h"
+#include "lepton/CustomFunction.h"
+#include "lepton/Parser.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+//以随机生成的表达式对比解释执行与本地代码的结果，两者应逐位一致
+
+class Clamp : public Lepton::CustomFunction {
+public:
+    int getNumArguments() const override
+    {
+        return 3;
+    }
+
+    double evaluate(const double* arguments) const override
+    {
+        return arguments[0] < arguments[1] ? arguments[1] : (arguments[0] > arguments[2] ? arguments[2] : arguments[0]);
+    }
+
+    double evaluateDerivative(const double* arguments, const int* derivOrder) const override
+    {
+        return 0.0;
+    }
+
+    Lepton::CustomFunction* clone() const override
+    {
+        return new Clamp();
+    }
+};
+
+class Fail : public Lepton::CustomFunction {
+public:
+    int getNumArguments() const override
+    {
+        return 1;
+    }
+
+    double evaluate(const double*) const override
+    {
+        throw Lepton::Exception("fail");
+    }
+
+    double evaluateDerivative(const double*, const int*) const override
+    {
+        return 0.0;
+    }
+
+    Lepton::CustomFunction* clone() const override
+    {
+        return new Fail();
+    }
+};
+
+class Generator {
+public:
+    explicit Generator(uint64_t seed)
+        : mRandom(seed)
+    {
+    }
+
+    std::string expression(int depth)
+    {
+        if (depth == 0 || pick(4) == 0) {
+            return leaf();
+        }
+
+        static const char* kBinary[] = { "+", "-", "*", "/", "^" };
+        static const char* kUnary[] = { "sqrt", "exp", "log", "sin", "cos", "sec", "csc", "tan", "cot", "asin", "acos", "atan",
+            "sinh", "cosh", "tanh", "erf", "erfc", "step", "delta", "square", "cube", "recip", "abs" };
+        static const char* kPowers[] = { "2", "3", "-1", "-2", "5", "0.5", "1.5", "0" };
+
+        switch (pick(6)) {
+        case 0:
+        case 1:
+            return "(" + expression(depth - 1) + kBinary[pick(5)] + expression(depth - 1) + ")";
+        case 2:
+            return std::string(kUnary[pick(23)]) + "(" + expression(depth - 1) + ")";
+        case 3:
+            return std::string(pick(2) == 0 ? "min(" : "max(") + expression(depth - 1) + ", " + expression(depth - 1) + ")";
+        case 4:
+            return "(" + expression(depth - 1) + ")^" + kPowers[pick(8)];
+        default:
+            return "clamp(" + expression(depth - 1) + ", " + leaf() + ", " + expression(depth - 1) + ")";
+        }
+    }
+
+    double value()
+    {
+        static const double kSpecial[] = { 0.0, -0.0, 1.0, -1.0, 0.5, std::numeric_limits<double>::infinity(),
+            std::numeric_limits<double>::quiet_NaN(), 1e300, -1e-300 };
+        if (pick(10) == 0) {
+            return kSpecial[pick(9)];
+        }
+        return std::uniform_real_distribution<double>(-10.0, 10.0)(mRandom);
+    }
+
+private:
+    std::mt19937_64 mRandom;
+
+    int pick(int n)
+    {
+        return static_cast<int>(mRandom() % static_cast<uint64_t>(n));
+    }
+
+    std::string leaf()
+    {
+        static const char* kLeaves[] = { "x", "y", "z", "w", "2", "0.5", "3.25", "-1" };
+        return kLeaves[pick(8)];
+    }
+};
+
+static bool identical(double a, double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0 || (std::isnan(a) && std::isnan(b));
+}
+
+int main()
+{
+    if (!Lepton::CompiledExpression::isNativeCodeSupported()) {
+        std::cout << "native code is not supported on this platform" << std::endl;
+        return 0;
+    }
+
+    Clamp clamp;
+    std::map<std::string, Lepton::CustomFunction*> functions { { "clamp", &clamp } };
+
+    const int expressions = 3000;
+    const int samples = 64;
+    int mismatches = 0;
+    int native = 0;
+    Generator generator(20221019);
+
+    for (int e = 0; e < expressions; ++e) {
+        auto text = generator.expression(5);
+        auto compiled = Lepton::Parser::parse(text, functions).createCompiledExpression();
+        auto interpreter = compiled.createContext();
+        auto jit = compiled.createContext();
+
+        for (int s = 0; s < samples; ++s) {
+            for (int v = 0; v < interpreter.getNumVariables(); ++v) {
+                auto value = generator.value();
+                interpreter.setVariable(v, value);
+                jit.setVariable(v, value);
+            }
+
+            Lepton::CompiledExpression::setUseNativeCode(false);
+            auto expected = interpreter.evaluate();
+            Lepton::CompiledExpression::setUseNativeCode(true);
+            auto result = jit.evaluate();
+
+            if (!identical(expected, result)) {
+                if (++mismatches <= 10) {
+                    std::cout << text << ": expected " << expected << " got " << result << std::endl;
+                }
+                break;
+            }
+        }
+        native += compiled.hasNativeCode() ? 1 : 0;
+    }
+
+    std::cout << expressions << " expressions, " << native << " native, " << mismatches << " mismatches" << std::endl;
+
+    //自定义函数抛出的异常不能穿过本地代码，本地代码中以NaN作为其结果，解释执行时照常抛出
+    Fail fail;
+    std::map<std::string, Lepton::CustomFunction*> failing { { "fail", &fail } };
+    auto throwing = Lepton::Parser::parse("fail(x) + 1", failing).createCompiledExpression();
+    auto throwingContext = throwing.createContext();
+    throwingContext.setVariable(0, 1.0);
+    Lepton::CompiledExpression::setUseNativeCode(true);
+    bool nativeNan = throwing.hasNativeCode() && std::isnan(throwingContext.evaluate());
+    Lepton::CompiledExpression::setUseNativeCode(false);
+    bool interpreterThrows = false;
+    try {
+        throwingContext.evaluate();
+    } catch (const Lepton::Exception&) {
+        interpreterThrows = true;
+    }
+    std::cout << "throwing custom function: native NaN " << nativeNan << ", interpreter throws " << interpreterThrows << std::endl;
+
+    //常用公式的单次计算耗时
+    static const char* kFormulas[] = {
+        "atk * (1 + crit * critDamage) - def * 0.5",
+        "max(0, atk - def) * (1 + 0.01 * level) + sqrt(level)",
+        "lv^2 * 0.5 + lv^3 * 0.01 + lv * 3 + base",
+        "(a + b) * (a - b) / (c + 1) + sin(a) * cos(b)",
+    };
+    const int iterations = 2000000;
+    for (auto text : kFormulas) {
+        auto compiled = Lepton::Parser::parse(text).createCompiledExpression();
+        auto context = compiled.createContext();
+        double times[2];
+        for (int useNative = 0; useNative < 2; ++useNative) {
+            Lepton::CompiledExpression::setUseNativeCode(useNative != 0);
+            auto variables = context.getVariables();
+            double sum = 0.0;
+            auto begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                for (int v = 0; v < context.getNumVariables(); ++v) {
+                    variables[v] = static_cast<double>((i + v) & 1023) * 0.25;
+                }
+                sum += context.evaluate();
+            }
+            times[useNative] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / iterations;
+            if (sum == 0.123) {
+                std::cout << sum;
+            }
+        }
+        std::cout << text << std::endl
+                  << "    interpreter " << times[0] << " ns/eval, native " << times[1] << " ns/eval" << std::endl;
+    }
+
+    bool ok = mismatches == 0 && native == expressions && nativeNan && interpreterThrows;
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
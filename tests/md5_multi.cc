@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "md5/md5.h"
+
+static std::string randomString(std::mt19937& random, size_t size)
+{
+    std::string s(size, '\0');
+    for (auto& c : s) {
+        c = static_cast<char>(random());
+    }
+    return s;
+}
+
+/**
+ * @brief 用指定宽度计算所有消息的摘要，与标量MD5逐个比较
+ */
+static bool checkDigests(const std::vector<std::string>& strings, size_t lanes)
+{
+    std::vector<std::string_view> messages(strings.begin(), strings.end());
+    std::vector<md5::ByteT> digests(16 * messages.size());
+    md5::digestMulti(messages.data(), messages.size(), digests.data(), lanes);
+
+    for (size_t i = 0; i < messages.size(); ++i) {
+        md5::MD5 md5(messages[i]);
+        if (std::memcmp(md5.digest(), digests.data() + 16 * i, 16) != 0) {
+            std::printf("%zu lanes: digest of %zu bytes message differs\n", lanes, messages[i].size());
+            return false;
+        }
+    }
+    return true;
+}
+
+static double hashesPerSecond(const std::vector<std::string_view>& messages, size_t lanes, int rounds)
+{
+    std::vector<md5::ByteT> digests(16 * messages.size());
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        md5::digestMulti(messages.data(), messages.size(), digests.data(), lanes);
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return static_cast<double>(messages.size()) * rounds / seconds;
+}
+
+/**
+ * 校验多缓冲MD5与标量MD5的结果一致，并测量32字节与4KB消息在各宽度下的每秒哈希数
+ */
+int main(int argc, char* argv[])
+{
+    bool ok = true;
+    std::printf("multi-buffer lanes: %zu\n", md5::multiLanes());
+
+    //已知结果
+    md5::MD5 known("The quick brown fox jumps over the lazy dog");
+    ok = known.toString() == "9e107d9d372bb6826bd81d3542a419d6" && ok;
+    char hex[32];
+    md5::digestToHex(known.digest(), hex);
+    ok = std::string(hex, sizeof(hex)) == known.toString() && ok;
+
+    std::mt19937 random(20221019);
+    std::vector<std::string> lengths, mixed;
+    for (size_t size = 0; size <= 300; ++size) {
+        lengths.push_back(randomString(random, size));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        mixed.push_back(randomString(random, random() % 8 == 0 ? random() % 20000 : random() % 100));
+    }
+    for (size_t lanes : { 1, 4, 8 }) {
+        ok = checkDigests(lengths, lanes) && ok;
+        ok = checkDigests(mixed, lanes) && ok;
+        ok = checkDigests({}, lanes) && ok;
+        ok = checkDigests({ "abc" }, lanes) && ok;
+    }
+
+    int rounds = argc > 1 ? std::stoi(argv[1]) : 200;
+    for (size_t size : { 32, 4096 }) {
+        std::vector<std::string> strings;
+        for (int i = 0; i < (size == 32 ? 8192 : 256); ++i) {
+            strings.push_back(randomString(random, size));
+        }
+        std::vector<std::string_view> messages(strings.begin(), strings.end());
+        int n = size == 32 ? rounds : rounds / 2;
+        std::printf("%4zu bytes: scalar %10.0f/s, sse2 %10.0f/s, avx2 %10.0f/s\n", size, hashesPerSecond(messages, 1, n),
+            hashesPerSecond(messages, 4, n), hashesPerSecond(messages, 8, n));
+    }
+
+    std::printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
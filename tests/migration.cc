@@ -0,0 +1,42 @@
+#include <string>
+
+#include "sqlite/sqlite3.hpp"
+#include "storage/migration.hpp"
+#include "test_expect.hpp"
+#include "test_logger.hpp"
+
+static int64_t count(const sqlite::database_manager& database, const char* table)
+{
+    auto stmt = database.query(table, "COUNT(*)", "");
+    return stmt.step() == SQLITE_ROW ? stmt.column_int64(0) : -1;
+}
+
+/**
+ * 校验迁移后的外键检查：0002将GamePlayerItems.itemId改为引用GameItems，
+ * 引用了不存在的物品实例的背包行使迁移回滚，清理后迁移成功
+ */
+int main()
+{
+    sqlite::database_manager database(":memory:", SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY);
+    auto logger = std::make_shared<test::Logger>(0);
+
+    //只应用第一个版本，并写入一个没有对应GameItems的背包行（在版本1中它引用的是BasicItems）
+    auto first = core::migration::begin();
+    bool ok = test::expect(database.exec(std::string(first->sql)) && database.exec("PRAGMA user_version = 1;"), "version 1");
+    ok = test::expect(database.exec("PRAGMA foreign_keys = OFF;"
+                              "INSERT INTO BasicItems(itemBaseId, itemName, itemDescribe, itemCateogory, itemProperties) VALUES (1, 'item', '', 0, '{}');"
+                              "INSERT INTO GamePlayer(playerId, playerName, playerRegdate) VALUES (1, 'player', '2022-01-01 00:00:00');"
+                              "INSERT INTO GameItems(itemId, itemBaseId) VALUES (10, 1);"
+                              "INSERT INTO GamePlayerItems(playerId, itemId, itemAmount, itemLocation) VALUES (1, 10, 1, 0), (1, 1, 1, 0);"),
+             "populate")
+        && ok;
+
+    ok = test::expect(!core::migration::apply(database, logger), "orphan rejected") && ok;
+    ok = test::expect(core::migration::currentVersion(database) == 1 && count(database, "GamePlayerItems") == 2, "rolled back") && ok;
+
+    ok = test::expect(database.exec("DELETE FROM GamePlayerItems WHERE itemId NOT IN (SELECT itemId FROM GameItems);"), "remove orphan") && ok;
+    ok = test::expect(core::migration::apply(database, logger), "migrated") && ok;
+    ok = test::expect(core::migration::currentVersion(database) == core::migration::latestVersion() && count(database, "GamePlayerItems") == 1, "migrated rows") && ok;
+
+    return test::report(ok);
+}
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "player/player_working_set.hpp"
+#include "storage/write_behind_queue.hpp"
+#include "test_expect.hpp"
+#include "test_logger.hpp"
+
+/**
+ * @brief 等待载入线程完成淘汰
+ */
+template <class Predicate>
+static bool waitFor(const core::PlayerWorkingSet& players, Predicate&& predicate)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!predicate(players.statistics())) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+static int64_t amountOf(const sqlite::database_manager& database, int64_t playerId, int64_t itemId)
+{
+    auto stmt = database.query("GamePlayerItems", "itemAmount", "WHERE playerId=? AND itemId=?");
+    stmt.bind(playerId, itemId);
+    return stmt.step() == SQLITE_ROW ? stmt.column_int64(0) : -1;
+}
+
+/**
+ * 校验玩家工作集的请求合并、最近最少使用淘汰、淘汰前写回失败时保留玩家，以及各项统计
+ */
+int main()
+{
+    sqlite::database_manager database(":memory:", SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY | SQLITE_OPEN_FULLMUTEX);
+    bool ok = database.exec("CREATE TABLE GamePlayer(playerId INTEGER PRIMARY KEY, playerName TEXT, playerRegdate TEXT);"
+                            "CREATE TABLE GamePlayerBind(playerId INTEGER, bindObject TEXT, bindTime TEXT);"
+                            "CREATE TABLE GamePlayerItems(playerId INTEGER NOT NULL, itemId INTEGER NOT NULL, itemAmount INTEGER NOT NULL,"
+                            " itemLocation INTEGER NOT NULL, PRIMARY KEY(playerId, itemId));"
+                            "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x+1 FROM c LIMIT 100)"
+                            " INSERT INTO GamePlayer SELECT x, 'player' || x, '2022-10-19' FROM c;"
+                            "INSERT INTO GamePlayerBind SELECT playerId, 'qq', '2022-10-19' FROM GamePlayer;"
+                            "INSERT INTO GamePlayerItems SELECT playerId, 1, 1, 0 FROM GamePlayer;"
+                            //control.fail非零时拒绝写入，用于模拟写回失败
+                            "CREATE TABLE control(fail INTEGER);"
+                            "INSERT INTO control VALUES(0);"
+                            "CREATE TRIGGER failUpdate BEFORE UPDATE ON GamePlayerItems WHEN (SELECT fail FROM control) BEGIN SELECT RAISE(ABORT, 'fail'); END;");
+
+    auto logger = std::make_shared<test::Logger>(0);
+    core::WriteBehindQueue queue(database, logger);
+    ok = test::expect(queue.start(), "queue start") && ok;
+
+    core::PlayerWorkingSet::Options options;
+    options.capacity = 3;
+    options.maxBatchDelay = std::chrono::milliseconds(20);
+    core::PlayerWorkingSet players(database, logger, options);
+    ok = test::expect(players.start(&queue), "start") && ok;
+
+    //请求合并：同一批次内的多个玩家与对同一玩家的并发请求共享一次载入
+    {
+        auto batch = players.acquire(std::vector<int64_t> { 1, 2, 3, 1 });
+        ok = test::expect(batch.size() == 4 && batch[0] && batch[0] == batch[3] && batch[1]->playerName == "player2", "batch acquire") && ok;
+        ok = test::expect(batch[2]->binds.size() == 1 && batch[2]->inventory.size() == 1, "batch contents") && ok;
+        ok = test::expect(players.acquire(101) == nullptr, "missing player") && ok;
+
+        auto statistics = players.statistics();
+        ok = test::expect(statistics.misses == 4 && statistics.coalesced == 1 && statistics.batches == 2 && statistics.loadedPlayers == 3, "coalesced load") && ok;
+    }
+
+    //最近最少使用淘汰：访问1之后载入4，淘汰最久未使用的2
+    {
+        ok = test::expect(players.acquire(1) != nullptr, "touch") && ok;
+        auto player = players.acquire(4);
+        ok = test::expect(player && waitFor(players, [](const core::PlayerWorkingSet::Statistics& s) { return s.evictions == 1; }), "evict") && ok;
+        player.reset();
+
+        auto before = players.statistics();
+        players.acquire(1);
+        players.acquire(3);
+        players.acquire(4);
+        auto after = players.statistics();
+        ok = test::expect(after.hits - before.hits == 3 && after.misses == before.misses && after.size == 3, "lru order") && ok;
+    }
+
+    //淘汰前写回失败时保留玩家与修改，恢复后写回并淘汰
+    {
+        ok = test::expect(players.acquire(3)->inventory.setAmount(1, 30), "modify") && ok;
+        players.acquire(1);
+        players.acquire(4);
+
+        database.exec("UPDATE control SET fail=1");
+        ok = test::expect(players.acquire(5) != nullptr, "acquire 5") && ok;
+        ok = test::expect(waitFor(players, [](const core::PlayerWorkingSet::Statistics& s) { return s.evictionFailures == 1; }), "eviction failure") && ok;
+
+        auto statistics = players.statistics();
+        ok = test::expect(statistics.evictions == 1 && statistics.size == 4, "failed player kept") && ok;
+        auto player = players.acquire(3);
+        ok = test::expect(player && player->inventory.find(1)->itemAmount == 30 && player->inventory.isDirty(), "failed player keeps changes") && ok;
+        ok = test::expect(amountOf(database, 3, 1) == 1, "failed write not committed") && ok;
+        player.reset();
+
+        //再次访问其它玩家使3成为最久未使用，恢复写入后再次淘汰
+        players.acquire(1);
+        players.acquire(4);
+        players.acquire(5);
+        database.exec("UPDATE control SET fail=0");
+        ok = test::expect(players.acquire(6) != nullptr, "acquire 6") && ok;
+        ok = test::expect(waitFor(players, [](const core::PlayerWorkingSet::Statistics& s) { return s.evictions >= 3; }), "eviction retried") && ok;
+        ok = test::expect(amountOf(database, 3, 1) == 30, "evicted player written") && ok;
+
+        //重新载入时读到写回后的数据
+        player = players.acquire(3);
+        ok = test::expect(player && player->inventory.find(1)->itemAmount == 30 && !player->inventory.isDirty(), "reload") && ok;
+    }
+
+    //统计
+    {
+        auto statistics = players.statistics();
+        ok = test::expect(statistics.hitRate() > 0.0 && statistics.hitRate() < 1.0, "hit rate") && ok;
+        ok = test::expect(statistics.maxLoadNanoseconds > 0 && statistics.totalLoadNanoseconds >= statistics.maxLoadNanoseconds, "load time") && ok;
+        uint64_t histogram = 0;
+        for (auto count : statistics.loadHistogram) {
+            histogram += count;
+        }
+        ok = test::expect(histogram == statistics.misses + statistics.coalesced, "load histogram") && ok;
+        ok = test::expect(statistics.loadPercentile(0.5) <= statistics.loadPercentile(1.0), "load percentile") && ok;
+    }
+
+    //停止时写回全部玩家
+    players.acquire(6)->inventory.setAmount(1, 60);
+    players.stop();
+    queue.stop();
+    ok = test::expect(amountOf(database, 6, 1) == 60, "stop writes back") && ok;
+
+    return test::report(ok);
+}
@@ -0,0 +1,208 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "logger/logger.hpp"
+#include "sqlite/sqlite3.hpp"
+#include "storage/migration.hpp"
+#include "test_logger.hpp"
+
+/**
+ * 热点查询，参数以字面量代替，以及查询计划中依次访问的表与使用的索引
+ * 索引写作 表.索引名，主键为 rowid（INTEGER PRIMARY KEY）或 PK（WITHOUT ROWID表的主键）
+ * 计划中不允许出现全量扫描与临时B树，且使用的索引必须与预期一致
+ */
+struct HotQuery {
+    const char* sql;
+    std::vector<std::string> indexes;
+};
+
+static const HotQuery kHotQueries[] = {
+    //背包
+    { "SELECT itemId, itemAmount, itemLocation FROM GamePlayerItems WHERE playerId=1",
+        { "GamePlayerItems.GamePlayerItemsByLocation" } },
+    { "SELECT itemId, itemAmount FROM GamePlayerItems WHERE playerId=1 AND itemLocation=2",
+        { "GamePlayerItems.GamePlayerItemsByLocation" } },
+    { "SELECT playerId, itemId, itemAmount, itemLocation FROM GamePlayerItems WHERE playerId IN (1, 2, 3)",
+        { "GamePlayerItems.GamePlayerItemsByLocation" } },
+    { "SELECT playerId FROM GamePlayerItems WHERE itemId=1",
+        { "GamePlayerItems.GamePlayerItemsByItem" } },
+    { "DELETE FROM GamePlayerItems WHERE playerId=1 AND itemId=1",
+        { "GamePlayerItems.PK" } },
+    { "INSERT INTO GamePlayerItems(playerId, itemId, itemAmount, itemLocation) VALUES (1, 1, 1, 0) "
+      "ON CONFLICT(playerId, itemId) DO UPDATE SET itemAmount=excluded.itemAmount, itemLocation=excluded.itemLocation",
+        {} },
+    //玩家
+    { "SELECT playerId, playerName, playerRegdate FROM GamePlayer WHERE playerId IN (1, 2, 3)",
+        { "GamePlayer.rowid" } },
+    { "SELECT playerId, bindObject, bindTime FROM GamePlayerBind WHERE playerId IN (1, 2, 3)",
+        { "GamePlayerBind.sqlite_autoindex_GamePlayerBind_1" } },
+    //物品
+    { "SELECT itemBaseId, itemName, itemDescribe, itemCateogory, itemProperties FROM BasicItems WHERE itemBaseId=1",
+        { "BasicItems.rowid" } },
+    { "SELECT itemBaseId, itemProperties FROM GameItems WHERE itemId=1",
+        { "GameItems.rowid" } },
+    { "SELECT itemId FROM GameItems WHERE itemBaseId=1",
+        { "GameItems.GameItemsByBase" } },
+    { "SELECT itemId, itemBaseId, itemName, itemCateogory, itemDescribe, itemProperties FROM GameItemsView WHERE itemId=1",
+        { "GameItems.rowid", "BasicItems.rowid" } },
+    { "SELECT itemId, itemBaseId, itemName, itemCateogory, itemDescribe, itemProperties FROM GameItemsView WHERE itemBaseId=1",
+        { "BasicItems.rowid", "GameItems.GameItemsByBase" } },
+    { "SELECT playerId, itemId, itemAmount, itemLocation, itemBaseId, itemCateogory, itemDescribe, itemName, itemProperties "
+      "FROM GamePlayerItemsView WHERE playerId=1",
+        { "GamePlayerItems.GamePlayerItemsByLocation", "GameItems.rowid", "BasicItems.rowid" } },
+    { "SELECT itemId FROM GamePlayerItemsView WHERE playerId=1 AND itemLocation=2",
+        { "GamePlayerItems.GamePlayerItemsByLocation", "GameItems.rowid", "BasicItems.sqlite_autoindex_BasicItems_1" } },
+    //删除，计划中包含外键检查
+    { "DELETE FROM GameItems WHERE itemId=1",
+        { "GameItems.rowid", "GamePlayerItems.GamePlayerItemsByItem" } },
+    { "DELETE FROM BasicItems WHERE itemBaseId=1",
+        { "BasicItems.rowid", "GameItems.GameItemsByBase" } },
+};
+
+static bool populate(const sqlite::database_manager& database, int players, int itemsPerPlayer, int basicItems)
+{
+    std::vector<std::tuple<std::string, std::string, int, std::string>> basic;
+    for (int i = 0; i < basicItems; ++i) {
+        basic.emplace_back("item" + std::to_string(i), "describe", i % 8, "{\"atk\":1}");
+    }
+
+    std::vector<std::tuple<std::string, std::string>> gamePlayers;
+    std::vector<std::tuple<int64_t, std::string, std::string>> binds;
+    for (int i = 1; i <= players; ++i) {
+        gamePlayers.emplace_back("player" + std::to_string(i), "2022-01-01 00:00:00");
+        binds.emplace_back(i, "qq:" + std::to_string(i), "2022-01-01 00:00:00");
+    }
+
+    std::vector<std::tuple<int64_t, int64_t, std::nullptr_t>> items;
+    std::vector<std::tuple<int64_t, int64_t, int64_t, int32_t>> playerItems;
+    int64_t itemId = 0;
+    for (int i = 1; i <= players; ++i) {
+        for (int j = 0; j < itemsPerPlayer; ++j) {
+            ++itemId;
+            items.emplace_back(itemId, 1 + itemId % basicItems, nullptr);
+            playerItems.emplace_back(i, itemId, 1, j % 4);
+        }
+    }
+
+    return database.bulk_insert("INSERT INTO BasicItems(itemName, itemDescribe, itemCateogory, itemProperties)", basic)
+        && database.bulk_insert("INSERT INTO GamePlayer(playerName, playerRegdate)", gamePlayers)
+        && database.bulk_insert("INSERT INTO GamePlayerBind(playerId, bindObject, bindTime)", binds)
+        && database.bulk_insert("INSERT INTO GameItems(itemId, itemBaseId, itemProperties)", items)
+        && database.bulk_insert("INSERT INTO GamePlayerItems(playerId, itemId, itemAmount, itemLocation)", playerItems);
+}
+
+/**
+ * @brief 由查询计划的一行取得 表.索引
+ * @return 若该行不是对表的访问则返回空串
+ */
+static std::string accessOf(const std::string& detail)
+{
+    std::string_view view(detail);
+    for (std::string_view prefix : { "SEARCH ", "SCAN " }) {
+        if (view.substr(0, prefix.size()) == prefix) {
+            view.remove_prefix(prefix.size());
+            auto table = view.substr(0, view.find(' '));
+
+            std::string_view index = "";
+            auto position = view.find(" USING ");
+            if (position != std::string_view::npos) {
+                index = view.substr(position + 7);
+                if (index.substr(0, 19) == "INTEGER PRIMARY KEY") {
+                    index = "rowid";
+                } else if (index.substr(0, 11) == "PRIMARY KEY") {
+                    index = "PK";
+                } else {
+                    index = index.substr(index.find("INDEX ") + 6);
+                    index = index.substr(0, index.find(' '));
+                }
+            }
+            return std::string(table).append(".").append(index);
+        }
+    }
+    return "";
+}
+
+/**
+ * @return 查询计划出现全量扫描、临时B树或使用了非预期索引的查询数
+ */
+static int check(const sqlite::database_manager& database, const char* stage)
+{
+    int regressions = 0;
+    for (auto& query : kHotQueries) {
+        std::string plan;
+        std::vector<std::string> indexes;
+        bool scan = false;
+        bool temp = false;
+
+        auto transaction = database.begin_transaction();
+        auto explain = transaction.prepare(std::string("EXPLAIN QUERY PLAN ").append(query.sql));
+        int rc;
+        while ((rc = explain.step()) == SQLITE_ROW) {
+            auto detail = explain.column<std::string>(3);
+            //SCAN表示逐行遍历整张表或整个索引（包括覆盖索引）；SEARCH表示按索引定位
+            scan = scan || detail.rfind("SCAN", 0) == 0;
+            //USE TEMP B-TREE表示排序或去重没有可用的索引
+            temp = temp || detail.find("TEMP B-TREE") != std::string::npos;
+            auto access = accessOf(detail);
+            if (!access.empty()) {
+                indexes.push_back(std::move(access));
+            }
+            plan.append("    ").append(detail).append("\n");
+        }
+
+        if (rc != SQLITE_DONE) {
+            std::cout << "[" << stage << "] FAILED to explain: " << query.sql << std::endl;
+            ++regressions;
+        } else if (scan) {
+            std::cout << "[" << stage << "] FULL SCAN: " << query.sql << "\n" << plan;
+            ++regressions;
+        } else if (temp) {
+            std::cout << "[" << stage << "] TEMP B-TREE: " << query.sql << "\n" << plan;
+            ++regressions;
+        } else if (indexes != query.indexes) {
+            std::cout << "[" << stage << "] UNEXPECTED INDEX: " << query.sql << "\n" << plan << "    expected:";
+            for (auto& index : query.indexes) {
+                std::cout << " " << index;
+            }
+            std::cout << std::endl;
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[])
+{
+    int players = argc > 1 ? std::stoi(argv[1]) : 20000;
+    int itemsPerPlayer = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    auto path = std::filesystem::temp_directory_path() / "kgame_query_plan.db";
+    std::filesystem::remove(path);
+
+    sqlite::database_manager database(path.u8string(), SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    auto logger = std::make_shared<test::Logger>(test::Logger::Info | test::Logger::Warn | test::Logger::Error);
+    if (!core::migration::apply(database, logger) || !database.exec("PRAGMA foreign_keys = ON;")) {
+        std::cout << "failed to migrate" << std::endl;
+        return 1;
+    }
+
+    if (!populate(database, players, itemsPerPlayer, 1000)) {
+        std::cout << "failed to populate" << std::endl;
+        return 1;
+    }
+
+    //未收集统计信息时（游戏数据库的默认状态）与ANALYZE之后的计划都需要检查
+    auto regressions = check(database, "no stats");
+    database.exec("ANALYZE;");
+    regressions += check(database, "analyzed");
+
+    database.close();
+    std::filesystem::remove(path);
+
+    std::cout << (regressions == 0 ? "all query plans use indexes" : std::to_string(regressions) + " query plans regressed") << std::endl;
+    return regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sqlite/sqlite3.hpp"
+#include "storage/query_profiler.hpp"
+#include "test_expect.hpp"
+
+//记录慢查询日志
+class Logger : public core::LoggerBase {
+public:
+    std::vector<std::string> warnings() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mWarnings;
+    }
+
+private:
+    mutable std::mutex mMutex;
+    mutable std::vector<std::string> mWarnings;
+
+    virtual void info(const std::string&) const override { }
+    virtual void debug(const std::string&) const override { }
+    virtual void warn(const std::string& message) const override
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWarnings.push_back(message);
+    }
+    virtual void error(const std::string& message) const override { std::cout << message << '\n'; }
+};
+
+static bool checkNormalize(std::string_view sql, std::string_view expected)
+{
+    auto normalized = core::QueryProfiler::normalize(sql);
+    return test::expect(normalized == expected, "normalize \"" + std::string(sql) + "\" -> \"" + normalized + "\"");
+}
+
+static const core::QueryProfiler::Statistics* find(const std::vector<core::QueryProfiler::Statistics>& statistics, std::string_view sql)
+{
+    for (auto& element : statistics) {
+        if (element.sql == sql) {
+            return &element;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * 校验SQL归一化、经由sqlite3_trace_v2的统计聚合、慢查询日志与查询计划，以及取消注册
+ */
+int main()
+{
+    bool ok = true;
+
+    ok = checkNormalize("SELECT  *\n FROM t WHERE id = 12;", "SELECT * FROM t WHERE id = ?") && ok;
+    ok = checkNormalize("SELECT * FROM t WHERE name='it''s' AND w=1.5e3", "SELECT * FROM t WHERE name=? AND w=?") && ok;
+    ok = checkNormalize("SELECT * FROM t2 WHERE a=@a AND b=:b AND c=$c AND d=?3", "SELECT * FROM t2 WHERE a=? AND b=? AND c=? AND d=?") && ok;
+    ok = checkNormalize("SELECT * FROM t WHERE id IN (1, 2, 3, 4)", "SELECT * FROM t WHERE id IN (?)") && ok;
+    ok = checkNormalize("INSERT INTO t(a) VALUES (?), (?), (?)", "INSERT INTO t(a) VALUES (?)") && ok;
+    ok = checkNormalize("SELECT col1 FROM table2", "SELECT col1 FROM table2") && ok;
+
+    auto path = std::filesystem::temp_directory_path() / "kgame_query_profiler.db";
+    std::filesystem::remove(path);
+    sqlite::database_manager database(path.u8string(), SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE);
+    ok = database.exec("CREATE TABLE item(id INTEGER PRIMARY KEY, name TEXT, amount INT)") && ok;
+
+    auto logger = std::make_shared<Logger>();
+    core::QueryProfiler::Options options;
+    options.normalizedCacheSize = 8;
+    core::QueryProfiler profiler(logger, options);
+    ok = test::expect(profiler.attach(database), "attach") && ok;
+
+    //字面量不同的语句聚合为同一种，超过缓存上限也不影响聚合
+    for (int i = 0; i < 100; ++i) {
+        database.exec("INSERT INTO item(name, amount) VALUES('item" + std::to_string(i) + "', " + std::to_string(i) + ")");
+    }
+    for (int i = 0; i < 50; ++i) {
+        database.single_step("UPDATE item SET amount=amount+1 WHERE id=?", i);
+    }
+
+    auto statistics = profiler.snapshot();
+    auto inserts = find(statistics, "INSERT INTO item(name, amount) VALUES(?)");
+    auto updates = find(statistics, "UPDATE item SET amount=amount+? WHERE id=?");
+    ok = test::expect(inserts && inserts->calls == 100, "insert calls") && ok;
+    ok = test::expect(updates && updates->calls == 50, "update calls") && ok;
+    if (inserts) {
+        uint64_t histogram = 0;
+        for (auto count : inserts->histogram) {
+            histogram += count;
+        }
+        ok = test::expect(histogram == inserts->calls && inserts->totalNanoseconds >= inserts->maxNanoseconds && inserts->maxNanoseconds > 0,
+                 "histogram and latency")
+            && ok;
+    }
+    for (size_t i = 1; i < statistics.size(); ++i) {
+        ok = test::expect(statistics[i - 1].totalNanoseconds >= statistics[i].totalNanoseconds, "snapshot order") && ok;
+    }
+    ok = test::expect(logger->warnings().empty(), "no slow queries") && ok;
+    ok = test::expect(profiler.dump(1).find("calls") != std::string::npos, "dump") && ok;
+
+    //阈值为0时每条语句都是慢查询，每种语句只在第一次附带查询计划
+    profiler.reset();
+    profiler.setSlowThreshold(std::chrono::microseconds(0));
+    for (int i = 0; i < 3; ++i) {
+        auto stmt = database.query("item", "name", "WHERE id=" + std::to_string(i + 1));
+        stmt.step();
+    }
+    auto warnings = logger->warnings();
+    ok = test::expect(warnings.size() == 3, "slow query log") && ok;
+    ok = test::expect(warnings.size() == 3 && warnings[0].find("SEARCH item") != std::string::npos, "query plan logged") && ok;
+    ok = test::expect(warnings.size() == 3 && warnings[1].find("SEARCH") == std::string::npos, "query plan logged once") && ok;
+    statistics = profiler.snapshot();
+    ok = test::expect(statistics.size() == 1 && statistics[0].calls == 3 && statistics[0].slowCalls == 3, "slow calls") && ok;
+
+    //取消注册后不再统计
+    profiler.detach();
+    database.exec("DELETE FROM item");
+    statistics = profiler.snapshot();
+    ok = test::expect(statistics.size() == 1 && statistics[0].calls == 3, "detach") && ok;
+
+    database.close();
+    std::filesystem::remove(path);
+
+    return test::report(ok);
+}
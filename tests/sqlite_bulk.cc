@@ -0,0 +1,96 @@
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "sqlite/sqlite3.hpp"
+#include "test_expect.hpp"
+
+static int64_t count(const sqlite::database_manager& database)
+{
+    auto stmt = database.query("user", "COUNT(*)");
+    return stmt.step() == SQLITE_ROW ? stmt.column_int64(0) : -1;
+}
+
+static std::vector<int64_t> rowids(const sqlite::database_manager& database)
+{
+    std::vector<int64_t> result;
+    auto stmt = database.query("user", "rowid", "ORDER BY rowid");
+    for (auto [rowid] : stmt.rows<std::tuple<int64_t>>()) {
+        result.push_back(rowid);
+    }
+    return result;
+}
+
+/**
+ * 校验bulk_step与bulk_insert写入的行数、返回的rowid、upsert，以及失败时整批回滚
+ */
+int main()
+{
+    sqlite::database_manager database(":memory:", SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY);
+    bool ok = database.exec("CREATE TABLE user(id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE, height DOUBLE)");
+
+    std::vector<std::tuple<std::string, double>> people;
+    for (int i = 0; i < 100; ++i) {
+        people.emplace_back("step" + std::to_string(i), 1.5 + i / 100.0);
+    }
+
+    //bulk_step：逐行执行，rowid按行顺序返回
+    std::vector<int64_t> ids;
+    ok = test::expect(database.bulk_step("INSERT INTO user(name, height) VALUES(?, ?)", people, &ids), "bulk_step") && ok;
+    ok = test::expect(count(database) == 100, "bulk_step row count") && ok;
+    ok = test::expect(ids == rowids(database), "bulk_step rowids") && ok;
+
+    //bulk_insert：按每块7行拆分，包含完整分块与剩余分块
+    std::vector<std::tuple<std::string, std::nullptr_t>> inserted;
+    for (int i = 0; i < 50; ++i) {
+        inserted.emplace_back("insert" + std::to_string(i), nullptr);
+    }
+    ids.clear();
+    ok = test::expect(database.bulk_insert("INSERT INTO user(name, height)", inserted, &ids, "", 7), "bulk_insert") && ok;
+    ok = test::expect(count(database) == 150, "bulk_insert row count") && ok;
+    auto all = rowids(database);
+    ok = test::expect(ids == std::vector<int64_t>(all.end() - 50, all.end()), "bulk_insert rowids") && ok;
+    {
+        auto stmt = database.query("user", "COUNT(*)", "WHERE height IS NULL");
+        ok = test::expect(stmt.step() == SQLITE_ROW && stmt.column_int64(0) == 50, "bulk_insert binds nullptr as NULL") && ok;
+    }
+
+    //upsert：已存在的name更新height
+    std::vector<std::tuple<std::string, double>> updates { { "step0", 2.5 }, { "insert0", 2.5 }, { "new", 2.5 } };
+    ok = test::expect(database.bulk_insert("INSERT INTO user(name, height)", updates, nullptr, "ON CONFLICT(name) DO UPDATE SET height=excluded.height"),
+             "bulk_insert upsert")
+        && ok;
+    ok = test::expect(count(database) == 151, "upsert row count") && ok;
+    {
+        auto stmt = database.query("user", "COUNT(*)", "WHERE height=2.5");
+        ok = test::expect(stmt.step() == SQLITE_ROW && stmt.column_int64(0) == 3, "upsert updated rows") && ok;
+    }
+
+    //最后一行违反UNIQUE约束，整批回滚
+    std::vector<std::tuple<std::string, double>> conflicting { { "a", 1 }, { "b", 1 }, { "step1", 1 } };
+    ids.clear();
+    ok = test::expect(!database.bulk_step("INSERT INTO user(name, height) VALUES(?, ?)", conflicting, &ids), "bulk_step fails") && ok;
+    ok = test::expect(count(database) == 151, "bulk_step rolled back") && ok;
+    ok = test::expect(!database.bulk_insert("INSERT INTO user(name, height)", conflicting, nullptr, "", 2), "bulk_insert fails") && ok;
+    ok = test::expect(count(database) == 151, "bulk_insert rolled back") && ok;
+
+    //语法错误的语句不执行任何行
+    ok = test::expect(!database.bulk_step("INSERT INTO missing(name) VALUES(?)", std::vector<std::tuple<int>> { { 1 } }), "bad sql fails") && ok;
+
+    //事务内失败时由调用者决定是否回滚，此前成功的分块仍在事务中
+    {
+        auto transaction = database.begin_transaction();
+        ok = test::expect(!transaction.bulk_insert("INSERT INTO user(name, height)", conflicting, nullptr, "", 2), "transaction bulk_insert fails") && ok;
+        auto stmt = transaction.prepare("SELECT COUNT(*) FROM user");
+        ok = test::expect(stmt.step() == SQLITE_ROW && stmt.column_int64(0) == 153, "transaction keeps earlier chunks") && ok;
+        stmt.finalize();
+        transaction.rollback();
+    }
+    ok = test::expect(count(database) == 151, "transaction rolled back by caller") && ok;
+
+    //空集合
+    ok = test::expect(database.bulk_insert("INSERT INTO user(name, height)", std::vector<std::tuple<std::string, double>>()), "empty bulk_insert") && ok;
+    ok = test::expect(count(database) == 151, "empty bulk_insert row count") && ok;
+
+    return test::report(ok);
+}
@@ -0,0 +1,92 @@
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "sqlite/sqlite3.hpp"
+#include "test_expect.hpp"
+
+struct Item {
+    int64_t id;
+    std::string name;
+    std::optional<int32_t> amount;
+    std::optional<double> weight;
+};
+
+/**
+ * 校验stmt_manager的NULL处理、零拷贝视图、按类型取列，以及按tuple和编译期列映射逐行解码
+ */
+int main()
+{
+    sqlite::database_manager database(":memory:", SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY);
+    bool ok = database.exec("CREATE TABLE item(id INTEGER PRIMARY KEY, name TEXT, amount INT, weight DOUBLE, data BLOB);"
+                            "INSERT INTO item VALUES(1, 'sword', 3, 1.5, x'00ff10');"
+                            "INSERT INTO item VALUES(2, NULL, NULL, NULL, NULL);"
+                            "INSERT INTO item VALUES(3, 'a' || char(0) || 'b', 0, 0.25, x'');");
+
+    //NULL列
+    {
+        auto stmt = database.query("item", "name, amount, weight, data", "WHERE id=2");
+        ok = test::expect(stmt.step() == SQLITE_ROW, "step") && ok;
+        ok = test::expect(stmt.column_is_null(0) && stmt.column_type(1) == SQLITE_NULL, "column_is_null") && ok;
+        ok = test::expect(stmt.column_text(0).empty() && stmt.column_text_view(0).empty(), "NULL text is empty") && ok;
+        ok = test::expect(stmt.column_blob(3).empty(), "NULL blob is empty") && ok;
+        ok = test::expect(!stmt.column<std::optional<int32_t>>(1) && !stmt.column<std::optional<std::string>>(0), "NULL optional") && ok;
+        ok = test::expect(stmt.column<int32_t>(1) == 0, "NULL integer") && ok;
+    }
+
+    //文本保留内嵌的NUL，二进制按长度返回
+    {
+        auto stmt = database.query("item", "name, data", "WHERE id=3");
+        ok = test::expect(stmt.step() == SQLITE_ROW, "step") && ok;
+        ok = test::expect(stmt.column_text(0) == std::string("a\0b", 3) && stmt.column_text_view(0).size() == 3, "embedded NUL") && ok;
+        ok = test::expect(stmt.column_type(1) == SQLITE_BLOB && stmt.column_blob(1).empty(), "empty blob") && ok;
+    }
+    {
+        auto stmt = database.query("item", "data, amount, weight", "WHERE id=1");
+        ok = test::expect(stmt.step() == SQLITE_ROW, "step") && ok;
+        auto blob = stmt.column<sqlite::blob_view>(0);
+        ok = test::expect(std::vector<uint8_t>(blob.begin(), blob.end()) == std::vector<uint8_t> { 0x00, 0xff, 0x10 }, "blob") && ok;
+        ok = test::expect(stmt.column<std::optional<int32_t>>(1) == 3 && stmt.column<bool>(1), "optional integer") && ok;
+        ok = test::expect(stmt.column<float>(2) == 1.5f, "floating point") && ok;
+        ok = test::expect(stmt.read<std::tuple<std::string_view, int, double>>() == std::make_tuple(std::string_view("\x00\xff\x10", 3), 3, 1.5),
+                 "read tuple")
+            && ok;
+    }
+
+    //按tuple逐行解码
+    {
+        std::vector<int64_t> ids;
+        std::vector<std::string> names;
+        auto stmt = database.query("item", "id, name", "ORDER BY id");
+        for (auto [id, name] : stmt.rows<std::tuple<int64_t, std::string_view>>()) {
+            ids.push_back(id);
+            names.emplace_back(name);
+        }
+        ok = test::expect(ids == std::vector<int64_t> { 1, 2, 3 }, "tuple rows") && ok;
+        ok = test::expect(names == std::vector<std::string> { "sword", "", std::string("a\0b", 3) }, "tuple row names") && ok;
+    }
+
+    //按编译期列映射解码为结构体
+    {
+        std::vector<Item> items;
+        auto stmt = database.query("item", "id, name, amount, weight", "ORDER BY id");
+        for (const auto& item : stmt.rows(sqlite::columns<&Item::id, &Item::name, &Item::amount, &Item::weight> {})) {
+            items.push_back(item);
+        }
+        ok = test::expect(items.size() == 3, "struct rows") && ok;
+        ok = test::expect(items.size() == 3 && items[0].name == "sword" && items[0].amount == 3 && items[0].weight == 1.5, "struct row 1") && ok;
+        ok = test::expect(items.size() == 3 && items[1].name.empty() && !items[1].amount && !items[1].weight, "struct row 2") && ok;
+        ok = test::expect(items.size() == 3 && items[2].amount == 0 && items[2].weight == 0.25, "struct row 3") && ok;
+    }
+
+    //结果集为空
+    {
+        auto stmt = database.query("item", "id", "WHERE id > 100");
+        auto rows = stmt.rows<std::tuple<int64_t>>();
+        ok = test::expect(rows.begin() == rows.end(), "empty rows") && ok;
+    }
+
+    return test::report(ok);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+namespace test {
+
+/**
+ * @brief 测试程序共用的断言，失败时输出名称，返回condition以便以 ok = expect(...) && ok 累积结果
+ */
+inline bool expect(bool condition, const std::string& name)
+{
+    if (!condition) {
+        std::cout << "FAILED: " << name << std::endl;
+    }
+    return condition;
+}
+
+/**
+ * @brief 输出测试结果并返回main的返回值
+ */
+inline int report(bool ok)
+{
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+}
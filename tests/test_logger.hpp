@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cinttypes>
+#include <iostream>
+#include <string>
+
+#include "logger/logger.hpp"
+
+namespace test {
+
+/**
+ * @brief 测试与基准程序共用的日志，只把指定级别的日志输出到标准输出
+ */
+class Logger : public core::LoggerBase {
+public:
+    enum Output : uint32_t {
+        Info = 1 << 0,
+        Warn = 1 << 1,
+        Error = 1 << 2,
+    };
+
+    explicit Logger(uint32_t outputs = Warn | Error)
+        : mOutputs(outputs)
+    {
+    }
+
+private:
+    uint32_t mOutputs;
+
+    void print(Output output, const std::string& message) const
+    {
+        if (mOutputs & output) {
+            std::cout << message << '\n';
+        }
+    }
+
+    virtual void info(const std::string& message) const override { print(Info, message); }
+    virtual void debug(const std::string&) const override { }
+    virtual void warn(const std::string& message) const override { print(Warn, message); }
+    virtual void error(const std::string& message) const override { print(Error, message); }
+};
+
+}
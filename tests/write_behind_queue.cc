@@ -0,0 +1,176 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "storage/write_behind_queue.hpp"
+#include "test_expect.hpp"
+#include "test_logger.hpp"
+
+static std::vector<int64_t> values(const sqlite::database_manager& database, const char* table)
+{
+    std::vector<int64_t> result;
+    auto stmt = database.query(table, "value", "ORDER BY rowid");
+    for (auto [value] : stmt.rows<std::tuple<int64_t>>()) {
+        result.push_back(value);
+    }
+    return result;
+}
+
+/**
+ * @brief 按写线程中的执行顺序记录变更与完成回调，以此划分批次
+ * 同一批次的变更全部执行之后才调用各自的完成回调
+ */
+struct BatchRecorder {
+    //正数为变更，负数为完成回调
+    std::vector<int> events;
+
+    std::vector<size_t> batchSizes() const
+    {
+        std::vector<size_t> sizes;
+        bool inMutations = false;
+        for (auto event : events) {
+            if (event > 0) {
+                if (!inMutations) {
+                    sizes.push_back(0);
+                }
+                ++sizes.back();
+            }
+            inMutations = event > 0;
+        }
+        return sizes;
+    }
+};
+
+/**
+ * 校验延迟写入队列的先进先出顺序、队列满时阻塞、按数量与时间划分批次，
+ * 以及单个变更失败时只回滚该变更而同批次的其它变更照常提交
+ */
+int main()
+{
+    sqlite::database_manager database(":memory:", SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY | SQLITE_OPEN_FULLMUTEX);
+    bool ok = database.exec("PRAGMA foreign_keys = ON;"
+                            "CREATE TABLE log(value INTEGER NOT NULL);"
+                            "CREATE TABLE parent(id INTEGER PRIMARY KEY);"
+                            "CREATE TABLE child(value INTEGER NOT NULL, parentId INTEGER NOT NULL REFERENCES parent(id));"
+                            "INSERT INTO parent VALUES(1);");
+    auto logger = std::make_shared<test::Logger>(0);
+
+    //先进先出
+    {
+        core::WriteBehindQueue queue(database, logger);
+        ok = test::expect(queue.start(), "start") && ok;
+        std::vector<int64_t> expected;
+        for (int64_t i = 0; i < 1000; ++i) {
+            queue.enqueue([i](sqlite::transaction_manager& transaction) {
+                return transaction.single_step("INSERT INTO log(value) VALUES(?)", i);
+            });
+            expected.push_back(i);
+        }
+        queue.flush();
+        ok = test::expect(values(database, "log") == expected, "fifo order") && ok;
+        queue.stop();
+        ok = test::expect(!queue.enqueue([](sqlite::transaction_manager&) { return true; }), "stopped queue rejects") && ok;
+        database.exec("DELETE FROM log");
+    }
+
+    //队列满时enqueue阻塞，tryEnqueue立即返回false
+    {
+        core::WriteBehindQueue::Options options;
+        options.capacity = 2;
+        options.maxBatchSize = 1;
+        options.maxBatchDelay = std::chrono::milliseconds(0);
+        core::WriteBehindQueue queue(database, logger, options);
+        ok = test::expect(queue.start(), "start") && ok;
+
+        std::promise<void> started, release;
+        auto gate = release.get_future().share();
+        queue.enqueue([&started, gate](sqlite::transaction_manager&) {
+            started.set_value();
+            gate.wait();
+            return true;
+        });
+        started.get_future().wait();
+
+        auto noop = [](sqlite::transaction_manager&) { return true; };
+        ok = test::expect(queue.enqueue(noop) && queue.enqueue(noop) && queue.pending() == 2, "fill") && ok;
+        ok = test::expect(!queue.tryEnqueue(noop), "try enqueue when full") && ok;
+
+        std::atomic<bool> enqueued { false };
+        std::thread producer([&queue, &enqueued, noop] {
+            queue.enqueue(noop);
+            enqueued = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ok = test::expect(!enqueued, "enqueue blocks when full") && ok;
+
+        release.set_value();
+        producer.join();
+        queue.flush();
+        ok = test::expect(enqueued && queue.pending() == 0, "enqueue resumes") && ok;
+    }
+
+    //按数量与时间划分批次
+    {
+        core::WriteBehindQueue::Options options;
+        options.maxBatchSize = 4;
+        options.maxBatchDelay = std::chrono::milliseconds(50);
+        core::WriteBehindQueue queue(database, logger, options);
+        ok = test::expect(queue.start(), "start") && ok;
+
+        //超过单批数量的变更分为多个批次，凑满一批后不等待
+        BatchRecorder recorder;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 1; i <= 8; ++i) {
+            queue.enqueue([&recorder, i](sqlite::transaction_manager&) {
+                recorder.events.push_back(i);
+                return true;
+            },
+                [&recorder, i](bool) { recorder.events.push_back(-i); });
+        }
+        queue.flush();
+        ok = test::expect(recorder.batchSizes() == std::vector<size_t> { 4, 4 }, "size limit") && ok;
+        ok = test::expect(std::chrono::steady_clock::now() - begin < options.maxBatchDelay, "full batch does not wait") && ok;
+
+        //不足一批时等待最长等待时间后提交
+        std::promise<bool> committed;
+        begin = std::chrono::steady_clock::now();
+        queue.enqueue([](sqlite::transaction_manager&) { return true; }, [&committed](bool success) { committed.set_value(success); });
+        auto result = committed.get_future();
+        ok = test::expect(result.wait_for(std::chrono::seconds(5)) == std::future_status::ready && result.get(), "time limit") && ok;
+        ok = test::expect(std::chrono::steady_clock::now() - begin >= options.maxBatchDelay, "partial batch waits") && ok;
+    }
+
+    //失败的变更只回滚自身，包括它在失败前已执行的部分
+    {
+        core::WriteBehindQueue::Options options;
+        options.maxBatchDelay = std::chrono::seconds(10);
+        core::WriteBehindQueue queue(database, logger, options);
+        ok = test::expect(queue.start(), "start") && ok;
+
+        std::vector<int> results;
+        auto record = [&results](bool success) { results.push_back(success ? 1 : 0); };
+        queue.enqueue([](sqlite::transaction_manager& transaction) {
+            return transaction.single_step("INSERT INTO child(value, parentId) VALUES(1, 1)");
+        },
+            record);
+        queue.enqueue([](sqlite::transaction_manager& transaction) {
+            //第二条违反外键约束
+            return transaction.single_step("INSERT INTO child(value, parentId) VALUES(2, 1)")
+                && transaction.single_step("INSERT INTO child(value, parentId) VALUES(3, 2)");
+        },
+            record);
+        queue.enqueue([](sqlite::transaction_manager& transaction) {
+            return transaction.single_step("INSERT INTO child(value, parentId) VALUES(4, 1)");
+        },
+            record);
+        queue.flush();
+
+        ok = test::expect(results == std::vector<int> { 1, 0, 1 }, "completion results") && ok;
+        ok = test::expect(values(database, "child") == std::vector<int64_t> { 1, 4 }, "failed mutation rolled back alone") && ok;
+    }
+
+    return test::report(ok);
+}
@@ -7,4 +7,5 @@
 #include "cppcrc/code_crcdnp.hh"
 #include "cppcrc/code_crckrmit.hh"
 #include "cppcrc/code_crcsick.hh"
-#include "cppcrc/encoder.hh"
\ No newline at end of file
+#include "cppcrc/encoder.hh"
+#include "cppcrc/static_encoder.hh"
\ No newline at end of file
@@ -0,0 +1,220 @@
+#pragma once
+
+/**
+ * @file algorithms.hh
+ * @brief Compile-time descriptions of the supported crc algorithms.
+ *
+ * Every algorithm provides
+ *   - Value: the register type
+ *   - start(): the initial register value
+ *   - update(value, c, pre): feed one byte, pre is the byte before c
+ *   - update(value, data, size, pre): feed size bytes
+ *   - result(value): the final checksum
+ * all of them constexpr. Lookup tables are generated at compile time.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace crc {
+
+namespace detail {
+
+template <class T> using SliceTables = std::array<std::array<T, 256>, 8>;
+
+/**
+ * @brief Tables for a crc processed least significant bit first.
+ * tables[0] is the byte-wise table, tables[k][i] is the crc of byte i
+ * followed by k zero bytes, so 8 bytes can be processed per step.
+ */
+template <class T, T Poly> constexpr SliceTables<T> makeReflectedTables() {
+  SliceTables<T> tables{};
+  for (uint32_t i = 0; i < 256; i++) {
+    T crc = static_cast<T>(i);
+    for (uint32_t j = 0; j < 8; j++) {
+      crc = (crc & 1) ? static_cast<T>((crc >> 1) ^ Poly)
+                      : static_cast<T>(crc >> 1);
+    }
+    tables[0][i] = crc;
+  }
+  for (size_t k = 1; k < 8; k++) {
+    for (size_t i = 0; i < 256; i++) {
+      auto previous = tables[k - 1][i];
+      tables[k][i] = static_cast<T>((sizeof(T) > 1 ? previous >> 8 : 0) ^
+                                    tables[0][previous & 0xFF]);
+    }
+  }
+  return tables;
+}
+
+/**
+ * @brief Tables for a crc processed most significant bit first.
+ */
+template <class T, T Poly> constexpr SliceTables<T> makeForwardTables() {
+  constexpr unsigned kTop = sizeof(T) * 8 - 8;
+  constexpr T kHighBit = static_cast<T>(T(1) << (sizeof(T) * 8 - 1));
+
+  SliceTables<T> tables{};
+  for (uint32_t i = 0; i < 256; i++) {
+    T crc = static_cast<T>(static_cast<T>(i) << kTop);
+    for (uint32_t j = 0; j < 8; j++) {
+      crc = (crc & kHighBit) ? static_cast<T>((crc << 1) ^ Poly)
+                             : static_cast<T>(crc << 1);
+    }
+    tables[0][i] = crc;
+  }
+  for (size_t k = 1; k < 8; k++) {
+    for (size_t i = 0; i < 256; i++) {
+      auto previous = tables[k - 1][i];
+      tables[k][i] = static_cast<T>((sizeof(T) > 1 ? previous << 8 : 0) ^
+                                    tables[0][(previous >> kTop) & 0xFF]);
+    }
+  }
+  return tables;
+}
+
+} // namespace detail
+
+/**
+ * @brief Table driven crc shifting towards the least significant bit.
+ */
+template <class T, T Poly, T Init = 0, T XorOut = 0> struct ReflectedCrc {
+  using Value = T;
+
+  static constexpr detail::SliceTables<T> kTables =
+      detail::makeReflectedTables<T, Poly>();
+
+  static constexpr Value start() noexcept { return Init; }
+
+  static constexpr Value update(Value value, uint8_t c, uint8_t) noexcept {
+    return static_cast<Value>((sizeof(T) > 1 ? value >> 8 : 0) ^
+                              kTables[0][(value ^ c) & 0xFF]);
+  }
+
+  template <class Byte>
+  static constexpr Value update(Value value, const Byte *data, size_t size,
+                                uint8_t) noexcept {
+    for (; size >= 8; data += 8, size -= 8) {
+      Value next = 0;
+      for (size_t j = 0; j < 8; j++) {
+        uint8_t index = static_cast<uint8_t>(data[j]);
+        if (j < sizeof(T)) {
+          index ^= static_cast<uint8_t>(value >> (8 * j));
+        }
+        next ^= kTables[7 - j][index];
+      }
+      value = next;
+    }
+    for (; size > 0; ++data, --size) {
+      value = update(value, static_cast<uint8_t>(*data), 0);
+    }
+    return value;
+  }
+
+  static constexpr uint64_t result(Value value) noexcept {
+    return static_cast<Value>(value ^ XorOut);
+  }
+};
+
+/**
+ * @brief Table driven crc shifting towards the most significant bit.
+ */
+template <class T, T Poly, T Init = 0, T XorOut = 0> struct ForwardCrc {
+  using Value = T;
+
+  static constexpr unsigned kTop = sizeof(T) * 8 - 8;
+  static constexpr detail::SliceTables<T> kTables =
+      detail::makeForwardTables<T, Poly>();
+
+  static constexpr Value start() noexcept { return Init; }
+
+  static constexpr Value update(Value value, uint8_t c, uint8_t) noexcept {
+    return static_cast<Value>((sizeof(T) > 1 ? value << 8 : 0) ^
+                              kTables[0][((value >> kTop) ^ c) & 0xFF]);
+  }
+
+  template <class Byte>
+  static constexpr Value update(Value value, const Byte *data, size_t size,
+                                uint8_t) noexcept {
+    for (; size >= 8; data += 8, size -= 8) {
+      Value next = 0;
+      for (size_t j = 0; j < 8; j++) {
+        uint8_t index = static_cast<uint8_t>(data[j]);
+        if (j < sizeof(T)) {
+          index ^= static_cast<uint8_t>(value >> (kTop - 8 * j));
+        }
+        next ^= kTables[7 - j][index];
+      }
+      value = next;
+    }
+    for (; size > 0; ++data, --size) {
+      value = update(value, static_cast<uint8_t>(*data), 0);
+    }
+    return value;
+  }
+
+  static constexpr uint64_t result(Value value) noexcept {
+    return static_cast<Value>(value ^ XorOut);
+  }
+};
+
+// Sensirion SHT75 crc8.
+using Crc8 = ForwardCrc<uint8_t, 0x31>;
+
+using Crc16 = ReflectedCrc<uint16_t, 0xA001>;
+
+using Crc32 = ReflectedCrc<uint32_t, 0xEDB88320ul, 0xFFFFFFFFul, 0xFFFFFFFFul>;
+
+using Crc64Ecma = ForwardCrc<uint64_t, 0x42F0E1EBA9EA3693ull>;
+
+using Crc64We = ForwardCrc<uint64_t, 0x42F0E1EBA9EA3693ull,
+                           0xFFFFFFFFFFFFFFFFull, 0xFFFFFFFFFFFFFFFFull>;
+
+struct CrcKrmit : ReflectedCrc<uint16_t, 0x8408> {
+  static constexpr uint64_t result(Value value) noexcept {
+    return static_cast<uint16_t>((value >> 8) | (value << 8));
+  }
+};
+
+struct CrcDnp : ReflectedCrc<uint16_t, 0xA6BC> {
+  static constexpr uint64_t result(Value value) noexcept {
+    value = static_cast<Value>(~value);
+    return static_cast<uint16_t>((value >> 8) | (value << 8));
+  }
+};
+
+/**
+ * @brief SICK sensor crc, which mixes in the previous byte and has no table.
+ */
+struct CrcSick {
+  using Value = uint16_t;
+
+  static constexpr uint16_t kPoly = 0x8005;
+
+  static constexpr Value start() noexcept { return 0; }
+
+  static constexpr Value update(Value value, uint8_t c, uint8_t pre) noexcept {
+    // Branchless form of (value & 0x8000) ? (value << 1) ^ kPoly : value << 1
+    auto carry = static_cast<Value>(0 - (value >> 15));
+    value = static_cast<Value>((value << 1) ^ (carry & kPoly));
+    return static_cast<Value>(value ^ (c | (pre << 8)));
+  }
+
+  template <class Byte>
+  static constexpr Value update(Value value, const Byte *data, size_t size,
+                                uint8_t pre) noexcept {
+    for (size_t i = 0; i < size; i++) {
+      auto c = static_cast<uint8_t>(data[i]);
+      value = update(value, c, pre);
+      pre = c;
+    }
+    return value;
+  }
+
+  static constexpr uint64_t result(Value value) noexcept {
+    return static_cast<uint16_t>((value >> 8) | (value << 8));
+  }
+};
+
+} // namespace crc
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cinttypes>
+#include <cstddef>
 #include <memory>
 
 namespace crc {
@@ -15,8 +16,31 @@ public:
 private:
   virtual uint64_t updateCrc(uint64_t value, uint8_t c, uint8_t pre) const = 0;
 
+  /**
+   * @brief Update the crc with size consecutive bytes.
+   * pre is the byte preceding data[0]. Codes with a faster bulk algorithm
+   * override this, it must give the same result as calling updateCrc for each
+   * byte.
+   */
+  virtual uint64_t update(uint64_t value, const uint8_t *data, size_t size,
+                          uint8_t pre) const {
+    for (size_t i = 0; i < size; ++i) {
+      value = updateCrc(value, data[i], pre);
+      pre = data[i];
+    }
+    return value;
+  }
+
   virtual uint64_t startValue() const noexcept { return 0; }
   virtual uint64_t result(uint64_t value) const noexcept { return value; }
+
+  /**
+   * @brief The register after feeding size zero bytes into value.
+   * Feeding a zero byte is linear over GF(2), so it is applied as a bit matrix
+   * raised to the size-th power in O(log size) squarings, as in zlib's
+   * crc32_combine.
+   */
+  uint64_t appendZeros(uint64_t value, uint64_t size) const noexcept;
 };
 
 }; // namespace crc
@@ -14,6 +14,9 @@ private:
   virtual uint64_t updateCrc(uint64_t value, uint8_t c,
                              uint8_t pre) const override;
 
+  virtual uint64_t update(uint64_t value, const uint8_t *data, size_t size,
+                          uint8_t pre) const override;
+
   virtual uint64_t result(uint64_t value) const noexcept override {
     return value ^ static_cast<uint32_t>(-1);
   }
@@ -22,6 +22,9 @@ private:
 
   virtual uint64_t updateCrc(uint64_t value, uint8_t c,
                              uint8_t pre) const override;
+
+  virtual uint64_t update(uint64_t value, const uint8_t *data, size_t size,
+                          uint8_t pre) const override;
 };
 
 } // namespace crc
\ No newline at end of file
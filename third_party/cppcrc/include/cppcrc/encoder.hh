@@ -13,11 +13,13 @@
  */
 
 #include "code_base.hh"
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <memory>
 #include <string_view>
 #include <type_traits>
+#include <vector>
 
 namespace crc {
 
@@ -55,15 +57,23 @@ public:
     mPreByte = c;
   }
 
-  void update(std::istream &input) {
-    uint8_t c = 0;
+  void update(const uint8_t *data, size_t size) noexcept {
+    if (size == 0) {
+      return;
+    }
+    mValue = mCode->update(mValue, data, size, mPreByte);
+    mPreByte = data[size - 1];
+  }
 
+  void update(std::istream &input) {
     if (!input) {
       return;
     }
 
-    while (input.read(reinterpret_cast<char *>(&c), 1)) {
-      this->update(c);
+    std::vector<char> buffer(kStreamBlockSize);
+    while (input.read(buffer.data(), buffer.size()) || input.gcount() > 0) {
+      this->update(reinterpret_cast<const uint8_t *>(buffer.data()),
+                   static_cast<size_t>(input.gcount()));
     }
   }
 
@@ -75,13 +85,50 @@ public:
                          uint8_t>,
           int> = 0>
   void update(Iterator first, Iterator last) {
-    uint8_t c = 0;
-    for (; first != last; ++first) {
-      this->update(*first);
+    if constexpr (std::is_pointer_v<Iterator>) {
+      this->update(reinterpret_cast<const uint8_t *>(first),
+                   static_cast<size_t>(last - first));
+    } else {
+      // Copy into a small block so the code still sees bulk updates.
+      uint8_t block[256];
+      size_t size = 0;
+      for (; first != last; ++first) {
+        block[size++] = static_cast<uint8_t>(*first);
+        if (size == sizeof(block)) {
+          this->update(block, size);
+          size = 0;
+        }
+      }
+      this->update(block, size);
     }
   }
 
-  void update(std::string_view str) { this->update(str.cbegin(), str.cend()); }
+  void update(std::string_view str) {
+    this->update(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+  }
+
+  /**
+   * @brief Set the byte preceding the input of a fresh encoder.
+   * Used when the encoder hashes a chunk from the middle of a message that is
+   * merged back with combine(), some codes mix the previous byte in.
+   */
+  void setPreByte(uint8_t pre) noexcept { mPreByte = pre; }
+
+  /**
+   * @brief Append the crc of the size bytes hashed by next, which directly
+   * follow the bytes hashed by this encoder.
+   * next must use the same code and start fresh, with setPreByte() given the
+   * last byte hashed here. The result equals hashing both parts in sequence.
+   */
+  void combine(const Encoder &next, uint64_t size) noexcept {
+    if (size == 0) {
+      return;
+    }
+    // Both registers started from startValue(), which next contributes again.
+    mValue = mCode->appendZeros(mValue ^ mCode->startValue(), size) ^
+             next.mValue;
+    mPreByte = next.mPreByte;
+  }
 
   void reset() noexcept {
     mValue = mCode->startValue();
@@ -91,6 +138,8 @@ public:
   uint64_t value() noexcept { return mCode->result(mValue); }
 
 private:
+  static constexpr size_t kStreamBlockSize = 64 * 1024;
+
   std::shared_ptr<const CodeBase> mCode;
   uint64_t mValue;
   uint8_t mPreByte;
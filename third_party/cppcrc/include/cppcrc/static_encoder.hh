@@ -0,0 +1,77 @@
+#pragma once
+
+/**
+ * @file static_encoder.hh
+ * @brief Crc encoder specialized for one algorithm at compile time.
+ *
+ * Unlike Encoder it holds no shared code object and makes no virtual calls,
+ * and it can be evaluated in constant expressions:
+ *
+ *   static_assert(crc::StaticEncoder<crc::Crc32>("123456789").value() ==
+ *                 0xCBF43926);
+ */
+
+#include "algorithms.hh"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace crc {
+
+template <class Algorithm> class StaticEncoder {
+public:
+  using Value = typename Algorithm::Value;
+
+  constexpr StaticEncoder() noexcept
+      : mValue(Algorithm::start()), mPreByte(0) {}
+
+  constexpr explicit StaticEncoder(std::string_view str) noexcept
+      : StaticEncoder() {
+    this->update(str);
+  }
+
+  constexpr void update(uint8_t c) noexcept {
+    mValue = Algorithm::update(mValue, c, mPreByte);
+    mPreByte = c;
+  }
+
+  constexpr void update(const uint8_t *data, size_t size) noexcept {
+    this->updateBytes(data, size);
+  }
+
+  constexpr void update(std::string_view str) noexcept {
+    this->updateBytes(str.data(), str.size());
+  }
+
+  constexpr void reset() noexcept {
+    mValue = Algorithm::start();
+    mPreByte = 0;
+  }
+
+  constexpr uint64_t value() const noexcept {
+    return Algorithm::result(mValue);
+  }
+
+private:
+  Value mValue;
+  uint8_t mPreByte;
+
+  template <class Byte>
+  constexpr void updateBytes(const Byte *data, size_t size) noexcept {
+    if (size == 0) {
+      return;
+    }
+    mValue = Algorithm::update(mValue, data, size, mPreByte);
+    mPreByte = static_cast<uint8_t>(data[size - 1]);
+  }
+};
+
+/**
+ * @brief Checksum of a whole string, usable in constant expressions.
+ */
+template <class Algorithm>
+constexpr uint64_t checksum(std::string_view str) noexcept {
+  return StaticEncoder<Algorithm>(str).value();
+}
+
+} // namespace crc
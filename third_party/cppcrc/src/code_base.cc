@@ -0,0 +1,58 @@
+#include "cppcrc/code_base.hh"
+
+namespace crc {
+
+namespace {
+
+using Matrix = uint64_t[64];
+
+uint64_t multiply(const Matrix matrix, uint64_t vector) noexcept {
+  uint64_t sum = 0;
+  for (int i = 0; vector != 0; ++i, vector >>= 1) {
+    if (vector & 1) {
+      sum ^= matrix[i];
+    }
+  }
+  return sum;
+}
+
+void square(Matrix result, const Matrix matrix) noexcept {
+  for (int i = 0; i < 64; ++i) {
+    result[i] = multiply(matrix, matrix[i]);
+  }
+}
+
+} // namespace
+
+uint64_t CodeBase::appendZeros(uint64_t value, uint64_t size) const noexcept {
+  // Column i is the register after one zero byte starting from bit i alone.
+  // Codes truncate the register to their width, so unused columns are zero.
+  Matrix even, odd;
+  for (int i = 0; i < 64; ++i) {
+    odd[i] = updateCrc(uint64_t(1) << i, 0, 0);
+  }
+
+  // odd holds the operator for 2^k zero bytes, alternating with even.
+  for (;;) {
+    if (size & 1) {
+      value = multiply(odd, value);
+    }
+    size >>= 1;
+    if (size == 0) {
+      break;
+    }
+    square(even, odd);
+
+    if (size & 1) {
+      value = multiply(even, value);
+    }
+    size >>= 1;
+    if (size == 0) {
+      break;
+    }
+    square(odd, even);
+  }
+  return value;
+}
+
+} // namespace crc
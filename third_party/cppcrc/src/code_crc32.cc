@@ -1,56 +1,125 @@
 #include "cppcrc/code_crc32.hh"
+#include "cppcrc/algorithms.hh"
 
 #include <cinttypes>
 
-#ifdef CPPCRC_THREADSAFE
-#include <mutex>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CPPCRC_PCLMUL
+#include <immintrin.h>
 #endif
 
 namespace crc {
 
-constexpr uint32_t kPoly = 0xEDB88320ul;
+#ifdef CPPCRC_PCLMUL
 
-#ifdef CPPCRC_THREADSAFE
-static std::mutex kLock;
-#endif
+// Below this size the setup and final reduction cost more than they save.
+constexpr size_t kPclmulMinSize = 256;
 
-static bool kTableInit = false;
-static uint32_t kTable[256];
+static bool hasPclmul() {
+  static const bool supported =
+      __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+  return supported;
+}
 
-static void initTable() {
-#ifdef CPPCRC_THREADSAFE
-  std::lock_guard<std::mutex> lockGuard(kLock);
-#endif
+__attribute__((target("pclmul,sse4.1"))) static inline __m128i
+load128(const uint8_t *data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+}
 
-  if (kTableInit) {
-    return;
-  }
+// x * (high and low halves of k) folded onto next.
+__attribute__((target("pclmul,sse4.1"))) static inline __m128i
+fold128(__m128i x, __m128i k, __m128i next) {
+  auto low = _mm_clmulepi64_si128(x, k, 0x00);
+  auto high = _mm_clmulepi64_si128(x, k, 0x11);
+  return _mm_xor_si128(_mm_xor_si128(high, next), low);
+}
 
-  for (uint32_t i = 0; i < 256; i++) {
+/**
+ * @brief Fold 64 bytes per step with carry-less multiplication, as described in
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+ * (Intel, 2009). size must be a multiple of 16 and at least 64.
+ */
+__attribute__((target("pclmul,sse4.1"))) static uint32_t
+updatePclmul(uint32_t crc, const uint8_t *data, size_t size) {
+  // Bit-reflected folding constants x^(4*128+32) mod P, x^(4*128-32) mod P,
+  // x^(128+32) mod P, x^(128-32) mod P, x^64 mod P, and the Barrett
+  // reduction constants P' and mu.
+  alignas(16) static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+  alignas(16) static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+  alignas(16) static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+  alignas(16) static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
 
-    kTable[i] = i;
+  auto x1 = load128(data);
+  auto x2 = load128(data + 16);
+  auto x3 = load128(data + 32);
+  auto x4 = load128(data + 48);
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
 
-    for (uint32_t j = 0; j < 8; j++) {
-      kTable[i] =
-          (kTable[i] & 0x01L) ? (kTable[i] >> 1) ^ kPoly : kTable[i] >> 1;
-    }
+  auto k = _mm_load_si128(reinterpret_cast<const __m128i *>(k1k2));
+  data += 64;
+  size -= 64;
+
+  for (; size >= 64; data += 64, size -= 64) {
+    x1 = fold128(x1, k, load128(data));
+    x2 = fold128(x2, k, load128(data + 16));
+    x3 = fold128(x3, k, load128(data + 32));
+    x4 = fold128(x4, k, load128(data + 48));
   }
 
-  kTableInit = true;
+  // Fold the four lanes into one.
+  k = _mm_load_si128(reinterpret_cast<const __m128i *>(k3k4));
+  x1 = fold128(x1, k, x2);
+  x1 = fold128(x1, k, x3);
+  x1 = fold128(x1, k, x4);
+
+  for (; size >= 16; data += 16, size -= 16) {
+    x1 = fold128(x1, k, load128(data));
+  }
+
+  // Fold 128 bits to 64 bits.
+  auto mask = _mm_setr_epi32(~0, 0, ~0, 0);
+  x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+  k = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(k5k0));
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits.
+  k = _mm_load_si128(reinterpret_cast<const __m128i *>(poly));
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x10);
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), k, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
 }
 
+#endif
+
 CodeBase::ShareConstPtr CodeCrc32::instance() {
   static auto ptr = std::make_shared<CodeCrc32>();
   return ptr;
 }
 
 uint64_t CodeCrc32::updateCrc(uint64_t value, uint8_t c, uint8_t pre) const {
-  if (!kTableInit) {
-    initTable();
-  }
+  return Crc32::update(static_cast<uint32_t>(value), c, pre);
+}
+
+uint64_t CodeCrc32::update(uint64_t value, const uint8_t *data, size_t size,
+                           uint8_t pre) const {
   auto crc32Value = static_cast<uint32_t>(value);
-  return (crc32Value >> 8) ^
-         kTable[(crc32Value ^ static_cast<uint32_t>(c)) & 0x000000FFul];
+
+#ifdef CPPCRC_PCLMUL
+  if (size >= kPclmulMinSize && hasPclmul()) {
+    auto folded = size & ~static_cast<size_t>(15);
+    crc32Value = updatePclmul(crc32Value, data, folded);
+    data += folded;
+    size -= folded;
+  }
+#endif
+
+  return Crc32::update(crc32Value, data, size, pre);
 }
 
-} // namespace crc
\ No newline at end of file
+} // namespace crc
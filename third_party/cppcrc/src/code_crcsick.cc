@@ -1,8 +1,7 @@
 #include "cppcrc/code_crcsick.hh"
-#include <cstdint>
+#include "cppcrc/algorithms.hh"
 
 namespace crc {
-constexpr uint16_t kPoly = 0x8005;
 
 CodeBase::ShareConstPtr CodeCrcSick::instance() {
   static auto ptr = std::make_shared<CodeCrcSick>();
@@ -10,15 +9,12 @@ CodeBase::ShareConstPtr CodeCrcSick::instance() {
 }
 
 uint64_t CodeCrcSick::updateCrc(uint64_t value, uint8_t c, uint8_t pre) const {
-  auto crcValue = static_cast<uint16_t>(value);
-
-  uint16_t high = 0x00FF & static_cast<uint16_t>(c);
-  uint16_t low = (0x00FF & static_cast<uint16_t>(pre)) << 8;
-
-  crcValue = (crcValue & 0x8000) ? ((crcValue << 1) ^ kPoly) : (crcValue << 1);
-  crcValue ^= (high | low);
+  return CrcSick::update(static_cast<uint16_t>(value), c, pre);
+}
 
-  return crcValue;
+uint64_t CodeCrcSick::update(uint64_t value, const uint8_t *data, size_t size,
+                             uint8_t pre) const {
+  return CrcSick::update(static_cast<uint16_t>(value), data, size, pre);
 }
 
 } // namespace crc
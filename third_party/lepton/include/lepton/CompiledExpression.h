@@ -35,12 +35,14 @@
 #include "ExpressionTreeNode.h"
 #include "windowsIncludes.h"
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
 
 namespace Lepton {
 
+class EvaluationContext;
 class Operation;
 class ParsedExpression;
 
@@ -51,12 +53,15 @@ class ParsedExpression;
  * 
  * A CompiledExpression is created by calling createCompiledExpression() on a ParsedExpression.
  * 
- * WARNING: CompiledExpression is NOT thread safe.  You should never access a CompiledExpression from two threads at
- * the same time.
+ * The compiled program is immutable and shared between copies, so copying a CompiledExpression is cheap and does not
+ * clone any Operations.  Each CompiledExpression still owns a private workspace used by getVariableReference() and
+ * evaluate(), so a single instance must not be accessed from two threads at the same time.  To evaluate the same
+ * expression from several threads, create one EvaluationContext per thread with createContext().
  */
 
 class LEPTON_EXPORT CompiledExpression {
 public:
+    class Program;
     CompiledExpression();
     CompiledExpression(const CompiledExpression& expression);
     ~CompiledExpression();
@@ -65,6 +70,15 @@ public:
      * Get the names of all variables used by this expression.
      */
     const std::set<std::string>& getVariables() const;
+    /**
+     * Get the number of variables used by this expression.  Variables are numbered from 0 to getNumVariables()-1
+     * in the same order as getVariables().
+     */
+    int getNumVariables() const;
+    /**
+     * Get the index of a variable, for use with EvaluationContext.
+     */
+    int getVariableIndex(const std::string& name) const;
     /**
      * Get a reference to the memory location where the value of a particular variable is stored.  This can be used
      * to set the value of the variable before calling evaluate().
@@ -74,19 +88,100 @@ public:
      * Evaluate the expression.  The values of all variables should have been set before calling this.
      */
     double evaluate() const;
+    /**
+     * Create a new EvaluationContext for evaluating this expression.  The context shares the compiled program with
+     * this object and may be used independently from any thread.
+     */
+    EvaluationContext createContext() const;
+    /**
+     * Get whether this expression is evaluated with native code.  The code is generated the first time it is needed.
+     */
+    bool hasNativeCode() const;
+    /**
+     * Get whether native code can be generated on this platform.  This is only true on x86-64 Linux.
+     */
+    static bool isNativeCodeSupported();
+    /**
+     * Get whether evaluate() runs generated native code instead of the interpreter.
+     */
+    static bool getUseNativeCode();
+    /**
+     * Set whether evaluate() runs generated native code instead of the interpreter.  This is disabled by default.
+     * Native code gives identical results, but exceptions thrown by custom functions cannot propagate through it.
+     * When a custom function throws during native evaluation, the exception is discarded and its result is NaN.
+     *
+     * @return whether native code will actually be used
+     */
+    static bool setUseNativeCode(bool use);
 private:
     friend class ParsedExpression;
+    friend class EvaluationContext;
     CompiledExpression(const ParsedExpression& expression);
-    void compileExpression(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
-    int findTempIndex(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
-    std::vector<std::vector<int> > arguments;
-    std::vector<int> target;
-    std::vector<Operation*> operation;
-    std::map<std::string, int> variableIndices;
-    std::set<std::string> variableNames;
+    std::shared_ptr<const Program> program;
     mutable std::vector<double> workspace;
     mutable std::vector<double> argValues;
-    std::map<std::string, double> dummyVariables;
+};
+
+/**
+ * An EvaluationContext holds the mutable state needed to evaluate a CompiledExpression: the values of its variables
+ * and the intermediate results.  Any number of contexts may share one CompiledExpression, and each one may be used
+ * from a different thread.  Variables are addressed by the index returned by CompiledExpression::getVariableIndex().
+ * A context always refers to a compiled program, so there is no default constructor; create one with
+ * CompiledExpression::createContext().
+ */
+
+class LEPTON_EXPORT EvaluationContext {
+public:
+    EvaluationContext() = delete;
+    explicit EvaluationContext(const CompiledExpression& expression);
+    /**
+     * Get the number of variable slots.
+     */
+    int getNumVariables() const;
+    /**
+     * Get a pointer to the variable slots, which are stored contiguously in index order.
+     */
+    double* getVariables() {
+        return workspace.empty() ? NULL : &workspace[0];
+    }
+    void setVariable(int index, double value) {
+        workspace[index] = value;
+    }
+    double getVariable(int index) const {
+        return workspace[index];
+    }
+    /**
+     * Evaluate the expression.  The values of all variables should have been set before calling this.
+     */
+    double evaluate();
+    /**
+     * Evaluate the expression for many sets of variable values at once.  Each operation is applied to a block of
+     * values at a time, using vector instructions for the arithmetic operations when they are available.  The standard
+     * math functions call the C library for each value of the block, and only custom functions are evaluated through
+     * Operation::evaluate().  The results are identical to calling evaluate() once for each set of values.
+     *
+     * @param variables   an array of getNumVariables() pointers, indexed by variable index.  variables[i] points to
+     *                    count values of variable i.
+     * @param results     on exit, contains the count results
+     * @param count       the number of values to evaluate
+     */
+    void evaluateBatch(const double* const* variables, double* results, int count);
+    /**
+     * Get whether evaluateBatch() uses AVX2 instructions.
+     */
+    static bool getUseVectorInstructions();
+    /**
+     * Set whether evaluateBatch() may use AVX2 instructions.  They are used by default if the CPU supports them.
+     *
+     * @return whether AVX2 instructions will actually be used
+     */
+    static bool setUseVectorInstructions(bool use);
+private:
+    std::shared_ptr<const CompiledExpression::Program> program;
+    std::vector<double> workspace;
+    std::vector<double> argValues;
+    std::vector<double> batchWorkspace;
+    std::vector<const double*> batchSlots;
 };
 
 } // namespace Lepton
@@ -116,6 +116,15 @@ public:
     virtual bool operator==(const Operation& op) const {
         return !(*this != op);
     }
+protected:
+    /**
+     * Compare two constant values, treating NaN as equal to itself.  Otherwise an expression containing a NaN
+     * constant never compares equal to itself and optimize() does not terminate.
+     */
+    static bool isSameValue(double a, double b) {
+        return a == b || (a != a && b != b);
+    }
+public:
     class Constant;
     class Variable;
     class Custom;
@@ -182,7 +191,7 @@ public:
     }
     bool operator!=(const Operation& op) const {
         const Constant* o = dynamic_cast<const Constant*>(&op);
-        return (o == NULL || o->value != value);
+        return (o == NULL || !isSameValue(o->value, value));
     }
 private:
     double value;
@@ -924,7 +933,7 @@ public:
     }
     bool operator!=(const Operation& op) const {
         const AddConstant* o = dynamic_cast<const AddConstant*>(&op);
-        return (o == NULL || o->value != value);
+        return (o == NULL || !isSameValue(o->value, value));
     }
 private:
     double value;
@@ -957,7 +966,7 @@ public:
     }
     bool operator!=(const Operation& op) const {
         const MultiplyConstant* o = dynamic_cast<const MultiplyConstant*>(&op);
-        return (o == NULL || o->value != value);
+        return (o == NULL || !isSameValue(o->value, value));
     }
 private:
     double value;
@@ -1011,7 +1020,7 @@ public:
     }
     bool operator!=(const Operation& op) const {
         const PowerConstant* o = dynamic_cast<const PowerConstant*>(&op);
-        return (o == NULL || o->value != value);
+        return (o == NULL || !isSameValue(o->value, value));
     }
     bool isInfixOperator() const {
         return true;
@@ -0,0 +1,319 @@
+/* -------------------------------------------------------------------------- *
+ *                                   Lepton                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the Lepton expression parser originating from              *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "BatchKernels.h"
+#include "MSVC_erfc.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEPTON_BATCH_AVX2 1
+#include <immintrin.h>
+#endif
+
+using namespace Lepton;
+
+// Portable kernels.  These are written as simple loops so the compiler is free to vectorize them for the baseline
+// instruction set.
+
+static void addScalar(const double* a, const double* b, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = a[i]+b[i];
+}
+
+static void subtractScalar(const double* a, const double* b, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = a[i]-b[i];
+}
+
+static void multiplyScalar(const double* a, const double* b, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = a[i]*b[i];
+}
+
+static void divideScalar(const double* a, const double* b, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = a[i]/b[i];
+}
+
+static void minScalar(const double* a, const double* b, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = (std::min)(a[i], b[i]);
+}
+
+static void maxScalar(const double* a, const double* b, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = (std::max)(a[i], b[i]);
+}
+
+static void negateScalar(const double* a, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = -a[i];
+}
+
+static void sqrtScalar(const double* a, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = std::sqrt(a[i]);
+}
+
+static void squareScalar(const double* a, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = a[i]*a[i];
+}
+
+static void cubeScalar(const double* a, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = a[i]*a[i]*a[i];
+}
+
+static void reciprocalScalar(const double* a, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = 1.0/a[i];
+}
+
+static void stepScalar(const double* a, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = (a[i] >= 0.0 ? 1.0 : 0.0);
+}
+
+static void deltaScalar(const double* a, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = (a[i] == 0.0 ? 1.0 : 0.0);
+}
+
+static void absScalar(const double* a, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = std::abs(a[i]);
+}
+
+static void addConstantScalar(const double* a, double value, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = a[i]+value;
+}
+
+static void multiplyConstantScalar(const double* a, double value, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = a[i]*value;
+}
+
+static double powerIntScalar(double base, int exponent) {
+    // This must match Operation::PowerConstant::evaluate() exactly.
+    
+    if (exponent < 0) {
+        exponent = -exponent;
+        base = 1.0/base;
+    }
+    double result = 1.0;
+    while (exponent != 0) {
+        if ((exponent&1) == 1)
+            result *= base;
+        base *= base;
+        exponent = exponent>>1;
+    }
+    return result;
+}
+
+static void powerIntScalar(const double* a, int exponent, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = powerIntScalar(a[i], exponent);
+}
+
+// Kernels for functions computed by the C library.  There is no vectorized version that is guaranteed to give the
+// same results, so every table calls the library once per value.  That still avoids the virtual call and argument
+// copying of the generic path.  Each expression must match the corresponding Operation::evaluate() exactly.
+
+#define LEPTON_MATH_KERNEL(NAME, EXPRESSION) \
+static void NAME(const double* a, double* out, int n) { \
+    using namespace std; \
+    for (int i = 0; i < n; i++) { \
+        double x = a[i]; \
+        out[i] = EXPRESSION; \
+    } \
+}
+
+LEPTON_MATH_KERNEL(expScalar, std::exp(x))
+LEPTON_MATH_KERNEL(logScalar, std::log(x))
+LEPTON_MATH_KERNEL(sinScalar, std::sin(x))
+LEPTON_MATH_KERNEL(cosScalar, std::cos(x))
+LEPTON_MATH_KERNEL(secScalar, 1.0/std::cos(x))
+LEPTON_MATH_KERNEL(cscScalar, 1.0/std::sin(x))
+LEPTON_MATH_KERNEL(tanScalar, std::tan(x))
+LEPTON_MATH_KERNEL(cotScalar, 1.0/std::tan(x))
+LEPTON_MATH_KERNEL(asinScalar, std::asin(x))
+LEPTON_MATH_KERNEL(acosScalar, std::acos(x))
+LEPTON_MATH_KERNEL(atanScalar, std::atan(x))
+LEPTON_MATH_KERNEL(sinhScalar, std::sinh(x))
+LEPTON_MATH_KERNEL(coshScalar, std::cosh(x))
+LEPTON_MATH_KERNEL(tanhScalar, std::tanh(x))
+LEPTON_MATH_KERNEL(erfScalar, erf(x))
+LEPTON_MATH_KERNEL(erfcScalar, erfc(x))
+
+static void powerScalar(const double* a, const double* b, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = std::pow(a[i], b[i]);
+}
+
+static void powerConstantScalar(const double* a, double value, double* out, int n) {
+    for (int i = 0; i < n; i++)
+        out[i] = std::pow(a[i], value);
+}
+
+const BatchKernels& Lepton::getScalarBatchKernels() {
+    static const BatchKernels kernels = {"scalar",
+        addScalar, subtractScalar, multiplyScalar, divideScalar, minScalar, maxScalar,
+        negateScalar, sqrtScalar, squareScalar, cubeScalar, reciprocalScalar, stepScalar, deltaScalar, absScalar,
+        addConstantScalar, multiplyConstantScalar, powerIntScalar,
+        powerScalar, expScalar, logScalar, sinScalar, cosScalar, secScalar, cscScalar, tanScalar, cotScalar,
+        asinScalar, acosScalar, atanScalar, sinhScalar, coshScalar, tanhScalar, erfScalar, erfcScalar,
+        powerConstantScalar};
+    return kernels;
+}
+
+#ifdef LEPTON_BATCH_AVX2
+
+// AVX2 kernels.  Each one processes four values per iteration and finishes the remainder with scalar code.  They only
+// use operations that are correctly rounded, so the results are identical to the scalar versions.  FMA is deliberately
+// not enabled, since contracting a*b+c would change the results.
+
+#define LEPTON_AVX2 __attribute__((target("avx2")))
+
+#define LEPTON_BINARY_AVX2(NAME, VECTOR, SCALAR) \
+LEPTON_AVX2 static void NAME(const double* a, const double* b, double* out, int n) { \
+    int i = 0; \
+    for (; i+4 <= n; i += 4) { \
+        __m256d x = _mm256_loadu_pd(a+i); \
+        __m256d y = _mm256_loadu_pd(b+i); \
+        _mm256_storeu_pd(out+i, VECTOR); \
+    } \
+    for (; i < n; i++) { \
+        double x = a[i]; \
+        double y = b[i]; \
+        out[i] = SCALAR; \
+    } \
+}
+
+#define LEPTON_UNARY_AVX2(NAME, VECTOR, SCALAR) \
+LEPTON_AVX2 static void NAME(const double* a, double* out, int n) { \
+    const __m256d zero = _mm256_setzero_pd(); \
+    const __m256d one = _mm256_set1_pd(1.0); \
+    const __m256d sign = _mm256_set1_pd(-0.0); \
+    (void) zero; (void) one; (void) sign; \
+    int i = 0; \
+    for (; i+4 <= n; i += 4) { \
+        __m256d x = _mm256_loadu_pd(a+i); \
+        _mm256_storeu_pd(out+i, VECTOR); \
+    } \
+    for (; i < n; i++) { \
+        double x = a[i]; \
+        out[i] = SCALAR; \
+    } \
+}
+
+// The argument order of min and max matches std::min() and std::max() when one of the values is NaN.
+
+LEPTON_BINARY_AVX2(addAvx2, _mm256_add_pd(x, y), x+y)
+LEPTON_BINARY_AVX2(subtractAvx2, _mm256_sub_pd(x, y), x-y)
+LEPTON_BINARY_AVX2(multiplyAvx2, _mm256_mul_pd(x, y), x*y)
+LEPTON_BINARY_AVX2(divideAvx2, _mm256_div_pd(x, y), x/y)
+LEPTON_BINARY_AVX2(minAvx2, _mm256_min_pd(y, x), (std::min)(x, y))
+LEPTON_BINARY_AVX2(maxAvx2, _mm256_max_pd(y, x), (std::max)(x, y))
+
+LEPTON_UNARY_AVX2(negateAvx2, _mm256_xor_pd(x, sign), -x)
+LEPTON_UNARY_AVX2(sqrtAvx2, _mm256_sqrt_pd(x), std::sqrt(x))
+LEPTON_UNARY_AVX2(squareAvx2, _mm256_mul_pd(x, x), x*x)
+LEPTON_UNARY_AVX2(cubeAvx2, _mm256_mul_pd(_mm256_mul_pd(x, x), x), x*x*x)
+LEPTON_UNARY_AVX2(reciprocalAvx2, _mm256_div_pd(one, x), 1.0/x)
+LEPTON_UNARY_AVX2(stepAvx2, _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GE_OQ), one), (x >= 0.0 ? 1.0 : 0.0))
+LEPTON_UNARY_AVX2(deltaAvx2, _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_EQ_OQ), one), (x == 0.0 ? 1.0 : 0.0))
+LEPTON_UNARY_AVX2(absAvx2, _mm256_andnot_pd(sign, x), std::abs(x))
+
+LEPTON_AVX2 static void addConstantAvx2(const double* a, double value, double* out, int n) {
+    const __m256d c = _mm256_set1_pd(value);
+    int i = 0;
+    for (; i+4 <= n; i += 4)
+        _mm256_storeu_pd(out+i, _mm256_add_pd(_mm256_loadu_pd(a+i), c));
+    for (; i < n; i++)
+        out[i] = a[i]+value;
+}
+
+LEPTON_AVX2 static void multiplyConstantAvx2(const double* a, double value, double* out, int n) {
+    const __m256d c = _mm256_set1_pd(value);
+    int i = 0;
+    for (; i+4 <= n; i += 4)
+        _mm256_storeu_pd(out+i, _mm256_mul_pd(_mm256_loadu_pd(a+i), c));
+    for (; i < n; i++)
+        out[i] = a[i]*value;
+}
+
+LEPTON_AVX2 static void powerIntAvx2(const double* a, int exponent, double* out, int n) {
+    // The same square-and-multiply sequence as the scalar version, applied to four values at once.
+    
+    const __m256d one = _mm256_set1_pd(1.0);
+    int i = 0;
+    for (; i+4 <= n; i += 4) {
+        __m256d base = _mm256_loadu_pd(a+i);
+        int e = exponent;
+        if (e < 0) {
+            e = -e;
+            base = _mm256_div_pd(one, base);
+        }
+        __m256d result = one;
+        while (e != 0) {
+            if ((e&1) == 1)
+                result = _mm256_mul_pd(result, base);
+            base = _mm256_mul_pd(base, base);
+            e = e>>1;
+        }
+        _mm256_storeu_pd(out+i, result);
+    }
+    for (; i < n; i++)
+        out[i] = powerIntScalar(a[i], exponent);
+}
+
+const BatchKernels* Lepton::getAvx2BatchKernels() {
+    static const BatchKernels kernels = {"avx2",
+        addAvx2, subtractAvx2, multiplyAvx2, divideAvx2, minAvx2, maxAvx2,
+        negateAvx2, sqrtAvx2, squareAvx2, cubeAvx2, reciprocalAvx2, stepAvx2, deltaAvx2, absAvx2,
+        addConstantAvx2, multiplyConstantAvx2, powerIntAvx2,
+        powerScalar, expScalar, logScalar, sinScalar, cosScalar, secScalar, cscScalar, tanScalar, cotScalar,
+        asinScalar, acosScalar, atanScalar, sinhScalar, coshScalar, tanhScalar, erfScalar, erfcScalar,
+        powerConstantScalar};
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported ? &kernels : NULL;
+}
+
+#else
+
+const BatchKernels* Lepton::getAvx2BatchKernels() {
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef LEPTON_BATCH_KERNELS_H_
+#define LEPTON_BATCH_KERNELS_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   Lepton                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the Lepton expression parser originating from              *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+namespace Lepton {
+
+/**
+ * A table of kernels used by EvaluationContext::evaluateBatch().  Each kernel applies one operation to n
+ * consecutive values.  The input and output arrays may not overlap, except that out may equal an input.  Every
+ * implementation produces exactly the same results as the corresponding Operation::evaluate().
+ */
+
+struct BatchKernels {
+    typedef void (*Binary)(const double* a, const double* b, double* out, int n);
+    typedef void (*Unary)(const double* a, double* out, int n);
+    typedef void (*UnaryConstant)(const double* a, double value, double* out, int n);
+    const char* name;
+    Binary add, subtract, multiply, divide, min, max;
+    Unary negate, sqrt, square, cube, reciprocal, step, delta, abs;
+    UnaryConstant addConstant, multiplyConstant;
+    void (*powerInt)(const double* a, int exponent, double* out, int n);
+    Binary power;
+    Unary exp, log, sin, cos, sec, csc, tan, cot, asin, acos, atan, sinh, cosh, tanh, erf, erfc;
+    UnaryConstant powerConstant;
+};
+
+/**
+ * Get the portable kernels.
+ */
+const BatchKernels& getScalarBatchKernels();
+
+/**
+ * Get the AVX2 kernels, or NULL if they were not compiled in or the CPU does not support AVX2.
+ */
+const BatchKernels* getAvx2BatchKernels();
+
+} // namespace Lepton
+
+#endif /*LEPTON_BATCH_KERNELS_H_*/
@@ -32,44 +32,87 @@
 #include "lepton/CompiledExpression.h"
 #include "lepton/Operation.h"
 #include "lepton/ParsedExpression.h"
+#include "BatchKernels.h"
+#include "CompiledProgram.h"
+#include "NativeCode.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <utility>
 
 using namespace Lepton;
 using namespace std;
 
-CompiledExpression::CompiledExpression() {
+static const map<string, double> dummyVariables;
+
+static atomic<bool> useVectorInstructions(true);
+
+static atomic<bool> useNativeCode(false);
+
+CompiledExpression::Program::Program() : workspaceSize(1), maxArguments(1), resultIndex(0),
+        nativeState(NativeNotCompiled), nativeCode(NULL) {
 }
 
-CompiledExpression::CompiledExpression(const ParsedExpression& expression) {
+CompiledExpression::Program::Program(const ParsedExpression& expression) : workspaceSize(0), maxArguments(1), resultIndex(0),
+        nativeState(NativeNotCompiled), nativeCode(NULL) {
     ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
     vector<pair<ExpressionTreeNode, int> > temps;
-    compileExpression(expr.getRootNode(), temps);
+    vector<vector<int> > stepArgs;
+    map<string, int> variableTemps;
+    compileExpression(expr.getRootNode(), temps, stepArgs, variableTemps);
+    
+    // Move the variables to the start of the workspace so they can be addressed by index.
+    
+    operands.resize(operation.size());
+    vector<int> remap(workspaceSize, -1);
+    int next = 0;
+    for (map<string, int>::const_iterator iter = variableTemps.begin(); iter != variableTemps.end(); ++iter) {
+        variableIndices[iter->first] = next;
+        remap[iter->second] = next++;
+    }
+    for (int i = 0; i < workspaceSize; i++)
+        if (remap[i] == -1)
+            remap[i] = next++;
+    resultIndex = remap[workspaceSize-1];
+    
+    // Remap the steps.
+    
+    for (int step = 0; step < (int) operation.size(); step++) {
+        target[step] = remap[target[step]];
+        vector<int>& args = stepArgs[step];
+        if (args.size() == 0) {
+            arguments[step].push_back(0); // The value won't actually be used.  We just need something there.
+            continue;
+        }
+        for (int i = 0; i < (int) args.size(); i++)
+            args[i] = remap[args[i]];
+        operands[step] = args;
+        
+        // If the arguments are sequential, we can just pass a pointer to the first one.
+        
+        bool sequential = true;
+        for (int i = 1; i < args.size(); i++)
+            if (args[i] != args[i-1]+1)
+                sequential = false;
+        if (sequential)
+            arguments[step].push_back(args[0]);
+        else {
+            arguments[step] = args;
+        }
+        if ((int) args.size() > maxArguments)
+            maxArguments = (int) args.size();
+    }
 }
 
-CompiledExpression::~CompiledExpression() {
+CompiledExpression::Program::~Program() {
+    delete nativeCode;
     for (int i = 0; i < (int) operation.size(); i++)
         if (operation[i] != NULL)
             delete operation[i];
 }
 
-CompiledExpression::CompiledExpression(const CompiledExpression& expression) {
-    *this = expression;
-}
-
-CompiledExpression& CompiledExpression::operator=(const CompiledExpression& expression) {
-    arguments = expression.arguments;
-    target = expression.target;
-    variableIndices = expression.variableIndices;
-    variableNames = expression.variableNames;
-    workspace.resize(expression.workspace.size());
-    argValues.resize(expression.argValues.size());
-    operation.resize(expression.operation.size());
-    for (int i = 0; i < (int) operation.size(); i++)
-        operation[i] = expression.operation[i]->clone();
-    return *this;
-}
-
-void CompiledExpression::compileExpression(const ExpressionTreeNode& node, vector<pair<ExpressionTreeNode, int> >& temps) {
+void CompiledExpression::Program::compileExpression(const ExpressionTreeNode& node, vector<pair<ExpressionTreeNode, int> >& temps,
+        vector<vector<int> >& stepArgs, map<string, int>& variableTemps) {
     if (findTempIndex(node, temps) != -1)
         return; // We have already processed a node identical to this one.
     
@@ -77,62 +120,54 @@ void CompiledExpression::compileExpression(const ExpressionTreeNode& node, vecto
     
     vector<int> args;
     for (int i = 0; i < node.getChildren().size(); i++) {
-        compileExpression(node.getChildren()[i], temps);
+        compileExpression(node.getChildren()[i], temps, stepArgs, variableTemps);
         args.push_back(findTempIndex(node.getChildren()[i], temps));
     }
     
-    // Process this node.
+    // Process this node.  Argument indices are resolved once the final workspace layout is known.
     
     if (node.getOperation().getId() == Operation::VARIABLE) {
-        variableIndices[node.getOperation().getName()] = (int) workspace.size();
+        variableTemps[node.getOperation().getName()] = workspaceSize;
         variableNames.insert(node.getOperation().getName());
     }
     else {
-        int stepIndex = (int) arguments.size();
         arguments.push_back(vector<int>());
-        target.push_back((int) workspace.size());
+        stepArgs.push_back(args);
+        target.push_back(workspaceSize);
         operation.push_back(node.getOperation().clone());
-        if (args.size() == 0)
-            arguments[stepIndex].push_back(0); // The value won't actually be used.  We just need something there.
-        else {
-            // If the arguments are sequential, we can just pass a pointer to the first one.
-            
-            bool sequential = true;
-            for (int i = 1; i < args.size(); i++)
-                if (args[i] != args[i-1]+1)
-                    sequential = false;
-            if (sequential)
-                arguments[stepIndex].push_back(args[0]);
-            else {
-                arguments[stepIndex] = args;
-                if (args.size() > argValues.size())
-                    argValues.resize(args.size(), 0.0);
-            }
-        }
     }
-    temps.push_back(make_pair(node, workspace.size()));
-    workspace.push_back(0.0);
+    temps.push_back(make_pair(node, workspaceSize));
+    workspaceSize++;
 }
 
-int CompiledExpression::findTempIndex(const ExpressionTreeNode& node, vector<pair<ExpressionTreeNode, int> >& temps) {
+int CompiledExpression::Program::findTempIndex(const ExpressionTreeNode& node, vector<pair<ExpressionTreeNode, int> >& temps) {
     for (int i = 0; i < (int) temps.size(); i++)
         if (temps[i].first == node)
             return i;
     return -1;
 }
 
-const set<string>& CompiledExpression::getVariables() const {
-    return variableNames;
-}
-
-double& CompiledExpression::getVariableReference(const string& name) {
-    map<string, int>::iterator index = variableIndices.find(name);
-    if (index == variableIndices.end())
-        throw Exception("getVariableReference: Unknown variable '"+name+"'");
-    return workspace[index->second];
+const NativeCode* CompiledExpression::Program::getNativeCode() const {
+    if (!useNativeCode.load(memory_order_relaxed))
+        return NULL;
+    int state = nativeState.load(memory_order_acquire);
+    if (state == NativeNotCompiled) {
+        lock_guard<mutex> lock(nativeMutex);
+        state = nativeState.load(memory_order_relaxed);
+        if (state == NativeNotCompiled) {
+            nativeCode = NativeCode::compile(*this);
+            state = (nativeCode == NULL ? NativeUnavailable : NativeCompiled);
+            nativeState.store(state, memory_order_release);
+        }
+    }
+    return (state == NativeCompiled ? nativeCode : NULL);
 }
 
-double CompiledExpression::evaluate() const {
+double CompiledExpression::Program::evaluate(double* workspace, double* argValues) const {
+    const NativeCode* native = getNativeCode();
+    if (native != NULL)
+        return native->getFunction()(workspace, argValues);
+    
     // Loop over the operations and evaluate each one.
     
     for (int step = 0; step < operation.size(); step++) {
@@ -142,8 +177,254 @@ double CompiledExpression::evaluate() const {
         else {
             for (int i = 0; i < args.size(); i++)
                 argValues[i] = workspace[args[i]];
-            workspace[target[step]] = operation[step]->evaluate(&argValues[0], dummyVariables);
+            workspace[target[step]] = operation[step]->evaluate(argValues, dummyVariables);
         }
     }
-    return workspace[workspace.size()-1];
+    return workspace[resultIndex];
+}
+
+void CompiledExpression::Program::evaluateBatch(const double* const* variables, double* results, int count,
+        const BatchKernels& kernels, vector<double>& buffer, vector<const double*>& slots, double* argValues) const {
+    const int numVariables = (int) variableNames.size();
+    buffer.resize((size_t) workspaceSize*BatchBlockSize);
+    slots.resize(workspaceSize);
+    for (int start = 0; start < count; start += BatchBlockSize) {
+        const int n = (std::min)(BatchBlockSize, count-start);
+        
+        // Variables are read directly from the caller's arrays.
+        
+        for (int i = 0; i < numVariables; i++)
+            slots[i] = variables[i]+start;
+        for (int step = 0; step < (int) operation.size(); step++) {
+            const Operation& op = *operation[step];
+            const vector<int>& args = operands[step];
+            const double* a = (args.size() > 0 ? slots[args[0]] : NULL);
+            const double* b = (args.size() > 1 ? slots[args[1]] : NULL);
+            double* out = &buffer[(size_t) target[step]*BatchBlockSize];
+            slots[target[step]] = out;
+            switch (op.getId()) {
+                case Operation::CONSTANT:
+                    std::fill(out, out+n, static_cast<const Operation::Constant&>(op).getValue());
+                    break;
+                case Operation::ADD:
+                    kernels.add(a, b, out, n);
+                    break;
+                case Operation::SUBTRACT:
+                    kernels.subtract(a, b, out, n);
+                    break;
+                case Operation::MULTIPLY:
+                    kernels.multiply(a, b, out, n);
+                    break;
+                case Operation::DIVIDE:
+                    kernels.divide(a, b, out, n);
+                    break;
+                case Operation::MIN:
+                    kernels.min(a, b, out, n);
+                    break;
+                case Operation::MAX:
+                    kernels.max(a, b, out, n);
+                    break;
+                case Operation::NEGATE:
+                    kernels.negate(a, out, n);
+                    break;
+                case Operation::SQRT:
+                    kernels.sqrt(a, out, n);
+                    break;
+                case Operation::SQUARE:
+                    kernels.square(a, out, n);
+                    break;
+                case Operation::CUBE:
+                    kernels.cube(a, out, n);
+                    break;
+                case Operation::RECIPROCAL:
+                    kernels.reciprocal(a, out, n);
+                    break;
+                case Operation::STEP:
+                    kernels.step(a, out, n);
+                    break;
+                case Operation::DELTA:
+                    kernels.delta(a, out, n);
+                    break;
+                case Operation::ABS:
+                    kernels.abs(a, out, n);
+                    break;
+                case Operation::ADD_CONSTANT:
+                    kernels.addConstant(a, static_cast<const Operation::AddConstant&>(op).getValue(), out, n);
+                    break;
+                case Operation::MULTIPLY_CONSTANT:
+                    kernels.multiplyConstant(a, static_cast<const Operation::MultiplyConstant&>(op).getValue(), out, n);
+                    break;
+                case Operation::POWER_CONSTANT: {
+                    double value = static_cast<const Operation::PowerConstant&>(op).getValue();
+                    int intValue = (int) value;
+                    if (intValue == value)
+                        kernels.powerInt(a, intValue, out, n);
+                    else
+                        kernels.powerConstant(a, value, out, n);
+                    break;
+                }
+                case Operation::POWER:
+                    kernels.power(a, b, out, n);
+                    break;
+                case Operation::EXP:
+                    kernels.exp(a, out, n);
+                    break;
+                case Operation::LOG:
+                    kernels.log(a, out, n);
+                    break;
+                case Operation::SIN:
+                    kernels.sin(a, out, n);
+                    break;
+                case Operation::COS:
+                    kernels.cos(a, out, n);
+                    break;
+                case Operation::SEC:
+                    kernels.sec(a, out, n);
+                    break;
+                case Operation::CSC:
+                    kernels.csc(a, out, n);
+                    break;
+                case Operation::TAN:
+                    kernels.tan(a, out, n);
+                    break;
+                case Operation::COT:
+                    kernels.cot(a, out, n);
+                    break;
+                case Operation::ASIN:
+                    kernels.asin(a, out, n);
+                    break;
+                case Operation::ACOS:
+                    kernels.acos(a, out, n);
+                    break;
+                case Operation::ATAN:
+                    kernels.atan(a, out, n);
+                    break;
+                case Operation::SINH:
+                    kernels.sinh(a, out, n);
+                    break;
+                case Operation::COSH:
+                    kernels.cosh(a, out, n);
+                    break;
+                case Operation::TANH:
+                    kernels.tanh(a, out, n);
+                    break;
+                case Operation::ERF:
+                    kernels.erf(a, out, n);
+                    break;
+                case Operation::ERFC:
+                    kernels.erfc(a, out, n);
+                    break;
+                default:
+                    // Custom functions and any other operations without a kernel are evaluated one value at a time.
+                    
+                    for (int i = 0; i < n; i++) {
+                        for (int j = 0; j < (int) args.size(); j++)
+                            argValues[j] = slots[args[j]][i];
+                        out[i] = op.evaluate(argValues, dummyVariables);
+                    }
+            }
+        }
+        memcpy(results+start, slots[resultIndex], n*sizeof(double));
+    }
+}
+
+CompiledExpression::CompiledExpression() : program(new Program()), workspace(1, 0.0), argValues(1, 0.0) {
+}
+
+CompiledExpression::CompiledExpression(const ParsedExpression& expression) : program(new Program(expression)) {
+    workspace.resize(program->workspaceSize, 0.0);
+    argValues.resize(program->maxArguments, 0.0);
+}
+
+CompiledExpression::~CompiledExpression() {
+}
+
+CompiledExpression::CompiledExpression(const CompiledExpression& expression) {
+    *this = expression;
+}
+
+CompiledExpression& CompiledExpression::operator=(const CompiledExpression& expression) {
+    // The program is immutable, so copies share it.  Only the workspace is private to each copy.
+    
+    program = expression.program;
+    workspace = expression.workspace;
+    argValues.resize(expression.argValues.size());
+    return *this;
+}
+
+const set<string>& CompiledExpression::getVariables() const {
+    return program->variableNames;
+}
+
+int CompiledExpression::getNumVariables() const {
+    return (int) program->variableNames.size();
+}
+
+int CompiledExpression::getVariableIndex(const string& name) const {
+    map<string, int>::const_iterator index = program->variableIndices.find(name);
+    if (index == program->variableIndices.end())
+        throw Exception("getVariableIndex: Unknown variable '"+name+"'");
+    return index->second;
+}
+
+double& CompiledExpression::getVariableReference(const string& name) {
+    map<string, int>::const_iterator index = program->variableIndices.find(name);
+    if (index == program->variableIndices.end())
+        throw Exception("getVariableReference: Unknown variable '"+name+"'");
+    return workspace[index->second];
+}
+
+double CompiledExpression::evaluate() const {
+    return program->evaluate(&workspace[0], &argValues[0]);
+}
+
+bool CompiledExpression::isNativeCodeSupported() {
+    return NativeCode::isSupported();
+}
+
+bool CompiledExpression::getUseNativeCode() {
+    return useNativeCode.load(memory_order_relaxed) && NativeCode::isSupported();
+}
+
+bool CompiledExpression::setUseNativeCode(bool use) {
+    useNativeCode.store(use, memory_order_relaxed);
+    return getUseNativeCode();
+}
+
+bool CompiledExpression::hasNativeCode() const {
+    return program->getNativeCode() != NULL;
+}
+
+EvaluationContext CompiledExpression::createContext() const {
+    return EvaluationContext(*this);
+}
+
+EvaluationContext::EvaluationContext(const CompiledExpression& expression) : program(expression.program),
+        workspace(expression.program->workspaceSize, 0.0), argValues(expression.program->maxArguments, 0.0) {
+}
+
+int EvaluationContext::getNumVariables() const {
+    return program == NULL ? 0 : (int) program->variableNames.size();
+}
+
+double EvaluationContext::evaluate() {
+    return program->evaluate(&workspace[0], &argValues[0]);
+}
+
+void EvaluationContext::evaluateBatch(const double* const* variables, double* results, int count) {
+    const BatchKernels* kernels = NULL;
+    if (useVectorInstructions.load(memory_order_relaxed))
+        kernels = getAvx2BatchKernels();
+    if (kernels == NULL)
+        kernels = &getScalarBatchKernels();
+    program->evaluateBatch(variables, results, count, *kernels, batchWorkspace, batchSlots, &argValues[0]);
+}
+
+bool EvaluationContext::getUseVectorInstructions() {
+    return useVectorInstructions.load(memory_order_relaxed) && getAvx2BatchKernels() != NULL;
+}
+
+bool EvaluationContext::setUseVectorInstructions(bool use) {
+    useVectorInstructions.store(use, memory_order_relaxed);
+    return getUseVectorInstructions();
 }
@@ -0,0 +1,100 @@
+#ifndef LEPTON_COMPILED_PROGRAM_H_
+#define LEPTON_COMPILED_PROGRAM_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   Lepton                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the Lepton expression parser originating from              *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "lepton/CompiledExpression.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Lepton {
+
+struct BatchKernels;
+class NativeCode;
+
+/**
+ * The immutable part of a CompiledExpression, shared by all copies of it and by every EvaluationContext created
+ * from it.  The workspace is laid out with the variables first, in the order of variableNames, followed by the
+ * intermediate results of each step.
+ */
+
+class CompiledExpression::Program {
+public:
+    Program();
+    Program(const ParsedExpression& expression);
+    ~Program();
+    /**
+     * Evaluate the program using the given workspace, which must hold workspaceSize values with the variables
+     * already set, and a scratch array of at least maxArguments values.
+     */
+    double evaluate(double* workspace, double* argValues) const;
+    /**
+     * Get the native code for this program, generating it the first time it is requested.  Returns NULL if native
+     * code is disabled or could not be generated.
+     */
+    const NativeCode* getNativeCode() const;
+    /**
+     * Evaluate the program for count sets of variable values, one operation at a time over blocks of
+     * BatchBlockSize values.
+     */
+    void evaluateBatch(const double* const* variables, double* results, int count, const BatchKernels& kernels,
+            std::vector<double>& buffer, std::vector<const double*>& slots, double* argValues) const;
+    static const int BatchBlockSize = 256;
+    std::vector<std::vector<int> > arguments;
+    std::vector<int> target;
+    std::vector<Operation*> operation;
+    std::vector<std::vector<int> > operands; // The workspace index of every argument of each step
+    std::map<std::string, int> variableIndices;
+    std::set<std::string> variableNames;
+    int workspaceSize;
+    int maxArguments;
+    int resultIndex;
+private:
+    enum NativeState {NativeNotCompiled, NativeCompiled, NativeUnavailable};
+    mutable std::atomic<int> nativeState;
+    mutable std::mutex nativeMutex;
+    mutable NativeCode* nativeCode;
+    Program(const Program&);
+    Program& operator=(const Program&);
+    void compileExpression(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps,
+            std::vector<std::vector<int> >& stepArgs, std::map<std::string, int>& variableTemps);
+    int findTempIndex(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
+};
+
+} // namespace Lepton
+
+#endif /*LEPTON_COMPILED_PROGRAM_H_*/
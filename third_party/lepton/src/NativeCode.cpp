@@ -0,0 +1,472 @@
+/* -------------------------------------------------------------------------- *
+ *                                   Lepton                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the Lepton expression parser originating from              *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "NativeCode.h"
+#include "lepton/Operation.h"
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) && defined(__x86_64__)
+#define LEPTON_NATIVE_CODE 1
+#include <math.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace Lepton;
+using namespace std;
+
+#ifdef LEPTON_NATIVE_CODE
+
+static const map<string, double> dummyVariables;
+
+/**
+ * Called from generated code for operations that have no native lowering.  The generated code has no unwind
+ * information, so exceptions must not propagate out of it.  An operation that throws produces NaN instead.
+ */
+static double evaluateOperation(const Operation* operation, double* args) noexcept {
+    try {
+        return operation->evaluate(args, dummyVariables);
+    }
+    catch (...) {
+        return numeric_limits<double>::quiet_NaN();
+    }
+}
+
+namespace {
+
+/**
+ * A minimal x86-64 encoder for the instructions the code generator needs.  rbx holds the workspace pointer, rbp the
+ * argument scratch array, and only xmm0 and xmm1 are used for values.
+ */
+
+class Assembler {
+public:
+    // SSE2 scalar double opcodes, all encoded as F2 0F <op> /r.
+    enum ScalarOp {SQRT = 0x51, ADD = 0x58, MUL = 0x59, SUB = 0x5C, MIN = 0x5D, DIV = 0x5E, MAX = 0x5F};
+    vector<unsigned char> code;
+    void emit(unsigned char byte) {
+        code.push_back(byte);
+    }
+    void emit(const unsigned char* bytes, int count) {
+        code.insert(code.end(), bytes, bytes+count);
+    }
+    void emit32(int32_t value) {
+        unsigned char bytes[4];
+        memcpy(bytes, &value, 4);
+        emit(bytes, 4);
+    }
+    void emit64(uint64_t value) {
+        unsigned char bytes[8];
+        memcpy(bytes, &value, 8);
+        emit(bytes, 8);
+    }
+    void prologue() {
+        static const unsigned char bytes[] = {
+            0x53,                   // push rbx
+            0x55,                   // push rbp
+            0x48, 0x83, 0xEC, 0x08, // sub rsp, 8 (keeps the stack 16 byte aligned for calls)
+            0x48, 0x89, 0xFB,       // mov rbx, rdi
+            0x48, 0x89, 0xF5        // mov rbp, rsi
+        };
+        emit(bytes, sizeof(bytes));
+    }
+    void epilogue() {
+        static const unsigned char bytes[] = {
+            0x48, 0x83, 0xC4, 0x08, // add rsp, 8
+            0x5D,                   // pop rbp
+            0x5B,                   // pop rbx
+            0xC3                    // ret
+        };
+        emit(bytes, sizeof(bytes));
+    }
+    // movsd xmm, [rbx+8*slot]
+    void load(int xmm, int slot) {
+        scalarMemory(0x10, xmm, 3, 8*slot);
+    }
+    // movsd [rbx+8*slot], xmm
+    void store(int slot, int xmm) {
+        scalarMemory(0x11, xmm, 3, 8*slot);
+    }
+    // movsd [rbp+8*index], xmm
+    void storeArgument(int index, int xmm) {
+        scalarMemory(0x11, xmm, 5, 8*index);
+    }
+    // <op>sd xmm0, [rbx+8*slot]
+    void operate(ScalarOp op, int slot) {
+        scalarMemory(op, 0, 3, 8*slot);
+    }
+    // <op>sd dst, src
+    void operate(ScalarOp op, int dst, int src) {
+        unsigned char bytes[] = {0xF2, 0x0F, (unsigned char) op, (unsigned char) (0xC0 | (dst<<3) | src)};
+        emit(bytes, sizeof(bytes));
+    }
+    // mov rax, imm64; movq xmm, rax
+    void loadConstant(int xmm, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, 8);
+        loadBits(xmm, bits);
+    }
+    void loadBits(int xmm, uint64_t bits) {
+        movRax(bits);
+        unsigned char bytes[] = {0x66, 0x48, 0x0F, 0x6E, (unsigned char) (0xC0 | (xmm<<3))};
+        emit(bytes, sizeof(bytes));
+    }
+    // mov rax, imm64; mov [rbx+8*slot], rax
+    void storeConstant(int slot, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, 8);
+        movRax(bits);
+        static const unsigned char bytes[] = {0x48, 0x89, 0x83};
+        emit(bytes, sizeof(bytes));
+        emit32(8*slot);
+    }
+    // movapd xmm1, xmm0
+    void copy0To1() {
+        static const unsigned char bytes[] = {0x66, 0x0F, 0x28, 0xC8};
+        emit(bytes, sizeof(bytes));
+    }
+    // xorpd xmm0, xmm1
+    void xor01() {
+        static const unsigned char bytes[] = {0x66, 0x0F, 0x57, 0xC1};
+        emit(bytes, sizeof(bytes));
+    }
+    // andpd xmm0, xmm1
+    void and01() {
+        static const unsigned char bytes[] = {0x66, 0x0F, 0x54, 0xC1};
+        emit(bytes, sizeof(bytes));
+    }
+    // xorpd xmm1, xmm1
+    void zero1() {
+        static const unsigned char bytes[] = {0x66, 0x0F, 0x57, 0xC9};
+        emit(bytes, sizeof(bytes));
+    }
+    // cmpsd xmm1, xmm0, predicate
+    void compare10(unsigned char predicate) {
+        unsigned char bytes[] = {0xF2, 0x0F, 0xC2, 0xC8, predicate};
+        emit(bytes, sizeof(bytes));
+    }
+    // mov rdi, imm64
+    void movRdi(uint64_t value) {
+        static const unsigned char bytes[] = {0x48, 0xBF};
+        emit(bytes, sizeof(bytes));
+        emit64(value);
+    }
+    // lea rsi, [rbx+8*slot]
+    void leaRsiSlot(int slot) {
+        static const unsigned char bytes[] = {0x48, 0x8D, 0xB3};
+        emit(bytes, sizeof(bytes));
+        emit32(8*slot);
+    }
+    // mov rsi, rbp
+    void movRsiArguments() {
+        static const unsigned char bytes[] = {0x48, 0x89, 0xEE};
+        emit(bytes, sizeof(bytes));
+    }
+    // mov rax, imm64; call rax
+    void call(const void* function) {
+        movRax((uint64_t) (uintptr_t) function);
+        static const unsigned char bytes[] = {0xFF, 0xD0};
+        emit(bytes, sizeof(bytes));
+    }
+private:
+    void movRax(uint64_t value) {
+        static const unsigned char bytes[] = {0x48, 0xB8};
+        emit(bytes, sizeof(bytes));
+        emit64(value);
+    }
+    // F2 0F <op> with a [base+disp32] operand
+    void scalarMemory(unsigned char op, int xmm, int base, int32_t displacement) {
+        unsigned char bytes[] = {0xF2, 0x0F, op, (unsigned char) (0x80 | (xmm<<3) | base)};
+        emit(bytes, sizeof(bytes));
+        emit32(displacement);
+    }
+};
+
+typedef double (*MathFunction)(double);
+
+/**
+ * Get the C library function that computes a unary operation, or NULL if there is none.  The second value is true if
+ * the operation is the reciprocal of that function.
+ */
+MathFunction getMathFunction(Operation::Id id, bool& reciprocal) {
+    reciprocal = false;
+    switch (id) {
+        case Operation::EXP:
+            return ::exp;
+        case Operation::LOG:
+            return ::log;
+        case Operation::SIN:
+            return ::sin;
+        case Operation::COS:
+            return ::cos;
+        case Operation::TAN:
+            return ::tan;
+        case Operation::SEC:
+            reciprocal = true;
+            return ::cos;
+        case Operation::CSC:
+            reciprocal = true;
+            return ::sin;
+        case Operation::COT:
+            reciprocal = true;
+            return ::tan;
+        case Operation::ASIN:
+            return ::asin;
+        case Operation::ACOS:
+            return ::acos;
+        case Operation::ATAN:
+            return ::atan;
+        case Operation::SINH:
+            return ::sinh;
+        case Operation::COSH:
+            return ::cosh;
+        case Operation::TANH:
+            return ::tanh;
+        default:
+            return NULL;
+    }
+}
+
+void emitReciprocal(Assembler& as) {
+    // xmm0 = 1.0/xmm0
+    as.copy0To1();
+    as.loadConstant(0, 1.0);
+    as.operate(Assembler::DIV, 0, 1);
+}
+
+void emitGeneric(Assembler& as, const Operation& op, const vector<int>& args) {
+    bool sequential = true;
+    for (int i = 1; i < (int) args.size(); i++)
+        if (args[i] != args[i-1]+1)
+            sequential = false;
+    if (args.size() > 0 && sequential)
+        as.leaRsiSlot(args[0]);
+    else {
+        for (int i = 0; i < (int) args.size(); i++) {
+            as.load(0, args[i]);
+            as.storeArgument(i, 0);
+        }
+        as.movRsiArguments();
+    }
+    as.movRdi((uint64_t) (uintptr_t) &op);
+    as.call((const void*) evaluateOperation);
+}
+
+void emitStep(Assembler& as, const Operation& op, const vector<int>& args, int target) {
+    // Each step leaves its result in xmm0, which is then stored to the target slot.  The instruction sequences
+    // reproduce the corresponding Operation::evaluate() exactly, including the order of operands for min and max.
+    
+    switch (op.getId()) {
+        case Operation::CONSTANT:
+            as.storeConstant(target, static_cast<const Operation::Constant&>(op).getValue());
+            return;
+        case Operation::ADD:
+            as.load(0, args[0]);
+            as.operate(Assembler::ADD, args[1]);
+            break;
+        case Operation::SUBTRACT:
+            as.load(0, args[0]);
+            as.operate(Assembler::SUB, args[1]);
+            break;
+        case Operation::MULTIPLY:
+            as.load(0, args[0]);
+            as.operate(Assembler::MUL, args[1]);
+            break;
+        case Operation::DIVIDE:
+            as.load(0, args[0]);
+            as.operate(Assembler::DIV, args[1]);
+            break;
+        case Operation::MIN:
+            // std::min(a, b) returns (b < a ? b : a), which is minsd with b as the destination.
+            as.load(0, args[1]);
+            as.operate(Assembler::MIN, args[0]);
+            break;
+        case Operation::MAX:
+            // std::max(a, b) returns (a < b ? b : a), which is maxsd with b as the destination.
+            as.load(0, args[1]);
+            as.operate(Assembler::MAX, args[0]);
+            break;
+        case Operation::POWER:
+            as.load(0, args[0]);
+            as.load(1, args[1]);
+            as.call((const void*) static_cast<double (*)(double, double)>(::pow));
+            break;
+        case Operation::NEGATE:
+            as.load(0, args[0]);
+            as.loadBits(1, 0x8000000000000000ULL);
+            as.xor01();
+            break;
+        case Operation::SQRT:
+            as.load(0, args[0]);
+            as.operate(Assembler::SQRT, 0, 0);
+            break;
+        case Operation::SQUARE:
+            as.load(0, args[0]);
+            as.operate(Assembler::MUL, 0, 0);
+            break;
+        case Operation::CUBE:
+            as.load(0, args[0]);
+            as.copy0To1();
+            as.operate(Assembler::MUL, 0, 1);
+            as.operate(Assembler::MUL, 0, 1);
+            break;
+        case Operation::RECIPROCAL:
+            as.loadConstant(0, 1.0);
+            as.operate(Assembler::DIV, args[0]);
+            break;
+        case Operation::ABS:
+            as.load(0, args[0]);
+            as.loadBits(1, 0x7FFFFFFFFFFFFFFFULL);
+            as.and01();
+            break;
+        case Operation::STEP:
+        case Operation::DELTA:
+            // xmm1 = (0 <= x) or (0 == x) as a mask, then select 1.0 with it.
+            as.load(0, args[0]);
+            as.zero1();
+            as.compare10(op.getId() == Operation::STEP ? 2 : 0);
+            as.loadConstant(0, 1.0);
+            as.and01();
+            break;
+        case Operation::ADD_CONSTANT:
+            as.load(0, args[0]);
+            as.loadConstant(1, static_cast<const Operation::AddConstant&>(op).getValue());
+            as.operate(Assembler::ADD, 0, 1);
+            break;
+        case Operation::MULTIPLY_CONSTANT:
+            as.load(0, args[0]);
+            as.loadConstant(1, static_cast<const Operation::MultiplyConstant&>(op).getValue());
+            as.operate(Assembler::MUL, 0, 1);
+            break;
+        case Operation::POWER_CONSTANT: {
+            double value = static_cast<const Operation::PowerConstant&>(op).getValue();
+            int exponent = (int) value;
+            if (exponent == value) {
+                // Unroll the same square-and-multiply sequence used by PowerConstant, with xmm1 as the base.
+                
+                as.load(1, args[0]);
+                if (exponent < 0) {
+                    exponent = -exponent;
+                    as.loadConstant(0, 1.0);
+                    as.operate(Assembler::DIV, 0, 1);
+                    as.copy0To1();
+                }
+                as.loadConstant(0, 1.0);
+                while (exponent != 0) {
+                    if ((exponent&1) == 1)
+                        as.operate(Assembler::MUL, 0, 1);
+                    exponent = exponent>>1;
+                    if (exponent != 0)
+                        as.operate(Assembler::MUL, 1, 1);
+                }
+            }
+            else {
+                as.load(0, args[0]);
+                as.loadConstant(1, value);
+                as.call((const void*) static_cast<double (*)(double, double)>(::pow));
+            }
+            break;
+        }
+        default: {
+            bool reciprocal;
+            MathFunction function = getMathFunction(op.getId(), reciprocal);
+            if (function != NULL) {
+                as.load(0, args[0]);
+                as.call((const void*) function);
+                if (reciprocal)
+                    emitReciprocal(as);
+            }
+            else
+                emitGeneric(as, op, args);
+        }
+    }
+    as.store(target, 0);
+}
+
+} // namespace
+
+bool NativeCode::isSupported() {
+    return true;
+}
+
+NativeCode* NativeCode::compile(const CompiledExpression::Program& program) {
+    Assembler as;
+    as.prologue();
+    for (int step = 0; step < (int) program.operation.size(); step++)
+        emitStep(as, *program.operation[step], program.operands[step], program.target[step]);
+    as.load(0, program.resultIndex);
+    as.epilogue();
+    
+    // Copy the code into its own pages, which are never writable and executable at the same time.
+    
+    size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    size_t size = (as.code.size()+pageSize-1)/pageSize*pageSize;
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return NULL;
+    memcpy(memory, &as.code[0], as.code.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return NULL;
+    }
+    return new NativeCode(memory, size);
+}
+
+NativeCode::NativeCode(void* memory, size_t size) : memory(memory), size(size) {
+    function = reinterpret_cast<Function>(memory);
+}
+
+NativeCode::~NativeCode() {
+    munmap(memory, size);
+}
+
+#else
+
+bool NativeCode::isSupported() {
+    return false;
+}
+
+NativeCode* NativeCode::compile(const CompiledExpression::Program& program) {
+    return NULL;
+}
+
+NativeCode::NativeCode(void* memory, size_t size) : memory(memory), size(size), function(NULL) {
+}
+
+NativeCode::~NativeCode() {
+}
+
+#endif
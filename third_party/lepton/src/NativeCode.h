@@ -0,0 +1,83 @@
+#ifndef LEPTON_NATIVE_CODE_H_
+#define LEPTON_NATIVE_CODE_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   Lepton                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the Lepton expression parser originating from              *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CompiledProgram.h"
+#include <cstddef>
+
+namespace Lepton {
+
+/**
+ * Machine code generated from a CompiledExpression::Program.  The generated function has the same effect as
+ * Program::evaluate(): it reads the variables from the workspace, stores every intermediate result back into it, and
+ * returns the final value.
+ *
+ * Arithmetic is done with scalar SSE2 instructions and the common math functions are called directly in the C
+ * library, so the results are identical to the interpreter.  Operations without a native lowering, such as custom
+ * functions, are evaluated by calling back into Operation::evaluate().
+ *
+ * Native code is only generated on x86-64 Linux.
+ */
+
+class NativeCode {
+public:
+    typedef double (*Function)(double* workspace, double* argValues);
+    ~NativeCode();
+    /**
+     * Get whether native code can be generated on this platform.
+     */
+    static bool isSupported();
+    /**
+     * Generate native code for a program.
+     *
+     * @return the generated code, or NULL if it could not be generated
+     */
+    static NativeCode* compile(const CompiledExpression::Program& program);
+    Function getFunction() const {
+        return function;
+    }
+    size_t getSize() const {
+        return size;
+    }
+private:
+    NativeCode(void* memory, size_t size);
+    NativeCode(const NativeCode&);
+    NativeCode& operator=(const NativeCode&);
+    void* memory;
+    size_t size;
+    Function function;
+};
+
+} // namespace Lepton
+
+#endif /*LEPTON_NATIVE_CODE_H_*/
@@ -62,13 +62,6 @@ Rotation is separate from addition to prevent recomputation.
     }
 
 const ByteT MD5::PADDING[64] = { 0x80 };
-const char MD5::HEX[16] = {
-    '0', '1', '2', '3',
-    '4', '5', '6', '7',
-    '8', '9', 'a', 'b',
-    'c', 'd', 'e', 'f'
-};
-
 /* Default construct. */
 MD5::MD5()
 {
@@ -334,23 +327,20 @@ void MD5::decode(const ByteT* input, U32T* output, size_t length)
     }
 }
 
-/* Convert byte array to hex string. */
-string MD5::bytesToHexString(const ByteT* input, size_t length)
+/* Convert digest to string value */
+string MD5::toString()
 {
-    string str;
-    str.reserve(length << 1);
-    for (size_t i = 0; i < length; i++) {
-        int t = input[i];
-        int a = t / 16;
-        int b = t % 16;
-        str.append(1, HEX[a]);
-        str.append(1, HEX[b]);
-    }
+    string str(32, '\0');
+    digestToHex(digest(), &str[0]);
     return str;
 }
 
-/* Convert digest to string value */
-string MD5::toString()
+/* Convert a 16 byte digest to hex. */
+void md5::digestToHex(const ByteT* digest, char* output)
 {
-    return bytesToHexString(digest(), 16);
-}
\ No newline at end of file
+    static const char HEX[] = "0123456789abcdef";
+    for (size_t i = 0; i < 16; i++) {
+        output[2 * i] = HEX[digest[i] >> 4];
+        output[2 * i + 1] = HEX[digest[i] & 0x0f];
+    }
+}
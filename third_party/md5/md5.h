@@ -37,11 +37,6 @@ private:
     void transform(const ByteT block[64]);
     void encode(const U32T* input, ByteT* output, size_t length);
     void decode(const ByteT* input, U32T* output, size_t length);
-    string bytesToHexString(const ByteT* input, size_t length);
-
-    /* class uncopyable */
-    MD5(const MD5&);
-    MD5& operator=(const MD5&);
 
 private:
     U32T _state[4]; /* state (ABCD) */
@@ -51,10 +46,26 @@ private:
     bool _finished; /* calculate finished ? */
 
     static const ByteT PADDING[64]; /* padding for calculate */
-    static const char HEX[16];
     static const size_t BUFFER_SIZE = 1024;
 };
 
+/* Write the 32 lowercase hex characters of a 16 byte digest to output.
+ * No allocation, output is not null terminated.
+ */
+void digestToHex(const ByteT* digest, char* output);
+
+/* Number of messages digestMulti hashes at once on this processor:
+ * 8 with AVX2, 4 with SSE2, otherwise 1.
+ */
+size_t multiLanes();
+
+/* Multi-buffer MD5. Hashes count independent messages, one per SIMD lane,
+ * and writes the digest of messages[i] to digests + 16 * i. Every digest
+ * is identical to MD5(messages[i]).digest().
+ * lanes limits the width (1, 4 or 8), 0 uses multiLanes().
+ */
+void digestMulti(const std::string_view* messages, size_t count, ByteT* digests, size_t lanes = 0);
+
 }
 
 #endif /*MD5_H*/
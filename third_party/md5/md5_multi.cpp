@@ -0,0 +1,416 @@
+#include "md5.h"
+#include <cstring>
+
+using namespace md5;
+
+/* Multi-buffer MD5.
+ *
+ * Each SIMD lane hashes its own message: lane l of every vector holds the
+ * state or message word of the message in lane l, so the 64 steps of a
+ * block run once for Lanes messages. When a lane finishes its message it
+ * is refilled with the next one, so messages of different lengths keep
+ * all lanes busy.
+ *
+ * The kernels use GCC vector extensions (__builtin_shuffle is GCC only)
+ * and are compiled for SSE2 and AVX2 through function target attributes,
+ * the processor is checked at runtime.
+ */
+
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define MD5_MULTI_SIMD
+#endif
+
+namespace {
+
+/* Process every message with the scalar MD5. */
+void digestScalar(const std::string_view* messages, size_t count, ByteT* digests)
+{
+    for (size_t i = 0; i < count; i++) {
+        MD5 md5(messages[i]);
+        memcpy(digests + 16 * i, md5.digest(), 16);
+    }
+}
+
+#ifdef MD5_MULTI_SIMD
+
+/* The 8 lane helpers pass vectors by value but are all inlined into the
+ * AVX2 kernel, the ABI of out of line calls does not matter.
+ */
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+typedef U32T V4 __attribute__((vector_size(16)));
+typedef U32T V8 __attribute__((vector_size(32)));
+
+/* Basic MD5 functions in the form with the fewest operations. */
+template <class V>
+inline V F(V x, V y, V z) { return z ^ (x & (y ^ z)); }
+template <class V>
+inline V G(V x, V y, V z) { return y ^ (z & (x ^ y)); }
+template <class V>
+inline V H(V x, V y, V z) { return x ^ y ^ z; }
+template <class V>
+inline V I(V x, V y, V z) { return y ^ (x | ~z); }
+
+template <int S, class V>
+inline V rotateLeft(V x) { return (x << S) | (x >> (32 - S)); }
+
+/* The sine constants, each repeated for all 8 lanes so that a step adds
+ * it from memory instead of broadcasting it first.
+ */
+struct Sines {
+    alignas(32) U32T t[64][8];
+};
+
+constexpr Sines makeSines()
+{
+    const U32T sines[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+        0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+        0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+        0xd62f105d, 0x2441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+        0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+        0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x4881d05,
+        0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+        0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+        0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+    };
+    Sines table {};
+    for (int i = 0; i < 64; i++)
+        for (int l = 0; l < 8; l++)
+            table.t[i][l] = sines[i];
+    return table;
+}
+
+constexpr Sines SINES = makeSines();
+
+template <class V>
+inline V sine(const Sines* sines, int i)
+{
+    V t;
+    memcpy(&t, sines->t[i], sizeof(V));
+    return t;
+}
+
+#define STEP(f, a, b, c, d, x, s, i) \
+    (a) = (b) + rotateLeft<s>((a) + f((b), (c), (d)) + (x) + sine<V>(sines, i))
+
+/* Load a block of every lane and transpose it, so that x[i] holds
+ * word i of every lane.
+ */
+inline void loadBlock(const ByteT* const* blocks, V4 x[16])
+{
+    for (int i = 0; i < 4; i++) {
+        V4 r0, r1, r2, r3;
+        memcpy(&r0, blocks[0] + 16 * i, 16);
+        memcpy(&r1, blocks[1] + 16 * i, 16);
+        memcpy(&r2, blocks[2] + 16 * i, 16);
+        memcpy(&r3, blocks[3] + 16 * i, 16);
+
+        V4 t0 = __builtin_shuffle(r0, r1, V4 { 0, 4, 1, 5 });
+        V4 t1 = __builtin_shuffle(r0, r1, V4 { 2, 6, 3, 7 });
+        V4 t2 = __builtin_shuffle(r2, r3, V4 { 0, 4, 1, 5 });
+        V4 t3 = __builtin_shuffle(r2, r3, V4 { 2, 6, 3, 7 });
+        x[4 * i] = __builtin_shuffle(t0, t2, V4 { 0, 1, 4, 5 });
+        x[4 * i + 1] = __builtin_shuffle(t0, t2, V4 { 2, 3, 6, 7 });
+        x[4 * i + 2] = __builtin_shuffle(t1, t3, V4 { 0, 1, 4, 5 });
+        x[4 * i + 3] = __builtin_shuffle(t1, t3, V4 { 2, 3, 6, 7 });
+    }
+}
+
+/* Transpose 4 rows of lanes within each 128 bit half, half h of u[i] then
+ * holds word 4 * h + i of the 4 lanes.
+ */
+inline void transposeHalves(const V8 r[4], V8 u[4])
+{
+    V8 t0 = __builtin_shuffle(r[0], r[1], V8 { 0, 8, 1, 9, 4, 12, 5, 13 });
+    V8 t1 = __builtin_shuffle(r[0], r[1], V8 { 2, 10, 3, 11, 6, 14, 7, 15 });
+    V8 t2 = __builtin_shuffle(r[2], r[3], V8 { 0, 8, 1, 9, 4, 12, 5, 13 });
+    V8 t3 = __builtin_shuffle(r[2], r[3], V8 { 2, 10, 3, 11, 6, 14, 7, 15 });
+    u[0] = __builtin_shuffle(t0, t2, V8 { 0, 1, 8, 9, 4, 5, 12, 13 });
+    u[1] = __builtin_shuffle(t0, t2, V8 { 2, 3, 10, 11, 6, 7, 14, 15 });
+    u[2] = __builtin_shuffle(t1, t3, V8 { 0, 1, 8, 9, 4, 5, 12, 13 });
+    u[3] = __builtin_shuffle(t1, t3, V8 { 2, 3, 10, 11, 6, 7, 14, 15 });
+}
+
+inline void loadBlock(const ByteT* const* blocks, V8 x[16])
+{
+    for (int i = 0; i < 2; i++) {
+        V8 r[8], low[4], high[4];
+        for (int l = 0; l < 8; l++)
+            memcpy(&r[l], blocks[l] + 32 * i, 32);
+        transposeHalves(r, low);
+        transposeHalves(r + 4, high);
+
+        for (int j = 0; j < 4; j++) {
+            x[8 * i + j] = __builtin_shuffle(low[j], high[j], V8 { 0, 1, 2, 3, 8, 9, 10, 11 });
+            x[8 * i + j + 4] = __builtin_shuffle(low[j], high[j], V8 { 4, 5, 6, 7, 12, 13, 14, 15 });
+        }
+    }
+}
+
+/* MD5 basic transformation of count consecutive blocks per lane.
+ * state holds A, B, C and D of every lane in turn, blocks[l] is advanced
+ * past the blocks of lane l.
+ */
+template <class V, size_t Lanes>
+inline void transform(U32T* state, const ByteT** blocks, size_t count)
+{
+    /* Hide the table from constant folding, otherwise GCC broadcasts every
+     * constant from an immediate in each block again.
+     */
+    const Sines* sines = &SINES;
+    __asm__("" : "+r"(sines));
+
+    V a, b, c, d, x[16];
+    memcpy(&a, state, sizeof(V));
+    memcpy(&b, state + Lanes, sizeof(V));
+    memcpy(&c, state + 2 * Lanes, sizeof(V));
+    memcpy(&d, state + 3 * Lanes, sizeof(V));
+
+    for (; count > 0; count--) {
+        loadBlock(blocks, x);
+        for (size_t l = 0; l < Lanes; l++)
+            blocks[l] += 64;
+
+        V aa = a, bb = b, cc = c, dd = d;
+
+        /* Round 1 */
+        STEP(F, a, b, c, d, x[0], 7, 0);
+        STEP(F, d, a, b, c, x[1], 12, 1);
+        STEP(F, c, d, a, b, x[2], 17, 2);
+        STEP(F, b, c, d, a, x[3], 22, 3);
+        STEP(F, a, b, c, d, x[4], 7, 4);
+        STEP(F, d, a, b, c, x[5], 12, 5);
+        STEP(F, c, d, a, b, x[6], 17, 6);
+        STEP(F, b, c, d, a, x[7], 22, 7);
+        STEP(F, a, b, c, d, x[8], 7, 8);
+        STEP(F, d, a, b, c, x[9], 12, 9);
+        STEP(F, c, d, a, b, x[10], 17, 10);
+        STEP(F, b, c, d, a, x[11], 22, 11);
+        STEP(F, a, b, c, d, x[12], 7, 12);
+        STEP(F, d, a, b, c, x[13], 12, 13);
+        STEP(F, c, d, a, b, x[14], 17, 14);
+        STEP(F, b, c, d, a, x[15], 22, 15);
+
+        /* Round 2 */
+        STEP(G, a, b, c, d, x[1], 5, 16);
+        STEP(G, d, a, b, c, x[6], 9, 17);
+        STEP(G, c, d, a, b, x[11], 14, 18);
+        STEP(G, b, c, d, a, x[0], 20, 19);
+        STEP(G, a, b, c, d, x[5], 5, 20);
+        STEP(G, d, a, b, c, x[10], 9, 21);
+        STEP(G, c, d, a, b, x[15], 14, 22);
+        STEP(G, b, c, d, a, x[4], 20, 23);
+        STEP(G, a, b, c, d, x[9], 5, 24);
+        STEP(G, d, a, b, c, x[14], 9, 25);
+        STEP(G, c, d, a, b, x[3], 14, 26);
+        STEP(G, b, c, d, a, x[8], 20, 27);
+        STEP(G, a, b, c, d, x[13], 5, 28);
+        STEP(G, d, a, b, c, x[2], 9, 29);
+        STEP(G, c, d, a, b, x[7], 14, 30);
+        STEP(G, b, c, d, a, x[12], 20, 31);
+
+        /* Round 3 */
+        STEP(H, a, b, c, d, x[5], 4, 32);
+        STEP(H, d, a, b, c, x[8], 11, 33);
+        STEP(H, c, d, a, b, x[11], 16, 34);
+        STEP(H, b, c, d, a, x[14], 23, 35);
+        STEP(H, a, b, c, d, x[1], 4, 36);
+        STEP(H, d, a, b, c, x[4], 11, 37);
+        STEP(H, c, d, a, b, x[7], 16, 38);
+        STEP(H, b, c, d, a, x[10], 23, 39);
+        STEP(H, a, b, c, d, x[13], 4, 40);
+        STEP(H, d, a, b, c, x[0], 11, 41);
+        STEP(H, c, d, a, b, x[3], 16, 42);
+        STEP(H, b, c, d, a, x[6], 23, 43);
+        STEP(H, a, b, c, d, x[9], 4, 44);
+        STEP(H, d, a, b, c, x[12], 11, 45);
+        STEP(H, c, d, a, b, x[15], 16, 46);
+        STEP(H, b, c, d, a, x[2], 23, 47);
+
+        /* Round 4 */
+        STEP(I, a, b, c, d, x[0], 6, 48);
+        STEP(I, d, a, b, c, x[7], 10, 49);
+        STEP(I, c, d, a, b, x[14], 15, 50);
+        STEP(I, b, c, d, a, x[5], 21, 51);
+        STEP(I, a, b, c, d, x[12], 6, 52);
+        STEP(I, d, a, b, c, x[3], 10, 53);
+        STEP(I, c, d, a, b, x[10], 15, 54);
+        STEP(I, b, c, d, a, x[1], 21, 55);
+        STEP(I, a, b, c, d, x[8], 6, 56);
+        STEP(I, d, a, b, c, x[15], 10, 57);
+        STEP(I, c, d, a, b, x[6], 15, 58);
+        STEP(I, b, c, d, a, x[13], 21, 59);
+        STEP(I, a, b, c, d, x[4], 6, 60);
+        STEP(I, d, a, b, c, x[11], 10, 61);
+        STEP(I, c, d, a, b, x[2], 15, 62);
+        STEP(I, b, c, d, a, x[9], 21, 63);
+
+        a += aa;
+        b += bb;
+        c += cc;
+        d += dd;
+    }
+
+    memcpy(state, &a, sizeof(V));
+    memcpy(state + Lanes, &b, sizeof(V));
+    memcpy(state + 2 * Lanes, &c, sizeof(V));
+    memcpy(state + 3 * Lanes, &d, sizeof(V));
+}
+
+#undef STEP
+
+/* flatten inlines the whole kernel, so it is generated for the target ISA. */
+__attribute__((target("sse2"), flatten)) void transformSse2(U32T* state, const ByteT** blocks, size_t count)
+{
+    transform<V4, 4>(state, blocks, count);
+}
+
+__attribute__((target("avx2"), flatten)) void transformAvx2(U32T* state, const ByteT** blocks, size_t count)
+{
+    transform<V8, 8>(state, blocks, count);
+}
+
+/* Longest run of blocks per kernel call, an idle lane reads as many
+ * blocks from ZEROS.
+ */
+const size_t MAX_RUN = 16;
+const ByteT ZEROS[64 * MAX_RUN] = {};
+
+/* Lane scheduler. A message is fed to its lane as the full blocks read
+ * in place followed by one or two padded blocks in tail. A lane that
+ * finished its message takes the next one. Only built for x86, so the
+ * length and the digest are stored little-endian by memcpy.
+ */
+template <size_t Lanes>
+void digestLanes(void (*kernel)(U32T*, const ByteT**, size_t),
+    const std::string_view* messages, size_t count, ByteT* digests)
+{
+    struct Lane {
+        size_t message;
+        size_t blocks; /* blocks left in the current segment */
+        bool tailing; /* current segment is tail */
+        bool idle;
+        ByteT tail[128];
+    } lanes[Lanes];
+
+    U32T state[4 * Lanes];
+    const ByteT* blocks[Lanes];
+    size_t next = 0;
+
+    /* Start the next message in lane l, or mark it idle. */
+    auto refill = [&](size_t l) {
+        Lane& lane = lanes[l];
+        if (next == count) {
+            lane.idle = true;
+            return;
+        }
+
+        lane.message = next++;
+        lane.idle = false;
+        state[l] = 0x67452301;
+        state[Lanes + l] = 0xefcdab89;
+        state[2 * Lanes + l] = 0x98badcfe;
+        state[3 * Lanes + l] = 0x10325476;
+
+        const std::string_view& message = messages[lane.message];
+        size_t full = message.size() / 64, rest = message.size() % 64;
+        size_t tailBlocks = rest < 56 ? 1 : 2;
+        uint64_t bits = (uint64_t)message.size() << 3;
+
+        if (rest > 0)
+            memcpy(lane.tail, message.data() + 64 * full, rest);
+        lane.tail[rest] = 0x80;
+        memset(lane.tail + rest + 1, 0, 64 * tailBlocks - 8 - rest - 1);
+        memcpy(lane.tail + 64 * tailBlocks - 8, &bits, 8);
+
+        if (full > 0) {
+            lane.tailing = false;
+            lane.blocks = full;
+            blocks[l] = (const ByteT*)message.data();
+        } else {
+            lane.tailing = true;
+            lane.blocks = tailBlocks;
+            blocks[l] = lane.tail;
+        }
+    };
+
+    for (size_t l = 0; l < Lanes; l++)
+        refill(l);
+
+    for (;;) {
+        size_t run = MAX_RUN;
+        bool active = false;
+        for (size_t l = 0; l < Lanes; l++) {
+            if (lanes[l].idle) {
+                blocks[l] = ZEROS;
+            } else {
+                active = true;
+                if (lanes[l].blocks < run)
+                    run = lanes[l].blocks;
+            }
+        }
+        if (!active)
+            break;
+
+        kernel(state, blocks, run);
+
+        for (size_t l = 0; l < Lanes; l++) {
+            Lane& lane = lanes[l];
+            if (lane.idle || (lane.blocks -= run) > 0)
+                continue;
+
+            if (!lane.tailing) {
+                const std::string_view& message = messages[lane.message];
+                lane.tailing = true;
+                lane.blocks = message.size() % 64 < 56 ? 1 : 2;
+                blocks[l] = lane.tail;
+                continue;
+            }
+
+            ByteT* digest = digests + 16 * lane.message;
+            for (int i = 0; i < 4; i++)
+                memcpy(digest + 4 * i, &state[i * Lanes + l], 4);
+            refill(l);
+        }
+    }
+}
+
+#endif
+
+}
+
+size_t md5::multiLanes()
+{
+#ifdef MD5_MULTI_SIMD
+    static const size_t lanes = __builtin_cpu_supports("avx2") ? 8 : __builtin_cpu_supports("sse2") ? 4 : 1;
+    return lanes;
+#else
+    return 1;
+#endif
+}
+
+void md5::digestMulti(const std::string_view* messages, size_t count, ByteT* digests, size_t lanes)
+{
+    if (lanes == 0 || lanes > multiLanes())
+        lanes = multiLanes();
+
+#ifdef MD5_MULTI_SIMD
+    if (lanes >= 8) {
+        digestLanes<8>(transformAvx2, messages, count, digests);
+        return;
+    }
+    if (lanes >= 4) {
+        digestLanes<4>(transformSse2, messages, count, digests);
+        return;
+    }
+#endif
+    digestScalar(messages, count, digests);
+}
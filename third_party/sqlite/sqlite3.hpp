@@ -20,16 +20,22 @@ extern "C" {
 #include "sqlite3.h"
 }
 
+#include <algorithm>
 #include <cfloat>
 #include <cinttypes>
 
 #include <exception>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace sqlite {
 
@@ -51,6 +57,76 @@ struct database_connect {
     }
 };
 
+/**
+ * @brief 二进制列数据的只读视图
+ * 与column_text_view一致，仅在下一次step、reset或finalize之前有效
+ */
+struct blob_view {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    const uint8_t* begin() const noexcept { return data; }
+    const uint8_t* end() const noexcept { return data + size; }
+    bool empty() const noexcept { return size == 0; }
+};
+
+class stmt_manager;
+
+namespace detail {
+
+template <class T>
+struct is_optional : std::false_type {
+};
+
+template <class T>
+struct is_optional<std::optional<T>> : std::true_type {
+};
+
+template <class T>
+struct dependent_false : std::false_type {
+};
+
+template <class Class, class Member>
+Class member_class(Member Class::*);
+
+template <auto First, auto... Rest>
+struct first_value {
+    static constexpr auto value = First;
+};
+
+template <class Tuple, size_t... I>
+Tuple decode_tuple(const stmt_manager& stmt, std::index_sequence<I...>) noexcept;
+
+}
+
+/**
+ * @brief 编译期列映射
+ * 将结果集的第N列解码到第N个成员指针所指的成员，例如：
+ * sqlite::columns<&Record::itemId, &Record::itemName>
+ * 成员类型可以是整数、浮点数、std::string、std::string_view、blob_view或其std::optional
+ */
+template <auto... Members>
+struct columns {
+    static_assert(sizeof...(Members) > 0, "columns requires at least one member");
+
+    using row_type = decltype(detail::member_class(detail::first_value<Members...>::value));
+
+    static row_type decode(const stmt_manager& stmt) noexcept;
+};
+
+/**
+ * @brief 将结果集的第N列解码到tuple的第N个元素
+ */
+template <class Tuple>
+struct tuple_columns {
+    using row_type = Tuple;
+
+    static row_type decode(const stmt_manager& stmt) noexcept;
+};
+
+template <class Decoder>
+class row_range;
+
 class stmt_manager {
 private:
     friend class database_manager;
@@ -122,6 +198,14 @@ private:
             : false;
     }
 
+    template <class... Args>
+    bool bind_recur(int32_t which, std::nullptr_t, Args&&... args) const noexcept
+    {
+        return (sqlite3_bind_null(m_stmt.get(), which) == SQLITE_OK)
+            ? bind_recur(which + 1, std::forward<decltype(args)>(args)...)
+            : false;
+    }
+
     template <class... Args>
     bool bind_recur(const int32_t) const noexcept { return true; }
     /* bind recur end */
@@ -147,6 +231,41 @@ public:
         return (m_status != status::ok) ? false : this->bind_recur(1, std::forward<decltype(args)>(args)...);
     }
 
+    /**
+     * @brief 从指定位置开始绑定参数
+     * @param first 第一个参数的位置（从1开始）
+     */
+    template <class... Args>
+    bool bind_at(int32_t first, Args&&... args) const noexcept
+    {
+        return (m_status != status::ok) ? false : this->bind_recur(first, std::forward<decltype(args)>(args)...);
+    }
+
+    /**
+     * @brief 从指定位置开始依次绑定tuple（或pair、array）中的元素
+     */
+    template <class Tuple>
+    bool bind_tuple(int32_t first, const Tuple& row) const noexcept
+    {
+        return std::apply([this, first](const auto&... values) { return this->bind_at(first, values...); }, row);
+    }
+
+    /**
+     * @brief 重置语句以便再次执行，已绑定的参数保持不变
+     */
+    bool reset() const noexcept
+    {
+        return (m_status != status::ok) ? false : sqlite3_reset(m_stmt.get()) == SQLITE_OK;
+    }
+
+    /**
+     * @brief 清除全部已绑定的参数
+     */
+    bool clear_bindings() const noexcept
+    {
+        return (m_status != status::ok) ? false : sqlite3_clear_bindings(m_stmt.get()) == SQLITE_OK;
+    }
+
     /**
      * @brief 单步执行
      *
@@ -188,11 +307,119 @@ public:
         return (m_status != status::ok) ? 0 : sqlite3_column_double(m_stmt.get(), iCol);
     }
 
+    /**
+     * @brief 取文本列
+     * 若列为NULL则返回空字符串
+     */
     std::string column_text(const int32_t iCol) const noexcept
     {
-        return (m_status != status::ok) ? std::string() : std::string(reinterpret_cast<const char*>(sqlite3_column_text(m_stmt.get(), iCol)));
+        return std::string(column_text_view(iCol));
+    }
+
+    /**
+     * @brief 取文本列的只读视图，不产生拷贝
+     * 返回的视图仅在下一次step、reset或finalize之前有效；若列为NULL则返回空视图
+     */
+    std::string_view column_text_view(const int32_t iCol) const noexcept
+    {
+        if (m_status != status::ok) {
+            return std::string_view();
+        }
+
+        //必须先取内容再取长度，否则长度可能对应类型转换前的值
+        auto text = reinterpret_cast<const char*>(sqlite3_column_text(m_stmt.get(), iCol));
+        return text ? std::string_view(text, sqlite3_column_bytes(m_stmt.get(), iCol)) : std::string_view();
     }
 
+    /**
+     * @brief 取二进制列的只读视图，不产生拷贝
+     * 返回的视图仅在下一次step、reset或finalize之前有效；若列为NULL则返回空视图
+     */
+    blob_view column_blob(const int32_t iCol) const noexcept
+    {
+        if (m_status != status::ok) {
+            return blob_view();
+        }
+
+        auto data = reinterpret_cast<const uint8_t*>(sqlite3_column_blob(m_stmt.get(), iCol));
+        return data ? blob_view { data, static_cast<size_t>(sqlite3_column_bytes(m_stmt.get(), iCol)) } : blob_view();
+    }
+
+    /**
+     * @brief 取列的数据类型
+     *
+     * @return int32_t SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB 或 SQLITE_NULL
+     */
+    int32_t column_type(const int32_t iCol) const noexcept
+    {
+        return (m_status != status::ok) ? SQLITE_NULL : sqlite3_column_type(m_stmt.get(), iCol);
+    }
+
+    bool column_is_null(const int32_t iCol) const noexcept
+    {
+        return column_type(iCol) == SQLITE_NULL;
+    }
+
+    /**
+     * @brief 按类型取列
+     * T可以是整数、浮点数、std::string、std::string_view、blob_view，
+     * 或以上类型的std::optional（列为NULL时为std::nullopt）
+     */
+    template <class T>
+    T column(const int32_t iCol) const noexcept
+    {
+        if constexpr (detail::is_optional<T>::value) {
+            return column_is_null(iCol) ? T() : T(column<typename T::value_type>(iCol));
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return column_int64(iCol) != 0;
+        } else if constexpr (std::is_integral_v<T>) {
+            return static_cast<T>(column_int64(iCol));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return static_cast<T>(column_double(iCol));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            return column_text(iCol);
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            return column_text_view(iCol);
+        } else if constexpr (std::is_same_v<T, blob_view>) {
+            return column_blob(iCol);
+        } else {
+            static_assert(detail::dependent_false<T>::value, "unsupported column type");
+        }
+    }
+
+    /**
+     * @brief 将当前行解码为tuple
+     */
+    template <class Tuple>
+    Tuple read() const noexcept
+    {
+        return tuple_columns<Tuple>::decode(*this);
+    }
+
+    /**
+     * @brief 按编译期列映射将当前行解码为结构体
+     */
+    template <auto... Members>
+    auto read(columns<Members...>) const noexcept
+    {
+        return columns<Members...>::decode(*this);
+    }
+
+    /**
+     * @brief 逐行遍历结果集并解码为tuple
+     * 每次迭代执行一次step，遇到SQLITE_ROW以外的结果即结束
+     * 若tuple中含有std::string_view或blob_view，其仅在迭代到下一行之前有效
+     */
+    template <class Tuple>
+    row_range<tuple_columns<Tuple>> rows() const noexcept;
+
+    /**
+     * @brief 逐行遍历结果集并按编译期列映射解码为结构体
+     * 参照：rows<Tuple>()
+     */
+    template <auto... Members>
+    row_range<columns<Members...>> rows(columns<Members...>) const noexcept;
+
     /**
      * @brief 取列总数
      *
@@ -215,6 +442,102 @@ public:
     }
 };
 
+template <auto... Members>
+typename columns<Members...>::row_type columns<Members...>::decode(const stmt_manager& stmt) noexcept
+{
+    row_type row {};
+    int32_t iCol = 0;
+    ((row.*Members = stmt.column<std::decay_t<decltype(row.*Members)>>(iCol++)), ...);
+    return row;
+}
+
+template <class Tuple, size_t... I>
+Tuple detail::decode_tuple(const stmt_manager& stmt, std::index_sequence<I...>) noexcept
+{
+    return Tuple { stmt.column<std::tuple_element_t<I, Tuple>>(static_cast<int32_t>(I))... };
+}
+
+template <class Tuple>
+Tuple tuple_columns<Tuple>::decode(const stmt_manager& stmt) noexcept
+{
+    return detail::decode_tuple<Tuple>(stmt, std::make_index_sequence<std::tuple_size_v<Tuple>>());
+}
+
+/**
+ * @brief 结果集的逐行视图
+ * 通过stmt_manager::rows取得，生命周期不能超过对应的stmt_manager
+ */
+template <class Decoder>
+class row_range {
+public:
+    using value_type = typename Decoder::row_type;
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = typename Decoder::row_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        iterator() noexcept = default;
+
+        explicit iterator(const stmt_manager* stmt) noexcept
+            : m_stmt(stmt)
+        {
+            this->advance();
+        }
+
+        reference operator*() const noexcept { return m_row; }
+        pointer operator->() const noexcept { return &m_row; }
+
+        iterator& operator++() noexcept
+        {
+            this->advance();
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const noexcept { return m_stmt == other.m_stmt; }
+        bool operator!=(const iterator& other) const noexcept { return m_stmt != other.m_stmt; }
+
+    private:
+        const stmt_manager* m_stmt = nullptr;
+        value_type m_row {};
+
+        void advance() noexcept
+        {
+            if (m_stmt->step() == SQLITE_ROW) {
+                m_row = Decoder::decode(*m_stmt);
+            } else {
+                m_stmt = nullptr;
+            }
+        }
+    };
+
+    explicit row_range(const stmt_manager* stmt) noexcept
+        : m_stmt(stmt)
+    {
+    }
+
+    iterator begin() const noexcept { return iterator(m_stmt); }
+    iterator end() const noexcept { return iterator(); }
+
+private:
+    const stmt_manager* m_stmt;
+};
+
+template <class Tuple>
+row_range<tuple_columns<Tuple>> stmt_manager::rows() const noexcept
+{
+    return row_range<tuple_columns<Tuple>>(this);
+}
+
+template <auto... Members>
+row_range<columns<Members...>> stmt_manager::rows(columns<Members...>) const noexcept
+{
+    return row_range<columns<Members...>>(this);
+}
+
 /**
  * @brief SQLITE事务处理管理器
  * 通过database::begin_transaction取得管理器
@@ -293,18 +616,185 @@ public:
         }
 
         auto stmt = stmt_manager(*m_sqlite, sql, false);
-        return stmt.bind(std::forward<decltype(args)>(args)...) ? (stmt.step() == SQLITE_DONE) : false;
+        if (!stmt.bind(std::forward<decltype(args)>(args)...) || stmt.step() != SQLITE_DONE) {
+            //执行失败后sqlite3_finalize会返回该错误，先重置语句，避免析构时终止程序
+            stmt.reset();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 批量执行同一条sql
+     * sql只预准备一次，rows中的每一行（tuple、pair或array）依次绑定、执行并重置
+     * 遇到失败立即返回，是否回滚由调用者决定
+     *
+     * @param rows 行集合
+     * @param rowids 若不为空，则按行顺序写入每行执行后的last_insert_rowid
+     * @return true 全部执行成功
+     * @return false 执行失败
+     */
+    template <class Range>
+    bool bulk_step(std::string_view sql, const Range& rows, std::vector<int64_t>* rowids = nullptr) const noexcept
+    {
+        if (!m_sqlite) {
+            return false;
+        }
+
+        auto stmt = stmt_manager(*m_sqlite, sql, false);
+        if (!stmt) {
+            return false;
+        }
+
+        for (const auto& row : rows) {
+            if (!stmt.bind_tuple(1, row) || stmt.step() != SQLITE_DONE) {
+                //执行失败后sqlite3_finalize会返回该错误，先重置语句，避免析构时终止程序
+                stmt.reset();
+                return false;
+            }
+
+            if (rowids != nullptr) {
+                rowids->push_back(sqlite3_last_insert_rowid(m_sqlite->db));
+            }
+
+            stmt.reset();
+            stmt.clear_bindings();
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief 以多行VALUES批量插入
+     * 将rows按SQLite参数数量上限合并为 head VALUES (?, ...), (?, ...) ... tail 的语句分块执行，
+     * 完整的分块共用同一个预准备语句
+     *
+     * @param head 插入语句头部，例如 "INSERT INTO BasicItems(itemName, itemDescribe)"
+     * @param rows 行集合，每行为列数相同的tuple、pair或array
+     * @param rowids 若不为空，则通过RETURNING取得每块插入的rowid并按升序写入
+     * 由SQLite自动分配的rowid单调递增，此时rowid顺序与行顺序一致；若tail为upsert则仅表示受影响行的集合
+     * @param tail 附加在VALUES之后的子句，例如 "ON CONFLICT(id) DO UPDATE SET ..."
+     * @param max_rows_per_chunk 每块最多合并的行数
+     * @return true 全部执行成功
+     * @return false 执行失败
+     */
+    template <class Range>
+    bool bulk_insert(std::string_view head, const Range& rows, std::vector<int64_t>* rowids = nullptr,
+        std::string_view tail = std::string_view(), size_t max_rows_per_chunk = 512) const noexcept
+    {
+        using row_type = std::decay_t<decltype(*std::begin(rows))>;
+        constexpr size_t columns = std::tuple_size_v<row_type>;
+        static_assert(columns > 0, "bulk_insert requires at least one column");
+
+        if (!m_sqlite) {
+            return false;
+        }
+
+        auto variable_limit = static_cast<size_t>(sqlite3_limit(m_sqlite->db, SQLITE_LIMIT_VARIABLE_NUMBER, -1));
+        auto chunk_rows = std::max<size_t>(1, std::min(max_rows_per_chunk, variable_limit / columns));
+
+        auto make_sql = [&](size_t count) {
+            std::string sql(head);
+            sql.append(" VALUES ");
+            for (size_t i = 0; i < count; ++i) {
+                sql.append(i == 0 ? "(" : ", (");
+                for (size_t j = 0; j < columns; ++j) {
+                    sql.append(j == 0 ? "?" : ", ?");
+                }
+                sql.append(")");
+            }
+            sql.append(" ").append(tail);
+            if (rowids != nullptr) {
+                sql.append(" RETURNING rowid");
+            }
+            return sql;
+        };
+
+        auto execute = [&](const stmt_manager& stmt, auto first, size_t count) {
+            int32_t which = 1;
+            for (size_t i = 0; i < count; ++i, ++first, which += static_cast<int32_t>(columns)) {
+                if (!stmt.bind_tuple(which, *first)) {
+                    return false;
+                }
+            }
+
+            size_t rowid_begin = rowids != nullptr ? rowids->size() : 0;
+            int32_t rc = SQLITE_ROW;
+            while ((rc = stmt.step()) == SQLITE_ROW) {
+                if (rowids != nullptr) {
+                    rowids->push_back(stmt.column_int64(0));
+                }
+            }
+            if (rowids != nullptr) {
+                std::sort(rowids->begin() + rowid_begin, rowids->end());
+            }
+
+            stmt.reset();
+            stmt.clear_bindings();
+            return rc == SQLITE_DONE;
+        };
+
+        auto it = std::begin(rows);
+        auto total = static_cast<size_t>(std::distance(std::begin(rows), std::end(rows)));
+        auto full_chunks = total / chunk_rows;
+
+        if (full_chunks > 0) {
+            auto stmt = stmt_manager(*m_sqlite, make_sql(chunk_rows), false);
+            if (!stmt) {
+                return false;
+            }
+            for (size_t i = 0; i < full_chunks; ++i) {
+                if (!execute(stmt, it, chunk_rows)) {
+                    return false;
+                }
+                std::advance(it, chunk_rows);
+            }
+        }
+
+        if (auto remain = total - full_chunks * chunk_rows; remain > 0) {
+            auto stmt = stmt_manager(*m_sqlite, make_sql(remain), false);
+            if (!stmt || !execute(stmt, it, remain)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief 最近完成的SQL语句更改或插入\删除\更新的数据库行数
+     * @return 若事务无效则返回-1
+     */
+    int32_t changes() const noexcept
+    {
+        return m_sqlite ? sqlite3_changes(m_sqlite->db) : -1;
+    }
+
+    /**
+     * @brief 返回最后一次插入的rowid
+     * @return 若事务无效则返回-1
+     */
+    int64_t last_insert_rowid() const noexcept
+    {
+        return m_sqlite ? sqlite3_last_insert_rowid(m_sqlite->db) : -1;
     }
 
     /**
      * @brief 回滚事务，撤销所作的更改
+     * 回滚成功后事务结束并释放锁
      *
-     * @return true 执行成功
+     * @return true 执行成功或已经处于结束状态
      * @return false 执行失败
      */
-    bool rollback() const noexcept
+    bool rollback() noexcept
     {
-        return this->exec("ROLLBACK");
+        if (this->exec("ROLLBACK")) {
+            m_sqlite->mutex.unlock();
+            m_sqlite = nullptr;
+            return true;
+        }
+
+        return !m_sqlite;
     }
 
     /**
@@ -434,7 +924,43 @@ public:
         std::lock_guard<std::recursive_mutex> lock(m_sqlite->mutex);
 
         auto stmt = stmt_manager(*m_sqlite, sql, false);
-        return stmt.bind(std::forward<decltype(args)>(args)...) ? (stmt.step() == SQLITE_DONE) : false;
+        if (!stmt.bind(std::forward<decltype(args)>(args)...) || stmt.step() != SQLITE_DONE) {
+            //执行失败后sqlite3_finalize会返回该错误，先重置语句，避免析构时终止程序
+            stmt.reset();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 在单个事务中批量执行同一条sql
+     * 参数参照：transaction_manager::bulk_step，失败时回滚整个事务
+     */
+    template <class Range>
+    bool bulk_step(std::string_view sql, const Range& rows, std::vector<int64_t>* rowids = nullptr) const noexcept
+    {
+        auto transaction = this->begin_transaction();
+        if (!transaction || !transaction.bulk_step(sql, rows, rowids)) {
+            transaction.rollback();
+            return false;
+        }
+        return transaction.end_transaction();
+    }
+
+    /**
+     * @brief 在单个事务中以多行VALUES批量插入
+     * 参数参照：transaction_manager::bulk_insert，失败时回滚整个事务
+     */
+    template <class Range>
+    bool bulk_insert(std::string_view head, const Range& rows, std::vector<int64_t>* rowids = nullptr,
+        std::string_view tail = std::string_view(), size_t max_rows_per_chunk = 512) const noexcept
+    {
+        auto transaction = this->begin_transaction();
+        if (!transaction || !transaction.bulk_insert(head, rows, rowids, tail, max_rows_per_chunk)) {
+            transaction.rollback();
+            return false;
+        }
+        return transaction.end_transaction();
     }
 
     /**
@@ -449,6 +975,18 @@ public:
         return sqlite3_changes(m_sqlite->db);
     }
 
+    /**
+     * @brief 此连接打开以来插入\删除\更新的数据库行数总和，不包括其它连接的更改与表结构的更改
+     * @return 若此数据库状态异常则返回-1
+     */
+    int32_t total_changes() const noexcept
+    {
+        if (!m_sqlite || m_sqlite->db_status != status::ok) {
+            return -1;
+        }
+        return sqlite3_total_changes(m_sqlite->db);
+    }
+
     /**
      * @brief 返回最后一次插入的rowid
      * @return 若此数据库状态异常则返回-1
@@ -462,6 +1000,110 @@ public:
         return sqlite3_last_insert_rowid(m_sqlite->db);
     }
 
+    /**
+     * @brief 在线备份到另一个数据库
+     * 基于sqlite3_backup_step，每次只复制pages_per_step页且仅在复制期间持有两端的连接锁，
+     * 每次复制后调用on_step(remaining, page_count)，此时不持有锁，调用者可在其中让出执行；
+     * on_step也可以接受第三个参数int32_t& pages_per_step，修改它即可调整之后每次复制的页数；
+     * 备份完成时以remaining为0调用最后一次，其返回值被忽略
+     * 复制期间源数据库经由本连接发生的修改会自动同步到备份中
+     *
+     * @param destination 目标数据库，其原有内容将被覆盖
+     * @param pages_per_step 每次复制的页数，小于等于0表示一次复制全部
+     * @param on_step 返回false时中止备份
+     * @return true 备份完成
+     * @return false 备份失败或被中止
+     */
+    template <class OnStep>
+    bool backup(const database_manager& destination, int32_t pages_per_step, OnStep&& on_step) const
+    {
+        if (!*this || !destination) {
+            return false;
+        }
+
+        sqlite3_backup* handle = nullptr;
+        {
+            std::scoped_lock lock(m_sqlite->mutex, destination.m_sqlite->mutex);
+            handle = sqlite3_backup_init(destination.m_sqlite->db, "main", m_sqlite->db, "main");
+        }
+        if (handle == nullptr) {
+            return false;
+        }
+
+        auto notify = [&](int32_t remaining, int32_t page_count) -> bool {
+            if constexpr (std::is_invocable_v<OnStep&, int32_t, int32_t, int32_t&>) {
+                return on_step(remaining, page_count, pages_per_step);
+            } else {
+                return on_step(remaining, page_count);
+            }
+        };
+
+        int32_t rc = SQLITE_OK;
+        while (true) {
+            int32_t remaining = 0;
+            int32_t page_count = 0;
+            {
+                std::scoped_lock lock(m_sqlite->mutex, destination.m_sqlite->mutex);
+                rc = sqlite3_backup_step(handle, pages_per_step);
+                remaining = sqlite3_backup_remaining(handle);
+                page_count = sqlite3_backup_pagecount(handle);
+            }
+
+            if (rc == SQLITE_DONE) {
+                notify(0, page_count);
+                break;
+            }
+
+            if ((rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) || !notify(remaining, page_count)) {
+                break;
+            }
+        }
+
+        std::scoped_lock lock(m_sqlite->mutex, destination.m_sqlite->mutex);
+        return sqlite3_backup_finish(handle) == SQLITE_OK && rc == SQLITE_DONE;
+    }
+
+    /**
+     * @brief 在线备份到指定路径的数据库文件
+     * 参数参照：backup(const database_manager&, ...)
+     */
+    template <class OnStep>
+    bool backup(const std::string& path, int32_t pages_per_step, OnStep&& on_step) const
+    {
+        database_manager destination(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        if (!destination) {
+            return false;
+        }
+
+        bool success = this->backup(destination, pages_per_step, std::forward<OnStep>(on_step));
+        return destination.close() && success;
+    }
+
+    /**
+     * @brief 注册跟踪回调
+     * 参数参照：sqlite3_trace_v2，mask为0时取消注册
+     */
+    bool trace(unsigned mask, int (*callback)(unsigned, void*, void*, void*), void* context) const noexcept
+    {
+        if (!m_sqlite || m_sqlite->db_status != status::ok) {
+            return false;
+        }
+        return sqlite3_trace_v2(m_sqlite->db, mask, callback, context) == SQLITE_OK;
+    }
+
+    /**
+     * @brief 取得主数据库文件路径
+     * @return 若为内存数据库或数据库状态异常则返回空字符串
+     */
+    std::string filename() const noexcept
+    {
+        if (!m_sqlite || m_sqlite->db_status != status::ok) {
+            return std::string();
+        }
+        auto name = sqlite3_db_filename(m_sqlite->db, "main");
+        return name ? std::string(name) : std::string();
+    }
+
     /**
      * @brief 查询记录
      */
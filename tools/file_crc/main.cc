@@ -4,49 +4,250 @@
 #include "cppcrc/code_crckrmit.hh"
 #include "cppcrc/code_crcsick.hh"
 
-#include <vector>
-#include <fstream>
+#include "nlohmann/json.hpp"
+#include "thread/thread_pool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace crc;
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        return 0;
-    }
+namespace {
 
-    std::vector<std::pair<Encoder, std::string>> codes = {
-        {Encoder(CodeCrc8::instance()),             "CRC8      " },
-        {Encoder(CodeCrc16::instance()),            "CRC16     " },
-        {Encoder(CodeCrc32::instance()),            "CRC32     " },
-        {Encoder(CodeCrc64::ecmaInstance()),        "CRC64_ECMA" },
-        {Encoder(CodeCrc64::weInstance()),          "CRC64_WE  " },
-        {Encoder(CodeCrcDnp::instance()),           "DNP       " },
-        {Encoder(CodeCrcKrmit::instance()),         "KERMIT    " },
-        {Encoder(CodeCrcSick::instance()),          "SICK      " }
+struct Algorithm {
+    const char* name;
+    CodeBase::ShareConstPtr code;
+};
+
+const std::vector<Algorithm>& algorithms() {
+    static const std::vector<Algorithm> list = {
+        { "CRC8",       CodeCrc8::instance() },
+        { "CRC16",      CodeCrc16::instance() },
+        { "CRC32",      CodeCrc32::instance() },
+        { "CRC64_ECMA", CodeCrc64::ecmaInstance() },
+        { "CRC64_WE",   CodeCrc64::weInstance() },
+        { "DNP",        CodeCrcDnp::instance() },
+        { "KERMIT",     CodeCrcKrmit::instance() },
+        { "SICK",       CodeCrcSick::instance() }
     };
+    return list;
+}
 
-    std::ifstream is(argv[1], std::ios::binary);
+//每个任务处理的块大小
+constexpr size_t kChunkSize = 16 << 20;
+//块内按小段依次交给每个算法，小段留在缓存中，整块只从内存读一遍
+constexpr size_t kBlockSize = 256 << 10;
 
-    uint8_t c = 0;
+/**
+ * @brief 只读映射的输入文件
+ */
+class MappedFile {
+public:
+    ~MappedFile() {
+        if (mData != nullptr) {
+            munmap(mData, mSize);
+        }
+    }
 
-    if (!is) {
-        std::cout << "Unable to open file" << std::endl;
-        return 0;
+    bool open(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            return false;
+        }
+        mSize = static_cast<size_t>(st.st_size);
+        if (mSize > 0) {
+            auto data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                return false;
+            }
+            mData = data;
+            madvise(mData, mSize, MADV_SEQUENTIAL);
+        }
+        close(fd);
+        return true;
+    }
+
+    const uint8_t* data() const {
+        return static_cast<const uint8_t*>(mData);
     }
 
-    while (is.read(reinterpret_cast<char*>(&c), 1)) {
-        for (auto& code : codes) {
-            code.first.update(c);
+    /**
+     * @brief 提示内核预读一段内容
+     * 由计算该块的任务各自调用，预读与计算重叠，不必在映射时读入整个文件
+     */
+    void willNeed(size_t offset, size_t size) const {
+        if (mData == nullptr) {
+            return;
         }
+        static const size_t kPageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        auto begin = offset / kPageSize * kPageSize;
+        madvise(static_cast<uint8_t*>(mData) + begin, offset + size - begin, MADV_WILLNEED);
     }
 
-    is.close();
+    size_t size() const {
+        return mSize;
+    }
+
+private:
+    void* mData = nullptr;
+    size_t mSize = 0;
+};
+
+/**
+ * @brief 计算一个块的所有算法
+ * 除第一块外，编码器需要知道块前的一个字节，之后再与前面的结果合并
+ */
+std::vector<Encoder> hashChunk(const std::vector<Algorithm>& selected, const uint8_t* begin, size_t size, const uint8_t* fileBegin) {
+    std::vector<Encoder> encoders;
+    encoders.reserve(selected.size());
+    for (auto& algorithm : selected) {
+        encoders.emplace_back(algorithm.code);
+        if (begin != fileBegin) {
+            encoders.back().setPreByte(begin[-1]);
+        }
+    }
 
-    for (auto& code : codes) {
-        std::cout << code.second << "\t" << code.first.value() << std::endl;
+    for (size_t offset = 0; offset < size; offset += kBlockSize) {
+        auto length = std::min(kBlockSize, size - offset);
+        for (auto& encoder : encoders) {
+            encoder.update(begin + offset, length);
+        }
     }
+    return encoders;
+}
 
-    return 0;
+/**
+ * @brief 解析--algo参数，名称不区分大小写，以逗号分隔
+ */
+bool selectAlgorithms(const std::string& names, std::vector<Algorithm>& selected) {
+    std::stringstream ss(names);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::toupper(c)); });
+        auto it = std::find_if(algorithms().begin(), algorithms().end(), [&](const Algorithm& algorithm) { return name == algorithm.name; });
+        if (it == algorithms().end()) {
+            std::cout << "Unknown algorithm: " << name << std::endl;
+            return false;
+        }
+        selected.push_back(*it);
+    }
+    return !selected.empty();
+}
+
+void usage() {
+    std::cout << "usage: fcrc [--algo name[,name...]] [--threads n] [--json] <file>" << std::endl;
+    std::cout << "algorithms:";
+    for (auto& algorithm : algorithms()) {
+        std::cout << " " << algorithm.name;
+    }
+    std::cout << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<Algorithm> selected;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    bool json = false;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--algo" && i + 1 < argc) {
+            if (!selectAlgorithms(argv[++i], selected)) {
+                usage();
+                return 1;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--json") {
+            json = true;
+        } else if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path == nullptr) {
+        usage();
+        return 0;
+    }
+    if (selected.empty()) {
+        selected = algorithms();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cout << "Unable to open file" << std::endl;
+        return 1;
+    }
+
+    //各块并行计算，完成后按顺序合并
+    auto chunks = std::max<size_t>(1, (file.size() + kChunkSize - 1) / kChunkSize);
+    std::vector<std::promise<std::vector<Encoder>>> results(chunks);
+    {
+        ThreadPool pool(std::min(threads, chunks));
+        for (size_t i = 0; i < chunks; ++i) {
+            pool.commit([&, i] {
+                auto offset = i * kChunkSize;
+                auto size = std::min(kChunkSize, file.size() - offset);
+                file.willNeed(offset, size);
+                results[i].set_value(hashChunk(selected, file.data() + offset, size, file.data()));
+            });
+        }
 
+        auto encoders = results[0].get_future().get();
+        for (size_t i = 1; i < chunks; ++i) {
+            auto next = results[i].get_future().get();
+            auto size = std::min(kChunkSize, file.size() - i * kChunkSize);
+            for (size_t j = 0; j < encoders.size(); ++j) {
+                encoders[j].combine(next[j], size);
+            }
+        }
+
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        auto gigabytes = static_cast<double>(file.size()) / 1e9;
+
+        if (json) {
+            nlohmann::json output;
+            output["file"] = path;
+            output["size"] = file.size();
+            output["seconds"] = seconds;
+            output["gbps"] = seconds > 0 ? gigabytes / seconds : 0.0;
+            for (size_t j = 0; j < selected.size(); ++j) {
+                output["crc"][selected[j].name] = encoders[j].value();
+            }
+            std::cout << output.dump(4) << std::endl;
+        } else {
+            for (size_t j = 0; j < selected.size(); ++j) {
+                std::printf("%-10s\t%llu\n", selected[j].name, static_cast<unsigned long long>(encoders[j].value()));
+            }
+            std::printf("%zu bytes in %.3f s, %.2f GB/s\n", file.size(), seconds, seconds > 0 ? gigabytes / seconds : 0.0);
+        }
+    }
+
+    return 0;
 }
@@ -0,0 +1,310 @@
+#include "logger/binary_log_format.hpp"
+
+#include "fmt/args.h"
+#include "fmt/format.h"
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace core;
+
+namespace {
+
+const char* kLevelNames[] = { "debug", "info", "warn", "error" };
+
+struct Format {
+    std::string source;
+    std::string format;
+};
+
+struct Entry {
+    int64_t timestamp;
+    uint8_t level;
+    uint32_t id;
+    uint16_t argCount;
+    const char* args;
+    const char* end;
+};
+
+template <typename T>
+bool read(const char*& at, const char* end, T& value)
+{
+    if (end - at < static_cast<std::ptrdiff_t>(sizeof(T))) {
+        return false;
+    }
+    std::memcpy(&value, at, sizeof(T));
+    at += sizeof(T);
+    return true;
+}
+
+/**
+ * @brief 读取一条日志的参数
+ * @return 参数不完整或类型未知时返回false
+ */
+bool readArgs(const Entry& entry, fmt::dynamic_format_arg_store<fmt::format_context>& store, nlohmann::json& json)
+{
+    auto at = entry.args;
+    for (uint16_t i = 0; i < entry.argCount; ++i) {
+        binlog::ArgType type;
+        if (!read(at, entry.end, type)) {
+            return false;
+        }
+
+        switch (type) {
+        case binlog::ArgType::int64: {
+            int64_t value;
+            if (!read(at, entry.end, value)) {
+                return false;
+            }
+            store.push_back(value);
+            json.push_back(value);
+            break;
+        }
+        case binlog::ArgType::uint64: {
+            uint64_t value;
+            if (!read(at, entry.end, value)) {
+                return false;
+            }
+            store.push_back(value);
+            json.push_back(value);
+            break;
+        }
+        case binlog::ArgType::boolean: {
+            uint8_t value;
+            if (!read(at, entry.end, value)) {
+                return false;
+            }
+            store.push_back(value != 0);
+            json.push_back(value != 0);
+            break;
+        }
+        case binlog::ArgType::character: {
+            char value;
+            if (!read(at, entry.end, value)) {
+                return false;
+            }
+            store.push_back(value);
+            json.push_back(std::string(1, value));
+            break;
+        }
+        case binlog::ArgType::float32: {
+            float value;
+            if (!read(at, entry.end, value)) {
+                return false;
+            }
+            store.push_back(value);
+            json.push_back(value);
+            break;
+        }
+        case binlog::ArgType::float64: {
+            double value;
+            if (!read(at, entry.end, value)) {
+                return false;
+            }
+            store.push_back(value);
+            json.push_back(value);
+            break;
+        }
+        case binlog::ArgType::string: {
+            uint32_t length;
+            if (!read(at, entry.end, length) || entry.end - at < static_cast<std::ptrdiff_t>(length)) {
+                return false;
+            }
+            std::string value(at, length);
+            at += length;
+            json.push_back(value);
+            store.push_back(std::move(value));
+            break;
+        }
+        case binlog::ArgType::pointer: {
+            uint64_t value;
+            if (!read(at, entry.end, value)) {
+                return false;
+            }
+            store.push_back(reinterpret_cast<const void*>(value));
+            json.push_back(fmt::format("{:#x}", value));
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string formatTime(int64_t timestamp)
+{
+    auto time = static_cast<std::time_t>(timestamp / 1000000000);
+    std::tm local {};
+    localtime_r(&time, &local);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    return fmt::format("{}.{:03}", text, (timestamp / 1000000) % 1000);
+}
+
+/**
+ * @brief 解码一个段文件
+ * 段内的格式定义先全部读出，日志按时间排序后输出
+ */
+bool decode(const std::string& path, bool json, int minLevel, size_t& count)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << path << ": unable to open file" << std::endl;
+        return false;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    binlog::SegmentHeader header;
+    if (data.size() < sizeof(header)) {
+        std::cerr << path << ": not a log segment" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (!binlog::checkMagic(header) || header.version != binlog::kVersion || header.headerSize < sizeof(header)) {
+        std::cerr << path << ": not a log segment" << std::endl;
+        return false;
+    }
+
+    //未正常关闭的段读到第一条空记录为止
+    auto used = header.used != 0 ? std::min<uint64_t>(header.used, data.size()) : data.size();
+    if (header.used == 0) {
+        std::cerr << path << ": segment was not closed, decoding up to the first empty record" << std::endl;
+    }
+
+    std::unordered_map<uint32_t, Format> formats;
+    std::vector<Entry> entries;
+    size_t offset = header.headerSize;
+    while (offset + sizeof(binlog::RecordHeader) <= used) {
+        binlog::RecordHeader record;
+        std::memcpy(&record, data.data() + offset, sizeof(record));
+        if (record.size < sizeof(record) || offset + record.size > used) {
+            break;
+        }
+
+        const char* at = data.data() + offset + sizeof(record);
+        const char* end = data.data() + offset + record.size;
+        if (record.kind == binlog::RecordKind::format) {
+            binlog::FormatDefinition definition;
+            if (read(at, end, definition) && static_cast<size_t>(end - at) >= size_t(definition.sourceLength) + definition.formatLength) {
+                formats[definition.id] = { std::string(at, definition.sourceLength), std::string(at + definition.sourceLength, definition.formatLength) };
+            }
+        } else if (record.kind == binlog::RecordKind::entry) {
+            binlog::EntryHeader entry;
+            if (read(at, end, entry) && record.level >= minLevel) {
+                entries.push_back({ entry.timestamp, record.level, entry.id, record.argCount, at, end });
+            }
+        }
+        offset += record.size;
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.timestamp < b.timestamp; });
+
+    for (auto& entry : entries) {
+        auto level = entry.level < std::size(kLevelNames) ? kLevelNames[entry.level] : "unknown";
+        fmt::dynamic_format_arg_store<fmt::format_context> store;
+        auto args = nlohmann::json::array();
+        auto valid = readArgs(entry, store, args);
+
+        std::string source, message;
+        auto format = formats.find(entry.id);
+        if (format == formats.end()) {
+            message = fmt::format("<undefined format {}>", entry.id);
+        } else if (!valid) {
+            source = format->second.source;
+            message = fmt::format("<corrupted arguments for '{}'>", format->second.format);
+        } else {
+            source = format->second.source;
+            try {
+                message = fmt::vformat(format->second.format, store);
+            } catch (const fmt::format_error& e) {
+                message = fmt::format("<{}: '{}'>", e.what(), format->second.format);
+            }
+        }
+
+        if (json) {
+            nlohmann::json object;
+            object["timestamp"] = entry.timestamp;
+            object["time"] = formatTime(entry.timestamp);
+            object["level"] = level;
+            object["source"] = source;
+            object["message"] = message;
+            if (format != formats.end()) {
+                object["format"] = format->second.format;
+                object["args"] = std::move(args);
+            }
+            std::cout << object.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << '\n';
+        } else {
+            std::string upper(level);
+            std::transform(upper.begin(), upper.end(), upper.begin(), [](char c) { return static_cast<char>(std::toupper(c)); });
+            if (source.empty()) {
+                fmt::print("{} {:<5} {}\n", formatTime(entry.timestamp), upper, message);
+            } else {
+                fmt::print("{} {:<5} [{}] {}\n", formatTime(entry.timestamp), upper, source, message);
+            }
+        }
+    }
+
+    count += entries.size();
+    return true;
+}
+
+void usage()
+{
+    std::cout << "usage: log_decoder [--json] [--level debug|info|warn|error] <segment>..." << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    bool json = false;
+    int minLevel = 0;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+        } else if (arg == "--level" && i + 1 < argc) {
+            std::string name = argv[++i];
+            auto it = std::find(std::begin(kLevelNames), std::end(kLevelNames), name);
+            if (it == std::end(kLevelNames)) {
+                usage();
+                return 1;
+            }
+            minLevel = static_cast<int>(it - std::begin(kLevelNames));
+        } else if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.empty()) {
+        usage();
+        return 1;
+    }
+
+    //段文件名中的序号补齐了位数，按文件名排序即为写入顺序
+    std::sort(paths.begin(), paths.end());
+
+    bool ok = true;
+    size_t count = 0;
+    for (auto& path : paths) {
+        ok = decode(path, json, minLevel, count) && ok;
+    }
+    std::cout.flush();
+    std::cerr << count << " records" << std::endl;
+    return ok ? 0 : 1;
+}